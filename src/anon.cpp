@@ -21,7 +21,7 @@
 #include <txmempool.h>
 
 
-bool VerifyMLSAG(const CTransaction &tx, CValidationState &state)
+bool VerifyMLSAG(const CTransaction &tx, CValidationState &state, int checks)
 {
     const Consensus::Params &consensus = Params().GetConsensus();
 
@@ -142,7 +142,8 @@ bool VerifyMLSAG(const CTransaction &tx, CValidationState &state)
             vCommitments.push_back(ao.commitment);
             vpInCommits[i+k*nCols] = vCommitments.back().data;
 
-            if (state.m_spend_height - ao.nBlockHeight + 1 < consensus.nMinRCTOutputDepth) {
+            if ((checks & MLSAG_CHECK_INPUTS)
+                && state.m_spend_height - ao.nBlockHeight + 1 < consensus.nMinRCTOutputDepth) {
                 LogPrint(BCLog::RINGCT, "%s: Low input depth %s\n", __func__, state.m_spend_height - ao.nBlockHeight);
                 return state.Invalid(ValidationInvalidReason::TX_PREMATURE_SPEND, false, REJECT_NONSTANDARD, "bad-anonin-depth");
             }
@@ -160,8 +161,13 @@ bool VerifyMLSAG(const CTransaction &tx, CValidationState &state)
                 return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-anonin-dup-ki");
             }
 
+            if (!(checks & MLSAG_CHECK_INPUTS)) {
+                continue;
+            }
+
             if (mempool.HaveKeyImage(ki, txhashKI)
-                && txhashKI != txhash) {
+                && txhashKI != txhash
+                && !state.m_replaced_txids.count(txhashKI)) {
                 if (LogAcceptCategory(BCLog::RINGCT)) {
                     LogPrintf("%s: Duplicate keyimage detected in mempool %s, used in %s.\n", __func__,
                         HexStr(ki.begin(), ki.end()), txhashKI.ToString());
@@ -185,6 +191,9 @@ bool VerifyMLSAG(const CTransaction &tx, CValidationState &state)
                 }
             }
         }
+        if (!(checks & MLSAG_CHECK_SIGNATURES)) {
+            continue;
+        }
         if (0 != (rv = secp256k1_prepare_mlsag(&vM[0], nullptr,
             vpOutCommits.size(), 0, nCols, nRows,
             &vpInCommits[0], &vpOutCommits[0], nullptr))) {
@@ -198,7 +207,7 @@ bool VerifyMLSAG(const CTransaction &tx, CValidationState &state)
     }
 
     // Verify commitment sums match
-    if (fSplitCommitments) {
+    if (fSplitCommitments && (checks & MLSAG_CHECK_SIGNATURES)) {
         std::vector<const uint8_t*> vpOutCommits;
         vpOutCommits.push_back(plainCommitment.data);
 
@@ -267,7 +276,10 @@ bool RemoveKeyImagesFromMempool(const uint256 &hash, const CTxIn &txin, CTxMemPo
 
     for (size_t k = 0; k < nInputs; ++k) {
         const CCmpPubKey &ki = *((CCmpPubKey*)&vKeyImages[k*33]);
-        pool.mapKeyImages.erase(ki);
+        const auto mi = pool.mapKeyImages.find(ki);
+        if (mi != pool.mapKeyImages.end() && mi->second == hash) {
+            pool.mapKeyImages.erase(mi);
+        }
     }
 
     return true;
@@ -389,7 +401,7 @@ bool RewindToCheckpoint(int nCheckPointHeight, int &nBlocks, std::string &sError
         UpdateTip(pindex->pprev, chainparams);
         GetMainSignals().BlockDisconnected(pblock);
     }
-    nLastRCTOutput = ::ChainActive().Tip()->nAnonOutputs;
+    nLastRCTOutput = ::ChainActive().Tip()->Cold().nAnonOutputs;
 
     int nRemoveOutput = nLastRCTOutput+1;
     CAnonOutput ao;
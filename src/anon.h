@@ -28,7 +28,17 @@ const size_t DEFAULT_RING_SIZE = 5;
 const size_t DEFAULT_INPUTS_PER_SIG = 1;
 
 
-bool VerifyMLSAG(const CTransaction &tx, CValidationState &state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+/** Parts of VerifyMLSAG to run
+ *  MLSAG_CHECK_INPUTS must be run with cs_main held, MLSAG_CHECK_SIGNATURES alone only reads the
+ *  rct output index and can run on several threads at once. */
+enum MLSAGChecks
+{
+    MLSAG_CHECK_INPUTS      = (1 << 0), // ring members are deep enough, key images unspent in the chain and mempool
+    MLSAG_CHECK_SIGNATURES  = (1 << 1), // MLSAG signatures and commitment sums
+    MLSAG_CHECK_ALL         = MLSAG_CHECK_INPUTS | MLSAG_CHECK_SIGNATURES,
+};
+
+bool VerifyMLSAG(const CTransaction &tx, CValidationState &state, int checks = MLSAG_CHECK_ALL);
 
 int GetKeyImage(CCmpPubKey &ki, const CCmpPubKey &pubkey, const CKey &key);
 bool AddKeyImagesToMempool(const CTransaction &tx, CTxMemPool &pool);
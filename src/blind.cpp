@@ -24,6 +24,7 @@
 secp256k1_context *secp256k1_ctx_blind = nullptr;
 secp256k1_scratch_space *blind_scratch = nullptr;
 secp256k1_bulletproof_generators *blind_gens = nullptr;
+static thread_local secp256k1_scratch_space *blind_scratch_thread = nullptr;
 
 static CBloomFilter ct_tainted_filter;
 static std::set<uint256> ct_whitelist;
@@ -194,6 +195,24 @@ bool IsWhitelistedAnonOutput(int64_t anon_index)
     return rct_whitelist.count(anon_index);
 }
 
+secp256k1_scratch_space *GetBlindScratch()
+{
+    return blind_scratch_thread ? blind_scratch_thread : blind_scratch;
+}
+
+BlindScratchScope::BlindScratchScope()
+{
+    assert(!blind_scratch_thread);
+    blind_scratch_thread = secp256k1_scratch_space_create(secp256k1_ctx_blind, 1024 * 1024);
+    assert(blind_scratch_thread);
+}
+
+BlindScratchScope::~BlindScratchScope()
+{
+    secp256k1_scratch_space_destroy(blind_scratch_thread);
+    blind_scratch_thread = nullptr;
+}
+
 void ECC_Start_Blinding()
 {
     assert(secp256k1_ctx_blind == nullptr);
@@ -18,6 +18,23 @@ extern secp256k1_context *secp256k1_ctx_blind;
 extern secp256k1_scratch_space *blind_scratch;
 extern secp256k1_bulletproof_generators *blind_gens;
 
+/** Scratch space for verifying bulletproofs on the calling thread. */
+secp256k1_scratch_space *GetBlindScratch();
+
+/**
+ * Gives the calling thread its own bulletproof scratch space while in scope.
+ * Threads verifying proofs alongside validation must hold one, blind_scratch
+ * is only safe to use under cs_main.
+ */
+class BlindScratchScope
+{
+public:
+    BlindScratchScope();
+    ~BlindScratchScope();
+    BlindScratchScope(const BlindScratchScope&) = delete;
+    BlindScratchScope& operator=(const BlindScratchScope&) = delete;
+};
+
 int SelectRangeProofParameters(uint64_t nValueIn, uint64_t &minValue, int &exponent, int &nBits);
 
 int GetRangeProofInfo(const std::vector<uint8_t> &vRangeproof, int &rexp, int &rmantissa, CAmount &min_value, CAmount &max_value);
@@ -0,0 +1,62 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockcompress.h>
+
+#include <crypto/common.h>
+#include <serialize.h>
+#include <tinyformat.h>
+
+#include <lz4/lz4.h>
+#include <xxhash/xxhash.h>
+
+bool CompressDiskRecord(const uint8_t *data, size_t len, std::vector<uint8_t> &payload)
+{
+    if (len == 0 || len > MAX_SIZE) {
+        return false;
+    }
+
+    int bound = LZ4_compressBound(len);
+    payload.resize(DISK_RECORD_HEADER_SIZE + bound);
+    int len_compressed = LZ4_compress_default((const char*)data, (char*)payload.data() + DISK_RECORD_HEADER_SIZE, len, bound);
+    if (len_compressed <= 0 || DISK_RECORD_HEADER_SIZE + len_compressed >= len) {
+        payload.clear();
+        return false;
+    }
+    payload.resize(DISK_RECORD_HEADER_SIZE + len_compressed);
+
+    payload[0] = DISK_RECORD_LZ4;
+    WriteLE32(&payload[1], len);
+    WriteLE64(&payload[5], XXH64(data, len, 0));
+    return true;
+}
+
+bool DecompressDiskRecord(const uint8_t *payload, size_t len, std::vector<uint8_t> &data, std::string &error_str)
+{
+    if (len <= DISK_RECORD_HEADER_SIZE) {
+        error_str = "record too short";
+        return false;
+    }
+    if (payload[0] != DISK_RECORD_LZ4) {
+        error_str = strprintf("unknown record version %d", payload[0]);
+        return false;
+    }
+    uint32_t len_raw = ReadLE32(&payload[1]);
+    if (len_raw > MAX_SIZE) {
+        error_str = "record too large";
+        return false;
+    }
+
+    data.resize(len_raw);
+    int len_compressed = len - DISK_RECORD_HEADER_SIZE;
+    if (LZ4_decompress_safe((const char*)payload + DISK_RECORD_HEADER_SIZE, (char*)data.data(), len_compressed, len_raw) != (int)len_raw) {
+        error_str = "decompression failed";
+        return false;
+    }
+    if (XXH64(data.data(), data.size(), 0) != ReadLE64(&payload[5])) {
+        error_str = "checksum mismatch";
+        return false;
+    }
+    return true;
+}
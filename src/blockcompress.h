@@ -0,0 +1,37 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FALCON_BLOCKCOMPRESS_H
+#define FALCON_BLOCKCOMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+static const bool DEFAULT_COMPRESS_BLOCKS = false;
+
+/**
+ * Set in the size field of a block or undo file record when the payload is
+ * compressed. Plain records can't be larger than MAX_SIZE so never have it set,
+ * which lets old and new records coexist in the same file.
+ */
+static const uint32_t DISK_RECORD_COMPRESSED = 0x80000000;
+
+/** Payload format versions */
+static const uint8_t DISK_RECORD_LZ4 = 1;
+
+/** uint8_t version, uint32_t raw size, uint64_t xxh64 of the raw data */
+static const size_t DISK_RECORD_HEADER_SIZE = 1 + 4 + 8;
+
+/**
+ * Compress serialized block or undo data into a record payload.
+ * Returns false if the data doesn't shrink, it should then be stored plain.
+ */
+bool CompressDiskRecord(const uint8_t *data, size_t len, std::vector<uint8_t> &payload);
+
+/** Decompress a record payload, verifying the checksum of the output. */
+bool DecompressDiskRecord(const uint8_t *payload, size_t len, std::vector<uint8_t> &data, std::string &error_str);
+
+#endif // FALCON_BLOCKCOMPRESS_H
@@ -5,6 +5,58 @@
 
 #include <chain.h>
 
+#include <sync.h>
+#include <util/memory.h>
+
+std::function<bool(const uint256& hash, CBlockIndexCold& cold)> g_load_block_index_cold;
+
+//! Serializes loading the cold fields, readers don't all hold cs_main
+static Mutex g_load_cold_mutex;
+
+bool CBlockIndex::LoadCold() const
+{
+    if (m_cold.get() || !m_cold.on_disk()) {
+        return true;
+    }
+
+    LOCK(g_load_cold_mutex);
+    if (m_cold.get()) {
+        return true;
+    }
+    std::unique_ptr<CBlockIndexCold> loaded = MakeUnique<CBlockIndexCold>();
+    if (!phashBlock || !g_load_block_index_cold || !g_load_block_index_cold(*phashBlock, *loaded)) {
+        return false;
+    }
+    m_cold.reset(loaded.release());
+    return true;
+}
+
+const CBlockIndexCold& CBlockIndex::Cold() const
+{
+    static const CBlockIndexCold cold_null;
+    if (!LoadCold()) {
+        return cold_null;
+    }
+    // Set once and never unloaded after
+    const CBlockIndexCold* cold = m_cold.get();
+    return cold ? *cold : cold_null;
+}
+
+CBlockIndexCold& CBlockIndex::Cold()
+{
+    if (!LoadCold()) {
+        static thread_local CBlockIndexCold cold_unreadable;
+        cold_unreadable = CBlockIndexCold();
+        return cold_unreadable;
+    }
+    CBlockIndexCold* cold = m_cold.get();
+    if (!cold) {
+        // Not under g_load_cold_mutex, entries read by g_load_block_index_cold allocate here
+        cold = m_cold.set_if_null(new CBlockIndexCold());
+    }
+    return *cold;
+}
+
 /**
  * CChain implementation
  */
@@ -13,6 +13,8 @@
 #include <tinyformat.h>
 #include <uint256.h>
 
+#include <atomic>
+#include <functional>
 #include <vector>
 
 enum eBlockFlags
@@ -141,6 +143,75 @@ enum BlockStatus: uint32_t {
     BLOCK_OPT_WITNESS       =   128, //!< block data in blk*.data was received with a witness-enforcing client
 };
 
+/** The block chain is a tree shaped structure starting with the
+ * genesis block at the root, with each block potentially having multiple
+ * candidates to be the next block. A blockindex may have multiple pprev pointing
+ * to it, but at most one of them can be part of the currently active branch.
+ */
+/**
+ * Proof-of-stake and RingCT fields of a block index entry. They are only read
+ * near the tip and by RPC, so entries deep in the chain leave them in the block
+ * tree db until first use, see CBlockIndex::Cold().
+ */
+struct CBlockIndexCold
+{
+    uint256 bnStakeModifier; // hash modifier for proof-of-stake
+    COutPoint prevoutStake;
+    //uint256 hashProof;
+    CAmount nMoneySupply = 0;
+    int64_t nAnonOutputs = 0; // last index
+};
+
+/** Reads the cold fields of a block index entry back from the block tree db, installed by validation */
+extern std::function<bool(const uint256& hash, CBlockIndexCold& cold)> g_load_block_index_cold;
+
+/**
+ * Owning pointer to the cold fields, copies are deep. Null until the fields are
+ * first written, or while they are only on disk.
+ */
+class CBlockIndexColdPtr
+{
+private:
+    std::atomic<CBlockIndexCold*> m_ptr{nullptr};
+    //! Whether a null pointer means the fields are on disk, rather than all zero
+    std::atomic<bool> m_on_disk{false};
+
+public:
+    CBlockIndexColdPtr() {}
+    CBlockIndexColdPtr(const CBlockIndexColdPtr& other)
+    {
+        const CBlockIndexCold* p = other.get();
+        m_ptr = p ? new CBlockIndexCold(*p) : nullptr;
+        m_on_disk = other.on_disk();
+    }
+    CBlockIndexColdPtr& operator=(const CBlockIndexColdPtr& other)
+    {
+        if (this != &other) {
+            const CBlockIndexCold* p = other.get();
+            reset(p ? new CBlockIndexCold(*p) : nullptr);
+            m_on_disk = other.on_disk();
+        }
+        return *this;
+    }
+    ~CBlockIndexColdPtr() { delete m_ptr.load(); }
+
+    CBlockIndexCold* get() const { return m_ptr.load(std::memory_order_acquire); }
+    void reset(CBlockIndexCold* p) { delete m_ptr.exchange(p, std::memory_order_acq_rel); }
+    //! Set p if still null, deleting it otherwise. Returns the pointer set.
+    CBlockIndexCold* set_if_null(CBlockIndexCold* p)
+    {
+        CBlockIndexCold* expected = nullptr;
+        if (!m_ptr.compare_exchange_strong(expected, p, std::memory_order_acq_rel)) {
+            delete p;
+            return expected;
+        }
+        return p;
+    }
+
+    bool on_disk() const { return m_on_disk; }
+    void set_on_disk(bool on_disk) { m_on_disk = on_disk; }
+};
+
 /** The block chain is a tree shaped structure starting with the
  * genesis block at the root, with each block potentially having multiple
  * candidates to be the next block. A blockindex may have multiple pprev pointing
@@ -149,8 +220,7 @@ enum BlockStatus: uint32_t {
 class CBlockIndex
 {
 public:
-    //! pointer to the hash of the block, if any. Memory is owned by this CBlockIndex
-    const uint256* phashBlock;
+    // Fields read while walking the tree are kept together at the front.
 
     //! pointer to the index of the predecessor of this block
     CBlockIndex* pprev;
@@ -158,56 +228,60 @@ public:
     //! pointer to the index of some further predecessor of this block
     CBlockIndex* pskip;
 
-    //! height of the entry in the chain. The genesis block has height 0
-    int nHeight;
+    //! pointer to the hash of the block, if any. Memory is owned by this CBlockIndex
+    const uint256* phashBlock;
 
-    //! Which # file this block is stored in (blk?????.dat)
-    int nFile;
+    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
+    arith_uint256 nChainWork;
 
-    //! Byte offset within blk?????.dat where this block's data is stored
-    unsigned int nDataPos;
+    //! height of the entry in the chain. The genesis block has height 0
+    int nHeight;
 
-    //! Byte offset within rev?????.dat where this block's undo data is stored
-    unsigned int nUndoPos;
+    //! Verification status of this block. See enum BlockStatus
+    uint32_t nStatus;
 
-    //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
-    arith_uint256 nChainWork;
+    //! block header time and difficulty
+    uint32_t nTime;
+    uint32_t nBits;
 
-    //! Number of transactions in this block.
-    //! Note: in a potential headers-first mode, this number cannot be relied upon
-    unsigned int nTx;
+    //! (memory only) Maximum nTime in the chain up to and including this block.
+    unsigned int nTimeMax;
 
     //! (memory only) Number of transactions in the chain up to and including this block.
     //! This value will be non-zero only if and only if transactions for this block and all its parents are available.
     //! Change to 64-bit type when necessary; won't happen before 2030
     unsigned int nChainTx;
 
-
     // proof-of-stake specific fields
     unsigned int nFlags;  // pos: block index flags
-    uint256 bnStakeModifier; // hash modifier for proof-of-stake
-    COutPoint prevoutStake;
-    //uint256 hashProof;
-    CAmount nMoneySupply;
-    int64_t nAnonOutputs; // last index
 
-    //! Verification status of this block. See enum BlockStatus
-    uint32_t nStatus;
+    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
+    int32_t nSequenceId;
 
-    //! block header
+    //! Number of transactions in this block.
+    //! Note: in a potential headers-first mode, this number cannot be relied upon
+    unsigned int nTx;
+
+    //! Which # file this block is stored in (blk?????.dat)
+    int nFile;
+
+    //! Byte offset within blk?????.dat where this block's data is stored
+    unsigned int nDataPos;
+
+    //! Byte offset within rev?????.dat where this block's undo data is stored
+    unsigned int nUndoPos;
+
+    //! rest of the block header, needed to serve headers
     int32_t nVersion;
+    uint32_t nNonce;
     uint256 hashMerkleRoot;
     uint256 hashWitnessMerkleRoot;
-    uint32_t nTime;
-    uint32_t nBits;
-    uint32_t nNonce;
 
-    //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
-    int32_t nSequenceId;
-
-    //! (memory only) Maximum nTime in the chain up to and including this block.
-    unsigned int nTimeMax;
+private:
+    //! proof-of-stake and RingCT fields, see Cold()
+    mutable CBlockIndexColdPtr m_cold;
 
+public:
     void SetNull()
     {
         phashBlock = nullptr;
@@ -225,12 +299,8 @@ public:
         nTimeMax = 0;
 
         nFlags = 0;
-        bnStakeModifier = uint256();
-        prevoutStake.SetNull();
-        //hashProof = uint256();
-
-        nMoneySupply = 0;
-        nAnonOutputs = 0;
+        m_cold.reset(nullptr);
+        m_cold.set_on_disk(false);
 
         nVersion                = 0;
         hashMerkleRoot          = uint256();
@@ -318,6 +388,30 @@ public:
         return GetBlockTime();
     }
 
+    /**
+     * Load the cold fields if they were left on disk. Returns false if they
+     * can't be read, g_load_block_index_cold reports the error.
+     */
+    bool LoadCold() const;
+
+    /**
+     * Proof-of-stake and RingCT fields, loaded on first use if left on disk.
+     * Entries never written read as zero without allocating. If the fields
+     * can't be loaded zeros are returned and writes are dropped, leaving the
+     * entry on disk unchanged.
+     */
+    const CBlockIndexCold& Cold() const;
+    CBlockIndexCold& Cold();
+
+    bool HaveColdLoaded() const { return m_cold.get() != nullptr; }
+
+    //! Leave the cold fields on disk, only valid for entries stored unmodified in the block tree db
+    void UnloadCold()
+    {
+        m_cold.reset(nullptr);
+        m_cold.set_on_disk(true);
+    }
+
     bool IsProofOfStake() const
     {
         return (nFlags & BLOCK_PROOF_OF_STAKE);
@@ -424,11 +518,15 @@ public:
 
 
         READWRITE(nFlags);
-        READWRITE(bnStakeModifier);
-        READWRITE(prevoutStake);
+        if (!ser_action.ForRead() && !LoadCold()) {
+            throw std::ios_base::failure("Cold fields of block index entry not readable");
+        }
+        CBlockIndexCold& cold = Cold();
+        READWRITE(cold.bnStakeModifier);
+        READWRITE(cold.prevoutStake);
         //READWRITE(hashProof);
-        READWRITE(nMoneySupply);
-        READWRITE(nAnonOutputs);
+        READWRITE(cold.nMoneySupply);
+        READWRITE(cold.nAnonOutputs);
 
 
         // block header
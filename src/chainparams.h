@@ -29,6 +29,9 @@ struct CCheckpointData {
     MapCheckpoints mapCheckpoints;
 };
 
+/** Hashes of known good chainstate snapshots, keyed by the hash of the snapshot base block */
+typedef std::map<uint256, uint256> MapSnapshotHashes;
+
 /**
  * Holds various statistics on transactions within a chain. Used to estimate
  * verification progress during chain sync.
@@ -135,6 +138,7 @@ public:
     const std::vector<SeedSpec6>& FixedSeeds() const { return vFixedSeeds; }
     const CCheckpointData& Checkpoints() const { return checkpointData; }
     const ChainTxData& TxData() const { return chainTxData; }
+    const MapSnapshotHashes& SnapshotHashes() const { return mapSnapshotHashes; }
 
     bool IsBech32Prefix(const std::vector<unsigned char> &vchPrefixIn) const;
     bool IsBech32Prefix(const std::vector<unsigned char> &vchPrefixIn, CChainParams::Base58Type &rtype) const;
@@ -148,6 +152,11 @@ public:
         nCoinYearReward = nCoinYearReward_;
     }
     Consensus::Params& GetConsensus_nc() { assert(strNetworkID == "regtest"); return consensus; }
+    void AddSnapshotHash(const uint256 &block_hash, const uint256 &snapshot_hash)
+    {
+        assert(strNetworkID == "regtest");
+        mapSnapshotHashes[block_hash] = snapshot_hash;
+    }
 
 protected:
     CChainParams() {}
@@ -194,6 +203,7 @@ protected:
     bool m_is_test_chain;
     CCheckpointData checkpointData;
     ChainTxData chainTxData;
+    MapSnapshotHashes mapSnapshotHashes;
 };
 
 /**
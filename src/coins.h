@@ -12,6 +12,7 @@
 #include <crypto/siphash.h>
 #include <memusage.h>
 #include <serialize.h>
+#include <support/allocators/pool.h>
 #include <uint256.h>
 
 #include <assert.h>
@@ -31,9 +32,16 @@ extern bool fFalconMode;
  * Serialized format:
  * - VARINT((coinbase ? 1 : 0) | (height << 1))
  * - the non-spent CTxOut (via CTxOutCompressor)
+ * - if fFalconMode:
+ *   - uint8_t nType
+ *   - if nType == OUTPUT_CT: 33 byte commitment
  */
 class Coin
 {
+private:
+    //! amount commitment, only set for OUTPUT_CT coins so plain coins don't carry the 33 bytes
+    std::unique_ptr<secp256k1_pedersen_commitment> m_commitment;
+
 public:
     //! unspent transaction output
     CTxOut out;
@@ -45,12 +53,40 @@ public:
     uint32_t nHeight : 31;
 
     uint8_t nType = OUTPUT_STANDARD;
-    secp256k1_pedersen_commitment commitment;
 
     //! construct a Coin from a CTxOut and height/coinbase information.
     Coin(CTxOut&& outIn, int nHeightIn, bool fCoinBaseIn) : out(std::move(outIn)), fCoinBase(fCoinBaseIn), nHeight(nHeightIn) {}
     Coin(const CTxOut& outIn, int nHeightIn, bool fCoinBaseIn) : out(outIn), fCoinBase(fCoinBaseIn),nHeight(nHeightIn) {}
 
+    Coin(const Coin& other) : out(other.out), fCoinBase(other.fCoinBase), nHeight(other.nHeight), nType(other.nType)
+    {
+        if (other.m_commitment) {
+            m_commitment.reset(new secp256k1_pedersen_commitment(*other.m_commitment));
+        }
+    }
+    Coin(Coin&& other) = default;
+    Coin& operator=(const Coin& other)
+    {
+        if (this != &other) {
+            *this = Coin(other);
+        }
+        return *this;
+    }
+    Coin& operator=(Coin&& other) = default;
+
+    const secp256k1_pedersen_commitment *GetCommitment() const
+    {
+        return m_commitment.get();
+    }
+
+    void SetCommitment(const secp256k1_pedersen_commitment &commitment)
+    {
+        if (!m_commitment) {
+            m_commitment.reset(new secp256k1_pedersen_commitment);
+        }
+        memcpy(m_commitment->data, commitment.data, 33);
+    }
+
     bool Matches(CTxOutBase *txo) const
     {
         if (!txo->IsType(nType)) {
@@ -64,7 +100,7 @@ public:
             return false;
         }
         if (nType == OUTPUT_CT
-            && memcmp(commitment.data, ((CTxOutCT*)txo)->commitment.data, 33) != 0) {
+            && (!m_commitment || memcmp(m_commitment->data, ((CTxOutCT*)txo)->commitment.data, 33) != 0)) {
             return false;
         }
         return true;
@@ -74,6 +110,7 @@ public:
         out.SetNull();
         fCoinBase = false;
         nHeight = 0;
+        m_commitment.reset();
     }
 
     //! empty constructor
@@ -92,8 +129,12 @@ public:
         ::Serialize(s, CTxOutCompressor(REF(out)));
         if (!fFalconMode) return;
         ::Serialize(s, nType);
-        if (nType == OUTPUT_CT)
-            s.write((char*)&commitment.data[0], 33);
+        if (nType == OUTPUT_CT) {
+            if (!m_commitment) {
+                throw std::ios_base::failure("Coin: CT output without commitment");
+            }
+            s.write((char*)&m_commitment->data[0], 33);
+        }
     }
 
     template<typename Stream>
@@ -105,8 +146,14 @@ public:
         ::Unserialize(s, CTxOutCompressor(out));
         if (!fFalconMode) return;
         ::Unserialize(s, nType);
-        if (nType == OUTPUT_CT)
-            s.read((char*)&commitment.data[0], 33);
+        if (nType == OUTPUT_CT) {
+            if (!m_commitment) {
+                m_commitment.reset(new secp256k1_pedersen_commitment);
+            }
+            s.read((char*)&m_commitment->data[0], 33);
+        } else {
+            m_commitment.reset();
+        }
     }
 
     bool IsSpent() const {
@@ -114,7 +161,7 @@ public:
     }
 
     size_t DynamicMemoryUsage() const {
-        return memusage::DynamicUsage(out.scriptPubKey);
+        return memusage::DynamicUsage(out.scriptPubKey) + memusage::DynamicUsage(m_commitment);
     }
 };
 
@@ -164,7 +211,28 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/**
+ * PoolAllocator's MAX_BLOCK_SIZE_BYTES parameter here uses sizeof the data, and adds the size
+ * of 4 pointers. We do not know the exact node size used in the std::unordered_node implementation
+ * because it is implementation defined. Most implementations have an overhead of 1 or 2 pointers,
+ * so nodes can be connected in a linked list, and in some cases the hash value is stored as well.
+ * Using an additional sizeof(void*)*4 for MAX_BLOCK_SIZE_BYTES should thus be sufficient so that
+ * all implementations can allocate the nodes from the PoolAllocator.
+ *
+ * Nodes must stay at a stable address as callers hold references to cached coins across
+ * inserts, which rules out open addressing here; pooling the nodes removes the per entry
+ * malloc overhead instead.
+ */
+typedef std::unordered_map<COutPoint,
+                           CCoinsCacheEntry,
+                           SaltedOutpointHasher,
+                           std::equal_to<COutPoint>,
+                           PoolAllocator<std::pair<const COutPoint, CCoinsCacheEntry>,
+                                         sizeof(std::pair<const COutPoint, CCoinsCacheEntry>) + sizeof(void*) * 4,
+                                         alignof(void*)> >
+    CCoinsMap;
+
+typedef CCoinsMap::allocator_type::ResourceType CCoinsMapMemoryResource;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -255,6 +323,7 @@ public:
      */
     mutable uint256 hashBlock;
     mutable int nBlockHeight = 0;
+    mutable CCoinsMapMemoryResource m_cache_coins_memory_resource{};
     mutable CCoinsMap cacheCoins;
 
     /* Cached dynamic memory usage for the inner Coin objects. */
@@ -376,6 +445,11 @@ public:
     //! Check whether all prevouts of the transaction are present in the UTXO set represented by this view
     bool HaveInputs(const CTransaction& tx) const;
 
+    //! Force a reallocation of the cache map. This is required when downsizing
+    //! the cache because the map's allocator may be hanging onto a lot of
+    //! memory despite having called .clear().
+    void ReallocateCache();
+
 private:
     /**
      * @note this is marked const, but may actually append to `cacheCoins`, increasing
@@ -231,7 +231,8 @@ bool CheckBlindOutput(CValidationState &state, const CTxOutCT *p)
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-ctout-rangeproof-size");
     }
 
-    if ((fBusyImporting) && fSkipRangeproof) {
+    if (state.m_skip_rangeproof
+        || (fBusyImporting && fSkipRangeproof)) {
         return true;
     }
 
@@ -240,7 +241,7 @@ bool CheckBlindOutput(CValidationState &state, const CTxOutCT *p)
 
     if (state.fBulletproofsActive) {
         rv = secp256k1_bulletproof_rangeproof_verify(secp256k1_ctx_blind,
-            blind_scratch, blind_gens, p->vRangeproof.data(), p->vRangeproof.size(),
+            GetBlindScratch(), blind_gens, p->vRangeproof.data(), p->vRangeproof.size(),
             nullptr, &p->commitment, 1, 64, &secp256k1_generator_const_h, nullptr, 0);
     } else {
         rv = secp256k1_rangeproof_verify(secp256k1_ctx_blind, &min_value, &max_value,
@@ -275,7 +276,8 @@ bool CheckAnonOutput(CValidationState &state, const CTxOutRingCT *p)
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-rctout-rangeproof-size");
     }
 
-    if ((fBusyImporting) && fSkipRangeproof) {
+    if (state.m_skip_rangeproof
+        || (fBusyImporting && fSkipRangeproof)) {
         return true;
     }
 
@@ -284,7 +286,7 @@ bool CheckAnonOutput(CValidationState &state, const CTxOutRingCT *p)
 
     if (state.fBulletproofsActive) {
         rv = secp256k1_bulletproof_rangeproof_verify(secp256k1_ctx_blind,
-            blind_scratch, blind_gens, p->vRangeproof.data(), p->vRangeproof.size(),
+            GetBlindScratch(), blind_gens, p->vRangeproof.data(), p->vRangeproof.size(),
             nullptr, &p->commitment, 1, 64, &secp256k1_generator_const_h, nullptr, 0);
     } else {
         rv = secp256k1_rangeproof_verify(secp256k1_ctx_blind, &min_value, &max_value,
@@ -554,7 +556,10 @@ bool Consensus::CheckTxInputs(const CTransaction& tx, CValidationState& state, c
                 nStandard++;
             } else
             if (coin.nType == OUTPUT_CT) {
-                vpCommitsIn.push_back(&coin.commitment);
+                if (!coin.GetCommitment()) {
+                    return state.Error("bad-txns-input-commitment-missing");
+                }
+                vpCommitsIn.push_back(coin.GetCommitment());
                 nCt++;
 
                 if (coin.nHeight <= consensusParams.m_frozen_blinded_height) {
@@ -13,6 +13,8 @@
 class CBlockIndex;
 class CCoinsViewCache;
 class CTransaction;
+class CTxOutCT;
+class CTxOutRingCT;
 class CValidationState;
 
 /** Transaction validation functions */
@@ -74,4 +76,8 @@ bool EvaluateSequenceLocks(const CBlockIndex& block, std::pair<int, int64_t> loc
  */
 bool SequenceLocks(const CTransaction &tx, int flags, std::vector<int>* prevHeights, const CBlockIndex& block);
 
+/** Check the format and range proof of a blinded output. */
+bool CheckBlindOutput(CValidationState &state, const CTxOutCT *p);
+bool CheckAnonOutput(CValidationState &state, const CTxOutRingCT *p);
+
 #endif // BITCOIN_CONSENSUS_TX_VERIFY_H
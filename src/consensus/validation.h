@@ -165,6 +165,8 @@ public:
     bool fBulletproofsActive = false; // per block
     bool rct_active = false; // per block
     int m_spend_height = 0;
+    bool m_skip_rangeproof = false; // per block, set below the assumed valid block
+    bool m_skip_mlsag_signatures = false; // per tx, set when verified ahead of CheckInputs
     bool m_preserve_state = false; // Don't clear error during ActivateBestChain (debug)
 
     // TxValidationState
@@ -179,6 +181,7 @@ public:
     bool m_check_equal_rct_txid = true;
     CAmount tx_balances[6] = {0};
     std::set<CCmpPubKey> m_setHaveKI;
+    std::set<uint256> m_replaced_txids; // per tx, mempool txns a replacement may spend key images of
 
     void SetStateInfo(int64_t time, int spend_height, const Consensus::Params& consensusParams, bool in_block=false)
     {
@@ -0,0 +1,158 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/smsgfundindex.h>
+
+#include <chain.h>
+#include <primitives/block.h>
+#include <util/system.h>
+
+#include <string.h>
+
+constexpr char DB_FUNDED_MSG = 'f';
+
+/** Longest paid message retention plus leeway, older funding can't be used */
+static const int64_t FUNDED_MSG_RETAIN_TIME = 32 * 24 * 60 * 60;
+/** Blocks between removing expired entries */
+static const int FUNDED_MSG_PRUNE_INTERVAL = 100;
+
+std::unique_ptr<SmsgFundIndex> g_smsg_fund_index;
+
+std::vector<std::pair<uint160, uint32_t>> GetSmsgFunding(const CTransaction &tx)
+{
+    std::vector<std::pair<uint160, uint32_t>> funded;
+    for (const auto &v : tx.vpout) {
+        if (!v->IsType(OUTPUT_DATA)) {
+            continue;
+        }
+        const std::vector<uint8_t> &vData = *v->GetPData();
+        if (vData.size() < 25 || vData[0] != DO_FUND_MSG) {
+            continue;
+        }
+
+        size_t n = (vData.size()-1) / 24;
+        for (size_t k = 0; k < n; ++k) {
+            uint160 msg_id;
+            uint32_t amount;
+            memcpy(msg_id.begin(), &vData[1+k*24], 20);
+            memcpy(&amount, &vData[1+k*24+20], 4);
+            funded.emplace_back(msg_id, amount);
+        }
+    }
+    return funded;
+}
+
+SmsgFundIndex::SmsgFundIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "indexes" / "smsgfund", n_cache_size, f_memory, f_wipe))
+{}
+
+bool SmsgFundIndex::Init()
+{
+    {
+        LOCK(m_mutex);
+        m_funded.clear();
+
+        std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+        pcursor->Seek(std::make_pair(DB_FUNDED_MSG, std::make_pair(uint160(), uint256())));
+        for (; pcursor->Valid(); pcursor->Next()) {
+            std::pair<char, std::pair<uint160, uint256>> key;
+            if (!pcursor->GetKey(key) || key.first != DB_FUNDED_MSG) {
+                break;
+            }
+            FundedMsg funded;
+            if (!pcursor->GetValue(funded)) {
+                return error("%s: Failed to read entry for message %s", __func__, key.second.first.ToString());
+            }
+            m_funded.emplace(key.second, funded);
+        }
+        LogPrintf("Loaded %u funded messages from %s\n", m_funded.size(), GetName());
+    }
+
+    return BaseIndex::Init();
+}
+
+bool SmsgFundIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+    LOCK(m_mutex);
+
+    for (const auto &tx : block.vtx) {
+        // Coinstake outputs can't fund messages
+        if (tx->IsCoinStake()) {
+            continue;
+        }
+        for (const auto &entry : GetSmsgFunding(*tx)) {
+            auto key = std::make_pair(entry.first, tx->GetHash());
+            auto it = m_funded.find(key);
+            if (it != m_funded.end() && it->second.block_hash == pindex->GetBlockHash()) {
+                // Funded more than once in the same tx, the smallest amount counts
+                if (entry.second < it->second.amount) {
+                    it->second.amount = entry.second;
+                    batch.Write(std::make_pair(DB_FUNDED_MSG, key), it->second);
+                }
+                continue;
+            }
+            FundedMsg funded;
+            funded.block_hash = pindex->GetBlockHash();
+            funded.block_time = pindex->nTime;
+            funded.amount = entry.second;
+            m_funded[key] = funded;
+            batch.Write(std::make_pair(DB_FUNDED_MSG, key), funded);
+        }
+    }
+
+    if (pindex->nHeight % FUNDED_MSG_PRUNE_INTERVAL == 0) {
+        for (auto it = m_funded.begin(); it != m_funded.end(); ) {
+            if ((int64_t)it->second.block_time + FUNDED_MSG_RETAIN_TIME < pindex->GetBlockTime()) {
+                batch.Erase(std::make_pair(DB_FUNDED_MSG, it->first));
+                it = m_funded.erase(it);
+                continue;
+            }
+            ++it;
+        }
+    }
+
+    return m_db->WriteBatch(batch);
+}
+
+bool SmsgFundIndex::DisconnectBlock(const CBlock& block)
+{
+    const uint256 block_hash = block.GetHash();
+    CDBBatch batch(*m_db);
+    LOCK(m_mutex);
+
+    for (const auto &tx : block.vtx) {
+        if (tx->IsCoinStake()) {
+            continue;
+        }
+        for (const auto &entry : GetSmsgFunding(*tx)) {
+            auto key = std::make_pair(entry.first, tx->GetHash());
+            auto it = m_funded.find(key);
+            if (it == m_funded.end() || it->second.block_hash != block_hash) {
+                continue;
+            }
+            m_funded.erase(it);
+            batch.Erase(std::make_pair(DB_FUNDED_MSG, key));
+        }
+    }
+
+    return m_db->WriteBatch(batch);
+}
+
+bool SmsgFundIndex::FindFunding(const uint160& msg_id, const uint256& txid, FundedMsg& funded) const
+{
+    LOCK(m_mutex);
+    auto it = m_funded.find(std::make_pair(msg_id, txid));
+    if (it == m_funded.end()) {
+        return false;
+    }
+    funded = it->second;
+    return true;
+}
+
+size_t SmsgFundIndex::Size() const
+{
+    LOCK(m_mutex);
+    return m_funded.size();
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FALCON_INDEX_SMSGFUNDINDEX_H
+#define FALCON_INDEX_SMSGFUNDINDEX_H
+
+#include <index/base.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <map>
+#include <vector>
+
+static const bool DEFAULT_SMSGFUNDINDEX = false;
+//! Max memory allocated to the smsg funding index database cache in MiB, entries are also kept in memory
+static const int64_t max_smsg_fund_index_cache = 8;
+
+/** Message ids and amounts funded by the DO_FUND_MSG data outputs of tx */
+std::vector<std::pair<uint160, uint32_t>> GetSmsgFunding(const CTransaction &tx);
+
+/**
+ * SmsgFundIndex maps the ids of paid secure messages to the transaction and
+ * block funding them, so paid messages can be validated without reading the
+ * funding transaction from disk.
+ *
+ * All entries are kept in memory and written to a LevelDB database
+ * (indexes/smsgfund/). Entries for blocks older than the longest paid message
+ * retention are dropped as new blocks are connected.
+ */
+class SmsgFundIndex final : public BaseIndex
+{
+public:
+    struct FundedMsg {
+        uint256 block_hash;
+        uint32_t block_time = 0;
+        uint32_t amount = 0;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action)
+        {
+            READWRITE(block_hash);
+            READWRITE(block_time);
+            READWRITE(amount);
+        }
+    };
+
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+    mutable Mutex m_mutex;
+    //! Keyed by message id and funding txid
+    std::map<std::pair<uint160, uint256>, FundedMsg> m_funded GUARDED_BY(m_mutex);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    bool DisconnectBlock(const CBlock& block) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "smsgfundindex"; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SmsgFundIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the funding of a message, the block may no longer be in the active chain.
+    bool FindFunding(const uint160& msg_id, const uint256& txid, FundedMsg& funded) const;
+
+    size_t Size() const;
+};
+
+/// The global smsg funding index, used to validate paid messages. May be null.
+extern std::unique_ptr<SmsgFundIndex> g_smsg_fund_index;
+
+#endif // FALCON_INDEX_SMSGFUNDINDEX_H
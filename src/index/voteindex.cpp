@@ -0,0 +1,232 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/voteindex.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <primitives/block.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <string.h>
+
+constexpr char DB_BLOCK_VOTE = 'v';
+
+std::unique_ptr<VoteIndex> g_vote_index;
+
+BlockVote GetBlockVote(const CBlock &block)
+{
+    BlockVote vote;
+    if (block.vtx.size() < 1 || !block.vtx[0]->IsCoinStake()
+        || block.vtx[0]->vpout.size() < 1) {
+        return vote;
+    }
+    vote.staked = true;
+
+    const std::vector<uint8_t> *vData = block.vtx[0]->vpout[0]->GetPData();
+    if (vData && vData->size() >= 9 && (*vData)[4] == DO_VOTE) {
+        memcpy(&vote.token, &(*vData)[5], 4);
+    }
+    return vote;
+}
+
+bool CountBlockVote(const BlockVote& vote, int proposal, std::map<int, int>& votes)
+{
+    if (!vote.staked) {
+        return false;
+    }
+    // Count only if related to proposal, default to abstain
+    int option = (int)(vote.token & 0xFFFF) == proposal ? (vote.token >> 16) & 0xFFFF : 0;
+    votes[option]++;
+    return true;
+}
+
+int TallyBlockVotes(int proposal, int height_start, int height_end, std::map<int, int>& votes)
+{
+    votes.clear();
+
+    const Consensus::Params& consensus_params = Params().GetConsensus();
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    if (pindex && pindex->nHeight > height_end) {
+        pindex = pindex->GetAncestor(height_end);
+    }
+
+    int blocks = 0;
+    CBlock block;
+    for (; pindex && pindex->nHeight >= height_start; pindex = pindex->pprev) {
+        if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+            continue;
+        }
+        if (CountBlockVote(GetBlockVote(block), proposal, votes)) {
+            blocks++;
+        }
+    }
+    return blocks;
+}
+
+VoteIndex::VoteIndex(size_t n_cache_size, bool f_memory, bool f_wipe)
+    : m_db(MakeUnique<BaseIndex::DB>(GetDataDir() / "indexes" / "vote", n_cache_size, f_memory, f_wipe))
+{}
+
+void VoteIndex::AppendVote(const BlockVote& vote)
+{
+    const int height = m_votes.size();
+    m_votes.push_back(vote);
+    m_staked_below.push_back(m_staked_below.back() + (vote.staked ? 1 : 0));
+
+    const uint16_t option = vote.token >> 16;
+    if (vote.staked && option != 0) {
+        m_option_heights[std::make_pair((uint16_t)(vote.token & 0xFFFF), option)].push_back(height);
+    }
+}
+
+void VoteIndex::TruncateVotes(int height, CDBBatch& batch)
+{
+    while ((int)m_votes.size() > height) {
+        const int top = m_votes.size() - 1;
+        const BlockVote& vote = m_votes.back();
+        const uint16_t option = vote.token >> 16;
+        if (vote.staked && option != 0) {
+            auto it = m_option_heights.find(std::make_pair((uint16_t)(vote.token & 0xFFFF), option));
+            assert(it != m_option_heights.end() && it->second.back() == top);
+            it->second.pop_back();
+            if (it->second.empty()) {
+                m_option_heights.erase(it);
+            }
+        }
+        batch.Erase(std::make_pair(DB_BLOCK_VOTE, top));
+        m_votes.pop_back();
+        m_staked_below.pop_back();
+    }
+}
+
+bool VoteIndex::Init()
+{
+    {
+        LOCK(m_mutex);
+        m_votes.clear();
+        m_staked_below.assign(1, 0);
+        m_option_heights.clear();
+
+        std::vector<std::pair<int, BlockVote>> entries;
+        std::unique_ptr<CDBIterator> pcursor(m_db->NewIterator());
+        pcursor->Seek(std::make_pair(DB_BLOCK_VOTE, 0));
+        for (; pcursor->Valid(); pcursor->Next()) {
+            std::pair<char, int> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_VOTE) {
+                break;
+            }
+            BlockVote vote;
+            if (!pcursor->GetValue(vote)) {
+                return error("%s: Failed to read entry for height %d", __func__, key.second);
+            }
+            entries.emplace_back(key.second, vote);
+        }
+
+        // Heights aren't stored in order, entries above a gap are rewritten when synced
+        std::sort(entries.begin(), entries.end(), [](const std::pair<int, BlockVote>& a, const std::pair<int, BlockVote>& b) {
+            return a.first < b.first;
+        });
+        for (const auto& entry : entries) {
+            if (entry.first != (int)m_votes.size()) {
+                break;
+            }
+            AppendVote(entry.second);
+        }
+        LogPrintf("Loaded votes of %u blocks from %s\n", m_votes.size(), GetName());
+    }
+
+    return BaseIndex::Init();
+}
+
+bool VoteIndex::WriteBlock(const CBlock& block, const CBlockIndex* pindex)
+{
+    CDBBatch batch(*m_db);
+    LOCK(m_mutex);
+
+    // Entries from this height up belong to a chain the index has left
+    TruncateVotes(pindex->nHeight, batch);
+    if ((int)m_votes.size() != pindex->nHeight) {
+        return error("%s: Missing votes below height %d", __func__, pindex->nHeight);
+    }
+
+    BlockVote vote = GetBlockVote(block);
+    AppendVote(vote);
+    batch.Write(std::make_pair(DB_BLOCK_VOTE, pindex->nHeight), vote);
+
+    return m_db->WriteBatch(batch);
+}
+
+bool VoteIndex::DisconnectBlock(const CBlock& block)
+{
+    const CBlockIndex* pindex = WITH_LOCK(cs_main, return LookupBlockIndex(block.GetHash()));
+    if (!pindex) {
+        return false;
+    }
+
+    CDBBatch batch(*m_db);
+    LOCK(m_mutex);
+    TruncateVotes(pindex->nHeight, batch);
+
+    return m_db->WriteBatch(batch);
+}
+
+bool VoteIndex::Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip)
+{
+    assert(current_tip->GetAncestor(new_tip->nHeight) == new_tip);
+
+    CDBBatch batch(*m_db);
+    {
+        LOCK(m_mutex);
+        TruncateVotes(new_tip->nHeight + 1, batch);
+    }
+    if (!m_db->WriteBatch(batch)) return false;
+
+    return BaseIndex::Rewind(current_tip, new_tip);
+}
+
+int VoteIndex::TallyVotes(int proposal, int height_start, int height_end, std::map<int, int>& votes) const
+{
+    votes.clear();
+
+    // Entries above the best block may be left from before a restart, until overwritten
+    const CBlockIndex* best_block_index = m_best_block_index.load();
+    if (!best_block_index) {
+        return 0;
+    }
+    height_end = std::min(height_end, best_block_index->nHeight);
+    height_start = std::max(height_start, 0);
+
+    LOCK(m_mutex);
+    height_end = std::min(height_end, (int)m_votes.size() - 1);
+    if (height_start > height_end) {
+        return 0;
+    }
+
+    int blocks = m_staked_below[height_end + 1] - m_staked_below[height_start];
+    int abstain = blocks;
+    for (auto it = m_option_heights.lower_bound(std::make_pair((uint16_t)proposal, (uint16_t)0));
+         it != m_option_heights.end() && it->first.first == proposal; ++it) {
+        const std::vector<int>& heights = it->second;
+        int count = std::upper_bound(heights.begin(), heights.end(), height_end)
+                  - std::lower_bound(heights.begin(), heights.end(), height_start);
+        if (count > 0) {
+            votes[it->first.second] = count;
+            abstain -= count;
+        }
+    }
+    if (abstain > 0) {
+        votes[0] = abstain;
+    }
+
+    return blocks;
+}
+
+size_t VoteIndex::Size() const
+{
+    LOCK(m_mutex);
+    return m_votes.size();
+}
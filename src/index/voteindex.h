@@ -0,0 +1,95 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FALCON_INDEX_VOTEINDEX_H
+#define FALCON_INDEX_VOTEINDEX_H
+
+#include <index/base.h>
+#include <sync.h>
+
+#include <map>
+#include <vector>
+
+static const bool DEFAULT_VOTEINDEX = false;
+//! Max memory allocated to the vote index database cache in MiB, entries are also kept in memory
+static const int64_t max_vote_index_cache = 8;
+
+/** The vote cast by the coinstake of a block */
+struct BlockVote
+{
+    bool staked = false;  // block has a coinstake, only these are counted
+    uint32_t token = 0;   // proposal in the low 16 bits, option in the high 16 bits, 0 if not voting
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(staked);
+        READWRITE(token);
+    }
+};
+
+/** Vote read from the DO_VOTE data output of the coinstake of block */
+BlockVote GetBlockVote(const CBlock &block);
+
+/** Add the option vote is cast for to votes, 0 if it isn't for proposal. Returns false if vote is not counted */
+bool CountBlockVote(const BlockVote& vote, int proposal, std::map<int, int>& votes);
+
+/** Tally the votes like VoteIndex::TallyVotes, reading the blocks of the active chain from disk */
+int TallyBlockVotes(int proposal, int height_start, int height_end, std::map<int, int>& votes);
+
+/**
+ * VoteIndex keeps the vote cast by the coinstake of each block of the active
+ * chain, so votes can be tallied without reading the blocks from disk.
+ *
+ * All entries are kept in memory and written to a LevelDB database
+ * (indexes/vote/). Running counts of staked blocks and the heights voting for
+ * each proposal option make tallying any height range O(log n).
+ */
+class VoteIndex final : public BaseIndex
+{
+private:
+    const std::unique_ptr<BaseIndex::DB> m_db;
+
+    mutable Mutex m_mutex;
+    //! Vote of the block at each height
+    std::vector<BlockVote> m_votes GUARDED_BY(m_mutex);
+    //! Number of staked blocks below each height, one entry more than m_votes
+    std::vector<int> m_staked_below GUARDED_BY(m_mutex){0};
+    //! Heights voting for each (proposal, option) in ascending order, abstaining votes are not kept
+    std::map<std::pair<uint16_t, uint16_t>, std::vector<int>> m_option_heights GUARDED_BY(m_mutex);
+
+    void AppendVote(const BlockVote& vote) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    /// Drop the entries from height up, erasing them from the database with batch.
+    void TruncateVotes(int height, CDBBatch& batch) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+protected:
+    bool Init() override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+    bool DisconnectBlock(const CBlock& block) override;
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return "voteindex"; }
+
+    friend struct VoteIndexTest;
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit VoteIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Tally the votes for proposal cast by the staked blocks from height_start to height_end inclusive.
+    /// Fills votes with the count per option, option 0 counts abstaining blocks. Returns the number of blocks counted.
+    int TallyVotes(int proposal, int height_start, int height_end, std::map<int, int>& votes) const;
+
+    size_t Size() const;
+};
+
+/// The global vote index, used by tallyvotes. May be null.
+extern std::unique_ptr<VoteIndex> g_vote_index;
+
+#endif // FALCON_INDEX_VOTEINDEX_H
@@ -21,7 +21,9 @@
 #include <httprpc.h>
 #include <httpserver.h>
 #include <index/blockfilterindex.h>
+#include <index/smsgfundindex.h>
 #include <index/txindex.h>
+#include <index/voteindex.h>
 #include <interfaces/chain.h>
 #include <key.h>
 #include <miner.h>
@@ -54,10 +56,12 @@
 #include <validation.h>
 #include <validationinterface.h>
 #include <blind.h>
+#include <blockcompress.h>
 #include <smsg/smessage.h>
 #include <smsg/rpcsmessage.h>
 #include <insight/rpc.h>
 #include <pos/miner.h>
+#include <proofverifier.h>
 #include <core_io.h>
 #ifdef ENABLE_WALLET
 #include <wallet/hdwallet.h>
@@ -92,6 +96,7 @@
 #endif
 
 #include <insight/insight.h>
+#include <insight/blocktimeindex.h>
 
 static bool fFeeEstimatesInitialized = false;
 static const bool DEFAULT_PROXYRANDOMIZE = true;
@@ -259,6 +264,15 @@ void Interrupt()
         g_txindex->Interrupt();
     }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Interrupt(); });
+    if (g_smsg_fund_index) {
+        g_smsg_fund_index->Interrupt();
+    }
+    if (g_vote_index) {
+        g_vote_index->Interrupt();
+    }
+    if (g_proof_verifier) {
+        g_proof_verifier->Interrupt();
+    }
 }
 
 void Shutdown(InitInterfaces& interfaces)
@@ -292,6 +306,7 @@ void Shutdown(InitInterfaces& interfaces)
     // Because these depend on each-other, we make sure that neither can be
     // using the other before destroying them.
     if (peerLogic) UnregisterValidationInterface(peerLogic.get());
+    if (g_block_template_manager) UnregisterValidationInterface(g_block_template_manager.get());
     if (g_connman) g_connman->Stop();
 
     StopTorControl();
@@ -304,6 +319,7 @@ void Shutdown(InitInterfaces& interfaces)
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
     peerLogic.reset();
+    g_block_template_manager.reset();
     g_connman.reset();
     g_banman.reset();
 
@@ -345,6 +361,18 @@ void Shutdown(InitInterfaces& interfaces)
     }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
+    if (g_smsg_fund_index) {
+        g_smsg_fund_index->Stop();
+        g_smsg_fund_index.reset();
+    }
+    if (g_vote_index) {
+        g_vote_index->Stop();
+        g_vote_index.reset();
+    }
+    if (g_proof_verifier) {
+        g_proof_verifier->Stop();
+        g_proof_verifier.reset();
+    }
 
     // Any future callbacks will be dropped. This should absolutely be safe - if
     // missing a callback results in an unrecoverable situation, unclean shutdown
@@ -477,6 +505,7 @@ void SetupServerArgs()
 #endif
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Transactions from the wallet, RPC and relay whitelisted inbound peers are not affected. (default: %u)", DEFAULT_BLOCKSONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-compressblocks", strprintf("Store new blocks and undo data LZ4 compressed. Files written with this set can't be read by older versions (default: %u)", DEFAULT_COMPRESS_BLOCKS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
@@ -489,7 +518,7 @@ void SetupServerArgs()
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
-    gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+    gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads, also used to check blocks on -reindex and -loadblock (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -499,12 +528,14 @@ void SetupServerArgs()
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-skiprangeproofverify", "Skip verifying rangeproofs when reindexing or importing.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-checkskippedproofs", strprintf("Re-verify range proofs and MLSAGs skipped below the assumed valid block or with -skiprangeproofverify in the background, after the initial sync (default: %u)", DEFAULT_CHECK_SKIPPED_PROOFS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #else
     hidden_args.emplace_back("-sysperms");
 #endif
     gArgs.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-voteindex", strprintf("Maintain an index of the votes cast by coinstakes, used by the tallyvotes rpc call (default: %u)", DEFAULT_VOTEINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockfilterindex=<type>",
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
@@ -541,6 +572,8 @@ void SetupServerArgs()
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msghandthreads=<n>", strprintf("Number of threads processing peer messages, each peer's messages are processed in order by one thread at a time (1 to %d, default: %d)", MAX_MSGHAND_THREADS, DEFAULT_MSGHAND_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-netmsgstats", strprintf("Collect per command message processing times and peer queue depths, reported by getnetmsgstats and /rest/netmsgstats (default: %u)", DEFAULT_NET_MSG_STATS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -549,6 +582,11 @@ void SetupServerArgs()
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+#ifdef USE_EPOLL
+    gArgs.AddArg("-socketthreads=<n>", strprintf("Number of threads servicing peer sockets with -useepoll, connections are shared out between them (1 to %d, default: %d)", MAX_SOCKET_THREADS, DEFAULT_SOCKET_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+#else
+    hidden_args.emplace_back("-socketthreads=<n>");
+#endif
     gArgs.AddArg("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), true, OptionsCategory::CONNECTION);
     gArgs.AddArg("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -561,6 +599,11 @@ void SetupServerArgs()
 #endif
 #else
     hidden_args.emplace_back("-upnp");
+#endif
+#ifdef USE_EPOLL
+    gArgs.AddArg("-useepoll", strprintf("Service peer sockets from edge triggered epoll sets instead of polling all of them on every pass (default: %u)", DEFAULT_USE_EPOLL), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+#else
+    hidden_args.emplace_back("-useepoll");
 #endif
     gArgs.AddArg("-whitebind=<[permissions@]addr>", "Bind to given address and whitelist peers connecting to it. "
         "Use [host]:port notation for IPv6. Allowed permissions are bloomfilter (allow requesting BIP37 filtered blocks and transactions), "
@@ -825,18 +868,7 @@ static void ThreadImport(std::vector<fs::path> vImportFiles)
 
     // -reindex
     if (fReindex) {
-        int nFile = 0;
-        while (true) {
-            FlatFilePos pos(nFile, 0);
-            if (!fs::exists(GetBlockPosFilename(pos)))
-                break; // No block files left to reindex
-            FILE *file = OpenBlockFile(pos, true);
-            if (!file)
-                break; // This error is logged in OpenBlockFile
-            LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
-            LoadExternalBlockFile(chainparams, file, &pos);
-            nFile++;
-        }
+        ReindexBlockFiles(chainparams);
         pblocktree->WriteReindexing(false);
         fReindex = false;
         LogPrintf("Reindexing finished\n");
@@ -1140,6 +1172,12 @@ bool AppInitParameterInteraction()
         if (!g_enabled_filter_types.empty()) {
             return InitError(_("Prune mode is incompatible with -blockfilterindex.").translated);
         }
+        if (gArgs.GetBoolArg("-smsgfundindex", DEFAULT_SMSGFUNDINDEX)) {
+            return InitError(_("Prune mode is incompatible with -smsgfundindex.").translated);
+        }
+        if (gArgs.GetBoolArg("-voteindex", DEFAULT_VOTEINDEX)) {
+            return InitError(_("Prune mode is incompatible with -voteindex.").translated);
+        }
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1199,6 +1237,7 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fCompressBlocks = gArgs.GetBoolArg("-compressblocks", DEFAULT_COMPRESS_BLOCKS);
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1515,6 +1554,10 @@ bool AppInitMain(InitInterfaces& interfaces)
     peerLogic.reset(new PeerLogicValidation(g_connman.get(), g_banman.get(), scheduler, gArgs.GetBoolArg("-enablebip61", DEFAULT_ENABLE_BIP61)));
     RegisterValidationInterface(peerLogic.get());
 
+    assert(!g_block_template_manager);
+    g_block_template_manager = MakeUnique<BlockTemplateManager>(chainparams);
+    RegisterValidationInterface(g_block_template_manager.get());
+
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
     for (const std::string& cmt : gArgs.GetArgs("-uacomment")) {
@@ -1619,6 +1662,8 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     fReindex = gArgs.GetBoolArg("-reindex", false);
     fSkipRangeproof = gArgs.GetBoolArg("-skiprangeproofverify", false);
+    // Skipped proofs are recorded even when not re-verified, so -checkskippedproofs can be enabled later
+    g_proof_verifier = MakeUnique<CProofVerifier>();
     bool fReindexChainState = gArgs.GetBoolArg("-reindex-chainstate", false);
 
     fs::path blocksDir = GetDataDir() / "blocks";
@@ -1658,6 +1703,10 @@ bool AppInitMain(InitInterfaces& interfaces)
         filter_index_cache = max_cache / n_indexes;
         nTotalCache -= filter_index_cache * n_indexes;
     }
+    int64_t smsg_fund_index_cache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-smsgfundindex", DEFAULT_SMSGFUNDINDEX) ? max_smsg_fund_index_cache << 20 : 0);
+    nTotalCache -= smsg_fund_index_cache;
+    int64_t vote_index_cache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-voteindex", DEFAULT_VOTEINDEX) ? max_vote_index_cache << 20 : 0);
+    nTotalCache -= vote_index_cache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1673,6 +1722,12 @@ bool AppInitMain(InitInterfaces& interfaces)
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   filter_index_cache * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
     }
+    if (gArgs.GetBoolArg("-smsgfundindex", DEFAULT_SMSGFUNDINDEX)) {
+        LogPrintf("* Using %.1f MiB for smsg funding index database\n", smsg_fund_index_cache * (1.0 / 1024 / 1024));
+    }
+    if (gArgs.GetBoolArg("-voteindex", DEFAULT_VOTEINDEX)) {
+        LogPrintf("* Using %.1f MiB for vote index database\n", vote_index_cache * (1.0 / 1024 / 1024));
+    }
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1732,6 +1787,15 @@ bool AppInitMain(InitInterfaces& interfaces)
                     return InitError(_("Incorrect or no genesis block found. Wrong datadir for network?").translated);
                 }
 
+                // Indices built from the full blockchain can't be used, checked before the index states as -reindex won't help
+                if (fSnapshotChainstate && (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) || !g_enabled_filter_types.empty()
+                    || gArgs.GetBoolArg("-smsgfundindex", DEFAULT_SMSGFUNDINDEX) || gArgs.GetBoolArg("-voteindex", DEFAULT_VOTEINDEX)
+                    || gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)
+                    || gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX) || gArgs.GetBoolArg("-balancesindex", DEFAULT_BALANCESINDEX))) {
+                    strLoadError = _("The chainstate was loaded from a snapshot, -txindex, -blockfilterindex, -smsgfundindex, -voteindex and the insight indices need the full blockchain").translated;
+                    break;
+                }
+
                 // Check for changed index states
                 if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
                     strLoadError = _("You need to rebuild the database using -reindex to change -addressindex").translated;
@@ -1752,7 +1816,7 @@ bool AppInitMain(InitInterfaces& interfaces)
 
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
-                if (fHavePruned && !fPruneMode) {
+                if (fHavePruned && !fPruneMode && !fSnapshotChainstate) {
                     strLoadError = _("You need to rebuild the database using -reindex to go back to unpruned mode.  This will redownload the entire blockchain").translated;
                     break;
                 }
@@ -1857,6 +1921,12 @@ bool AppInitMain(InitInterfaces& interfaces)
                 break;
             }
 
+            if (fTimestampIndex) {
+                LOCK(cs_main);
+                g_block_time_index.Init();
+                LogPrintf("Block time index: %.1fMiB\n", g_block_time_index.DynamicMemoryUsage() * (1.0 / (1<<20)));
+            }
+
             fLoaded = true;
             LogPrintf(" block index %15dms\n", GetTimeMillis() - load_block_index_start_time);
         } while(false);
@@ -1928,6 +1998,20 @@ bool AppInitMain(InitInterfaces& interfaces)
         GetBlockFilterIndex(filter_type)->Start();
     }
 
+    if (gArgs.GetBoolArg("-smsgfundindex", DEFAULT_SMSGFUNDINDEX)) {
+        g_smsg_fund_index = MakeUnique<SmsgFundIndex>(smsg_fund_index_cache, false, fReindex);
+        g_smsg_fund_index->Start();
+    }
+
+    if (gArgs.GetBoolArg("-voteindex", DEFAULT_VOTEINDEX)) {
+        g_vote_index = MakeUnique<VoteIndex>(vote_index_cache, false, fReindex);
+        g_vote_index->Start();
+    }
+
+    if (gArgs.GetBoolArg("-checkskippedproofs", DEFAULT_CHECK_SKIPPED_PROOFS)) {
+        g_proof_verifier->Start();
+    }
+
     // ********************************************************* Step 9: load wallet
     for (const auto& client : interfaces.chain_clients) {
         if (!client->load()) {
@@ -1947,6 +2031,10 @@ bool AppInitMain(InitInterfaces& interfaces)
             ::ChainstateActive().PruneAndFlush();
         }
     }
+    if (fSnapshotChainstate && !fPruneMode) {
+        LogPrintf("Unsetting NODE_NETWORK, blocks below the snapshot base are not available\n");
+        nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK);
+    }
 
     if (chainparams.GetConsensus().SegwitHeight != std::numeric_limits<int>::max()) {
         // Advertise witness capabilities.
@@ -2054,6 +2142,10 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.m_msghand_threads = gArgs.GetArg("-msghandthreads", DEFAULT_MSGHAND_THREADS);
+    connOptions.m_socket_threads = gArgs.GetArg("-socketthreads", DEFAULT_SOCKET_THREADS);
+    connOptions.m_use_epoll = gArgs.GetBoolArg("-useepoll", DEFAULT_USE_EPOLL);
+    connOptions.m_msg_stats = gArgs.GetBoolArg("-netmsgstats", DEFAULT_NET_MSG_STATS);
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
@@ -0,0 +1,168 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <insight/blocktimeindex.h>
+
+#include <chain.h>
+#include <memusage.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <cassert>
+
+CBlockTimeIndex g_block_time_index;
+
+void CBlockTimeIndex::PushBack(const CBlockIndex *pindex)
+{
+    assert(pindex->nHeight == (int)m_by_height.size());
+    EraseStale(pindex);
+    m_by_height.push_back(pindex);
+
+    TimeEntry entry{pindex->nTime, pindex->nHeight};
+    if (m_by_time.empty() || m_by_time.back() < entry) {
+        m_by_time.push_back(entry);
+        return;
+    }
+    m_by_time.insert(std::upper_bound(m_by_time.begin(), m_by_time.end(), entry), entry);
+}
+
+void CBlockTimeIndex::PopBack()
+{
+    assert(!m_by_height.empty());
+    const CBlockIndex *pindex = m_by_height.back();
+    m_by_height.pop_back();
+
+    TimeEntry entry{pindex->nTime, pindex->nHeight};
+    if (!m_by_time.empty()
+        && m_by_time.back().nTime == entry.nTime && m_by_time.back().nHeight == entry.nHeight) {
+        m_by_time.pop_back();
+    } else {
+        auto it = std::lower_bound(m_by_time.begin(), m_by_time.end(), entry);
+        assert(it != m_by_time.end() && it->nHeight == entry.nHeight);
+        m_by_time.erase(it);
+    }
+
+    m_stale.emplace(pindex->nTime, pindex);
+}
+
+void CBlockTimeIndex::EraseStale(const CBlockIndex *pindex)
+{
+    auto range = m_stale.equal_range(pindex->nTime);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == pindex) {
+            m_stale.erase(it);
+            return;
+        }
+    }
+}
+
+void CBlockTimeIndex::Init()
+{
+    AssertLockHeld(cs_main);
+    const CBlockIndex *pindex_tip = ::ChainActive().Tip();
+
+    LOCK(m_mutex);
+    m_by_height.clear();
+    m_by_time.clear();
+    m_stale.clear();
+
+    if (pindex_tip) {
+        m_by_height.resize(pindex_tip->nHeight + 1);
+        m_by_time.reserve(pindex_tip->nHeight + 1);
+        for (const CBlockIndex *pindex = pindex_tip; pindex; pindex = pindex->pprev) {
+            m_by_height[pindex->nHeight] = pindex;
+            m_by_time.push_back(TimeEntry{pindex->nTime, pindex->nHeight});
+        }
+        std::sort(m_by_time.begin(), m_by_time.end());
+    }
+
+    // Blocks which passed ConnectBlock but are no longer in the active chain
+    for (const auto &item : ::BlockIndex()) {
+        const CBlockIndex *pindex = item.second;
+        if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)
+            || (pindex->nHeight < (int)m_by_height.size() && m_by_height[pindex->nHeight] == pindex)) {
+            continue;
+        }
+        m_stale.emplace(pindex->nTime, pindex);
+    }
+    m_initialised = true;
+}
+
+void CBlockTimeIndex::Clear()
+{
+    LOCK(m_mutex);
+    m_initialised = false;
+    m_by_height.clear();
+    m_by_height.shrink_to_fit();
+    m_by_time.clear();
+    m_by_time.shrink_to_fit();
+    m_stale.clear();
+}
+
+void CBlockTimeIndex::SetTip(const CBlockIndex *pindex_new)
+{
+    LOCK(m_mutex);
+    if (!m_initialised) {
+        return;
+    }
+
+    int nHeight = pindex_new ? pindex_new->nHeight : -1;
+    while ((int)m_by_height.size() > nHeight + 1) {
+        PopBack();
+    }
+
+    // Walk back to the fork point, then connect forwards
+    std::vector<const CBlockIndex*> connect;
+    for (const CBlockIndex *pindex = pindex_new; pindex; pindex = pindex->pprev) {
+        if (pindex->nHeight < (int)m_by_height.size()) {
+            if (m_by_height[pindex->nHeight] == pindex) {
+                break;
+            }
+            while ((int)m_by_height.size() > pindex->nHeight) {
+                PopBack();
+            }
+        }
+        connect.push_back(pindex);
+    }
+
+    for (auto it = connect.rbegin(); it != connect.rend(); ++it) {
+        PushBack(*it);
+    }
+}
+
+bool CBlockTimeIndex::GetBlockHashes(unsigned int high, unsigned int low, bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) const
+{
+    LOCK(m_mutex);
+    if (!m_initialised) {
+        return false;
+    }
+
+    size_t num_before = hashes.size();
+    auto it = std::lower_bound(m_by_time.begin(), m_by_time.end(), TimeEntry{low, -1});
+    for (; it != m_by_time.end() && it->nTime < high; ++it) {
+        hashes.emplace_back(m_by_height[it->nHeight]->GetBlockHash(), it->nTime);
+    }
+
+    if (!fActiveOnly) {
+        size_t num_active = hashes.size();
+        for (auto its = m_stale.lower_bound(low); its != m_stale.end() && its->first < high; ++its) {
+            hashes.emplace_back(its->second->GetBlockHash(), its->first);
+        }
+        if (hashes.size() > num_active) {
+            std::inplace_merge(hashes.begin() + num_before, hashes.begin() + num_active, hashes.end(),
+                [](const std::pair<uint256, unsigned int> &a, const std::pair<uint256, unsigned int> &b) {
+                    return a.second < b.second;
+                });
+        }
+    }
+
+    return true;
+}
+
+size_t CBlockTimeIndex::DynamicMemoryUsage() const
+{
+    LOCK(m_mutex);
+    return memusage::DynamicUsage(m_by_height) + memusage::DynamicUsage(m_by_time)
+        + memusage::MallocUsage(sizeof(memusage::stl_tree_node<std::pair<const uint32_t, const CBlockIndex*> >)) * m_stale.size();
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INSIGHT_BLOCKTIMEINDEX_H
+#define BITCOIN_INSIGHT_BLOCKTIMEINDEX_H
+
+#include <sync.h>
+#include <threadsafety.h>
+#include <uint256.h>
+
+#include <map>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+class CBlockIndex;
+
+extern CCriticalSection cs_main;
+
+/**
+ * In-memory time -> height index over the active chain.
+ *
+ * Block times are not strictly monotonic, so entries are kept in a vector
+ * sorted by (time, height). New tips almost always land at the end, making
+ * connect and disconnect amortised O(1), and range queries O(log n + k).
+ * Blocks that were connected once and then reorganised away are kept in a
+ * small side map so queries that include orphans match the on-disk index.
+ *
+ * The index is updated from UpdateTip() under cs_main, but has its own lock
+ * so readers do not need cs_main.
+ */
+class CBlockTimeIndex
+{
+private:
+    struct TimeEntry {
+        uint32_t nTime;
+        int32_t nHeight;
+        bool operator<(const TimeEntry &b) const
+        {
+            return nTime < b.nTime || (nTime == b.nTime && nHeight < b.nHeight);
+        }
+    };
+
+    mutable Mutex m_mutex;
+    bool m_initialised GUARDED_BY(m_mutex) = false;
+    std::vector<const CBlockIndex*> m_by_height GUARDED_BY(m_mutex);
+    std::vector<TimeEntry> m_by_time GUARDED_BY(m_mutex);
+    std::multimap<uint32_t, const CBlockIndex*> m_stale GUARDED_BY(m_mutex);
+
+    void PushBack(const CBlockIndex *pindex) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void PopBack() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void EraseStale(const CBlockIndex *pindex) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    /** Build the index from the active chain and block index. */
+    void Init() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /** Drop all entries and stop tracking the chain. */
+    void Clear();
+
+    /** Follow the active chain to a new tip, rewinding past any fork point. */
+    void SetTip(const CBlockIndex *pindex_new);
+
+    /**
+     * Get blocks with low <= time < high, ordered by time.
+     * If fActiveOnly is false blocks which have been disconnected are included.
+     */
+    bool GetBlockHashes(unsigned int high, unsigned int low, bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) const;
+
+    size_t DynamicMemoryUsage() const;
+};
+
+extern CBlockTimeIndex g_block_time_index;
+
+#endif // BITCOIN_INSIGHT_BLOCKTIMEINDEX_H
@@ -6,6 +6,7 @@
 #include <insight/addressindex.h>
 #include <insight/spentindex.h>
 #include <insight/timestampindex.h>
+#include <insight/blocktimeindex.h>
 #include <validation.h>
 #include <txdb.h>
 #include <txmempool.h>
@@ -80,7 +81,7 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const
     if (!fTimestampIndex) {
         return error("Timestamp index not enabled");
     }
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes)) {
+    if (!g_block_time_index.GetBlockHashes(high, low, fActiveOnly, hashes)) {
         return error("Unable to get hashes for timestamps");
     }
 
@@ -56,7 +56,7 @@ class LockImpl : public Chain::Lock, public UniqueLock<CCriticalSection>
     }
     size_t getAnonOutputs() override
     {
-        return ::ChainActive().Tip()->nAnonOutputs;
+        return ::ChainActive().Tip()->Cold().nAnonOutputs;
     }
 
     Optional<int> getBlockHeight(const uint256& hash) override
@@ -88,6 +88,37 @@ void BlockAssembler::resetBlock()
     nFees = 0;
 }
 
+/** Create the coinbase and fill in the header of a template holding the selected transactions,
+ *  vTxFees[0] must hold the negated total fees. */
+static void FinishBlock(CBlockTemplate& tmpl, const CScript& scriptPubKeyIn, bool fTestBlockValidity, const CBlockIndex* pindexPrev, const CChainParams& chainparams)
+{
+    CBlock* pblock = &tmpl.block;
+    const int nHeight = pindexPrev->nHeight + 1;
+
+    // Create coinbase transaction.
+    CMutableTransaction coinbaseTx;
+    if (!fTestBlockValidity) {
+        pblock->nVersion = FALCON_BLOCK_VERSION;
+        pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    } else {
+        coinbaseTx.vin.resize(1);
+        coinbaseTx.vin[0].prevout.SetNull();
+        coinbaseTx.vout.resize(1);
+        coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
+        coinbaseTx.vout[0].nValue = -tmpl.vTxFees[0] + GetBlockSubsidy(nHeight, chainparams.GetConsensus());
+        coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
+        pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+        tmpl.vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, chainparams.GetConsensus());
+    }
+
+    // Fill in header
+    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
+    UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
+    pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
+    pblock->nNonce         = 0;
+    tmpl.vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
+}
+
 Optional<int64_t> BlockAssembler::m_last_block_num_txs{nullopt};
 Optional<int64_t> BlockAssembler::m_last_block_weight{nullopt};
 
@@ -105,6 +136,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     // Add dummy coinbase tx as first transaction
     pblock->vtx.emplace_back();
+    pblock->vPrevalidated.push_back(false);
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOpsCost.push_back(-1); // updated at end
 
@@ -147,34 +179,14 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     m_last_block_num_txs = nBlockTx;
     m_last_block_weight = nBlockWeight;
 
-    // Create coinbase transaction.
-    CMutableTransaction coinbaseTx;
-    if (!fTestBlockValidity) {
-        pblock->nVersion = FALCON_BLOCK_VERSION;
-        pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
-    } else {
-        coinbaseTx.vin.resize(1);
-        coinbaseTx.vin[0].prevout.SetNull();
-        coinbaseTx.vout.resize(1);
-        coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
-        coinbaseTx.vout[0].nValue = nFees + GetBlockSubsidy(nHeight, chainparams.GetConsensus());
-        coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
-        pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
-        pblocktemplate->vchCoinbaseCommitment = GenerateCoinbaseCommitment(*pblock, pindexPrev, chainparams.GetConsensus());
-    }
     pblocktemplate->vTxFees[0] = -nFees;
+    FinishBlock(*pblocktemplate, scriptPubKeyIn, fTestBlockValidity, pindexPrev, chainparams);
 
     //LogPrintf("CreateNewBlock(): block weight: %u txs: %u fees: %ld sigops %d\n", GetBlockWeight(*pblock), nBlockTx, nFees, nBlockSigOpsCost);
     uint64_t nSerializeSize = GetSerializeSize(*pblock, PROTOCOL_VERSION);
     LogPrint(BCLog::POS, "CreateNewBlock(): total size: %u block weight: %u txs: %u fees: %ld sigops %d\n", nSerializeSize, GetBlockWeight(*pblock), nBlockTx, nFees, nBlockSigOpsCost);
     nLastBlockSize = nSerializeSize + 238 + 70; // Reserve bytes for coinstake txn and block signature
 
-    // Fill in header
-    pblock->hashPrevBlock  = pindexPrev->GetBlockHash();
-    UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev);
-    pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus());
-    pblock->nNonce         = 0;
-    pblocktemplate->vTxSigOpsCost[0] = WITNESS_SCALE_FACTOR * GetLegacySigOpCount(*pblock->vtx[0]);
     CValidationState state;
 
     if (fTestBlockValidity
@@ -229,6 +241,7 @@ bool BlockAssembler::TestPackageTransactions(const CTxMemPool::setEntries& packa
 void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
 {
     pblock->vtx.emplace_back(iter->GetSharedTx());
+    pblock->vPrevalidated.push_back(true);
     pblocktemplate->vTxFees.push_back(iter->GetFee());
     pblocktemplate->vTxSigOpsCost.push_back(iter->GetSigOpCost());
     nBlockWeight += iter->GetTxWeight();
@@ -456,3 +469,164 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
+
+std::unique_ptr<BlockTemplateManager> g_block_template_manager;
+
+BlockTemplateManager::BlockTemplateManager(const CChainParams& params) : chainparams(params)
+{
+    BlockAssembler::Options options = DefaultOptions();
+    blockMinFeeRate = options.blockMinFeeRate;
+    nBlockMaxWeight = std::max<size_t>(4000, std::min<size_t>(MAX_BLOCK_WEIGHT - 4000, options.nBlockMaxWeight));
+}
+
+bool BlockTemplateManager::Rebuild()
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_mutex);
+
+    m_included.clear();
+    m_template = BlockAssembler(chainparams).CreateNewBlock(CScript(), false);
+    if (!m_template) {
+        return false;
+    }
+
+    const CBlockIndex* pindexPrev = ::ChainActive().Tip();
+    m_height = pindexPrev->nHeight + 1;
+    m_lock_time_cutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                         ? pindexPrev->GetMedianTimePast()
+                         : m_template->block.GetBlockTime();
+    m_include_witness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus());
+
+    // Same reservation for the coinbase as BlockAssembler::resetBlock
+    m_block_weight = 4000;
+    m_block_sigops_cost = 400;
+    const CBlock& block = m_template->block;
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        m_included.insert(block.vtx[i]->GetHash());
+        m_block_weight += GetTransactionWeight(*block.vtx[i]);
+        m_block_sigops_cost += m_template->vTxSigOpsCost[i];
+    }
+
+    m_time_built = GetTime();
+    m_stale = false;
+    m_missed = false;
+    return true;
+}
+
+std::unique_ptr<CBlockTemplate> BlockTemplateManager::GetBlockTemplate(const CScript& scriptPubKeyIn, bool fTestBlockValidity)
+{
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+
+    LOCK(cs_main);
+    CBlockIndex* pindexPrev = ::ChainActive().Tip();
+    assert(pindexPrev != nullptr);
+    {
+        LOCK(m_mutex);
+        if (m_stale || !m_template
+            || m_template->block.hashPrevBlock != pindexPrev->GetBlockHash()
+            || (m_missed && GetTime() - m_time_built > BLOCK_TEMPLATE_MAX_AGE)) {
+            int64_t nTimeStart = GetTimeMicros();
+            if (!Rebuild()) {
+                return nullptr;
+            }
+            LogPrint(BCLog::BENCH, "%s: rebuilt template, %u txs: %.2fms\n", __func__, m_included.size(), 0.001 * (GetTimeMicros() - nTimeStart));
+        }
+        pblocktemplate = MakeUnique<CBlockTemplate>(*m_template);
+    }
+
+    CBlock* pblock = &pblocktemplate->block;
+    if (fTestBlockValidity) {
+        pblock->nVersion = ComputeBlockVersion(pindexPrev, chainparams.GetConsensus());
+        if (chainparams.MineBlocksOnDemand())
+            pblock->nVersion = gArgs.GetArg("-blockversion", pblock->nVersion);
+    }
+    FinishBlock(*pblocktemplate, scriptPubKeyIn, fTestBlockValidity, pindexPrev, chainparams);
+
+    CValidationState state;
+    if (fTestBlockValidity
+        && !TestBlockValidity(state, chainparams, *pblock, pindexPrev, false, false)) {
+        WITH_LOCK(m_mutex, m_stale = true);
+        throw std::runtime_error(strprintf("%s: TestBlockValidity failed: %s", __func__, FormatStateMessage(state)));
+    }
+
+    return pblocktemplate;
+}
+
+void BlockTemplateManager::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    LOCK(m_mutex);
+    m_stale = true;
+}
+
+void BlockTemplateManager::TransactionAddedToMempool(const CTransactionRef &ptx)
+{
+    CAmount nFee, nModifiedFee;
+    size_t nTxSize;
+    int64_t nTxWeight, nSigOpsCost;
+    uint64_t nCountWithAncestors;
+
+    // The mempool entry is checked against the tip it was accepted on, which
+    // may be ahead of the template until UpdatedBlockTip is delivered
+    LOCK(cs_main);
+    const CBlockIndex* pindexTip = ::ChainActive().Tip();
+    if (!pindexTip) {
+        return;
+    }
+    {
+        // Not held with m_mutex, Rebuild locks mempool.cs after m_mutex
+        LOCK(mempool.cs);
+        CTxMemPool::txiter it = mempool.mapTx.find(ptx->GetHash());
+        if (it == mempool.mapTx.end()) {
+            return;
+        }
+        nCountWithAncestors = it->GetCountWithAncestors();
+        nFee = it->GetFee();
+        nModifiedFee = it->GetModifiedFee();
+        nTxSize = it->GetTxSize();
+        nTxWeight = it->GetTxWeight();
+        nSigOpsCost = it->GetSigOpCost();
+    }
+
+    LOCK(m_mutex);
+    if (m_stale || !m_template || m_included.count(ptx->GetHash())) {
+        return;
+    }
+    if (m_template->block.hashPrevBlock != pindexTip->GetBlockHash()) {
+        m_stale = true;
+        return;
+    }
+    if (nCountWithAncestors > 1 // depends on unconfirmed transactions
+        || nModifiedFee < blockMinFeeRate.GetFee(nTxSize)
+        || m_block_weight + nTxWeight >= nBlockMaxWeight
+        || m_block_sigops_cost + nSigOpsCost >= MAX_BLOCK_SIGOPS_COST) {
+        m_missed = true;
+        return;
+    }
+    if (!IsFinalTx(*ptx, m_height, m_lock_time_cutoff)
+        || (!m_include_witness && ptx->HasWitness())) {
+        return;
+    }
+
+    m_template->block.vtx.push_back(ptx);
+    m_template->block.vPrevalidated.push_back(true);
+    m_template->vTxFees.push_back(nFee);
+    m_template->vTxSigOpsCost.push_back(nSigOpsCost);
+    m_template->vTxFees[0] -= nFee;
+    m_block_weight += nTxWeight;
+    m_block_sigops_cost += nSigOpsCost;
+    m_included.insert(ptx->GetHash());
+
+    // Stats as CreateNewBlock leaves them, for getmininginfo and getstakinginfo
+    nLastBlockTx = m_template->block.vtx.size() - 1;
+    nLastBlockSize += ::GetSerializeSize(*ptx, PROTOCOL_VERSION);
+    BlockAssembler::m_last_block_num_txs = nLastBlockTx;
+    BlockAssembler::m_last_block_weight = m_block_weight;
+}
+
+void BlockTemplateManager::TransactionRemovedFromMempool(const CTransactionRef &ptx)
+{
+    LOCK(m_mutex);
+    if (m_included.count(ptx->GetHash())) {
+        m_stale = true;
+    }
+}
@@ -8,10 +8,13 @@
 
 #include <optional.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <txmempool.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 #include <memory>
+#include <set>
 #include <stdint.h>
 
 #include <boost/multi_index_container.hpp>
@@ -24,6 +27,8 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Seconds after which a template that missed mempool transactions is rebuilt */
+static const int64_t BLOCK_TEMPLATE_MAX_AGE = 60;
 
 struct CBlockTemplate
 {
@@ -198,6 +203,46 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
 };
 
+/** Keep the body of the next block ready for the stake threads and getblocktemplate.
+ *  Transactions entering the mempool without unconfirmed parents are appended to the
+ *  shared template as they arrive. A new tip, or the removal of an included
+ *  transaction, rebuilds the template with BlockAssembler on the next request.
+ */
+class BlockTemplateManager final : public CValidationInterface
+{
+public:
+    explicit BlockTemplateManager(const CChainParams& params);
+
+    /** Return a copy of the shared template with coinbase and header filled in as CreateNewBlock would */
+    std::unique_ptr<CBlockTemplate> GetBlockTemplate(const CScript& scriptPubKeyIn, bool fTestBlockValidity=true);
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    void TransactionAddedToMempool(const CTransactionRef &ptx) override;
+    void TransactionRemovedFromMempool(const CTransactionRef &ptx) override;
+
+private:
+    bool Rebuild() EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mutex);
+
+    const CChainParams& chainparams;
+    unsigned int nBlockMaxWeight;
+    CFeeRate blockMinFeeRate;
+
+    Mutex m_mutex;
+    std::unique_ptr<CBlockTemplate> m_template GUARDED_BY(m_mutex);
+    std::set<uint256> m_included GUARDED_BY(m_mutex);
+    uint64_t m_block_weight GUARDED_BY(m_mutex) = 0;
+    int64_t m_block_sigops_cost GUARDED_BY(m_mutex) = 0;
+    int m_height GUARDED_BY(m_mutex) = 0;
+    int64_t m_lock_time_cutoff GUARDED_BY(m_mutex) = 0;
+    bool m_include_witness GUARDED_BY(m_mutex) = false;
+    int64_t m_time_built GUARDED_BY(m_mutex) = 0;
+    bool m_stale GUARDED_BY(m_mutex) = true;  // must be rebuilt before use
+    bool m_missed GUARDED_BY(m_mutex) = false; // skipped mempool transactions, rebuild after BLOCK_TEMPLATE_MAX_AGE
+};
+
+extern std::unique_ptr<BlockTemplateManager> g_block_template_manager;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
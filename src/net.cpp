@@ -27,12 +27,17 @@
 #include <string.h>
 #else
 #include <fcntl.h>
+#include <sys/uio.h>
 #endif
 
 #ifdef USE_POLL
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -53,6 +58,21 @@ static constexpr int DUMP_PEERS_INTERVAL = 15 * 60;
 /** Number of DNS seeds to query when the number of connections is low. */
 static constexpr int DNSSEEDS_TO_QUERY_AT_ONCE = 3;
 
+/** Maximum number of queued send buffers written with one sendmsg() call. */
+static constexpr size_t MAX_SEND_IOV = 64;
+
+/** Size of the buffer each recv() call reads into. */
+static constexpr size_t SOCKET_RECV_BUFFER_SIZE = 0x10000;
+
+#ifdef USE_EPOLL
+/** Maximum number of events taken from an epoll set per wait. */
+static constexpr int MAX_EPOLL_EVENTS = 256;
+/** Maximum number of full reads from one peer per pass, the rest is read on the next pass. */
+static constexpr int MAX_EPOLL_RECV_PER_PASS = 4;
+/** Tags epoll events of listening sockets, node events carry the node id. */
+static constexpr uint64_t EPOLL_LISTEN_SOCKET = uint64_t{1} << 63;
+#endif
+
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
@@ -530,12 +550,22 @@ void CNode::copyStats(CNodeStats &stats)
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgCmd);
         X(nSendBytes);
+        X(nPeakSendSize);
+        X(nSendStalls);
     }
     {
         LOCK(cs_vRecv);
         X(mapRecvBytesPerMsgCmd);
         X(nRecvBytes);
     }
+    {
+        LOCK(cs_vProcessMsg);
+        X(nPeakProcessQueueSize);
+    }
+    {
+        LOCK(cs_procStats);
+        X(mapProcStatsPerMsgCmd);
+    }
     X(m_legacyWhitelisted);
     X(m_permissionFlags);
     if (m_tx_relay != nullptr) {
@@ -567,6 +597,38 @@ void CNode::copyStats(CNodeStats &stats)
 }
 #undef X
 
+void CNetMsgProcStats::Add(int64_t nMicros, uint64_t nBytesIn)
+{
+    nCount++;
+    nBytes += nBytesIn;
+    nTotalMicros += nMicros;
+    nMaxMicros = std::max(nMaxMicros, nMicros);
+    vBuckets[std::min<uint64_t>(CountBits(std::max<int64_t>(nMicros, 0)), NET_MSG_TIME_BUCKETS - 1)]++;
+}
+
+void CNetMsgProcStats::Merge(const CNetMsgProcStats& other)
+{
+    nCount += other.nCount;
+    nBytes += other.nBytes;
+    nTotalMicros += other.nTotalMicros;
+    nMaxMicros = std::max(nMaxMicros, other.nMaxMicros);
+    for (int i = 0; i < NET_MSG_TIME_BUCKETS; ++i) {
+        vBuckets[i] += other.vBuckets[i];
+    }
+}
+
+void CNode::RecordMsgProcessTime(const std::string& command, uint64_t nBytes, int64_t nMicros)
+{
+    LOCK(cs_procStats);
+    auto it = mapProcStatsPerMsgCmd.find(command);
+    if (it == mapProcStatsPerMsgCmd.end()) {
+        // Commands without a receive byte counter are lumped together, as in mapRecvBytesPerMsgCmd
+        bool fKnown = WITH_LOCK(cs_vRecv, return mapRecvBytesPerMsgCmd.count(command) > 0);
+        it = mapProcStatsPerMsgCmd.emplace(fKnown ? command : NET_MESSAGE_COMMAND_OTHER, CNetMsgProcStats()).first;
+    }
+    it->second.Add(nMicros, nBytes);
+}
+
 bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete)
 {
     complete = false;
@@ -707,27 +769,54 @@ size_t CConnman::SocketSendData(CNode *pnode) const EXCLUSIVE_LOCKS_REQUIRED(pno
     size_t nSentSize = 0;
 
     while (it != pnode->vSendMsg.end()) {
-        const auto &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert(it->size() > pnode->nSendOffset);
         int nBytes = 0;
+        size_t nAttempted = 0;
         {
             LOCK(pnode->cs_hSocket);
             if (pnode->hSocket == INVALID_SOCKET)
                 break;
-            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(data.data()) + pnode->nSendOffset, data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#ifdef WIN32
+            nAttempted = it->size() - pnode->nSendOffset;
+            nBytes = send(pnode->hSocket, reinterpret_cast<const char*>(it->data()) + pnode->nSendOffset, nAttempted, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+            // Gather the queued buffers into a single syscall
+            struct iovec iov[MAX_SEND_IOV];
+            size_t nIov = 0;
+            for (auto it_iov = it; it_iov != pnode->vSendMsg.end() && nIov < MAX_SEND_IOV; ++it_iov, ++nIov) {
+                size_t nOffset = nIov == 0 ? pnode->nSendOffset : 0;
+                iov[nIov].iov_base = const_cast<unsigned char*>(it_iov->data()) + nOffset;
+                iov[nIov].iov_len = it_iov->size() - nOffset;
+                nAttempted += iov[nIov].iov_len;
+            }
+            struct msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = nIov;
+            nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         }
         if (nBytes > 0) {
             pnode->nLastSend = GetSystemTimeInSeconds();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (pnode->nSendOffset == data.size()) {
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                size_t nLeft = it->size() - pnode->nSendOffset;
+                if (nRemaining < nLeft) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+                nRemaining -= nLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
-                pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+                pnode->nSendSize -= it->size();
                 it++;
-            } else {
-                // could not send full message; stop sending more
+            }
+            pnode->fPauseSend = pnode->nSendSize > nSendBufferMaxSize;
+            if ((size_t)nBytes < nAttempted) {
+                // could not send everything; stop sending more
+                if (m_msg_stats) {
+                    pnode->nSendStalls++;
+                }
                 break;
             }
         } else {
@@ -1285,6 +1374,65 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+int CConnman::SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[SOCKET_RECV_BUFFER_SIZE];
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return 0;
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                if (m_msg_stats) {
+                    pnode->nPeakProcessQueueSize = std::max(pnode->nPeakProcessQueueSize, pnode->nProcessQueueSize);
+                }
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler();
+        }
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return nBytes;
+}
+
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
@@ -1334,57 +1482,7 @@ void CConnman::SocketHandler()
         }
         if (recvSet || errorSet)
         {
-            // typical socket buffer is 8K-64K
-            char pchBuf[0x10000];
-            int nBytes = 0;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-            }
-            if (nBytes > 0)
-            {
-                bool notify = false;
-                if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                    pnode->CloseSocketDisconnect();
-                RecordBytesRecv(nBytes);
-                if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        if (!it->complete())
-                            break;
-                        nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
-                    WakeMessageHandler();
-                }
-            }
-            else if (nBytes == 0)
-            {
-                // socket closed gracefully
-                if (!pnode->fDisconnect) {
-                    LogPrint(BCLog::NET, "socket closed\n");
-                }
-                pnode->CloseSocketDisconnect();
-            }
-            else if (nBytes < 0)
-            {
-                // error
-                int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                {
-                    if (!pnode->fDisconnect)
-                        LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                    pnode->CloseSocketDisconnect();
-                }
-            }
+            SocketRecvData(pnode);
         }
 
         //
@@ -1418,13 +1516,161 @@ void CConnman::ThreadSocketHandler()
     }
 }
 
+#ifdef USE_EPOLL
+bool CConnman::EpollAddNode(int epoll_fd, CNode *pnode)
+{
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return false;
+    struct epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.u64 = pnode->GetId();
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, pnode->hSocket, &ev) != 0) {
+        LogPrintf("%s: Failed to watch socket of peer=%d: %s\n", __func__, pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        pnode->CloseSocketDisconnect();
+        return false;
+    }
+    // Edges from before the socket was watched are lost, try both directions once
+    pnode->m_sock_registered = true;
+    pnode->m_sock_recv_ready = true;
+    pnode->m_sock_send_ready = true;
+    return true;
+}
+
+void CConnman::EpollNodeEvents(CNode *pnode, uint32_t events)
+{
+    if (events & (EPOLLIN | EPOLLRDHUP))
+        pnode->m_sock_recv_ready = true;
+    if (events & EPOLLOUT)
+        pnode->m_sock_send_ready = true;
+    if (events & (EPOLLERR | EPOLLHUP))
+        pnode->m_sock_error = true;
+}
+
+bool CConnman::EpollNodeHasWork(CNode *pnode)
+{
+    bool fSendPending = WITH_LOCK(pnode->cs_vSend, return !pnode->vSendMsg.empty());
+    return pnode->m_sock_error ||
+        (fSendPending ? pnode->m_sock_send_ready : (pnode->m_sock_recv_ready && !pnode->fPauseRecv));
+}
+
+void CConnman::EpollServiceNode(CNode *pnode)
+{
+    // As with select(), drain pending sends before receiving more
+    bool fSendPending = WITH_LOCK(pnode->cs_vSend, return !pnode->vSendMsg.empty());
+    if (pnode->m_sock_error || (!fSendPending && pnode->m_sock_recv_ready && !pnode->fPauseRecv))
+    {
+        // No new edge arrives until the socket is drained, a short read means it is
+        pnode->m_sock_error = false;
+        for (int k = 0; k < MAX_EPOLL_RECV_PER_PASS; ++k) {
+            if (SocketRecvData(pnode) < (int)SOCKET_RECV_BUFFER_SIZE) {
+                pnode->m_sock_recv_ready = false;
+                break;
+            }
+            if (pnode->fPauseRecv)
+                break;
+        }
+    }
+
+    if (fSendPending && pnode->m_sock_send_ready)
+    {
+        LOCK(pnode->cs_vSend);
+        size_t nBytes = SocketSendData(pnode);
+        if (nBytes) {
+            RecordBytesSent(nBytes);
+        }
+        // Socket buffer is full, wait for the next EPOLLOUT edge
+        if (!pnode->vSendMsg.empty())
+            pnode->m_sock_send_ready = false;
+    }
+}
+
+void CConnman::ThreadSocketHandlerEpoll(int thread_num)
+{
+    const int epoll_fd = m_epoll_fds[thread_num];
+    const int nThreads = m_epoll_fds.size();
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+
+    if (thread_num == 0) {
+        for (size_t i = 0; i < vhListenSocket.size(); ++i) {
+            struct epoll_event ev{};
+            ev.events = EPOLLIN;
+            ev.data.u64 = EPOLL_LISTEN_SOCKET | i;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, vhListenSocket[i].socket, &ev) != 0) {
+                LogPrintf("%s: Failed to watch listening socket: %s\n", __func__, NetworkErrorString(WSAGetLastError()));
+            }
+        }
+    }
+
+    while (!interruptNet)
+    {
+        if (thread_num == 0) {
+            DisconnectNodes();
+            NotifyNumConnectionsChanged();
+        }
+
+        // Nodes are sharded between the socket threads by id
+        std::vector<CNode*> vNodesCopy;
+        {
+            LOCK(cs_vNodes);
+            for (CNode* pnode : vNodes) {
+                if (pnode->GetId() % nThreads == thread_num) {
+                    pnode->AddRef();
+                    vNodesCopy.push_back(pnode);
+                }
+            }
+        }
+
+        // Watch new sockets, edge triggered, and don't block if a node can make progress already
+        bool fMoreWork = false;
+        std::unordered_map<NodeId, CNode*> mapNodes;
+        for (CNode* pnode : vNodesCopy) {
+            mapNodes.emplace(pnode->GetId(), pnode);
+            if (!pnode->m_sock_registered && !EpollAddNode(epoll_fd, pnode))
+                continue;
+            fMoreWork |= EpollNodeHasWork(pnode);
+        }
+
+        int nEvents = epoll_wait(epoll_fd, events, MAX_EPOLL_EVENTS, fMoreWork ? 0 : SELECT_TIMEOUT_MILLISECONDS);
+        if (interruptNet)
+            break;
+
+        for (int i = 0; i < nEvents; ++i) {
+            if (events[i].data.u64 & EPOLL_LISTEN_SOCKET) {
+                AcceptConnection(vhListenSocket[events[i].data.u64 & ~EPOLL_LISTEN_SOCKET]);
+                continue;
+            }
+            auto mi = mapNodes.find(events[i].data.u64);
+            if (mi == mapNodes.end())
+                continue;
+            EpollNodeEvents(mi->second, events[i].events);
+        }
+
+        for (CNode* pnode : vNodesCopy)
+        {
+            if (interruptNet)
+                break;
+
+            EpollServiceNode(pnode);
+            InactivityCheck(pnode);
+        }
+
+        {
+            LOCK(cs_vNodes);
+            for (CNode* pnode : vNodesCopy)
+                pnode->Release();
+        }
+    }
+}
+#endif
+
 void CConnman::WakeMessageHandler()
 {
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        ++nMsgProcWakeSeq;
     }
-    condMsgProc.notify_one();
+    condMsgProc.notify_all();
 }
 
 
@@ -1986,10 +2232,11 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     }
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int worker_num)
 {
     const int64_t nTimeDecBanThreshold = 60; // TODO: make option
     int64_t nTimeNextBanReduced = GetTime() + nTimeDecBanThreshold;
+    uint64_t nWakeSeqSeen = WITH_LOCK(mutexMsgProc, return nMsgProcWakeSeq);
 
     while (!flagInterruptMsgProc)
     {
@@ -2004,28 +2251,33 @@ void CConnman::ThreadMessageHandler()
 
         bool fMoreWork = false;
 
-        for (CNode* pnode : vNodesCopy)
+        // Threads start at different peers and skip any peer another thread is
+        // handling, so a slow peer only holds up the thread processing it.
+        const size_t nOffset = vNodesCopy.size() * worker_num / m_msghand_threads;
+        for (size_t i = 0; i < vNodesCopy.size(); ++i)
         {
+            CNode* pnode = vNodesCopy[(i + nOffset) % vNodesCopy.size()];
             if (pnode->fDisconnect)
                 continue;
+            if (pnode->m_msgproc_busy.exchange(true))
+                continue;
 
             // Receive messages
             bool fMoreNodeWork = m_msgproc->ProcessMessages(pnode, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
-            if (flagInterruptMsgProc)
-                return;
-            // Send messages
-            {
+            if (!flagInterruptMsgProc) {
+                // Send messages
                 LOCK(pnode->cs_sendProcessing);
                 m_msgproc->SendMessages(pnode);
             }
+            pnode->m_msgproc_busy = false;
 
             if (flagInterruptMsgProc)
                 return;
         }
 
         int64_t nTimeNow = GetTime();
-        if (nTimeNextBanReduced < nTimeNow) {
+        if (worker_num == 0 && nTimeNextBanReduced < nTimeNow) {
             LOCK(cs_main);
             CheckUnreceivedHeaders(nTimeNow);
             for (auto *pnode : vNodesCopy) {
@@ -2044,9 +2296,9 @@ void CConnman::ThreadMessageHandler()
 
         WAIT_LOCK(mutexMsgProc, lock);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, nWakeSeqSeen] { return nMsgProcWakeSeq != nWakeSeqSeen; });
         }
-        fMsgProcWake = false;
+        nWakeSeqSeen = nMsgProcWakeSeq;
     }
 }
 
@@ -2303,11 +2555,32 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     {
         LOCK(mutexMsgProc);
-        fMsgProcWake = false;
+        nMsgProcWakeSeq = 0;
     }
 
     // Send and receive from sockets, accept connections
-    threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
+#ifdef USE_EPOLL
+    for (int i = 0; m_use_epoll && i < m_socket_threads; ++i) {
+        int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd < 0) {
+            LogPrintf("Failed to create epoll set, using poll: %s\n", NetworkErrorString(WSAGetLastError()));
+            for (int fd : m_epoll_fds) {
+                close(fd);
+            }
+            m_epoll_fds.clear();
+            break;
+        }
+        m_epoll_fds.push_back(epoll_fd);
+    }
+    for (size_t i = 0; i < m_epoll_fds.size(); ++i) {
+        threadSocketHandlers.emplace_back([this, i] {
+            TraceThread(i == 0 ? "net" : strprintf("net.%d", i).c_str(), std::bind(&CConnman::ThreadSocketHandlerEpoll, this, i));
+        });
+    }
+#endif
+    if (threadSocketHandlers.empty()) {
+        threadSocketHandlers.emplace_back(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
+    }
 
     if (!gArgs.GetBoolArg("-dnsseed", true))
         LogPrintf("DNS seeding disabled\n");
@@ -2329,7 +2602,11 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this, connOptions.m_specified_outgoing)));
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < m_msghand_threads; ++i) {
+        threadMessageHandlers.emplace_back([this, i] {
+            TraceThread(i == 0 ? "msghand" : strprintf("msghand.%d", i).c_str(), std::bind(&CConnman::ThreadMessageHandler, this, i));
+        });
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpAddresses, this), DUMP_PEERS_INTERVAL * 1000);
@@ -2378,16 +2655,28 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (auto& thread : threadMessageHandlers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
         threadOpenAddedConnections.join();
     if (threadDNSAddressSeed.joinable())
         threadDNSAddressSeed.join();
-    if (threadSocketHandler.joinable())
-        threadSocketHandler.join();
+    for (auto& thread : threadSocketHandlers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    threadSocketHandlers.clear();
+#ifdef USE_EPOLL
+    for (int fd : m_epoll_fds) {
+        close(fd);
+    }
+    m_epoll_fds.clear();
+#endif
 
     if (fAddressesInitialized)
     {
@@ -2425,6 +2714,12 @@ void CConnman::DeleteNode(CNode* pnode)
     if(fUpdateConnectionTime) {
         addrman.Connected(pnode->addr);
     }
+    if (m_msg_stats) {
+        LOCK2(cs_msgProcStats, pnode->cs_procStats);
+        for (const auto& i : pnode->mapProcStatsPerMsgCmd) {
+            mapMsgProcStatsRetired[i.first].Merge(i.second);
+        }
+    }
     delete pnode;
 }
 
@@ -2509,6 +2804,18 @@ void CConnman::GetNodeStats(std::vector<CNodeStats>& vstats)
     }
 }
 
+void CConnman::GetMsgProcStats(mapMsgCmdProcStats& stats)
+{
+    stats = WITH_LOCK(cs_msgProcStats, return mapMsgProcStatsRetired);
+    LOCK(cs_vNodes);
+    for (CNode* pnode : vNodes) {
+        LOCK(pnode->cs_procStats);
+        for (const auto& i : pnode->mapProcStatsPerMsgCmd) {
+            stats[i.first].Merge(i.second);
+        }
+    }
+}
+
 bool CConnman::DisconnectNode(const std::string& strNode)
 {
     LOCK(cs_vNodes);
@@ -2704,6 +3011,8 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
 
     for (const std::string &msg : getAllNetMessageTypes())
         mapRecvBytesPerMsgCmd[msg] = 0;
+    for (const std::string &msg : SMSGMsgType::getAllTypes())
+        mapRecvBytesPerMsgCmd[msg] = 0;
     mapRecvBytesPerMsgCmd[NET_MESSAGE_COMMAND_OTHER] = 0;
 
     if (fLogIPs) {
@@ -2725,13 +3034,13 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    size_t nMessageSize = msg.shared_data ? msg.shared_data->data.size() : msg.data.size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
 
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
+    uint256 hash = msg.shared_data ? msg.shared_data->hash : Hash(msg.data.data(), msg.data.data() + nMessageSize);
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
@@ -2745,12 +3054,20 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         //log total amount of bytes per command
         pnode->mapSendBytesPerMsgCmd[msg.command] += nTotalSize;
         pnode->nSendSize += nTotalSize;
+        if (m_msg_stats) {
+            pnode->nPeakSendSize = std::max(pnode->nPeakSendSize, pnode->nSendSize);
+        }
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.emplace_back(std::move(serializedHeader));
+        if (nMessageSize) {
+            if (msg.shared_data) {
+                pnode->vSendMsg.emplace_back(std::move(msg.shared_data));
+            } else {
+                pnode->vSendMsg.emplace_back(std::move(msg.data));
+            }
+        }
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
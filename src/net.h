@@ -24,6 +24,7 @@
 #include <uint256.h>
 #include <threadinterrupt.h>
 
+#include <array>
 #include <atomic>
 #include <deque>
 #include <stdint.h>
@@ -91,6 +92,20 @@ static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default number of message handler threads, each peer is handled by one thread at a time */
+static const int DEFAULT_MSGHAND_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSGHAND_THREADS = 16;
+/** Default number of socket handler threads, connections are sharded between them when using epoll */
+static const int DEFAULT_SOCKET_THREADS = 1;
+/** Maximum number of socket handler threads */
+static const int MAX_SOCKET_THREADS = 16;
+/** Default for -useepoll, servicing peer sockets from epoll sets where available */
+static const bool DEFAULT_USE_EPOLL = false;
+/** Default for -netmsgstats */
+static const bool DEFAULT_NET_MSG_STATS = false;
+/** Number of power of two microsecond buckets in message processing time histograms */
+static const int NET_MSG_TIME_BUCKETS = 24;
 
 typedef int64_t NodeId;
 
@@ -108,6 +123,17 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/** An immutable serialized message payload, queued to any number of peers without copying */
+struct CSharedNetPayload
+{
+    explicit CSharedNetPayload(std::vector<unsigned char>&& dataIn)
+        : data(std::move(dataIn)), hash(Hash(data.begin(), data.end())) {}
+
+    const std::vector<unsigned char> data;
+    const uint256 hash; // checksum source for the message header
+};
+typedef std::shared_ptr<const CSharedNetPayload> CSharedNetPayloadRef;
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -119,7 +145,38 @@ struct CSerializedNetMsg
 
     std::vector<unsigned char> data;
     std::string command;
+    CSharedNetPayloadRef shared_data; // if set, sent instead of data
+};
+
+/** A buffer in a peer's send queue, either owned or shared with other peers */
+class CSendBuffer
+{
+public:
+    explicit CSendBuffer(std::vector<unsigned char>&& dataIn) : m_data(std::move(dataIn)) {}
+    explicit CSendBuffer(CSharedNetPayloadRef sharedIn) : m_shared(std::move(sharedIn)) {}
+
+    const unsigned char* data() const { return m_shared ? m_shared->data.data() : m_data.data(); }
+    size_t size() const { return m_shared ? m_shared->data.size() : m_data.size(); }
+
+private:
+    std::vector<unsigned char> m_data;
+    CSharedNetPayloadRef m_shared;
+};
+
+/** Processing time histogram and received bytes of one message command */
+struct CNetMsgProcStats
+{
+    uint64_t nCount{0};
+    uint64_t nBytes{0};
+    int64_t nTotalMicros{0};
+    int64_t nMaxMicros{0};
+    // Bucket i counts messages processed in under 2^i microseconds, the last bucket is unbounded
+    std::array<uint64_t, NET_MSG_TIME_BUCKETS> vBuckets{};
+
+    void Add(int64_t nMicros, uint64_t nBytesIn);
+    void Merge(const CNetMsgProcStats& other);
 };
+typedef std::map<std::string, CNetMsgProcStats> mapMsgCmdProcStats; //command, stats
 
 
 class NetEventsInterface;
@@ -151,6 +208,10 @@ public:
         uint64_t nMaxOutboundTimeframe = 0;
         uint64_t nMaxOutboundLimit = 0;
         int64_t m_peer_connect_timeout = DEFAULT_PEER_CONNECT_TIMEOUT;
+        int m_msghand_threads = DEFAULT_MSGHAND_THREADS;
+        int m_socket_threads = DEFAULT_SOCKET_THREADS;
+        bool m_use_epoll = DEFAULT_USE_EPOLL;
+        bool m_msg_stats = DEFAULT_NET_MSG_STATS;
         std::vector<std::string> vSeedNodes;
         std::vector<NetWhitelistPermissions> vWhitelistedRange;
         std::vector<NetWhitebindPermissions> vWhiteBinds;
@@ -176,6 +237,10 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_msghand_threads = std::max(1, std::min(connOptions.m_msghand_threads, MAX_MSGHAND_THREADS));
+        m_socket_threads = std::max(1, std::min(connOptions.m_socket_threads, MAX_SOCKET_THREADS));
+        m_use_epoll = connOptions.m_use_epoll;
+        m_msg_stats = connOptions.m_msg_stats;
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -282,6 +347,9 @@ public:
 
     size_t GetNodeCount(NumConnections num);
     void GetNodeStats(std::vector<CNodeStats>& vstats);
+    bool MsgStatsEnabled() const { return m_msg_stats; }
+    /** Message processing stats per command, summed over connected and disconnected peers */
+    void GetMsgProcStats(mapMsgCmdProcStats& stats);
     bool DisconnectNode(const std::string& node);
     bool DisconnectNode(const CSubNet& subnet);
     bool DisconnectNode(const CNetAddr& addr);
@@ -353,7 +421,7 @@ public:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int worker_num);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
@@ -362,6 +430,18 @@ public:
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketHandler();
     void ThreadSocketHandler();
+    int SocketRecvData(CNode *pnode);
+#ifdef USE_EPOLL
+    /// Watch the socket of pnode from epoll_fd, closing it on failure.
+    bool EpollAddNode(int epoll_fd, CNode *pnode);
+    /// Remember the readiness reported by epoll for pnode.
+    static void EpollNodeEvents(CNode *pnode, uint32_t events);
+    /// Whether pnode can send or receive without waiting for another event.
+    static bool EpollNodeHasWork(CNode *pnode);
+    /// Receive and send on the socket of pnode as far as its remembered readiness allows.
+    void EpollServiceNode(CNode *pnode);
+    void ThreadSocketHandlerEpoll(int thread_num);
+#endif
     void ThreadDNSAddressSeed();
 
     uint64_t CalculateKeyedNetGroup(const CAddress& ad) const;
@@ -404,6 +484,24 @@ public:
     // P2P timeout in seconds
     int64_t m_peer_connect_timeout;
 
+    // Number of threads running ThreadMessageHandler
+    int m_msghand_threads{DEFAULT_MSGHAND_THREADS};
+
+    // Number of threads servicing sockets, only used with epoll
+    int m_socket_threads{DEFAULT_SOCKET_THREADS};
+    // Service sockets from epoll sets, if compiled with USE_EPOLL
+    bool m_use_epoll{DEFAULT_USE_EPOLL};
+
+    // Collect message processing times and queue depths, see -netmsgstats
+    bool m_msg_stats{DEFAULT_NET_MSG_STATS};
+    // Message processing stats of disconnected peers
+    CCriticalSection cs_msgProcStats;
+    mapMsgCmdProcStats mapMsgProcStatsRetired GUARDED_BY(cs_msgProcStats);
+#ifdef USE_EPOLL
+    // One epoll set per socket thread, empty if epoll is unavailable
+    std::vector<int> m_epoll_fds;
+#endif
+
     // Whitelisted ranges. Any node connecting from these is automatically
     // whitelisted (as well as those connecting to whitelisted binds).
     std::vector<NetWhitelistPermissions> vWhitelistedRange;
@@ -462,8 +560,8 @@ public:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** incremented to wake the message processor threads. */
+    uint64_t nMsgProcWakeSeq{0};
 
     std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
@@ -472,10 +570,10 @@ public:
     CThreadInterrupt interruptNet;
 
     std::thread threadDNSAddressSeed;
-    std::thread threadSocketHandler;
+    std::vector<std::thread> threadSocketHandlers;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of m_max_outbound_full_relay
@@ -600,6 +698,10 @@ public:
     mapMsgCmdSize mapSendBytesPerMsgCmd;
     uint64_t nRecvBytes;
     mapMsgCmdSize mapRecvBytesPerMsgCmd;
+    mapMsgCmdProcStats mapProcStatsPerMsgCmd;
+    uint64_t nPeakSendSize;
+    uint64_t nPeakProcessQueueSize;
+    uint64_t nSendStalls;
     NetPermissionFlags m_permissionFlags;
     bool m_legacyWhitelisted;
     double dPingTime;
@@ -671,7 +773,7 @@ public:
     size_t nSendSize{0}; // total size of all vSendMsg entries
     size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<CSendBuffer> vSendMsg GUARDED_BY(cs_vSend);
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
@@ -680,7 +782,21 @@ public:
     std::list<CNetMessage> vProcessMsg GUARDED_BY(cs_vProcessMsg);
     size_t nProcessQueueSize{0};
 
+    // Only collected with -netmsgstats
+    size_t nPeakSendSize GUARDED_BY(cs_vSend){0};
+    uint64_t nSendStalls GUARDED_BY(cs_vSend){0}; // sends that could not write all queued data
+    size_t nPeakProcessQueueSize GUARDED_BY(cs_vProcessMsg){0};
+    CCriticalSection cs_procStats;
+    mapMsgCmdProcStats mapProcStatsPerMsgCmd GUARDED_BY(cs_procStats);
+
     CCriticalSection cs_sendProcessing;
+    // Set while a message handler thread processes this node, keeps its messages in order
+    std::atomic<bool> m_msgproc_busy{false};
+    // Socket readiness seen through epoll, only used by the socket thread servicing this node
+    bool m_sock_registered{false};
+    bool m_sock_recv_ready{false};
+    bool m_sock_send_ready{false};
+    bool m_sock_error{false};
 
     std::deque<CInv> vRecvGetData;
     uint64_t nRecvBytes GUARDED_BY(cs_vRecv){0};
@@ -734,9 +850,10 @@ public:
     std::atomic<int> nStartingHeight{-1};
     std::atomic<int> nChainHeight{-1}; // updated from ping messages
 
-    // flood relay
-    std::vector<CAddress> vAddrToSend;
-    CRollingBloomFilter addrKnown;
+    // flood relay, pushed to from other peers' message handler threads
+    CCriticalSection cs_addrSend;
+    std::vector<CAddress> vAddrToSend GUARDED_BY(cs_addrSend);
+    CRollingBloomFilter addrKnown GUARDED_BY(cs_addrSend);
     bool fGetAddr{false};
     int64_t nNextAddrSend GUARDED_BY(cs_sendProcessing){0};
     int64_t nNextLocalAddrSend GUARDED_BY(cs_sendProcessing){0};
@@ -862,6 +979,7 @@ public:
     }
 
     bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& complete);
+    void RecordMsgProcessTime(const std::string& command, uint64_t nBytes, int64_t nMicros);
 
     void SetRecvVersion(int nVersionIn)
     {
@@ -893,6 +1011,7 @@ public:
 
     void AddAddressKnown(const CAddress& _addr)
     {
+        LOCK(cs_addrSend);
         addrKnown.insert(_addr.GetKey());
     }
 
@@ -901,6 +1020,7 @@ public:
         // Known checking here is only to save space from duplicates.
         // SendMessages will filter it again for knowns that were added
         // after addresses were pushed.
+        LOCK(cs_addrSend);
         if (_addr.IsValid() && !addrKnown.contains(_addr.GetKey())) {
             if (vAddrToSend.size() >= MAX_ADDR_TO_SEND) {
                 vAddrToSend[insecure_rand.randrange(vAddrToSend.size())] = _addr;
@@ -31,6 +31,7 @@
 
 #include <smsg/smessage.h>
 
+#include <list>
 #include <memory>
 #include <typeinfo>
 
@@ -1407,6 +1408,51 @@ static std::shared_ptr<const CBlockHeaderAndShortTxIDs> most_recent_compact_bloc
 static uint256 most_recent_block_hash GUARDED_BY(cs_most_recent_block);
 static bool fWitnessesPresentInMostRecentCompactBlock GUARDED_BY(cs_most_recent_block);
 
+/** Maximum total size of serialized block messages kept to serve to other peers */
+static const size_t MAX_BLOCK_PAYLOAD_CACHE_SIZE = 32 * 1000 * 1000;
+
+// Serialized block messages recently served, most recent first, keyed on block hash
+// and witness flag. Block serialization doesn't depend on the peer's protocol version.
+typedef std::pair<uint256, bool> BlockPayloadKey;
+static CCriticalSection cs_block_payload_cache;
+static std::list<std::pair<BlockPayloadKey, CSharedNetPayloadRef>> block_payload_cache GUARDED_BY(cs_block_payload_cache);
+static std::map<BlockPayloadKey, std::list<std::pair<BlockPayloadKey, CSharedNetPayloadRef>>::iterator> map_block_payload_cache GUARDED_BY(cs_block_payload_cache);
+static size_t block_payload_cache_size GUARDED_BY(cs_block_payload_cache) = 0;
+
+static CSharedNetPayloadRef GetBlockPayload(const uint256& hash, bool fWitness)
+{
+    LOCK(cs_block_payload_cache);
+    auto it = map_block_payload_cache.find(std::make_pair(hash, fWitness));
+    if (it == map_block_payload_cache.end()) {
+        return nullptr;
+    }
+    block_payload_cache.splice(block_payload_cache.begin(), block_payload_cache, it->second);
+    return block_payload_cache.front().second;
+}
+
+static void CacheBlockPayload(const uint256& hash, bool fWitness, const CSharedNetPayloadRef& payload)
+{
+    LOCK(cs_block_payload_cache);
+    if (payload->data.size() > MAX_BLOCK_PAYLOAD_CACHE_SIZE) {
+        return;
+    }
+    const BlockPayloadKey key = std::make_pair(hash, fWitness);
+    auto it = map_block_payload_cache.find(key);
+    if (it != map_block_payload_cache.end()) {
+        // Cached by another peer's request meanwhile
+        block_payload_cache.splice(block_payload_cache.begin(), block_payload_cache, it->second);
+        return;
+    }
+    block_payload_cache.emplace_front(key, payload);
+    map_block_payload_cache.emplace(key, block_payload_cache.begin());
+    block_payload_cache_size += payload->data.size();
+    while (block_payload_cache_size > MAX_BLOCK_PAYLOAD_CACHE_SIZE) {
+        block_payload_cache_size -= block_payload_cache.back().second->data.size();
+        map_block_payload_cache.erase(block_payload_cache.back().first);
+        block_payload_cache.pop_back();
+    }
+}
+
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
@@ -1433,10 +1479,10 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
         fWitnessesPresentInMostRecentCompactBlock = fWitnessEnabled;
     }
 
-    connman->ForEachNode([this, &pcmpctblock, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
+    CSharedNetPayloadRef cmpctblock_payload; // serialized once, on the first announcement
+    connman->ForEachNode([this, &pcmpctblock, &cmpctblock_payload, pindex, &msgMaker, fWitnessEnabled, &hashBlock](CNode* pnode) {
         AssertLockHeld(cs_main);
 
-        // TODO: Avoid the repeated-serialization here
         if (pnode->nVersion < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
             return;
         ProcessBlockAvailability(pnode->GetId());
@@ -1449,7 +1495,10 @@ void PeerLogicValidation::NewPoWValidBlock(const CBlockIndex *pindex, const std:
 
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerLogicValidation::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
-            connman->PushMessage(pnode, msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock));
+            if (!cmpctblock_payload) {
+                cmpctblock_payload = msgMaker.MakePayload(0, *pcmpctblock);
+            }
+            connman->PushMessage(pnode, msgMaker.MakeShared(NetMsgType::CMPCTBLOCK, cmpctblock_payload));
             state.pindexBestHeaderSent = pindex;
         }
     });
@@ -1689,7 +1738,13 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
     if (send && (pindex->nStatus & BLOCK_HAVE_DATA))
     {
         std::shared_ptr<const CBlock> pblock;
-        if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
+        const bool fFullBlock = inv.type == MSG_BLOCK || inv.type == MSG_WITNESS_BLOCK;
+        const bool fWitness = inv.type == MSG_WITNESS_BLOCK;
+        CSharedNetPayloadRef block_payload;
+        if (fFullBlock && (block_payload = GetBlockPayload(pindex->GetBlockHash(), fWitness))) {
+            // Already serialized for another peer
+            connman->PushMessage(pfrom, msgMaker.MakeShared(NetMsgType::BLOCK, block_payload));
+        } else if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
             pblock = a_recent_block;
         } else if (inv.type == MSG_WITNESS_BLOCK) {
             // Fast-path: in this case it is possible to serve the block directly from disk,
@@ -1698,7 +1753,9 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
             if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
                 assert(!"cannot load block from disk");
             }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
+            block_payload = std::make_shared<const CSharedNetPayload>(std::move(block_data));
+            CacheBlockPayload(pindex->GetBlockHash(), fWitness, block_payload);
+            connman->PushMessage(pfrom, msgMaker.MakeShared(NetMsgType::BLOCK, block_payload));
             // Don't set pblock as we've sent the block
         } else {
             // Send block from disk
@@ -1708,10 +1765,11 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
             pblock = pblockRead;
         }
         if (pblock) {
-            if (inv.type == MSG_BLOCK)
-                connman->PushMessage(pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
-            else if (inv.type == MSG_WITNESS_BLOCK)
-                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+            if (fFullBlock) {
+                block_payload = msgMaker.MakePayload(fWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS, *pblock);
+                CacheBlockPayload(pindex->GetBlockHash(), fWitness, block_payload);
+                connman->PushMessage(pfrom, msgMaker.MakeShared(NetMsgType::BLOCK, block_payload));
+            }
             else if (inv.type == MSG_FILTERED_BLOCK)
             {
                 bool sendMerkleBlock = false;
@@ -3324,7 +3382,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         }
         pfrom->fSentAddr = true;
 
-        pfrom->vAddrToSend.clear();
+        WITH_LOCK(pfrom->cs_addrSend, pfrom->vAddrToSend.clear());
         std::vector<CAddress> vAddr = connman->GetAddresses();
         FastRandomContext insecure_rand;
         for (const CAddress &addr : vAddr) {
@@ -3672,6 +3730,7 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
 
     // Process message
     bool fRet = false;
+    const int64_t nTimeStart = connman->MsgStatsEnabled() ? GetTimeMicros() : 0;
     try
     {
         fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime, chainparams, connman, interruptMsgProc, m_enable_bip61);
@@ -3684,6 +3743,9 @@ bool PeerLogicValidation::ProcessMessages(CNode* pfrom, std::atomic<bool>& inter
     } catch (...) {
         LogPrint(BCLog::NET, "%s(%s, %u bytes): Unknown exception caught\n", __func__, SanitizeString(strCommand), nMessageSize);
     }
+    if (nTimeStart) {
+        pfrom->RecordMsgProcessTime(strCommand, nMessageSize + CMessageHeader::HEADER_SIZE, GetTimeMicros() - nTimeStart);
+    }
 
     if (!fRet) {
         LogPrint(BCLog::NET, "%s(%s, %u bytes) FAILED peer=%d\n", __func__, SanitizeString(strCommand), nMessageSize, pfrom->GetId());
@@ -3908,6 +3970,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
         //
         if (pto->IsAddrRelayPeer() && pto->nNextAddrSend < nNow) {
             pto->nNextAddrSend = PoissonNextSend(nNow, AVG_ADDRESS_BROADCAST_INTERVAL);
+            LOCK(pto->cs_addrSend);
             std::vector<CAddress> vAddr;
             vAddr.reserve(pto->vAddrToSend.size());
             for (const CAddress& addr : pto->vAddrToSend)
@@ -19,7 +19,7 @@
 #include <boost/thread.hpp>
 
 
-static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+static bool ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
 {
     assert(!outputs.empty());
     ss << hash;
@@ -36,7 +36,10 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
                 stats.nTotalAmount += output.second.out.nValue;
                 break;
             case OUTPUT_CT:
-                ss.write((char*)&output.second.commitment.data[0], 33);
+                if (!output.second.GetCommitment()) {
+                    return error("%s: missing commitment for %s:%d", __func__, hash.ToString(), output.first);
+                }
+                ss.write((char*)&output.second.GetCommitment()->data[0], 33);
                 stats.nBlindTransactionOutputs++;
                 break;
             default:
@@ -48,6 +51,7 @@ static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash,
                            (fFalconMode ? 1 /* nType */ + 33 /* commitment */ : 0);
     }
     ss << VARINT(0u);
+    return true;
 }
 
 //! Calculate statistics about the unspent transaction output set
@@ -71,7 +75,9 @@ bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
         Coin coin;
         if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
             if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, ss, prevkey, outputs);
+                if (!ApplyStats(stats, ss, prevkey, outputs)) {
+                    return false;
+                }
                 outputs.clear();
             }
             prevkey = key.hash;
@@ -81,8 +87,8 @@ bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
         }
         pcursor->Next();
     }
-    if (!outputs.empty()) {
-        ApplyStats(stats, ss, prevkey, outputs);
+    if (!outputs.empty() && !ApplyStats(stats, ss, prevkey, outputs)) {
+        return false;
     }
     stats.hashSerialized = ss.GetHash();
     stats.nDiskSize = view->EstimateSize();
@@ -0,0 +1,332 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/snapshot.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <hash.h>
+#include <rctindex.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <txdb.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <stdio.h>
+
+/** Number of records written per chunk */
+static const size_t SNAPSHOT_CHUNK_SIZE = 1000;
+
+namespace {
+
+/** Writes to a file while hashing the written data */
+class HashedFileWriter
+{
+private:
+    CAutoFile &m_file;
+    CHashWriter m_hasher;
+
+public:
+    explicit HashedFileWriter(CAutoFile &file) : m_file(file), m_hasher(file.GetType(), file.GetVersion()) {}
+
+    int GetType() const { return m_file.GetType(); }
+    int GetVersion() const { return m_file.GetVersion(); }
+
+    void write(const char *pch, size_t size)
+    {
+        m_file.write(pch, size);
+        m_hasher.write(pch, size);
+    }
+
+    template<typename T>
+    HashedFileWriter& operator<<(const T &obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+
+    uint256 GetHash() { return m_hasher.GetHash(); }
+};
+
+/** Buffers records and writes them to the snapshot in chunks */
+class ChunkWriter
+{
+private:
+    HashedFileWriter &m_writer;
+    CDataStream m_chunk;
+    size_t m_count = 0;
+
+    void WriteChunk()
+    {
+        WriteCompactSize(m_writer, m_count);
+        m_writer.write(m_chunk.data(), m_chunk.size());
+        m_chunk.clear();
+        m_count = 0;
+    }
+
+public:
+    explicit ChunkWriter(HashedFileWriter &writer) : m_writer(writer), m_chunk(writer.GetType(), writer.GetVersion()) {}
+
+    template<typename K, typename V>
+    void Add(const K &key, const V &value)
+    {
+        m_chunk << key << value;
+        if (++m_count >= SNAPSHOT_CHUNK_SIZE) {
+            WriteChunk();
+        }
+    }
+
+    void EndSection()
+    {
+        if (m_count > 0) {
+            WriteChunk();
+        }
+        WriteCompactSize(m_writer, 0);
+    }
+};
+
+} // anon namespace
+
+static bool WriteSnapshot(CAutoFile &file, const fs::path &path, SnapshotMetadata &metadata, uint256 &hash, std::string &error)
+{
+    // Iterators see the databases as they were when created, the RingCT tables are
+    // written as blocks are connected and the coins are flushed here.
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    std::unique_ptr<CDBIterator> pcursor_rct;
+    {
+        LOCK(cs_main);
+        ::ChainstateActive().ForceFlushStateToDisk();
+
+        const CBlockIndex *tip = ::ChainActive().Tip();
+        pcursor.reset(::ChainstateActive().CoinsDB().Cursor());
+        pcursor_rct.reset(pblocktree->NewIterator());
+        assert(pcursor->GetBestBlock() == tip->GetBlockHash());
+
+        metadata.base_blockhash = tip->GetBlockHash();
+        metadata.nHeight = tip->nHeight;
+        metadata.bnStakeModifier = tip->Cold().bnStakeModifier;
+        metadata.prevoutStake = tip->Cold().prevoutStake;
+        metadata.nMoneySupply = tip->Cold().nMoneySupply;
+        metadata.nAnonOutputs = tip->Cold().nAnonOutputs;
+    }
+    metadata.nCoins = 0;
+    metadata.nKeyImages = 0;
+
+    LogPrintf("Writing chainstate snapshot at block %s (height %d) to %s\n",
+        metadata.base_blockhash.ToString(), metadata.nHeight, path.string());
+
+    try {
+        HashedFileWriter writer(file);
+        ChunkWriter chunks(writer);
+        writer << metadata;
+
+        for (; pcursor->Valid(); pcursor->Next()) {
+            COutPoint outpoint;
+            Coin coin;
+            if (!pcursor->GetKey(outpoint) || !pcursor->GetValue(coin)) {
+                error = "Unable to read UTXO set";
+                return false;
+            }
+            chunks.Add(outpoint, coin);
+            if (++metadata.nCoins % 100000 == 0 && ShutdownRequested()) {
+                error = "Shutdown requested";
+                return false;
+            }
+        }
+        chunks.EndSection();
+
+        int64_t nAnonOutputs = 0;
+        pcursor_rct->Seek(std::make_pair(DB_RCTOUTPUT, (int64_t)0));
+        for (; pcursor_rct->Valid(); pcursor_rct->Next()) {
+            std::pair<char, int64_t> key;
+            if (!pcursor_rct->GetKey(key) || key.first != DB_RCTOUTPUT) {
+                break;
+            }
+            CAnonOutput ao;
+            if (!pcursor_rct->GetValue(ao)) {
+                error = "Unable to read anon output";
+                return false;
+            }
+            chunks.Add(key.second, ao);
+            nAnonOutputs++;
+        }
+        chunks.EndSection();
+        if (nAnonOutputs != metadata.nAnonOutputs) {
+            error = strprintf("Found %d anon outputs, expected %d", nAnonOutputs, metadata.nAnonOutputs);
+            return false;
+        }
+
+        pcursor_rct->Seek(std::make_pair(DB_RCTKEYIMAGE, CCmpPubKey()));
+        for (; pcursor_rct->Valid(); pcursor_rct->Next()) {
+            std::pair<char, CCmpPubKey> key;
+            if (!pcursor_rct->GetKey(key) || key.first != DB_RCTKEYIMAGE) {
+                break;
+            }
+            // Versions before 0.19.2.15 store only the txid
+            CAnonKeyImageInfo data;
+            bool read = pcursor_rct->GetValueSize() < 36
+                ? pcursor_rct->GetValue(data.txid)
+                : pcursor_rct->GetValue(data);
+            if (!read) {
+                error = "Unable to read key image";
+                return false;
+            }
+            if (pcursor_rct->GetValueSize() < 36) {
+                data.height = -1; // unset
+            }
+            chunks.Add(key.second, data);
+            metadata.nKeyImages++;
+        }
+        chunks.EndSection();
+
+        hash = writer.GetHash();
+    } catch (const std::exception &e) {
+        error = strprintf("Writing snapshot failed: %s", e.what());
+        return false;
+    }
+
+    if (fflush(file.Get()) != 0 || !FileCommit(file.Get())) {
+        error = "Writing snapshot failed: unable to flush file";
+        return false;
+    }
+    return true;
+}
+
+bool DumpSnapshot(const fs::path &path, SnapshotMetadata &metadata, uint256 &hash, std::string &error)
+{
+    fs::path temppath = path;
+    temppath += ".incomplete";
+    CAutoFile file(fsbridge::fopen(temppath, "wb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Unable to open %s for writing", temppath.string());
+        return false;
+    }
+    bool fSuccess = WriteSnapshot(file, path, metadata, hash, error);
+    file.fclose();
+    if (!fSuccess) {
+        fs::remove(temppath);
+        return false;
+    }
+    if (!RenameOver(temppath, path)) {
+        error = strprintf("Unable to rename %s to %s", temppath.string(), path.string());
+        return false;
+    }
+
+    LogPrintf("Wrote chainstate snapshot with %d coins, %d anon outputs and %d key images, hash %s\n",
+        metadata.nCoins, metadata.nAnonOutputs, metadata.nKeyImages, hash.ToString());
+    return true;
+}
+
+bool ReadSnapshot(CAutoFile &file, SnapshotMetadata &metadata, uint256 &hash, SnapshotVisitor *visitor, std::string &error)
+{
+    CHashVerifier<CAutoFile> verifier(&file);
+    try {
+        verifier >> metadata;
+        if (metadata.nVersion != SNAPSHOT_VERSION) {
+            error = strprintf("Unknown snapshot version %d", metadata.nVersion);
+            return false;
+        }
+        if (metadata.nAnonOutputs < 0) {
+            error = "Invalid anon output count";
+            return false;
+        }
+        if (visitor && !visitor->OnMetadata(metadata, error)) {
+            return false;
+        }
+        metadata.nCoins = 0;
+        metadata.nKeyImages = 0;
+
+        uint64_t nRecords;
+        while ((nRecords = ReadCompactSize(verifier)) > 0) {
+            for (uint64_t i = 0; i < nRecords; ++i) {
+                COutPoint outpoint;
+                Coin coin;
+                verifier >> outpoint >> coin;
+                if (coin.IsSpent()) {
+                    error = strprintf("Snapshot contains a spent coin %s", outpoint.ToString());
+                    return false;
+                }
+                metadata.nCoins++;
+                if (visitor && !visitor->OnCoin(outpoint, std::move(coin), error)) {
+                    return false;
+                }
+            }
+            if (ShutdownRequested()) {
+                error = "Shutdown requested";
+                return false;
+            }
+        }
+
+        int64_t nAnonOutputs = 0;
+        while ((nRecords = ReadCompactSize(verifier)) > 0) {
+            for (uint64_t i = 0; i < nRecords; ++i) {
+                int64_t index;
+                CAnonOutput ao;
+                verifier >> index >> ao;
+                if (index < 1 || index > metadata.nAnonOutputs) {
+                    error = strprintf("Anon output index %d out of range", index);
+                    return false;
+                }
+                nAnonOutputs++;
+                if (visitor && !visitor->OnAnonOutput(index, ao, error)) {
+                    return false;
+                }
+            }
+        }
+        if (nAnonOutputs != metadata.nAnonOutputs) {
+            error = strprintf("Snapshot contains %d anon outputs, expected %d", nAnonOutputs, metadata.nAnonOutputs);
+            return false;
+        }
+
+        while ((nRecords = ReadCompactSize(verifier)) > 0) {
+            for (uint64_t i = 0; i < nRecords; ++i) {
+                CCmpPubKey ki;
+                CAnonKeyImageInfo data;
+                verifier >> ki >> data;
+                metadata.nKeyImages++;
+                if (visitor && !visitor->OnKeyImage(ki, data, error)) {
+                    return false;
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        error = strprintf("Invalid snapshot file: %s", e.what());
+        return false;
+    }
+
+    if (fgetc(file.Get()) != EOF) {
+        error = "Invalid snapshot file: unexpected data after the last section";
+        return false;
+    }
+    hash = verifier.GetHash();
+    return true;
+}
+
+bool VerifySnapshot(const fs::path &path, const CChainParams &chainparams, SnapshotMetadata &metadata, std::string &error)
+{
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Unable to open %s", path.string());
+        return false;
+    }
+
+    uint256 hash;
+    if (!ReadSnapshot(file, metadata, hash, nullptr, error)) {
+        return false;
+    }
+
+    const MapSnapshotHashes &hashes = chainparams.SnapshotHashes();
+    const auto mi = hashes.find(metadata.base_blockhash);
+    if (mi == hashes.end()) {
+        error = strprintf("No snapshot hash is known for block %s", metadata.base_blockhash.ToString());
+        return false;
+    }
+    if (mi->second != hash) {
+        error = strprintf("Snapshot hash %s does not match the expected %s", hash.ToString(), mi->second.ToString());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FALCON_NODE_SNAPSHOT_H
+#define FALCON_NODE_SNAPSHOT_H
+
+#include <amount.h>
+#include <fs.h>
+#include <primitives/transaction.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <string>
+
+class CAnonKeyImageInfo;
+class CAnonOutput;
+class CAutoFile;
+class CChainParams;
+class CCmpPubKey;
+class Coin;
+
+static const uint32_t SNAPSHOT_VERSION = 1;
+
+/**
+ * Header of a chainstate snapshot file.
+ *
+ * The header is followed by three sections: the coins, the anon outputs and the
+ * key images. Each section is a sequence of chunks, a chunk is a CompactSize
+ * record count followed by the records, and an empty chunk ends the section.
+ * The snapshot hash is the double SHA256 of the whole file.
+ *
+ * The cold fields of the base block index entry are included, they are needed
+ * to connect the block after the base.
+ */
+class SnapshotMetadata
+{
+public:
+    uint32_t nVersion = SNAPSHOT_VERSION;
+    uint256 base_blockhash;
+    int nHeight = 0;
+    uint256 bnStakeModifier;
+    COutPoint prevoutStake;
+    CAmount nMoneySupply = 0;
+    int64_t nAnonOutputs = 0;
+
+    // Counted while reading or writing, not serialized
+    uint64_t nCoins = 0;
+    uint64_t nKeyImages = 0;
+
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nVersion);
+        READWRITE(base_blockhash);
+        READWRITE(nHeight);
+        READWRITE(bnStakeModifier);
+        READWRITE(prevoutStake);
+        READWRITE(nMoneySupply);
+        READWRITE(nAnonOutputs);
+    }
+};
+
+/** Receives the records of a snapshot file as they are read */
+class SnapshotVisitor
+{
+public:
+    virtual ~SnapshotVisitor() {};
+    virtual bool OnMetadata(const SnapshotMetadata &metadata, std::string &error) { return true; };
+    virtual bool OnCoin(const COutPoint &outpoint, Coin &&coin, std::string &error) { return true; };
+    virtual bool OnAnonOutput(int64_t index, const CAnonOutput &ao, std::string &error) { return true; };
+    virtual bool OnKeyImage(const CCmpPubKey &ki, const CAnonKeyImageInfo &data, std::string &error) { return true; };
+};
+
+/** Write the coins database and the RingCT tables at the current chain tip to path */
+bool DumpSnapshot(const fs::path &path, SnapshotMetadata &metadata, uint256 &hash, std::string &error);
+
+/**
+ * Read a snapshot file, passing each record to visitor when set.
+ * The structure of the file is checked, hash is set to the snapshot hash.
+ */
+bool ReadSnapshot(CAutoFile &file, SnapshotMetadata &metadata, uint256 &hash, SnapshotVisitor *visitor, std::string &error);
+
+/** Check the hash of the snapshot file at path against the value in chainparams */
+bool VerifySnapshot(const fs::path &path, const CChainParams &chainparams, SnapshotMetadata &metadata, std::string &error);
+
+#endif // FALCON_NODE_SNAPSHOT_H
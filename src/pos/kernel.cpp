@@ -32,7 +32,7 @@ uint256 ComputeStakeModifierV2(const CBlockIndex *pindexPrev, const uint256 &ker
         return uint256();  // genesis block's modifier is 0
 
     CDataStream ss(SER_GETHASH, 0);
-    ss << kernel << pindexPrev->bnStakeModifier;
+    ss << kernel << pindexPrev->Cold().bnStakeModifier;
     return Hash(ss.begin(), ss.end());
 }
 
@@ -85,7 +85,7 @@ bool CheckStakeKernelHash(const CBlockIndex *pindexPrev,
 
     targetProofOfStake = ArithToUint256(bnTarget);
 
-    const uint256 &bnStakeModifier = pindexPrev->bnStakeModifier;
+    const uint256 &bnStakeModifier = pindexPrev->Cold().bnStakeModifier;
     int nStakeModifierHeight = pindexPrev->nHeight;
     int64_t nStakeModifierTime = pindexPrev->nTime;
 
@@ -148,7 +148,7 @@ bool GetKernelInfo(const CBlockIndex *blockindex, const CTransaction &tx, uint25
     uint32_t nTime = blockindex->nTime;
 
     CDataStream ss(SER_GETHASH, 0);
-    ss << blockindex->pprev->bnStakeModifier;
+    ss << blockindex->pprev->Cold().bnStakeModifier;
     ss << nBlockFromTime << prevout.hash << prevout.n << nTime;
     hash = Hash(ss.begin(), ss.end());
 
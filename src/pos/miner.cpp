@@ -120,10 +120,13 @@ bool CheckStake(CBlock *pblock)
         LogPrintf("out %s\n", FormatMoney(pblock->vtx[0]->GetValueOut()));
     }
 
+    // Transactions taken from the mempool are marked in vPrevalidated, their proofs aren't verified again
+    int64_t nTimeStart = GetTimeMicros();
     std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
     if (!ProcessNewBlock(Params(), shared_pblock, true, nullptr)) {
         return error("%s: Block not accepted.", __func__);
     }
+    LogPrint(BCLog::BENCH, "%s: Block accepted in %.2fms\n", __func__, 0.001 * (GetTimeMicros() - nTimeStart));
 
     return true;
 };
@@ -216,6 +219,9 @@ bool ImportOutputs(CBlockTemplate *pblocktemplate, int nHeight)
     }
 
     pblock->vtx.insert(pblock->vtx.begin()+1, MakeTransactionRef(txn));
+    if (pblock->vPrevalidated.size() > 1) {
+        pblock->vPrevalidated.insert(pblock->vPrevalidated.begin()+1, false);
+    }
 
     return true;
 };
@@ -432,7 +438,9 @@ void ThreadStakeMiner(size_t nThreadID, std::vector<std::shared_ptr<CWallet>> &v
             }
 
             if (!pblocktemplate.get()) {
-                pblocktemplate = BlockAssembler(Params()).CreateNewBlock(coinbaseScript, false);
+                pblocktemplate = g_block_template_manager
+                    ? g_block_template_manager->GetBlockTemplate(coinbaseScript, false)
+                    : BlockAssembler(Params()).CreateNewBlock(coinbaseScript, false);
                 if (!pblocktemplate.get()) {
                     fIsStaking = false;
                     nWaitFor = std::min(nWaitFor, (size_t)nMinerSleep);
@@ -0,0 +1,124 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <pos/stakeseen.h>
+
+#include <algorithm>
+#include <assert.h>
+
+static size_t TableSize(size_t capacity)
+{
+    // Power of two, at most half full
+    size_t size = 16;
+    while (size < capacity * 2) {
+        size *= 2;
+    }
+    return size;
+}
+
+StakeSeenTracker::StakeSeenTracker(size_t capacity)
+    : m_capacity(capacity), m_slots(TableSize(capacity)), m_ring(capacity)
+{
+    assert(capacity > 0);
+}
+
+size_t StakeSeenTracker::Find(const COutPoint &kernel) const
+{
+    const size_t mask = m_slots.size() - 1;
+    size_t i = m_hasher(kernel) & mask;
+    while (m_slots[i].used && m_slots[i].kernel != kernel) {
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+void StakeSeenTracker::Erase(size_t slot)
+{
+    // Backward shift deletion, keeps probe sequences intact without tombstones
+    const size_t mask = m_slots.size() - 1;
+    size_t hole = slot;
+    size_t i = slot;
+    for (;;) {
+        i = (i + 1) & mask;
+        if (!m_slots[i].used) {
+            break;
+        }
+        size_t home = m_hasher(m_slots[i].kernel) & mask;
+        // Move the entry into the hole if its home is not cyclically in (hole, i]
+        bool fMove = hole <= i ? (home <= hole || home > i) : (home <= hole && home > i);
+        if (fMove) {
+            m_slots[hole] = m_slots[i];
+            m_ring[m_slots[hole].ring_pos] = hole;
+            hole = i;
+        }
+    }
+    m_slots[hole] = Slot();
+    m_size--;
+}
+
+void StakeSeenTracker::Insert(size_t slot, const COutPoint &kernel, const uint256 &block_hash)
+{
+    if (m_size == m_capacity) {
+        // Evict the oldest, entries may shift so find the slot again
+        Erase(m_ring[m_ring_head]);
+        m_ring_head = (m_ring_head + 1) % m_capacity;
+        slot = Find(kernel);
+    }
+    size_t ring_pos = (m_ring_head + m_size) % m_capacity;
+    Slot &s = m_slots[slot];
+    s.kernel = kernel;
+    s.block_hash = block_hash;
+    s.ring_pos = ring_pos;
+    s.used = true;
+    m_ring[ring_pos] = slot;
+    m_size++;
+}
+
+void StakeSeenTracker::Add(const COutPoint &kernel, const uint256 &block_hash)
+{
+    LOCK(m_mutex);
+    size_t slot = Find(kernel);
+    if (m_slots[slot].used) {
+        m_slots[slot].block_hash = block_hash;
+        return;
+    }
+    Insert(slot, kernel, block_hash);
+}
+
+bool StakeSeenTracker::CheckUnique(const COutPoint &kernel, const uint256 &block_hash, bool fUpdate, uint256 &first_seen)
+{
+    LOCK(m_mutex);
+    size_t slot = Find(kernel);
+    if (m_slots[slot].used) {
+        if (m_slots[slot].block_hash == block_hash) {
+            return true;
+        }
+        first_seen = m_slots[slot].block_hash;
+        return false;
+    }
+    if (fUpdate) {
+        Insert(slot, kernel, block_hash);
+    }
+    return true;
+}
+
+bool StakeSeenTracker::Contains(const COutPoint &kernel) const
+{
+    LOCK(m_mutex);
+    return m_slots[Find(kernel)].used;
+}
+
+size_t StakeSeenTracker::Size() const
+{
+    LOCK(m_mutex);
+    return m_size;
+}
+
+void StakeSeenTracker::Clear()
+{
+    LOCK(m_mutex);
+    std::fill(m_slots.begin(), m_slots.end(), Slot());
+    m_ring_head = 0;
+    m_size = 0;
+}
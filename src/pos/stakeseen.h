@@ -0,0 +1,61 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FALCON_POS_STAKESEEN_H
+#define FALCON_POS_STAKESEEN_H
+
+#include <coins.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <vector>
+
+/**
+ * Tracks the block each recently seen stake kernel was first seen in.
+ *
+ * Fixed capacity open addressing table with linear probing, when full the
+ * oldest inserted kernel is evicted. Has its own lock, callers don't need cs_main.
+ */
+class StakeSeenTracker
+{
+private:
+    struct Slot {
+        COutPoint kernel;
+        uint256 block_hash;
+        uint32_t ring_pos = 0;
+        bool used = false;
+    };
+
+    mutable Mutex m_mutex;
+    const size_t m_capacity;
+    const SaltedOutpointHasher m_hasher;
+    std::vector<Slot> m_slots GUARDED_BY(m_mutex);
+    //! Slot index of each kernel in insertion order, m_ring_head is the oldest
+    std::vector<uint32_t> m_ring GUARDED_BY(m_mutex);
+    size_t m_ring_head GUARDED_BY(m_mutex) = 0;
+    size_t m_size GUARDED_BY(m_mutex) = 0;
+
+    size_t Find(const COutPoint &kernel) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void Erase(size_t slot) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void Insert(size_t slot, const COutPoint &kernel, const uint256 &block_hash) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+public:
+    explicit StakeSeenTracker(size_t capacity);
+
+    /** Set the block kernel was seen in, overwrites an existing entry */
+    void Add(const COutPoint &kernel, const uint256 &block_hash);
+
+    /**
+     * Returns false if kernel was first seen in a block other than block_hash,
+     * setting first_seen. Otherwise inserts kernel if fUpdate is set.
+     */
+    bool CheckUnique(const COutPoint &kernel, const uint256 &block_hash, bool fUpdate, uint256 &first_seen);
+
+    bool Contains(const COutPoint &kernel) const;
+    size_t Size() const;
+    void Clear();
+};
+
+#endif // FALCON_POS_STAKESEEN_H
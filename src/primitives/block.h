@@ -106,6 +106,7 @@ public:
 
     // memory only
     mutable bool fChecked;
+    std::vector<bool> vPrevalidated; // per vtx, set when assembled from this node's mempool
 
     CBlock()
     {
@@ -144,6 +145,7 @@ public:
         CBlockHeader::SetNull();
         vtx.clear();
         fChecked = false;
+        vPrevalidated.clear();
     }
 
     CBlockHeader GetBlockHeader() const
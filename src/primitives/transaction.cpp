@@ -9,6 +9,9 @@
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
+#include <new>
+
 bool ExtractCoinStakeInt64(const std::vector<uint8_t> &vData, DataOutputTypes get_type, CAmount &out)
 {
     if (vData.size() < 5) { // First 4 bytes will be height
@@ -73,6 +76,87 @@ bool ExtractCoinStakeUint32(const std::vector<uint8_t> &vData, DataOutputTypes g
     return false;
 }
 
+/** Outputs allocated for up front, limits the allocation a peer can trigger with a bogus count. */
+static const size_t TXOUT_ARENA_MAX_PREALLOC = 512;
+static const size_t TXOUT_ARENA_ALIGN = std::max({alignof(CTxOutStandard), alignof(CTxOutCT), alignof(CTxOutRingCT), alignof(CTxOutData), alignof(size_t)});
+/** Each output is preceded by the size of its slot, so the arena never trusts the mutable nVersion */
+static const size_t TXOUT_ARENA_HEADER = (sizeof(size_t) + TXOUT_ARENA_ALIGN - 1) & ~(TXOUT_ARENA_ALIGN - 1);
+
+size_t CTxOutArena::OutputSize(uint8_t nType)
+{
+    size_t size;
+    switch (nType) {
+        case OUTPUT_STANDARD: size = sizeof(CTxOutStandard); break;
+        case OUTPUT_CT: size = sizeof(CTxOutCT); break;
+        case OUTPUT_RINGCT: size = sizeof(CTxOutRingCT); break;
+        case OUTPUT_DATA: size = sizeof(CTxOutData); break;
+        default:
+            return 0;
+    }
+    return (size + TXOUT_ARENA_ALIGN - 1) & ~(TXOUT_ARENA_ALIGN - 1);
+}
+
+size_t CTxOutArena::SlotSize(uint8_t nType)
+{
+    size_t size = OutputSize(nType);
+    return size ? TXOUT_ARENA_HEADER + size : 0;
+}
+
+void CTxOutArena::DestroyOutputs(Chunk &chunk)
+{
+    size_t ofs = 0;
+    while (ofs < chunk.used) {
+        size_t slot_size = *(size_t*)(chunk.data.get() + ofs);
+        assert(slot_size > TXOUT_ARENA_HEADER && ofs + slot_size <= chunk.used);
+        CTxOutBase *txout = (CTxOutBase*)(chunk.data.get() + ofs + TXOUT_ARENA_HEADER);
+        txout->~CTxOutBase();
+        ofs += slot_size;
+    }
+    chunk.used = 0;
+}
+
+CTxOutArena::~CTxOutArena()
+{
+    DestroyOutputs(m_first);
+    for (auto &chunk : m_overflow) {
+        DestroyOutputs(chunk);
+    }
+}
+
+CTxOutBase *CTxOutArena::Emplace(uint8_t nType, size_t nOutputsLeft)
+{
+    size_t size = SlotSize(nType);
+    if (size == 0) {
+        return nullptr;
+    }
+
+    Chunk *chunk = m_overflow.empty() ? &m_first : &m_overflow.back();
+    if (chunk->capacity - chunk->used < size) {
+        // Size the first chunk as if all outputs match the first, later chunks for the largest type
+        size_t nPerOutput = size;
+        if (chunk->data) {
+            nPerOutput = std::max({SlotSize(OUTPUT_STANDARD), SlotSize(OUTPUT_CT), SlotSize(OUTPUT_RINGCT), SlotSize(OUTPUT_DATA)});
+            m_overflow.emplace_back();
+            chunk = &m_overflow.back();
+        }
+        size_t capacity = std::max(size, std::min(nOutputsLeft, TXOUT_ARENA_MAX_PREALLOC) * nPerOutput);
+        chunk->data.reset(new uint8_t[capacity]);
+        chunk->capacity = capacity;
+    }
+
+    uint8_t *p = chunk->data.get() + chunk->used;
+    *(size_t*)p = size;
+    p += TXOUT_ARENA_HEADER;
+    CTxOutBase *txout;
+    switch (nType) {
+        case OUTPUT_STANDARD: txout = new (p) CTxOutStandard(); break;
+        case OUTPUT_CT: txout = new (p) CTxOutCT(); break;
+        case OUTPUT_RINGCT: txout = new (p) CTxOutRingCT(); break;
+        default: txout = new (p) CTxOutData(); break;
+    }
+    chunk->used += size;
+    return txout;
+}
 
 std::string COutPoint::ToString() const
 {
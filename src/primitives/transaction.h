@@ -543,6 +543,41 @@ public:
     };
 };
 
+/** Contiguous storage for the outputs of a deserialized transaction.
+ *
+ * Outputs are constructed in place, each after a header recording the size of
+ * its slot, and handed out as CTxOutBaseRefs sharing ownership of the arena through the shared_ptr
+ * aliasing constructor. A transaction then costs one or two allocations and
+ * one reference count for all of its outputs, rather than one of each per
+ * output.
+ */
+class CTxOutArena
+{
+private:
+    struct Chunk {
+        std::unique_ptr<uint8_t[]> data;
+        size_t capacity = 0;
+        size_t used = 0;
+    };
+    Chunk m_first;
+    std::vector<Chunk> m_overflow;
+
+    static void DestroyOutputs(Chunk &chunk);
+    static size_t SlotSize(uint8_t nType);
+
+public:
+    CTxOutArena() {};
+    ~CTxOutArena();
+    CTxOutArena(const CTxOutArena&) = delete;
+    CTxOutArena& operator=(const CTxOutArena&) = delete;
+
+    static size_t OutputSize(uint8_t nType);
+
+    /** Construct an empty output of type nType, nOutputsLeft includes this output.
+     * Returns nullptr if nType is unknown. */
+    CTxOutBase *Emplace(uint8_t nType, size_t nOutputsLeft);
+};
+
 
 /** An output of a transaction.  It contains the public key that the next input
  * must be able to sign with to claim it.
@@ -639,8 +674,21 @@ inline void UnserializeTransaction(TxType& tx, Stream& s) {
         size_t nOutputs = ReadCompactSize(s);
         tx.vpout.clear();
         tx.vpout.reserve(nOutputs);
+        std::shared_ptr<CTxOutArena> arena;
+        if (nOutputs > 1) {
+            arena = std::make_shared<CTxOutArena>();
+        }
         for (size_t k = 0; k < nOutputs; ++k) {
             s >> bv;
+            if (arena) {
+                CTxOutBase *txout = arena->Emplace(bv, nOutputs - k);
+                if (!txout) {
+                    throw std::ios_base::failure("Unknown transaction output type");
+                }
+                tx.vpout.push_back(CTxOutBaseRef(arena, txout));
+                s >> *txout;
+                continue;
+            }
             switch (bv) {
                 case OUTPUT_STANDARD:
                     tx.vpout.push_back(MAKE_OUTPUT<CTxOutStandard>());
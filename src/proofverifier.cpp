@@ -0,0 +1,195 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <proofverifier.h>
+
+#include <anon.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/tx_verify.h>
+#include <consensus/validation.h>
+#include <primitives/block.h>
+#include <txdb.h>
+#include <ui_interface.h>
+#include <util/system.h>
+#include <validation.h>
+#include <warnings.h>
+
+#include <algorithm>
+
+std::unique_ptr<CProofVerifier> g_proof_verifier;
+
+void CProofVerifier::AddPending(int from_height, int to_height)
+{
+    if (to_height < from_height) {
+        return;
+    }
+    if (m_skipped_height < m_next_height) {
+        m_next_height = from_height;
+        m_skipped_height = to_height;
+    } else {
+        m_next_height = std::min(m_next_height, from_height);
+        m_skipped_height = std::max(m_skipped_height, to_height);
+    }
+    m_dirty = true;
+}
+
+void CProofVerifier::LoadState()
+{
+    if (m_loaded || !pblocktree) {
+        return;
+    }
+    m_loaded = true;
+    int next_height, skipped_height;
+    if (pblocktree->ReadProofCheckState(next_height, skipped_height)) {
+        AddPending(next_height, skipped_height);
+    }
+}
+
+void CProofVerifier::BlockSkipped(const CBlockIndex *pindex)
+{
+    LOCK(m_mutex);
+    AddPending(pindex->nHeight, pindex->nHeight);
+}
+
+void CProofVerifier::GetProgress(int &next_height, int &skipped_height) const
+{
+    LOCK(m_mutex);
+    next_height = m_next_height;
+    skipped_height = m_skipped_height;
+}
+
+bool CProofVerifier::VerifyBlock(const CBlock &block, const CBlockIndex *pindex, std::string &reason)
+{
+    const Consensus::Params &consensus = Params().GetConsensus();
+
+    // The bulletproof scratch space and the rct index are shared with validation
+    LOCK(cs_main);
+    for (const auto &tx : block.vtx) {
+        if (!tx->IsFalconVersion()) {
+            continue;
+        }
+        CValidationState state;
+        state.SetStateInfo(block.nTime, pindex->nHeight, consensus, true);
+
+        for (const auto &txout : tx->vpout) {
+            bool fValid = true;
+            if (txout->IsType(OUTPUT_CT)) {
+                fValid = CheckBlindOutput(state, (const CTxOutCT*) txout.get());
+            } else
+            if (txout->IsType(OUTPUT_RINGCT)) {
+                fValid = CheckAnonOutput(state, (const CTxOutRingCT*) txout.get());
+            }
+            if (!fValid) {
+                reason = strprintf("%s in tx %s", state.GetRejectReason(), tx->GetHash().ToString());
+                return false;
+            }
+        }
+
+        bool fHasAnonInput = std::any_of(tx->vin.begin(), tx->vin.end(), [](const CTxIn &txin) { return txin.IsAnonInput(); });
+        if (fHasAnonInput && !VerifyMLSAG(*tx, state)) {
+            reason = strprintf("%s in tx %s", state.GetRejectReason(), tx->GetHash().ToString());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool CProofVerifier::WriteState(bool fSync)
+{
+    // Held while writing so an older snapshot can't overwrite a newer one
+    LOCK(m_mutex);
+    LoadState();
+    if (!m_dirty || !pblocktree) {
+        return true;
+    }
+    if (!pblocktree->WriteProofCheckState(m_next_height, m_skipped_height, fSync)) {
+        return error("%s: Failed to write state", __func__);
+    }
+    m_dirty = false;
+    return true;
+}
+
+void CProofVerifier::ThreadVerify()
+{
+    ScheduleBatchPriority();
+
+    const Consensus::Params &consensus = Params().GetConsensus();
+    while (!m_interrupt) {
+        // Don't compete with the initial sync, it's what skipped the proofs
+        if (::ChainstateActive().IsInitialBlockDownload()) {
+            if (!m_interrupt.sleep_for(std::chrono::seconds(10))) {
+                break;
+            }
+            continue;
+        }
+
+        int height;
+        {
+            LOCK(m_mutex);
+            LoadState();
+            height = m_next_height <= m_skipped_height ? m_next_height : -1;
+        }
+        if (height < 0) {
+            if (!m_interrupt.sleep_for(std::chrono::seconds(10))) {
+                break;
+            }
+            continue;
+        }
+
+        const CBlockIndex *pindex;
+        {
+            LOCK(cs_main);
+            pindex = ::ChainActive()[height];
+        }
+        CBlock block;
+        if (!pindex) {
+            // Chain was reorganised to below height, the new blocks were fully verified
+        } else
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            LogPrint(BCLog::RINGCT, "%s: Block at height %d is pruned, not verified.\n", __func__, height);
+        } else
+        if (!ReadBlockFromDisk(block, pindex, consensus)) {
+            LogPrintf("%s: Failed to read block at height %d, not verified.\n", __func__, height);
+        } else {
+            std::string reason;
+            if (!VerifyBlock(block, pindex, reason)) {
+                m_num_failed++;
+                std::string strWarning = strprintf("Warning: Block %s at height %d, below the assumed valid block, failed proof verification (%s).",
+                    pindex->GetBlockHash().ToString(), height, reason);
+                LogPrintf("*** %s\n", strWarning);
+                SetMiscWarning(strWarning);
+                uiInterface.ThreadSafeMessageBox(strWarning, "", CClientUIInterface::MSG_WARNING);
+            }
+        }
+
+        {
+            LOCK(m_mutex);
+            if (m_next_height == height) {
+                m_next_height = height + 1;
+                m_dirty = true;
+            }
+        }
+        WriteState(false);
+    }
+}
+
+void CProofVerifier::Start()
+{
+    m_thread_verify = std::thread(&TraceThread<std::function<void()>>, "proofcheck",
+                                  std::bind(&CProofVerifier::ThreadVerify, this));
+}
+
+void CProofVerifier::Interrupt()
+{
+    m_interrupt();
+}
+
+void CProofVerifier::Stop()
+{
+    if (m_thread_verify.joinable()) {
+        m_thread_verify.join();
+    }
+}
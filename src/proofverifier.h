@@ -0,0 +1,72 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FALCON_PROOFVERIFIER_H
+#define FALCON_PROOFVERIFIER_H
+
+#include <sync.h>
+#include <threadinterrupt.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+class CBlock;
+class CBlockIndex;
+
+static const bool DEFAULT_CHECK_SKIPPED_PROOFS = false;
+
+/**
+ * Re-verifies the range proofs and MLSAGs of blocks which were connected
+ * without them, below the assumed valid block or with -skiprangeproofverify.
+ *
+ * Skipped heights are always recorded and written to the block tree db with
+ * each full flush of the chain state, so enabling the verifier later still
+ * covers blocks synced before. Once the node is out of initial block download
+ * and the verifier is started, blocks are read back from disk in height order
+ * from a thread running at batch priority, storing progress after each block.
+ * A failure means the chain contains an invalid proof and raises a warning.
+ */
+class CProofVerifier
+{
+private:
+    mutable Mutex m_mutex;
+    //! Lowest height not yet re-verified, nothing is pending while above m_skipped_height
+    int m_next_height GUARDED_BY(m_mutex) = 0;
+    //! Highest height connected with proofs skipped
+    int m_skipped_height GUARDED_BY(m_mutex) = -1;
+    //! Whether the heights stored by an earlier run were merged in
+    bool m_loaded GUARDED_BY(m_mutex) = false;
+    bool m_dirty GUARDED_BY(m_mutex) = false;
+
+    std::atomic<int> m_num_failed{0};
+    CThreadInterrupt m_interrupt;
+    std::thread m_thread_verify;
+
+    void AddPending(int from_height, int to_height) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void LoadState() EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void ThreadVerify();
+
+public:
+    void BlockSkipped(const CBlockIndex *pindex);
+
+    /** Check all proofs in block, which must be in the active chain at pindex. */
+    bool VerifyBlock(const CBlock &block, const CBlockIndex *pindex, std::string &reason);
+
+    /** Write the heights left to verify to the block tree db, if changed. */
+    bool WriteState(bool fSync);
+
+    int NumFailed() const { return m_num_failed; }
+    void GetProgress(int &next_height, int &skipped_height) const;
+
+    /** Start the background verification thread. */
+    void Start();
+    void Interrupt();
+    void Stop();
+};
+
+extern std::unique_ptr<CProofVerifier> g_proof_verifier;
+
+#endif // FALCON_PROOFVERIFIER_H
@@ -9,6 +9,8 @@
 #include <core_io.h>
 #include <httpserver.h>
 #include <index/txindex.h>
+#include <insight/insight.h>
+#include <net.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
@@ -624,6 +626,125 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+static bool rest_blockhashes_by_time(HTTPRequest* req,
+                       const std::string& str_uri_part)
+{
+    if (!CheckWarmup(req)) return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, str_uri_part);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() < 2 || path.size() > 3 || (path.size() == 3 && path[2] != "noorphans")) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Use /rest/blockhashes/<high>/<low>[/noorphans].<ext>.");
+    }
+
+    int64_t high, low;
+    if (!ParseInt64(path[0], &high) || high < 0 || high > std::numeric_limits<uint32_t>::max()) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid timestamp: " + SanitizeString(path[0]));
+    }
+    if (!ParseInt64(path[1], &low) || low < 0 || low > std::numeric_limits<uint32_t>::max()) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid timestamp: " + SanitizeString(path[1]));
+    }
+    bool fActiveOnly = path.size() == 3;
+
+    std::vector<std::pair<uint256, unsigned int> > block_hashes;
+    if (!GetTimestampIndex(high, low, fActiveOnly, block_hashes)) {
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for block hashes");
+    }
+
+    switch (rf) {
+    case RetFormat::BINARY: {
+        CDataStream ss_blockhashes(SER_NETWORK, PROTOCOL_VERSION);
+        for (const auto &item : block_hashes) {
+            ss_blockhashes << item.first << item.second;
+        }
+        req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReply(HTTP_OK, ss_blockhashes.str());
+        return true;
+    }
+    case RetFormat::HEX: {
+        std::string str_hex;
+        for (const auto &item : block_hashes) {
+            str_hex += item.first.GetHex() + "\n";
+        }
+        req->WriteHeader("Content-Type", "text/plain");
+        req->WriteReply(HTTP_OK, str_hex);
+        return true;
+    }
+    case RetFormat::JSON: {
+        UniValue result(UniValue::VARR);
+        for (const auto &item : block_hashes) {
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("blockhash", item.first.GetHex());
+            entry.pushKV("logicalts", (int64_t)item.second);
+            result.push_back(entry);
+        }
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, result.write() + "\n");
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+}
+
+static bool rest_netmsgstats(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (strURIPart != ".txt") {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .txt)");
+    }
+    if (!g_connman) {
+        return RESTERR(req, HTTP_SERVICE_UNAVAILABLE, "Peer-to-peer functionality missing or disabled");
+    }
+
+    mapMsgCmdProcStats stats;
+    g_connman->GetMsgProcStats(stats);
+    std::vector<CNodeStats> vstats;
+    g_connman->GetNodeStats(vstats);
+
+    // Prometheus text exposition format
+    std::string out;
+    out += "# HELP falcon_p2p_msg_process_seconds Time spent processing received messages.\n";
+    out += "# TYPE falcon_p2p_msg_process_seconds histogram\n";
+    for (const auto& i : stats) {
+        const CNetMsgProcStats& cmd = i.second;
+        uint64_t nCumulative = 0;
+        for (int b = 0; b < NET_MSG_TIME_BUCKETS - 1; ++b) {
+            nCumulative += cmd.vBuckets[b];
+            out += strprintf("falcon_p2p_msg_process_seconds_bucket{command=\"%s\",le=\"%g\"} %u\n", i.first, (double)(1 << b) / 1e6, nCumulative);
+        }
+        out += strprintf("falcon_p2p_msg_process_seconds_bucket{command=\"%s\",le=\"+Inf\"} %u\n", i.first, cmd.nCount);
+        out += strprintf("falcon_p2p_msg_process_seconds_sum{command=\"%s\"} %g\n", i.first, (double)cmd.nTotalMicros / 1e6);
+        out += strprintf("falcon_p2p_msg_process_seconds_count{command=\"%s\"} %u\n", i.first, cmd.nCount);
+    }
+    out += "# HELP falcon_p2p_msg_recv_bytes_total Bytes received in processed messages.\n";
+    out += "# TYPE falcon_p2p_msg_recv_bytes_total counter\n";
+    for (const auto& i : stats) {
+        out += strprintf("falcon_p2p_msg_recv_bytes_total{command=\"%s\"} %u\n", i.first, i.second.nBytes);
+    }
+    out += "# HELP falcon_p2p_peer_send_queue_peak_bytes Largest send queue of each connected peer.\n";
+    out += "# TYPE falcon_p2p_peer_send_queue_peak_bytes gauge\n";
+    for (const CNodeStats& nodestats : vstats) {
+        out += strprintf("falcon_p2p_peer_send_queue_peak_bytes{peer=\"%d\"} %u\n", nodestats.nodeid, nodestats.nPeakSendSize);
+    }
+    out += "# HELP falcon_p2p_peer_recv_queue_peak_bytes Largest queue of received messages of each connected peer.\n";
+    out += "# TYPE falcon_p2p_peer_recv_queue_peak_bytes gauge\n";
+    for (const CNodeStats& nodestats : vstats) {
+        out += strprintf("falcon_p2p_peer_recv_queue_peak_bytes{peer=\"%d\"} %u\n", nodestats.nodeid, nodestats.nPeakProcessQueueSize);
+    }
+    out += "# HELP falcon_p2p_peer_send_stalls_total Sends that could not write all queued data.\n";
+    out += "# TYPE falcon_p2p_peer_send_stalls_total counter\n";
+    for (const CNodeStats& nodestats : vstats) {
+        out += strprintf("falcon_p2p_peer_send_stalls_total{peer=\"%d\"} %u\n", nodestats.nodeid, nodestats.nSendStalls);
+    }
+
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4");
+    req->WriteReply(HTTP_OK, out);
+    return true;
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -637,6 +758,8 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/blockhashes/", rest_blockhashes_by_time},
+      {"/rest/netmsgstats", rest_netmsgstats},
 };
 
 void StartREST()
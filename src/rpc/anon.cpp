@@ -42,7 +42,7 @@ UniValue anonoutput(const JSONRPCRequest &request)
 
     if (request.params.size() == 0) {
         LOCK(cs_main);
-        result.pushKV("lastindex", (int)::ChainActive().Tip()->nAnonOutputs);
+        result.pushKV("lastindex", (int)::ChainActive().Tip()->Cold().nAnonOutputs);
         return result;
     }
 
@@ -151,7 +151,7 @@ UniValue rollbackrctindex(const JSONRPCRequest &request)
 
     std::set<CCmpPubKey> setKi; // unused
     int64_t nTestExists = 0;
-    RollBackRCTIndex(pindex->nAnonOutputs, nTestExists, pindex->nHeight, setKi);
+    RollBackRCTIndex(pindex->Cold().nAnonOutputs, nTestExists, pindex->nHeight, setKi);
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("height", pindex->nHeight);
@@ -11,10 +11,14 @@
 #include <chainparams.h>
 #include <coins.h>
 #include <node/coinstats.h>
+#include <node/snapshot.h>
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
 #include <index/blockfilterindex.h>
+#include <index/smsgfundindex.h>
+#include <index/txindex.h>
+#include <index/voteindex.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
@@ -115,8 +119,8 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     result.pushKV("difficulty", GetDifficulty(blockindex));
     result.pushKV("chainwork", blockindex->nChainWork.GetHex());
     result.pushKV("nTx", (uint64_t)blockindex->nTx);
-    result.pushKV("moneysupply", ValueFromAmount(blockindex->nMoneySupply));
-    result.pushKV("anonoutputs", (uint64_t)blockindex->nAnonOutputs);
+    result.pushKV("moneysupply", ValueFromAmount(blockindex->Cold().nMoneySupply));
+    result.pushKV("anonoutputs", (uint64_t)blockindex->Cold().nAnonOutputs);
 
     if (blockindex->pprev)
         result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
@@ -170,7 +174,7 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIn
         result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
     if (coinstakeDetails && blockindex->pprev) {
         result.pushKV("blocksig", HexStr(block.vchBlockSig));
-        result.pushKV("prevstakemodifier", blockindex->pprev->bnStakeModifier.GetHex());
+        result.pushKV("prevstakemodifier", blockindex->pprev->Cold().bnStakeModifier.GetHex());
         uint256 kernelhash, kernelblockhash;
         CAmount kernelvalue;
         CScript kernelscript;
@@ -1324,7 +1328,7 @@ UniValue getblockchaininfo(const JSONRPCRequest& request)
     obj.pushKV("headers",               pindexBestHeader ? pindexBestHeader->nHeight : -1);
     obj.pushKV("bestblockhash",         tip->GetBlockHash().GetHex());
     if (fFalconMode) {
-        obj.pushKV("moneysupply",           ValueFromAmount(tip->nMoneySupply));
+        obj.pushKV("moneysupply",           ValueFromAmount(tip->Cold().nMoneySupply));
         obj.pushKV("blockindexsize",        (int)::BlockIndex().size());
         obj.pushKV("delayedblocks",         (int)CountDelayedBlocks());
     }
@@ -2350,6 +2354,117 @@ static UniValue getblockfilter(const JSONRPCRequest& request)
     return ret;
 }
 
+static UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"dumptxoutset",
+                "\nWrite the UTXO set and the RingCT output and key image tables at the chain tip to a snapshot file.\n"
+                "Note this call may take some time.\n",
+                {
+                    {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
+                },
+                RPCResult{
+            "{\n"
+            "  \"base_hash\": \"hex\",       (string) The hash of the block the snapshot was taken at\n"
+            "  \"base_height\": n,          (numeric) The height of the block the snapshot was taken at\n"
+            "  \"coins_written\": n,        (numeric) The number of unspent outputs written\n"
+            "  \"anon_outputs\": n,         (numeric) The number of anon outputs written\n"
+            "  \"key_images\": n,           (numeric) The number of key images written\n"
+            "  \"snapshot_hash\": \"hex\",   (string) The hash of the snapshot file\n"
+            "  \"path\": \"str\",            (string) The absolute path the snapshot was written to\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+                },
+            }.Check(request);
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    if (fs::exists(path)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists.");
+    }
+
+    SnapshotMetadata metadata;
+    uint256 hash;
+    std::string error;
+    if (!DumpSnapshot(path, metadata, hash, error)) {
+        throw JSONRPCError(RPC_MISC_ERROR, error);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("base_hash", metadata.base_blockhash.GetHex());
+    ret.pushKV("base_height", metadata.nHeight);
+    ret.pushKV("coins_written", (int64_t)metadata.nCoins);
+    ret.pushKV("anon_outputs", metadata.nAnonOutputs);
+    ret.pushKV("key_images", (int64_t)metadata.nKeyImages);
+    ret.pushKV("snapshot_hash", hash.GetHex());
+    ret.pushKV("path", path.string());
+    return ret;
+}
+
+static UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"loadtxoutset",
+                "\nReplace the chainstate with a snapshot written by dumptxoutset.\n"
+                "The hash of the snapshot must match the value hardcoded for its base block.\n"
+                "The chain tip must be the genesis block and the header of the base block must be known.\n"
+                "Blocks below the base block are not downloaded or validated, the node treats them as pruned.\n"
+                "There is no background validation of the historical chain, the snapshot hash is the only check of the loaded state.\n"
+                "Not compatible with -txindex, -blockfilterindex and the insight indices.\n",
+                {
+                    {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the snapshot file. If relative, will be prefixed by datadir."},
+                },
+                RPCResult{
+            "{\n"
+            "  \"base_hash\": \"hex\",       (string) The hash of the snapshot base block\n"
+            "  \"base_height\": n,          (numeric) The height of the snapshot base block\n"
+            "  \"coins_loaded\": n,         (numeric) The number of unspent outputs loaded\n"
+            "  \"anon_outputs\": n,         (numeric) The number of anon outputs loaded\n"
+            "  \"key_images\": n,           (numeric) The number of key images loaded\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("loadtxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\"")
+                },
+            }.Check(request);
+
+    if (g_txindex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Loading a snapshot is not supported with -txindex");
+    }
+    bool have_filter_index = false;
+    ForEachBlockFilterIndex([&have_filter_index](BlockFilterIndex&) { have_filter_index = true; });
+    if (have_filter_index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Loading a snapshot is not supported with -blockfilterindex");
+    }
+    if (g_smsg_fund_index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Loading a snapshot is not supported with -smsgfundindex");
+    }
+    if (g_vote_index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Loading a snapshot is not supported with -voteindex");
+    }
+
+    fs::path path = fs::absolute(request.params[0].get_str(), GetDataDir());
+    SnapshotMetadata metadata;
+    std::string error;
+    if (!::ChainstateActive().LoadSnapshot(path, Params(), metadata, error)) {
+        throw JSONRPCError(RPC_MISC_ERROR, error);
+    }
+
+    CValidationState state;
+    if (!ActivateBestChain(state, Params())) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, FormatStateMessage(state));
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("base_hash", metadata.base_blockhash.GetHex());
+    ret.pushKV("base_height", metadata.nHeight);
+    ret.pushKV("coins_loaded", (int64_t)metadata.nCoins);
+    ret.pushKV("anon_outputs", metadata.nAnonOutputs);
+    ret.pushKV("key_images", (int64_t)metadata.nKeyImages);
+    return ret;
+}
+
 // clang-format off
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
@@ -2379,6 +2494,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "preciousblock",          &preciousblock,          {"blockhash"} },
     { "blockchain",         "scantxoutset",           &scantxoutset,           {"action", "scanobjects"} },
     { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash", "filtertype"} },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           {"path"} },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           {"path"} },
 
     /* Not shown in help */
     { "hidden",             "invalidateblock",        &invalidateblock,        {"blockhash"} },
@@ -153,6 +153,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "setban", 2, "bantime" },
     { "setban", 3, "absolute" },
     { "setnetworkactive", 0, "state" },
+    { "getnetmsgstats", 0, "peers" },
     { "setwalletflag", 1, "value" },
     { "getmempoolancestors", 1, "verbose" },
     { "getmempooldescendants", 1, "verbose" },
@@ -271,6 +272,12 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "smsgsend", 5, "testfee" },
     { "smsgsend", 6, "options" },
     { "smsgsend", 7, "coincontrol" },
+    { "smsgsendbatch", 1, "messages" },
+    { "smsgsendbatch", 2, "paid_msg" },
+    { "smsgsendbatch", 3, "days_retention" },
+    { "smsgsendbatch", 4, "testfee" },
+    { "smsgsendbatch", 5, "options" },
+    { "smsgsendbatch", 6, "coincontrol" },
     { "smsg", 1, "options" },
     { "smsgimport", 1, "options" },
     { "smsginbox", 2, "options" },
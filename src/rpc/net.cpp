@@ -425,6 +425,99 @@ static UniValue getnettotals(const JSONRPCRequest& request)
     return obj;
 }
 
+static UniValue MsgProcStatsToJSON(const mapMsgCmdProcStats& stats)
+{
+    UniValue ret(UniValue::VOBJ);
+    for (const auto& i : stats) {
+        const CNetMsgProcStats& cmd = i.second;
+        if (cmd.nCount == 0) {
+            continue;
+        }
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("count", cmd.nCount);
+        obj.pushKV("bytes", cmd.nBytes);
+        obj.pushKV("total_us", cmd.nTotalMicros);
+        obj.pushKV("max_us", cmd.nMaxMicros);
+        UniValue buckets(UniValue::VARR);
+        for (const uint64_t n : cmd.vBuckets) {
+            buckets.push_back(n);
+        }
+        obj.pushKV("histogram", buckets);
+        ret.pushKV(i.first, obj);
+    }
+    return ret;
+}
+
+static UniValue getnetmsgstats(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getnetmsgstats",
+                "\nReturns message processing times per command, collected when started with -netmsgstats.\n"
+                "Histogram bucket i counts messages processed in under 2^i microseconds, the last bucket is unbounded.\n",
+                {
+                    {"peers", RPCArg::Type::BOOL, /* default */ "false", "Include the stats and queue depths of each connected peer"},
+                },
+                RPCResult{
+            "{\n"
+            "  \"enabled\": true|false,       (boolean) Whether stats are being collected\n"
+            "  \"commands\": {                (json object) Totals over all peers, disconnected peers included\n"
+            "    \"command\": {               (json object) Stats of one message command\n"
+            "      \"count\": n,              (numeric) Number of messages processed\n"
+            "      \"bytes\": n,              (numeric) Bytes received in these messages, headers included\n"
+            "      \"total_us\": n,           (numeric) Total processing time in microseconds\n"
+            "      \"max_us\": n,             (numeric) Longest processing time in microseconds\n"
+            "      \"histogram\": [n,...]     (array) Message count per processing time bucket\n"
+            "    }, ...\n"
+            "  },\n"
+            "  \"peers\": [                   (array) Only with peers=true\n"
+            "    {\n"
+            "      \"id\": n,                 (numeric) Peer index\n"
+            "      \"addr\": \"host:port\",     (string) The IP address and port of the peer\n"
+            "      \"peak_send_queue\": n,    (numeric) Largest send queue seen, in bytes\n"
+            "      \"peak_recv_queue\": n,    (numeric) Largest queue of received messages waiting to be processed, in bytes\n"
+            "      \"send_stalls\": n,        (numeric) Number of sends that could not write all queued data\n"
+            "      \"commands\": {...}        (json object) Stats per command, as above\n"
+            "    }, ...\n"
+            "  ]\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getnetmsgstats", "")
+            + HelpExampleCli("getnetmsgstats", "true")
+            + HelpExampleRpc("getnetmsgstats", "true")
+                },
+            }.Check(request);
+    if(!g_connman)
+        throw JSONRPCError(RPC_CLIENT_P2P_DISABLED, "Error: Peer-to-peer functionality missing or disabled");
+
+    bool fPeers = request.params[0].isNull() ? false : request.params[0].get_bool();
+
+    mapMsgCmdProcStats stats;
+    g_connman->GetMsgProcStats(stats);
+
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("enabled", g_connman->MsgStatsEnabled());
+    obj.pushKV("commands", MsgProcStatsToJSON(stats));
+
+    if (fPeers) {
+        std::vector<CNodeStats> vstats;
+        g_connman->GetNodeStats(vstats);
+
+        UniValue peers(UniValue::VARR);
+        for (const CNodeStats& nodestats : vstats) {
+            UniValue peer(UniValue::VOBJ);
+            peer.pushKV("id", nodestats.nodeid);
+            peer.pushKV("addr", nodestats.addrName);
+            peer.pushKV("peak_send_queue", nodestats.nPeakSendSize);
+            peer.pushKV("peak_recv_queue", nodestats.nPeakProcessQueueSize);
+            peer.pushKV("send_stalls", nodestats.nSendStalls);
+            peer.pushKV("commands", MsgProcStatsToJSON(nodestats.mapProcStatsPerMsgCmd));
+            peers.push_back(peer);
+        }
+        obj.pushKV("peers", peers);
+    }
+    return obj;
+}
+
 static UniValue GetNetworksInfo()
 {
     UniValue networks(UniValue::VARR);
@@ -754,6 +847,7 @@ static const CRPCCommand commands[] =
     { "network",            "disconnectnode",         &disconnectnode,         {"address", "nodeid"} },
     { "network",            "getaddednodeinfo",       &getaddednodeinfo,       {"node"} },
     { "network",            "getnettotals",           &getnettotals,           {} },
+    { "network",            "getnetmsgstats",         &getnetmsgstats,         {"peers"} },
     { "network",            "getnetworkinfo",         &getnetworkinfo,         {} },
     { "network",            "setban",                 &setban,                 {"subnet", "command", "bantime", "absolute"} },
     { "network",            "listbanned",             &listbanned,             {} },
@@ -338,9 +338,13 @@ UniValue SignTransaction(CMutableTransaction& mtx, const SigningProvider* keysto
             memcpy(vchAmount.data(), &coin->second.out.nValue, 8);
         } else
         if (coin->second.nType == OUTPUT_CT) {
+            if (!coin->second.GetCommitment()) {
+                TxInErrorToJSON(txin, vErrors, "Input commitment not found");
+                continue;
+            }
             amount = 0; // Bypass amount check
             vchAmount.resize(33);
-            memcpy(vchAmount.data(), coin->second.commitment.data, 33);
+            memcpy(vchAmount.data(), coin->second.GetCommitment()->data, 33);
         } else {
             throw JSONRPCError(RPC_MISC_ERROR, strprintf("Bad input type: %d", coin->second.nType));
         }
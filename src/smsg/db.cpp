@@ -19,6 +19,12 @@ const std::string DBK_INBOX         = "IM";
 const std::string DBK_OUTBOX        = "SM";
 const std::string DBK_QUEUED        = "QM";
 const std::string DBK_PURGED_TOKEN  = "pm";
+const std::string DBK_META          = "mi";
+const std::string DBK_UNREAD        = "mu";
+const std::string DBK_FOLDER        = "mf";
+const std::string DBK_INDEX_VERSION = "mv";
+
+static const int SMSG_DB_INDEX_VERSION = 2;
 
 CCriticalSection cs_smsgDB;
 leveldb::DB *smsgDB = nullptr;
@@ -411,6 +417,78 @@ bool SecMsgDB::ReadSmesg(const uint8_t *chKey, SecMsgStored &smsgStored)
     return true;
 };
 
+static bool IsIndexedKey(const uint8_t *chKey)
+{
+    return memcmp(chKey, DBK_INBOX.data(), 2) == 0
+        || memcmp(chKey, DBK_OUTBOX.data(), 2) == 0
+        || memcmp(chKey, DBK_QUEUED.data(), 2) == 0;
+}
+
+static std::string IndexKey(const std::string &index, const uint8_t *chKey)
+{
+    std::string key = index;
+    key.append((const char*)chKey, 30);
+    return key;
+}
+
+static std::string FolderPrefix(const std::string &prefix, uint16_t folderId)
+{
+    std::string key = DBK_FOLDER + prefix;
+    key.push_back((char)(folderId >> 8));
+    key.push_back((char)(folderId & 0xFF));
+    return key;
+}
+
+// box prefix, folder, status, address, timestamp, hash
+static std::string FolderKey(const uint8_t *chKey, uint16_t folderId, uint8_t status, const CKeyID &addrTo)
+{
+    std::string key = FolderPrefix(std::string((const char*)chKey, 2), folderId);
+    key.push_back((char)status);
+    key.append((const char*)addrTo.begin(), 20);
+    key.append((const char*)chKey + 2, 28);
+    return key;
+}
+
+static const size_t FOLDER_KEY_SIZE = 55;
+
+void SecMsgDB::WriteIndexes(leveldb::WriteBatch &batch, const uint8_t *chKey, const SecMsgStored &smsgStored)
+{
+    if (!IsIndexedKey(chKey)) {
+        return;
+    }
+    SecMsgStoredMeta smsgMetaOld;
+    if (ReadSmesgMeta(chKey, smsgMetaOld)) {
+        if (smsgMetaOld.folderId != smsgStored.folderId
+            || smsgMetaOld.status != smsgStored.status
+            || smsgMetaOld.addrTo != smsgStored.addrTo) {
+            batch.Delete(FolderKey(chKey, smsgMetaOld.folderId, smsgMetaOld.status, smsgMetaOld.addrTo));
+        }
+    }
+
+    CDataStream ssMeta(SER_DISK, CLIENT_VERSION);
+    ssMeta << SecMsgStoredMeta(smsgStored);
+    batch.Put(IndexKey(DBK_META, chKey), ssMeta.str());
+    batch.Put(FolderKey(chKey, smsgStored.folderId, smsgStored.status, smsgStored.addrTo), leveldb::Slice());
+    if (smsgStored.status & SMSG_MASK_UNREAD) {
+        batch.Put(IndexKey(DBK_UNREAD, chKey), leveldb::Slice());
+    } else {
+        batch.Delete(IndexKey(DBK_UNREAD, chKey));
+    }
+};
+
+void SecMsgDB::EraseIndexes(leveldb::WriteBatch &batch, const uint8_t *chKey)
+{
+    if (!IsIndexedKey(chKey)) {
+        return;
+    }
+    SecMsgStoredMeta smsgMetaOld;
+    if (ReadSmesgMeta(chKey, smsgMetaOld)) {
+        batch.Delete(FolderKey(chKey, smsgMetaOld.folderId, smsgMetaOld.status, smsgMetaOld.addrTo));
+    }
+    batch.Delete(IndexKey(DBK_META, chKey));
+    batch.Delete(IndexKey(DBK_UNREAD, chKey));
+};
+
 bool SecMsgDB::WriteSmesg(const uint8_t *chKey, SecMsgStored &smsgStored)
 {
     if (!pdb) {
@@ -424,12 +502,17 @@ bool SecMsgDB::WriteSmesg(const uint8_t *chKey, SecMsgStored &smsgStored)
 
     if (activeBatch) {
         activeBatch->Put(ssKey.str(), ssValue.str());
+        WriteIndexes(*activeBatch, chKey, smsgStored);
         return true;
     }
 
+    leveldb::WriteBatch batch;
+    batch.Put(ssKey.str(), ssValue.str());
+    WriteIndexes(batch, chKey, smsgStored);
+
     leveldb::WriteOptions writeOptions;
     writeOptions.sync = true;
-    leveldb::Status s = pdb->Put(writeOptions, ssKey.str(), ssValue.str());
+    leveldb::Status s = pdb->Write(writeOptions, &batch);
     if (!s.ok()) {
         return error("SecMsgDB write failed: %s\n", s.ToString());
     }
@@ -466,12 +549,17 @@ bool SecMsgDB::EraseSmesg(const uint8_t *chKey)
 
     if (activeBatch) {
         activeBatch->Delete(ssKey.str());
+        EraseIndexes(*activeBatch, chKey);
         return true;
     }
 
+    leveldb::WriteBatch batch;
+    batch.Delete(ssKey.str());
+    EraseIndexes(batch, chKey);
+
     leveldb::WriteOptions writeOptions;
     writeOptions.sync = true;
-    leveldb::Status s = pdb->Delete(writeOptions, ssKey.str());
+    leveldb::Status s = pdb->Write(writeOptions, &batch);
 
     if (s.ok() || s.IsNotFound()) {
         return true;
@@ -479,6 +567,230 @@ bool SecMsgDB::EraseSmesg(const uint8_t *chKey)
     return error("SecMsgDB erase failed: %s\n", s.ToString());
 };
 
+bool SecMsgDB::NextSmesgMeta(leveldb::Iterator *it, const std::string &prefix, uint8_t *chKey, SecMsgStoredMeta &smsgMeta)
+{
+    if (!pdb) {
+        return false;
+    }
+
+    std::string index_prefix = DBK_META + prefix;
+    if (!it->Valid()) { // First run
+        it->Seek(index_prefix);
+    } else {
+        it->Next();
+    }
+
+    if (!(it->Valid()
+        && it->key().size() == 32
+        && memcmp(it->key().data(), index_prefix.data(), 4) == 0)) {
+        return false;
+    }
+
+    memcpy(chKey, it->key().data() + 2, 30);
+
+    try {
+        CDataStream ssValue(it->value().data(), it->value().data() + it->value().size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> smsgMeta;
+    } catch (std::exception &e) {
+        LogPrintf("%s unserialize threw: %s.\n", __func__, e.what());
+        return false;
+    };
+
+    return true;
+};
+
+bool SecMsgDB::NextSmesgUnread(leveldb::Iterator *it, const std::string &prefix, uint8_t *chKey, SecMsgStored &smsgStored)
+{
+    if (!pdb) {
+        return false;
+    }
+
+    std::string index_prefix = DBK_UNREAD + prefix;
+    for (;;) {
+        if (!it->Valid()) { // First run
+            it->Seek(index_prefix);
+        } else {
+            it->Next();
+        }
+
+        if (!(it->Valid()
+            && it->key().size() == 32
+            && memcmp(it->key().data(), index_prefix.data(), 4) == 0)) {
+            return false;
+        }
+
+        memcpy(chKey, it->key().data() + 2, 30);
+
+        std::string strValue;
+        leveldb::Status s = pdb->Get(leveldb::ReadOptions(), leveldb::Slice((const char*)chKey, 30), &strValue);
+        if (!s.ok()) {
+            if (s.IsNotFound()) {
+                continue;
+            }
+            return error("LevelDB read failure: %s\n", s.ToString());
+        }
+
+        try {
+            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> smsgStored;
+        } catch (std::exception &e) {
+            LogPrintf("%s unserialize threw: %s.\n", __func__, e.what());
+            return false;
+        };
+        return true;
+    }
+};
+
+bool SecMsgDB::NextSmesgInFolder(leveldb::Iterator *it, const std::string &prefix, uint16_t folderId, const CKeyID *addrTo, uint8_t *chKey, uint8_t &status)
+{
+    if (!pdb) {
+        return false;
+    }
+
+    std::string folder_prefix = FolderPrefix(prefix, folderId);
+    if (!it->Valid()) { // First run
+        std::string seek = folder_prefix;
+        if (addrTo) {
+            seek.push_back((char)0);
+            seek.append((const char*)addrTo->begin(), 20);
+        }
+        it->Seek(seek);
+    } else {
+        it->Next();
+    }
+
+    for (;;) {
+        if (!(it->Valid()
+            && it->key().size() == FOLDER_KEY_SIZE
+            && memcmp(it->key().data(), folder_prefix.data(), folder_prefix.size()) == 0)) {
+            return false;
+        }
+        const uint8_t *pKey = (const uint8_t*)it->key().data();
+        status = pKey[folder_prefix.size()];
+
+        if (addrTo) {
+            // Skip to the address within this status, or within the next
+            int cmp = memcmp(pKey + folder_prefix.size() + 1, addrTo->begin(), 20);
+            if (cmp != 0) {
+                if (cmp > 0 && status == 0xFF) {
+                    return false;
+                }
+                std::string seek = folder_prefix;
+                seek.push_back((char)(cmp < 0 ? status : status + 1));
+                seek.append((const char*)addrTo->begin(), 20);
+                it->Seek(seek);
+                continue;
+            }
+        }
+
+        memcpy(chKey, prefix.data(), 2);
+        memcpy(chKey + 2, pKey + FOLDER_KEY_SIZE - 28, 28);
+        return true;
+    }
+};
+
+bool SecMsgDB::ReadSmesgMeta(const uint8_t *chKey, SecMsgStoredMeta &smsgMeta)
+{
+    if (!pdb) {
+        return false;
+    }
+
+    std::string key = IndexKey(DBK_META, chKey);
+    std::string strValue;
+
+    bool readFromDb = true;
+    if (activeBatch) {
+        bool deleted = false;
+        CDataStream ssIndexKey(key.data(), key.data() + key.size(), SER_DISK, CLIENT_VERSION);
+        readFromDb = ScanBatch(ssIndexKey, &strValue, &deleted) == false;
+        if (deleted) {
+            return false;
+        }
+    }
+
+    if (readFromDb) {
+        leveldb::Status s = pdb->Get(leveldb::ReadOptions(), key, &strValue);
+        if (!s.ok()) {
+            if (s.IsNotFound()) {
+                return false;
+            }
+            return error("LevelDB read failure: %s\n", s.ToString());
+        }
+    }
+
+    try {
+        CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> smsgMeta;
+    } catch (std::exception &e) {
+        LogPrintf("%s unserialize threw: %s.\n", __func__, e.what());
+        return false;
+    };
+
+    return true;
+};
+
+bool SecMsgDB::CheckIndexes()
+{
+    if (!pdb) {
+        return false;
+    }
+
+    std::string strValue;
+    leveldb::Status s = pdb->Get(leveldb::ReadOptions(), DBK_INDEX_VERSION, &strValue);
+    if (s.ok() && strValue == std::to_string(SMSG_DB_INDEX_VERSION)) {
+        return true;
+    }
+    if (!s.ok() && !s.IsNotFound()) {
+        return error("LevelDB read failure: %s\n", s.ToString());
+    }
+
+    LogPrintf("Building smsg db indexes.\n");
+    size_t nIndexed = 0;
+    uint8_t chKey[30];
+    SecMsgStored smsgStored;
+    for (const auto &prefix : {DBK_INBOX, DBK_OUTBOX, DBK_QUEUED}) {
+        leveldb::Iterator *it = pdb->NewIterator(leveldb::ReadOptions());
+        leveldb::WriteBatch batch;
+        // Entries are rewritten from the messages, drop any left by an older version
+        for (it->Seek(DBK_META + prefix); it->Valid() && it->key().starts_with(DBK_META + prefix); it->Next()) {
+            batch.Delete(it->key());
+        }
+        for (it->Seek(DBK_FOLDER + prefix); it->Valid() && it->key().starts_with(DBK_FOLDER + prefix); it->Next()) {
+            batch.Delete(it->key());
+        }
+        s = pdb->Write(leveldb::WriteOptions(), &batch);
+        if (!s.ok()) {
+            return error("SecMsgDB write failed: %s\n", s.ToString());
+        }
+        batch.Clear();
+
+        delete it;
+        it = pdb->NewIterator(leveldb::ReadOptions());
+        while (NextSmesg(it, prefix, chKey, smsgStored)) {
+            WriteIndexes(batch, chKey, smsgStored);
+            nIndexed++;
+        }
+        delete it;
+
+        leveldb::WriteOptions writeOptions;
+        writeOptions.sync = true;
+        s = pdb->Write(writeOptions, &batch);
+        if (!s.ok()) {
+            return error("SecMsgDB write failed: %s\n", s.ToString());
+        }
+    }
+
+    leveldb::WriteOptions writeOptions;
+    writeOptions.sync = true;
+    s = pdb->Put(writeOptions, DBK_INDEX_VERSION, std::to_string(SMSG_DB_INDEX_VERSION));
+    if (!s.ok()) {
+        return error("SecMsgDB write failed: %s\n", s.ToString());
+    }
+    LogPrintf("Indexed %u messages.\n", nIndexed);
+
+    return true;
+};
+
 bool SecMsgDB::ReadPurged(const uint8_t *chKey, SecMsgPurged &smsgPurged)
 {
     if (!pdb) {
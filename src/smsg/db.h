@@ -17,6 +17,7 @@ namespace smsg {
 
 class SecMsgKey;
 class SecMsgStored;
+class SecMsgStoredMeta;
 class SecMsgPurged;
 
 extern CCriticalSection cs_smsgDB;
@@ -28,6 +29,9 @@ extern const std::string DBK_INBOX;
 extern const std::string DBK_OUTBOX;
 extern const std::string DBK_QUEUED;
 extern const std::string DBK_PURGED_TOKEN;
+extern const std::string DBK_META;
+extern const std::string DBK_UNREAD;
+extern const std::string DBK_FOLDER;
 
 class SecMsgDB
 {
@@ -67,6 +71,21 @@ public:
     bool ExistsSmesg(const uint8_t *chKey);
     bool EraseSmesg(const uint8_t *chKey);
 
+    /**
+     * Messages in the inbox, outbox and send queue are indexed by key with
+     * their metadata, and unread messages by key alone, so listing and
+     * filtering doesn't read the encrypted message.
+     * The folder index orders keys by folder, status, recipient address and
+     * timestamp.
+     * Iterators read committed data, like NextSmesg.
+     */
+    bool NextSmesgMeta(leveldb::Iterator *it, const std::string &prefix, uint8_t *chKey, SecMsgStoredMeta &smsgMeta);
+    bool NextSmesgUnread(leveldb::Iterator *it, const std::string &prefix, uint8_t *chKey, SecMsgStored &smsgStored);
+    /** Keys of the messages in folderId by status, sent to addrTo if not null */
+    bool NextSmesgInFolder(leveldb::Iterator *it, const std::string &prefix, uint16_t folderId, const CKeyID *addrTo, uint8_t *chKey, uint8_t &status);
+    bool ReadSmesgMeta(const uint8_t *chKey, SecMsgStoredMeta &smsgMeta);
+    /** Build the indexes if the db was written by a version without them */
+    bool CheckIndexes();
 
     bool ReadPurged(const uint8_t *chKey, SecMsgPurged &smsgPurged);
     bool WritePurged(const uint8_t *chKey, SecMsgPurged &smsgPurged);
@@ -75,6 +94,12 @@ public:
 
     bool NextPrivKey(leveldb::Iterator *it, const std::string &prefix, CKeyID &idk, SecMsgKey &key);
 
+private:
+    void WriteIndexes(leveldb::WriteBatch &batch, const uint8_t *chKey, const SecMsgStored &smsgStored);
+    void EraseIndexes(leveldb::WriteBatch &batch, const uint8_t *chKey);
+
+public:
+
     leveldb::DB *pdb; // points to the global instance
     leveldb::WriteBatch *activeBatch;
 };
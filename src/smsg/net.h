@@ -7,6 +7,9 @@
 
 #include <sync.h>
 
+#include <string>
+#include <vector>
+
 const uint32_t SMSG_RCVCOUNT_REDUCE = 200;
 
 namespace SMSGMsgType {
@@ -19,6 +22,11 @@ extern const char *HAVE;
 extern const char *WANT;
 extern const char *MSG;
 extern const char *IGNORING;
+extern const char *REQSKETCH;
+extern const char *SKETCH;
+
+/** All smsg message types, received bytes and processing times are kept per type */
+const std::vector<std::string> &getAllTypes();
 };
 
 class PeerBucket
@@ -12,6 +12,7 @@
 #include <smsg/db.h>
 #include <wallet/ismine.h>
 #include <util/strencodings.h>
+#include <util/memory.h>
 #include <core_io.h>
 #include <base58.h>
 #include <rpc/util.h>
@@ -959,6 +960,213 @@ static UniValue smsgsend(const JSONRPCRequest &request)
     return result;
 }
 
+static UniValue smsgsendbatch(const JSONRPCRequest &request)
+{
+            RPCHelpMan{"smsgsendbatch",
+                "\nSend encrypted messages from \"address_from\" to many recipients.\n"
+                + strprintf("Paid messages are funded by one transaction per %d messages.\n", smsg::SMSG_FUND_PER_OUTPUT),
+                {
+                    {"address_from", RPCArg::Type::STR, RPCArg::Optional::NO, "The address of the sender."},
+                    {"messages", RPCArg::Type::ARR, RPCArg::Optional::NO, strprintf("A json array of up to %d messages", smsg::SMSG_MAX_SEND_BATCH),
+                        {
+                            {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "",
+                                {
+                                    {"address_to", RPCArg::Type::STR, RPCArg::Optional::NO, "The address of the recipient."},
+                                    {"message", RPCArg::Type::STR, RPCArg::Optional::NO, "The message to send."},
+                                },
+                            },
+                        },
+                    },
+                    {"paid_msg", RPCArg::Type::BOOL, /* default */ "false", "Send as paid messages."},
+                    {"days_retention", RPCArg::Type::NUM, /* default */ "1", "No. of days for which the messages will be retained by network."},
+                    {"testfee", RPCArg::Type::BOOL, /* default */ "false", "Don't send the messages, only estimate the fee."},
+                    {"options", RPCArg::Type::OBJ, /* default */ "", "",
+                        {
+                            {"decodehex", RPCArg::Type::BOOL, /* default */ "false", "Decode each \"message\" from hex before sending."},
+                            {"savemsg", RPCArg::Type::BOOL, /* default */ "true", "Save smsgs to outbox."},
+                            {"ttl_is_seconds", RPCArg::Type::BOOL, /* default */ "false", "If true days_retention parameter is interpreted as seconds to live."},
+                            {"fund_from_rct", RPCArg::Type::BOOL, /* default */ "false", "Fund messages from anon balance."},
+                            {"rct_ring_size", RPCArg::Type::NUM, /* default */ strprintf("%d", DEFAULT_RING_SIZE), "Ring size to use with fund_from_rct."},
+                        },
+                        "options"},
+                    {"coin_control", RPCArg::Type::OBJ, /* default */ "", "Coin control options for the funding txn, see smsgsend.",
+                        {
+                            {"changeaddress", RPCArg::Type::STR, /* default */ "", "The falcon address to receive the change"},
+                            {"inputs", RPCArg::Type::ARR, /* default */ "", "A json array of json objects",
+                                {
+                                    {"", RPCArg::Type::OBJ, /* default */ "", "",
+                                        {
+                                            {"tx", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "txn id"},
+                                            {"n", RPCArg::Type::NUM, RPCArg::Optional::NO, "txn vout"},
+                                        },
+                                    },
+                                },
+                            },
+                            {"feeRate", RPCArg::Type::AMOUNT, /* default */ "not set: makes wallet determine the fee", "Set a specific fee rate in " + CURRENCY_UNIT + "/kB"},
+                        },
+                    },
+                },
+                RPCResult{
+            "{\n"
+            "  \"result\": \"Sent\"/\"Not Sent\"       (string)\n"
+            "  \"msgids\": [...]                   (array) if sent, the message identifiers in input order\n"
+            "  \"txids\": [...]                    (array) if paid_msg the txnids of the funding txns in input order\n"
+            "  \"fee\": n                          (amount) if paid_msg the fee paid\n"
+            "}\n"
+                },
+                RPCExamples{
+             HelpExampleCli("smsgsendbatch", "\"myaddress\" \"[{\\\"address_to\\\":\\\"toaddress\\\",\\\"message\\\":\\\"message\\\"}]\"") +
+            "\nAs a JSON-RPC call\n"
+            + HelpExampleRpc("smsgsendbatch", "\"myaddress\", [{\"address_to\":\"toaddress\",\"message\":\"message\"}]")
+                },
+            }.Check(request);
+
+    EnsureSMSGIsEnabled();
+
+    RPCTypeCheck(request.params,
+        {UniValue::VSTR, UniValue::VARR,
+         UniValue::VBOOL, UniValue::VNUM, UniValue::VBOOL, UniValue::VOBJ}, true);
+
+    std::string addrFrom  = request.params[0].get_str();
+    const UniValue &messages = request.params[1].get_array();
+
+    bool fPaid = request.params[2].isNull() ? false : request.params[2].get_bool();
+    int nRetention = request.params[3].isNull() ? 1 : request.params[3].get_int();
+    bool fTestFee = request.params[4].isNull() ? false : request.params[4].get_bool();
+
+    bool fDecodeHex = false;
+    bool save_msg = true;
+    bool ttl_in_seconds = false;
+    bool fund_from_rct = false;
+    size_t rct_ring_size = DEFAULT_RING_SIZE;
+
+    UniValue options = request.params[5];
+    if (options.isObject()) {
+        RPCTypeCheckObj(options,
+        {
+            {"decodehex",         UniValueType(UniValue::VBOOL)},
+            {"savemsg",           UniValueType(UniValue::VBOOL)},
+            {"ttl_is_seconds",    UniValueType(UniValue::VBOOL)},
+            {"fund_from_rct",     UniValueType(UniValue::VBOOL)},
+            {"rct_ring_size",     UniValueType(UniValue::VNUM)},
+        }, true, false);
+        if (!options["decodehex"].isNull()) {
+            fDecodeHex = options["decodehex"].get_bool();
+        }
+        if (!options["savemsg"].isNull()) {
+            save_msg = options["savemsg"].get_bool();
+        }
+        if (!options["ttl_is_seconds"].isNull()) {
+            ttl_in_seconds = options["ttl_is_seconds"].get_bool();
+        }
+        if (!options["fund_from_rct"].isNull()) {
+            fund_from_rct = options["fund_from_rct"].get_bool();
+        }
+        if (!options["rct_ring_size"].isNull()) {
+            rct_ring_size = options["rct_ring_size"].get_int();
+        }
+    }
+
+    if (messages.size() < 1 || messages.size() > smsg::SMSG_MAX_SEND_BATCH) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Expect between 1 and %d messages.", smsg::SMSG_MAX_SEND_BATCH));
+    }
+
+    if (fPaid && Params().GetConsensus().nPaidSmsgTime > GetTime()) {
+        throw std::runtime_error("Paid SMSG not yet active on mainnet.");
+    }
+
+    CKeyID kiFrom;
+    CBitcoinAddress coinAddress(addrFrom);
+    if (!coinAddress.IsValid() || !coinAddress.GetKeyID(kiFrom)) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid from address.");
+    }
+
+    std::vector<smsg::SecMsgBatchItem> items(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i) {
+        const UniValue &entry = messages[i];
+        RPCTypeCheckObj(entry,
+        {
+            {"address_to",        UniValueType(UniValue::VSTR)},
+            {"message",           UniValueType(UniValue::VSTR)},
+        }, false, true);
+
+        coinAddress.SetString(entry["address_to"].get_str());
+        if (!coinAddress.IsValid() || !coinAddress.GetKeyID(items[i].addressTo)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Invalid to address, message %d.", i));
+        }
+
+        std::string msg = entry["message"].get_str();
+        if (fDecodeHex) {
+            if (!IsHex(msg)) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Expect hex encoded message with decodehex, message %d.", i));
+            }
+            std::vector<uint8_t> vData = ParseHex(msg);
+            msg = std::string(vData.begin(), vData.end());
+        }
+        items[i].message = msg;
+    }
+
+    if (!ttl_in_seconds) {
+        nRetention *= smsg::SMSG_SECONDS_IN_DAY;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    std::string sError;
+    CAmount nFee = 0;
+    size_t nTxBytes = 0;
+
+#ifdef ENABLE_WALLET
+    CCoinControl cctl;
+    if (fPaid) {
+        if (!smsgModule.pactive_wallet) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Active wallet must be set to send a paid smsg.");
+        }
+        CHDWallet *const pw = GetFalconWallet(smsgModule.pactive_wallet.get());
+        if (!fTestFee) {
+            EnsureWalletIsUnlocked(pw);
+        }
+        UniValue uv_cctl = request.params[6];
+        if (uv_cctl.isObject()) {
+            ReadCoinControlOptions(uv_cctl, pw, cctl);
+        }
+    }
+    if (smsgModule.SendBatch(kiFrom, items, sError, fPaid, nRetention, fTestFee, &nFee, &nTxBytes,
+                             save_msg, fund_from_rct, rct_ring_size, &cctl) != 0) {
+#else
+    if (smsgModule.SendBatch(kiFrom, items, sError, fPaid, nRetention, fTestFee, &nFee, &nTxBytes,
+                             save_msg, fund_from_rct, rct_ring_size) != 0) {
+#endif
+        result.pushKV("result", "Send failed.");
+        result.pushKV("error", sError);
+    } else {
+        result.pushKV("result", fTestFee ? "Not Sent." : "Sent.");
+
+        if (!fTestFee) {
+            UniValue msgids(UniValue::VARR);
+            for (const auto &item : items) {
+                msgids.push_back(HexStr(smsgModule.GetMsgID(item.smsg)));
+            }
+            result.pushKV("msgids", msgids);
+        }
+
+        if (fPaid) {
+            if (!fTestFee) {
+                UniValue txids(UniValue::VARR);
+                for (size_t i = 0; i < items.size(); i += smsg::SMSG_FUND_PER_OUTPUT) {
+                    uint256 txid;
+                    items[i].smsg.GetFundingTxid(txid);
+                    txids.push_back(txid.ToString());
+                }
+                result.pushKV("txids", txids);
+            }
+            result.pushKV("fee", ValueFromAmount(nFee));
+            result.pushKV("tx_bytes", (int)nTxBytes);
+        }
+    }
+
+    return result;
+}
+
 static UniValue smsgsendanon(const JSONRPCRequest &request)
 {
             RPCHelpMan{"smsgsendanon",
@@ -997,6 +1205,44 @@ static UniValue smsgsendanon(const JSONRPCRequest &request)
     return result;
 }
 
+static std::unique_ptr<CKeyID> ParseFilterTo(const std::string &address)
+{
+    CTxDestination dest = DecodeDestination(address);
+    if (!IsValidDestination(dest)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Falcon address");
+    }
+    if (dest.type() != typeid(PKHash)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Address not a key id");
+    }
+    return MakeUnique<CKeyID>(CKeyID(boost::get<PKHash>(dest)));
+}
+
+/** Keys of the messages to addrTo from the folder index, in timestamp order */
+static std::vector<std::string> ListKeysTo(smsg::SecMsgDB &db, const std::string &prefix, const CKeyID &addrTo)
+{
+    std::vector<std::string> vKeys;
+    uint8_t chKey[30];
+    uint8_t status;
+    std::unique_ptr<leveldb::Iterator> it(db.pdb->NewIterator(leveldb::ReadOptions()));
+    while (db.NextSmesgInFolder(it.get(), prefix, 0, &addrTo, chKey, status)) {
+        vKeys.emplace_back((const char*)chKey, 30);
+    }
+    // The index lists them by status first
+    std::sort(vKeys.begin(), vKeys.end());
+    return vKeys;
+}
+
+static bool NextIndexedSmesg(smsg::SecMsgDB &db, const std::vector<std::string> &vKeys, size_t &nNext, uint8_t *chKey, smsg::SecMsgStored &smsgStored)
+{
+    while (nNext < vKeys.size()) {
+        memcpy(chKey, vKeys[nNext++].data(), 30);
+        if (db.ReadSmesg(chKey, smsgStored)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static UniValue smsginbox(const JSONRPCRequest &request)
 {
             RPCHelpMan{"smsginbox",
@@ -1009,6 +1255,7 @@ static UniValue smsginbox(const JSONRPCRequest &request)
                         {
                             {"updatestatus", RPCArg::Type::BOOL, /* default */ "true", "Update read status if true."},
                             {"encoding", RPCArg::Type::STR, /* default */ "text", "Display message data in encoding, values: \"text\", \"hex\", \"none\"."},
+                            {"to", RPCArg::Type::STR, /* default */ "", "Only list messages sent to address, read from the db index."},
                         },
                         "options"},
                 },
@@ -1043,6 +1290,7 @@ static UniValue smsginbox(const JSONRPCRequest &request)
 
     std::string sEnc = "text";
     bool update_status = true;
+    std::unique_ptr<CKeyID> filter_to;
     if (request.params[2].isObject()) {
         UniValue options = request.params[2].get_obj();
         if (options["updatestatus"].isBool()) {
@@ -1051,6 +1299,9 @@ static UniValue smsginbox(const JSONRPCRequest &request)
         if (options["encoding"].isStr()) {
             sEnc = options["encoding"].get_str();
         }
+        if (options["to"].isStr()) {
+            filter_to = ParseFilterTo(options["to"].get_str());
+        }
     }
 
     UniValue result(UniValue::VOBJ);
@@ -1091,11 +1342,25 @@ static UniValue smsginbox(const JSONRPCRequest &request)
             leveldb::Iterator *it = dbInbox.pdb->NewIterator(leveldb::ReadOptions());
             UniValue messageList(UniValue::VARR);
 
-            while (dbInbox.NextSmesg(it, smsg::DBK_INBOX, chKey, smsgStored)) {
+            // Unread messages are listed from the unread index, and messages to an address from the folder index,
+            // without reading the rest of the inbox
+            std::vector<std::string> vIndexedKeys;
+            if (!fCheckReadStatus && filter_to) {
+                vIndexedKeys = ListKeysTo(dbInbox, smsg::DBK_INBOX, *filter_to);
+            }
+            size_t nNextIndexed = 0;
+            while (fCheckReadStatus
+                ? dbInbox.NextSmesgUnread(it, smsg::DBK_INBOX, chKey, smsgStored)
+                : filter_to
+                ? NextIndexedSmesg(dbInbox, vIndexedKeys, nNextIndexed, chKey, smsgStored)
+                : dbInbox.NextSmesg(it, smsg::DBK_INBOX, chKey, smsgStored)) {
                 if (fCheckReadStatus
                     && !(smsgStored.status & SMSG_MASK_UNREAD)) {
                     continue;
                 }
+                if (filter_to && smsgStored.addrTo != *filter_to) {
+                    continue;
+                }
                 uint8_t *pHeader = &smsgStored.vchMessage[0];
                 const smsg::SecureMessage *psmsg = (smsg::SecureMessage*) pHeader;
 
@@ -1184,6 +1449,7 @@ static UniValue smsgoutbox(const JSONRPCRequest &request)
                         {
                             {"encoding", RPCArg::Type::STR, /* default */ "text", "Display message data in encoding, values: \"text\", \"hex\", \"none\"."},
                             {"sending", RPCArg::Type::BOOL, /* default */ "false", "Display messages in sending queue."},
+                            {"to", RPCArg::Type::STR, /* default */ "", "Only list messages sent to address, read from the db index."},
                         },
                         "options"},
                 },
@@ -1212,6 +1478,7 @@ static UniValue smsgoutbox(const JSONRPCRequest &request)
 
     bool show_sending = false;
     std::string sEnc = "text";
+    std::unique_ptr<CKeyID> filter_to;
     if (request.params[2].isObject()) {
         UniValue options = request.params[2].get_obj();
         if (options["encoding"].isStr()) {
@@ -1220,6 +1487,9 @@ static UniValue smsgoutbox(const JSONRPCRequest &request)
         if (options["sending"].isBool()) {
             show_sending = options["sending"].get_bool();
         }
+        if (options["to"].isStr()) {
+            filter_to = ParseFilterTo(options["to"].get_str());
+        }
     }
 
     UniValue result(UniValue::VOBJ);
@@ -1258,7 +1528,14 @@ static UniValue smsgoutbox(const JSONRPCRequest &request)
 
             UniValue messageList(UniValue::VARR);
 
-            while (dbOutbox.NextSmesg(it, db_prefix, chKey, smsgStored)) {
+            std::vector<std::string> vIndexedKeys;
+            if (filter_to) {
+                vIndexedKeys = ListKeysTo(dbOutbox, db_prefix, *filter_to);
+            }
+            size_t nNextIndexed = 0;
+            while (filter_to
+                ? NextIndexedSmesg(dbOutbox, vIndexedKeys, nNextIndexed, chKey, smsgStored)
+                : dbOutbox.NextSmesg(it, db_prefix, chKey, smsgStored)) {
                 uint8_t *pHeader = &smsgStored.vchMessage[0];
                 const smsg::SecureMessage *psmsg = (smsg::SecureMessage*) pHeader;
 
@@ -1356,10 +1633,11 @@ static UniValue smsgbuckets(const JSONRPCRequest &request)
         uint32_t nBuckets = 0;
         uint32_t nMessages = 0;
         uint64_t nBytes = 0;
-        {
-            LOCK(smsgModule.cs_smsg);
+        // Shards hold buckets out of time order
+        std::map<int64_t, UniValue> mapBuckets;
+        smsgModule.buckets.ForEachShard([&](smsg::SecMsgBucketShards::Shard &shard) {
             std::map<int64_t, smsg::SecMsgBucket>::const_iterator it;
-            for (it = smsgModule.buckets.begin(); it != smsgModule.buckets.end(); ++it) {
+            for (it = shard.buckets.begin(); it != shard.buckets.end(); ++it) {
                 const std::set<smsg::SecMsgToken> &tokenSet = it->second.setTokens;
 
                 std::string sBucket = std::to_string(it->first);
@@ -1401,10 +1679,13 @@ static UniValue smsgbuckets(const JSONRPCRequest &request)
                     }
                 }
                 if (objM.size() > 0) {
-                    arrBuckets.push_back(objM);
+                    mapBuckets.emplace(it->first, objM);
                 }
             }
-        } // cs_smsg
+        });
+        for (const auto &entry : mapBuckets) {
+            arrBuckets.push_back(entry.second);
+        }
 
         UniValue objM(UniValue::VOBJ);
         objM.pushKV("numbuckets", (int)nBuckets);
@@ -1419,19 +1700,22 @@ static UniValue smsgbuckets(const JSONRPCRequest &request)
     if (mode == "dump") {
         {
             LOCK(smsgModule.cs_smsg);
-            std::map<int64_t, smsg::SecMsgBucket>::iterator it;
-            for (it = smsgModule.buckets.begin(); it != smsgModule.buckets.end(); ++it) {
-                std::string sFile = std::to_string(it->first) + "_01.dat";
-
-                try {
-                    fs::path fullPath = GetDataDir() / smsg::STORE_DIR / sFile;
-                    fs::remove(fullPath);
-                } catch (const fs::filesystem_error& ex) {
-                    //objM.push_back(Pair("file size, error", ex.what()));
-                    LogPrintf("Error removing bucket file %s.\n", ex.what());
+            smsgModule.buckets.ForEachShard([](smsg::SecMsgBucketShards::Shard &shard) {
+                std::map<int64_t, smsg::SecMsgBucket>::iterator it;
+                for (it = shard.buckets.begin(); it != shard.buckets.end(); ++it) {
+                    std::string sFile = std::to_string(it->first) + "_01.dat";
+
+                    try {
+                        fs::path fullPath = GetDataDir() / smsg::STORE_DIR / sFile;
+                        fs::remove(fullPath);
+                    } catch (const fs::filesystem_error& ex) {
+                        //objM.push_back(Pair("file size, error", ex.what()));
+                        LogPrintf("Error removing bucket file %s.\n", ex.what());
+                    }
                 }
-            }
-            smsgModule.buckets.clear();
+                shard.buckets.clear();
+                shard.show_requests.clear();
+            });
             smsgModule.start_time = GetAdjustedTime();
         } // cs_smsg
 
@@ -2229,14 +2513,19 @@ static UniValue smsgzmqpush(const JSONRPCRequest &request)
 
         uint8_t chKey[30];
         smsg::SecMsgStored smsgStored;
+        smsg::SecMsgStoredMeta smsgMeta;
         leveldb::Iterator *it = dbInbox.pdb->NewIterator(leveldb::ReadOptions());
-        while (dbInbox.NextSmesg(it, smsg::DBK_INBOX, chKey, smsgStored)) {
+        // Filter on the index, only read the matching messages
+        while (dbInbox.NextSmesgMeta(it, smsg::DBK_INBOX, chKey, smsgMeta)) {
             if (unreadonly
-                && !(smsgStored.status & SMSG_MASK_UNREAD)) {
+                && !(smsgMeta.status & SMSG_MASK_UNREAD)) {
+                continue;
+            }
+            if (smsgMeta.timeReceived < timefrom ||
+                smsgMeta.timeReceived > timeto) {
                 continue;
             }
-            if (smsgStored.timeReceived < timefrom ||
-                smsgStored.timeReceived > timeto) {
+            if (!dbInbox.ReadSmesg(chKey, smsgStored)) {
                 continue;
             }
 
@@ -2309,24 +2598,25 @@ static UniValue smsgdebug(const JSONRPCRequest &request)
         }
 
         int num_messages = 0;
-        LOCK(smsgModule.cs_smsg);
-        std::map<int64_t, smsg::SecMsgBucket>::const_iterator it;
         std::vector<uint8_t> vch_msg;
-        for (it = smsgModule.buckets.begin(); it != smsgModule.buckets.end(); ++it) {
-            const std::set<smsg::SecMsgToken> &token_set = it->second.setTokens;
-            for (auto token : token_set) {
-                if (smsgModule.Retrieve(token, vch_msg) != smsg::SMSG_NO_ERROR) {
-                    LogPrintf("SecureMsgRetrieve failed %d.\n", token.timestamp);
-                    continue;
-                }
-                const smsg::SecureMessage *psmsg = (smsg::SecureMessage*) vch_msg.data();
-                if (psmsg->version[0] == 0 && psmsg->version[1] == 0) {
-                    continue; // Skip purged
+        smsgModule.buckets.ForEachShard([&](smsg::SecMsgBucketShards::Shard &shard) {
+            std::map<int64_t, smsg::SecMsgBucket>::const_iterator it;
+            for (it = shard.buckets.begin(); it != shard.buckets.end(); ++it) {
+                const std::set<smsg::SecMsgToken> &token_set = it->second.setTokens;
+                for (auto token : token_set) {
+                    if (smsgModule.Retrieve(token, vch_msg) != smsg::SMSG_NO_ERROR) {
+                        LogPrintf("SecureMsgRetrieve failed %d.\n", token.timestamp);
+                        continue;
+                    }
+                    const smsg::SecureMessage *psmsg = (smsg::SecureMessage*) vch_msg.data();
+                    if (psmsg->version[0] == 0 && psmsg->version[1] == 0) {
+                        continue; // Skip purged
+                    }
+                    file << strprintf("%d,%s\n", it->first, HexStr(smsgModule.GetMsgID(psmsg, vch_msg.data() + smsg::SMSG_HDR_LEN)));
+                    num_messages++;
                 }
-                file << strprintf("%d,%s\n", it->first, HexStr(smsgModule.GetMsgID(psmsg, vch_msg.data() + smsg::SMSG_HDR_LEN)));
-                num_messages++;
             }
-        }
+        });
 
         file.close();
         result.pushKV("messages", num_messages);
@@ -2353,6 +2643,7 @@ static const CRPCCommand commands[] =
     { "smsg",               "smsgdumpprivkey",        &smsgdumpprivkey,        {"address"} },
     { "smsg",               "smsggetpubkey",          &smsggetpubkey,          {"address"} },
     { "smsg",               "smsgsend",               &smsgsend,               {"address_from","address_to","message","paid_msg","days_retention","testfee","options","coincontrol"} },
+    { "smsg",               "smsgsendbatch",          &smsgsendbatch,          {"address_from","messages","paid_msg","days_retention","testfee","options","coincontrol"} },
     { "smsg",               "smsgsendanon",           &smsgsendanon,           {"address_to","message"} },
     { "smsg",               "smsginbox",              &smsginbox,              {"mode","filter","options"} },
     { "smsg",               "smsgoutbox",             &smsgoutbox,             {"mode","filter","options"} },
@@ -0,0 +1,154 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <smsg/sketch.h>
+
+#include <xxhash/xxhash.h>
+
+#include <assert.h>
+#include <string.h>
+
+namespace smsg {
+
+static void HashKey(int64_t timestamp, uint64_t sample, uint64_t &index_hash, uint32_t &check)
+{
+    uint8_t data[16];
+    memcpy(data, &timestamp, 8);
+    memcpy(data + 8, &sample, 8);
+    index_hash = XXH64(data, 16, 0);
+    check = XXH32(data, 16, 2);
+}
+
+SecMsgSketch::SecMsgSketch(size_t size) : m_size(size), m_cells(size * SKETCH_SUBTABLES)
+{
+    assert(IsValidSize(size));
+}
+
+bool SecMsgSketch::IsValidSize(size_t size)
+{
+    return size >= SKETCH_MIN_SIZE && size <= SKETCH_MAX_SIZE && (size & (size - 1)) == 0;
+}
+
+void SecMsgSketch::Update(int64_t timestamp, uint64_t sample, int32_t n)
+{
+    uint64_t index_hash;
+    uint32_t check;
+    HashKey(timestamp, sample, index_hash, check);
+
+    for (size_t i = 0; i < SKETCH_SUBTABLES; ++i) {
+        Cell &cell = m_cells[i * m_size + ((index_hash >> (21 * i)) & (m_size - 1))];
+        cell.count += n;
+        cell.check ^= check;
+        cell.timestamp ^= timestamp;
+        cell.sample ^= sample;
+    }
+}
+
+void SecMsgSketch::Update(int64_t timestamp, const uint8_t *sample, int32_t n)
+{
+    uint64_t sample_u64;
+    memcpy(&sample_u64, sample, 8);
+    Update(timestamp, sample_u64, n);
+}
+
+SecMsgSketch SecMsgSketch::Fold(size_t size) const
+{
+    assert(size <= m_size);
+    SecMsgSketch folded(size);
+    for (size_t i = 0; i < SKETCH_SUBTABLES; ++i) {
+        for (size_t k = 0; k < m_size; ++k) {
+            const Cell &from = m_cells[i * m_size + k];
+            Cell &to = folded.m_cells[i * size + (k & (size - 1))];
+            to.count += from.count;
+            to.check ^= from.check;
+            to.timestamp ^= from.timestamp;
+            to.sample ^= from.sample;
+        }
+    }
+    return folded;
+}
+
+void SecMsgSketch::Subtract(const SecMsgSketch &other)
+{
+    assert(other.m_size == m_size);
+    for (size_t k = 0; k < m_cells.size(); ++k) {
+        m_cells[k].count -= other.m_cells[k].count;
+        m_cells[k].check ^= other.m_cells[k].check;
+        m_cells[k].timestamp ^= other.m_cells[k].timestamp;
+        m_cells[k].sample ^= other.m_cells[k].sample;
+    }
+}
+
+bool SecMsgSketch::Decode(std::vector<SketchKey> &only_this, std::vector<SketchKey> &only_other) const
+{
+    SecMsgSketch work = *this;
+    std::vector<size_t> pending(m_cells.size());
+    for (size_t k = 0; k < pending.size(); ++k) {
+        pending[k] = k;
+    }
+
+    while (!pending.empty()) {
+        const Cell cell = work.m_cells[pending.back()];
+        pending.pop_back();
+        if (cell.count != 1 && cell.count != -1) {
+            continue;
+        }
+        uint64_t index_hash;
+        uint32_t check;
+        HashKey(cell.timestamp, cell.sample, index_hash, check);
+        if (check != cell.check) {
+            continue; // Not pure
+        }
+
+        (cell.count == 1 ? only_this : only_other).emplace_back(cell.timestamp, cell.sample);
+        if (only_this.size() + only_other.size() > m_cells.size()) {
+            return false; // Corrupt sketch
+        }
+        work.Update(cell.timestamp, cell.sample, -cell.count);
+        for (size_t i = 0; i < SKETCH_SUBTABLES; ++i) {
+            pending.push_back(i * m_size + ((index_hash >> (21 * i)) & (m_size - 1)));
+        }
+    }
+
+    for (const auto &cell : work.m_cells) {
+        if (!cell.IsEmpty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SecMsgSketch::GetData(std::vector<uint8_t> &vchData) const
+{
+    size_t ofs = vchData.size();
+    vchData.resize(ofs + m_cells.size() * SKETCH_CELL_BYTES);
+    uint8_t *p = &vchData[ofs];
+    for (const auto &cell : m_cells) {
+        memcpy(p, &cell.count, 4);
+        memcpy(p+4, &cell.check, 4);
+        memcpy(p+8, &cell.timestamp, 8);
+        memcpy(p+16, &cell.sample, 8);
+        p += SKETCH_CELL_BYTES;
+    }
+}
+
+bool SecMsgSketch::SetData(const uint8_t *p, size_t nBytes)
+{
+    if (nBytes != m_cells.size() * SKETCH_CELL_BYTES) {
+        return false;
+    }
+    for (auto &cell : m_cells) {
+        memcpy(&cell.count, p, 4);
+        memcpy(&cell.check, p+4, 4);
+        memcpy(&cell.timestamp, p+8, 8);
+        memcpy(&cell.sample, p+16, 8);
+        p += SKETCH_CELL_BYTES;
+        if (cell.count > SKETCH_MAX_COUNT || cell.count < -SKETCH_MAX_COUNT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace smsg
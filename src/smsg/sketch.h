@@ -0,0 +1,79 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FALCON_SMSG_SKETCH_H
+#define FALCON_SMSG_SKETCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <utility>
+#include <vector>
+
+namespace smsg {
+
+//! Cells per subtable, the sketch holds SKETCH_SUBTABLES times as many cells
+const size_t SKETCH_MIN_SIZE = 8;
+const size_t SKETCH_MAX_SIZE = 256;
+const size_t SKETCH_SUBTABLES = 3;
+const size_t SKETCH_CELL_BYTES = 24;
+//! Bound on cell counts read from peers, keeps the arithmetic from overflowing
+const int32_t SKETCH_MAX_COUNT = 1 << 24;
+
+/** Token timestamp and sample, the fields peers know a message by */
+typedef std::pair<int64_t, uint64_t> SketchKey;
+
+/**
+ * Invertible bloom lookup table over bucket tokens.
+ *
+ * Peers subtract each others sketches and peel the result to find the tokens
+ * only one side has, the size needed depends on the number of differences,
+ * not on the number of tokens. Each key maps to one cell in each subtable,
+ * subtable sizes are powers of two so a sketch can be folded down to a
+ * smaller size matching the peer's request.
+ */
+class SecMsgSketch
+{
+public:
+    struct Cell {
+        int32_t count = 0;
+        uint32_t check = 0;
+        int64_t timestamp = 0;
+        uint64_t sample = 0;
+
+        bool IsEmpty() const { return count == 0 && check == 0 && timestamp == 0 && sample == 0; }
+    };
+
+    explicit SecMsgSketch(size_t size);
+
+    size_t Size() const { return m_size; }
+    static bool IsValidSize(size_t size);
+
+    void Insert(int64_t timestamp, const uint8_t *sample) { Update(timestamp, sample, 1); }
+    void Erase(int64_t timestamp, const uint8_t *sample) { Update(timestamp, sample, -1); }
+
+    /** Return a copy reduced to size cells per subtable, size <= Size() */
+    SecMsgSketch Fold(size_t size) const;
+    /** Subtract a sketch of the same size */
+    void Subtract(const SecMsgSketch &other);
+    /**
+     * Peel a subtracted sketch into the keys only in this (positive count)
+     * and only in other. Returns false if the difference is too large to decode.
+     */
+    bool Decode(std::vector<SketchKey> &only_this, std::vector<SketchKey> &only_other) const;
+
+    void GetData(std::vector<uint8_t> &vchData) const;
+    /** Read Size() * SKETCH_SUBTABLES cells */
+    bool SetData(const uint8_t *p, size_t nBytes);
+
+private:
+    size_t m_size;
+    std::vector<Cell> m_cells;
+
+    void Update(int64_t timestamp, const uint8_t *sample, int32_t n);
+    void Update(int64_t timestamp, uint64_t sample, int32_t n);
+};
+
+} // namespace smsg
+
+#endif // FALCON_SMSG_SKETCH_H
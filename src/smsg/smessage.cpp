@@ -30,10 +30,13 @@ Notes:
 #include <crypto/sha512.h>
 #include <wallet/ismine.h>
 #include <support/allocators/secure.h>
+#include <util/memory.h>
 #include <util/strencodings.h>
 #include <consensus/validation.h>
 #include <validation.h>
 #include <validationinterface.h>
+#include <timedata.h>
+#include <index/smsgfundindex.h>
 #include <smsg/crypter.h>
 #include <smsg/db.h>
 #include <sync.h>
@@ -58,6 +61,8 @@ Notes:
 #include <stdexcept>
 #include <errno.h>
 #include <limits>
+#include <atomic>
+#include <thread>
 
 #include <xxhash/xxhash.h>
 #include <boost/algorithm/string/replace.hpp>
@@ -79,10 +84,17 @@ const char *HAVE="smsgHave";
 const char *WANT="smsgWant";
 const char *MSG="smsgMsg";
 const char *IGNORING="smsgIgnore";
+const char *REQSKETCH="smsgReqSketch";
+const char *SKETCH="smsgSketch";
 
-const static std::string allTypes[] = {
-    PING, PONG, DISABLED, INV, SHOW, HAVE, WANT, MSG, IGNORING
+const static std::vector<std::string> allTypes = {
+    PING, PONG, DISABLED, INV, SHOW, HAVE, WANT, MSG, IGNORING, REQSKETCH, SKETCH
 };
+
+const std::vector<std::string> &getAllTypes()
+{
+    return allTypes;
+}
 } // namespace SMSGMsgType
 
 namespace smsg {
@@ -100,6 +112,7 @@ const size_t MAX_BUNCH_MESSAGES = 500;
 const size_t MAX_BUNCH_BYTES = SMSG_MAX_MSG_BYTES_PAID * 4;
 const uint16_t MAX_WANT_SENT = 16000;
 const size_t SMSG_MAX_SHOW = 64;
+const uint32_t SKETCH_DIFF_SLACK = 4; // added to the difference in message counts, buckets with equal counts can still differ
 
 boost::thread_group threadGroupSmsg;
 
@@ -117,34 +130,77 @@ std::string SecMsgToken::ToString() const
     return strprintf("%d-%08x", timestamp, *((uint64_t*)sample));
 }
 
-void SecMsgBucket::hashBucket(int64_t bucket_time)
+static uint32_t TokenDigest(const SecMsgToken &token)
 {
-    XXH32_state_t *state = XXH32_createState();
-    XXH32_reset(state, 1);
-
-    int64_t now = GetAdjustedTime();
+    uint8_t data[16];
+    memcpy(data, &token.timestamp, 8);
+    memcpy(data + 8, token.sample, 8);
+    return XXH32(data, 16, 1);
+}
 
-    nActive = 0;
-    nLeastTTL = 0;
-    for (auto it = setTokens.begin(); it != setTokens.end(); ++it) {
-        if (it->timestamp + it->ttl < now) {
-            continue;
+void SecMsgBucket::Activate(const SecMsgToken &token, int64_t now)
+{
+    int64_t expiry = token.timestamp + token.ttl;
+    if (expiry < now) {
+        return;
+    }
+    if (m_expiry.emplace(expiry, &token).second) {
+        m_digest += TokenDigest(token);
+        m_legacy_valid = false;
+        if (m_sketch) {
+            m_sketch->Insert(token.timestamp, token.sample);
         }
+    }
+}
 
-        XXH32_update(state, it->sample, 8);
-        if (it->ttl > 0 && (nLeastTTL == 0 || it->ttl < nLeastTTL)) {
-            nLeastTTL = it->ttl;
+void SecMsgBucket::Deactivate(const SecMsgToken &token)
+{
+    if (m_expiry.erase(std::make_pair(token.timestamp + token.ttl, &token)) > 0) {
+        m_digest -= TokenDigest(token);
+        m_legacy_valid = false;
+        if (m_sketch) {
+            m_sketch->Erase(token.timestamp, token.sample);
         }
-        nActive++;
     }
+}
 
-    uint32_t hash_new = XXH32_digest(state);
-    XXH32_freeState(state);
+void SecMsgBucket::AddToken(const SecMsgToken &token, int64_t now)
+{
+    auto ret = setTokens.insert(token);
+    if (ret.second) {
+        Activate(*ret.first, now);
+    }
+}
+
+void SecMsgBucket::SetTokenTTL(std::set<SecMsgToken>::iterator it, uint32_t ttl, int64_t now)
+{
+    Deactivate(*it);
+    it->ttl = ttl;
+    Activate(*it, now);
+}
+
+void SecMsgBucket::ClearTokens()
+{
+    m_expiry.clear();
+    setTokens.clear();
+    m_digest = 0;
+    m_legacy_valid = false;
+    m_sketch.reset();
+}
 
-    if (hash != hash_new) {
-        LogPrint(BCLog::SMSG, "Bucket %d hashed %u messages updated from %u to %u.\n", bucket_time, nActive, hash, hash_new);
+void SecMsgBucket::hashBucket(int64_t bucket_time)
+{
+    int64_t now = GetAdjustedTime();
+
+    while (!m_expiry.empty() && m_expiry.begin()->first < now) {
+        Deactivate(*m_expiry.begin()->second);
+    }
+    nActive = m_expiry.size();
 
-        hash = hash_new;
+    if (hash != m_digest) {
+        LogPrint(BCLog::SMSG, "Bucket %d hashed %u messages updated from %u to %u.\n", bucket_time, nActive, hash, m_digest);
+
+        hash = m_digest;
         timeChanged = GetTime();
     }
     return;
@@ -152,150 +208,235 @@ void SecMsgBucket::hashBucket(int64_t bucket_time)
 
 size_t SecMsgBucket::CountActive() const
 {
-    size_t nMessages = 0;
+    size_t nExpired = 0;
 
     int64_t now = GetAdjustedTime();
+    for (auto it = m_expiry.begin(); it != m_expiry.end() && it->first < now; ++it) {
+        nExpired++;
+    }
+
+    return m_expiry.size() - nExpired;
+};
+
+int64_t SecMsgBucket::NextExpiry() const
+{
+    return m_expiry.empty() ? 0 : m_expiry.begin()->first;
+};
+
+uint32_t SecMsgBucket::LegacyHash()
+{
+    if (m_legacy_valid) {
+        return m_legacy_hash;
+    }
+
+    // Versions before SMSG_VERSION_BUCKET_DIGEST hash the samples in token order
+    XXH32_state_t *state = XXH32_createState();
+    XXH32_reset(state, 1);
     for (auto it = setTokens.begin(); it != setTokens.end(); ++it) {
-        if (it->timestamp + it->ttl < now) {
+        if (m_expiry.count(std::make_pair(it->timestamp + it->ttl, &*it)) == 0) {
             continue;
         }
-        nMessages++;
+        XXH32_update(state, it->sample, 8);
     }
+    m_legacy_hash = XXH32_digest(state);
+    XXH32_freeState(state);
+
+    m_legacy_valid = true;
+    return m_legacy_hash;
+};
 
-    return nMessages;
+const SecMsgSketch &SecMsgBucket::GetSketch()
+{
+    if (!m_sketch) {
+        m_sketch = MakeUnique<SecMsgSketch>(SKETCH_MAX_SIZE);
+        for (const auto &entry : m_expiry) {
+            m_sketch->Insert(entry.second->timestamp, entry.second->sample);
+        }
+    }
+    return *m_sketch;
+};
+
+size_t SecMsgBucketShards::Size()
+{
+    size_t n = 0;
+    ForEachShard([&n](Shard &shard) { n += shard.buckets.size(); });
+    return n;
+};
+
+void SecMsgBucketShards::Clear()
+{
+    ForEachShard([](Shard &shard) {
+        for (auto &it : shard.buckets) {
+            it.second.ClearTokens();
+        }
+        shard.buckets.clear();
+        shard.show_requests.clear();
+    });
 };
 
 /** Bucket management thread
   */
 void ThreadSecureMsg()
 {
-    uint32_t nLoop = 0;
+    std::vector<SecMsgTimer> vDue;
     std::vector<std::pair<int64_t, NodeId> > vTimedOutLocks;
     while (fSecMsgEnabled) {
-        nLoop++;
-        int64_t now = GetAdjustedTime();
+        vDue.clear();
+        vTimedOutLocks.clear();
+        smsgModule.m_timers.Advance(GetTime(), vDue);
 
-        vTimedOutLocks.resize(0);
-        int64_t cutoffTime = now - SMSG_RETENTION;
-        {
-            LOCK(smsgModule.cs_smsg);
-            for (std::map<int64_t, SecMsgBucket>::iterator it(smsgModule.buckets.begin()); it != smsgModule.buckets.end(); ) {
-                bool fErase = it->first < cutoffTime;
+        if (!vDue.empty()) {
+            smsgModule.ProcessTimers(vDue, vTimedOutLocks);
+        }
 
-                if (!fErase
-                    && it->first + it->second.nLeastTTL < now) {
-                    it->second.hashBucket(it->first);
+        for (const auto &timed_out : vTimedOutLocks) {
+            NodeId nPeerId = timed_out.second;
+            LogPrint(BCLog::SMSG, "Lock on bucket %d for peer %d timed out.\n", timed_out.first, nPeerId);
 
-                    // TODO: periodically prune files
-                    if (it->second.nActive < 1) {
-                        fErase = true;
-                    }
-                }
+            g_connman->ForNode(nPeerId, [nPeerId](CNode *pnode) {
+                LOCK(pnode->smsgData.cs_smsg_net);
+                int64_t ignoreUntil = GetTime() + SMSG_TIME_IGNORE;
+                pnode->smsgData.ignoreUntil = ignoreUntil;
 
-                if (fErase) {
-                    LogPrint(BCLog::SMSG, "Removing bucket %d.\n", it->first);
+                // Alert peer that they are being ignored
+                std::vector<uint8_t> vchData;
+                vchData.resize(8);
+                memcpy(&vchData[0], &ignoreUntil, 8);
+                g_connman->PushMessage(pnode,
+                    CNetMsgMaker(INIT_PROTO_VERSION).Make(SMSGMsgType::IGNORING, vchData));
 
-                    std::string fileName = std::to_string(it->first);
+                LogPrint(BCLog::SMSG, "This node will ignore peer %d until %d.\n", nPeerId, ignoreUntil);
+                return true;
+            });
+        }
 
-                    fs::path fullPath = GetDataDir() / STORE_DIR / (fileName + "_01.dat");
-                    if (fs::exists(fullPath)) {
-                        try { fs::remove(fullPath);
-                        } catch (const fs::filesystem_error &ex) {
-                            LogPrintf("Error removing bucket file %s.\n", ex.what());
-                        }
-                    } else {
-                        LogPrintf("Path %s does not exist.\n", fullPath.string());
-                    }
+        MilliSleep(SMSG_THREAD_DELAY * 1000); // advance the timer wheel every SMSG_THREAD_DELAY seconds
+    }
+    return;
+};
 
-                    // Look for a wl file, it stores incoming messages when wallet is locked
-                    fullPath = GetDataDir() / STORE_DIR / (fileName + "_01_wl.dat");
-                    if (fs::exists(fullPath)) {
-                        try { fs::remove(fullPath);
-                        } catch (const fs::filesystem_error &ex) {
-                            LogPrintf("Error removing wallet locked file %s.\n", ex.what());
-                        }
-                    }
+void CSMSG::ScheduleBucketExpiry(int64_t bucket_time, SecMsgBucket &bucket)
+{
+    int64_t expiry = bucket.NextExpiry();
+    if (expiry == 0) {
+        if (bucket.nLockUntil != 0) {
+            return; // Rescheduled when the lock is released
+        }
+        expiry = GetAdjustedTime(); // Remove empty bucket
+    } else {
+        expiry = std::min(expiry + 1, bucket_time + (int64_t)SMSG_RETENTION + 1);
+    }
+    if (bucket.nTimerExpiry != 0 && bucket.nTimerExpiry <= expiry) {
+        return;
+    }
+    bucket.nTimerExpiry = expiry;
+    // The wheel runs on local time
+    m_timers.Schedule(expiry - GetTimeOffset(), SMSG_TIMER_BUCKET_EXPIRY, bucket_time, expiry);
+};
 
-                    smsgModule.buckets.erase(it++);
-                } else {
-                    if (it->second.nLockCount > 0) { // Tick down nLockCount, to eventually expire if peer never sends data
-                        it->second.nLockCount--;
+static void RemoveBucketFiles(int64_t bucket_time)
+{
+    std::string fileName = std::to_string(bucket_time);
 
-                        if (it->second.nLockCount == 0) { // lock timed out
-                            vTimedOutLocks.push_back(std::make_pair(it->first, it->second.nLockPeerId)); // g_connman->cs_vNodes
-                            it->second.nLockPeerId = -1;
-                        }
-                    }
-                    ++it;
-                }
-            }
+    fs::path fullPath = GetDataDir() / STORE_DIR / (fileName + "_01.dat");
+    if (fs::exists(fullPath)) {
+        try { fs::remove(fullPath);
+        } catch (const fs::filesystem_error &ex) {
+            LogPrintf("Error removing bucket file %s.\n", ex.what());
+        }
+    } else {
+        LogPrintf("Path %s does not exist.\n", fullPath.string());
+    }
 
-            if (smsgModule.nLastProcessedPurged + SMSG_SECONDS_IN_DAY < now) {
-                smsgModule.BuildPurgedSets();
-            }
+    // Look for a wl file, it stores incoming messages when wallet is locked
+    fullPath = GetDataDir() / STORE_DIR / (fileName + "_01_wl.dat");
+    if (fs::exists(fullPath)) {
+        try { fs::remove(fullPath);
+        } catch (const fs::filesystem_error &ex) {
+            LogPrintf("Error removing wallet locked file %s.\n", ex.what());
+        }
+    }
+};
 
-            if (nLoop % 20 == 0) {
-                // Erase any unreceived show_requests
-                int64_t local_time = GetTime();
-                for (auto it = smsgModule.m_show_requests.begin(); it != smsgModule.m_show_requests.end(); ) {
-                    if (it->second < local_time) {
-                        it = smsgModule.m_show_requests.erase(it);
-                    } else {
-                        ++it;
-                    }
+void CSMSG::ProcessTimers(const std::vector<SecMsgTimer> &due, std::vector<std::pair<int64_t, NodeId> > &timed_out_locks)
+{
+    int64_t now = GetAdjustedTime();
+    int64_t local_time = GetTime();
+    for (const auto &timer : due) {
+        switch (timer.type) {
+            case SMSG_TIMER_BUCKET_EXPIRY:
+                {
+                SecMsgBucketShards::Shard &shard = buckets.Get(timer.key);
+                LOCK(shard.cs);
+                auto it = shard.buckets.find(timer.key);
+                if (it == shard.buckets.end()) {
+                    break;
                 }
-            }
-        } // cs_smsg
-
-        if (nLoop % 20 == 0) {
-            LOCK(g_connman->cs_vNodes);
-            for (auto *pnode : g_connman->vNodes) {
-                LOCK(pnode->smsgData.cs_smsg_net);
-                int64_t cutoffTime = now - SMSG_SECONDS_IN_DAY;
-                for (auto it = pnode->smsgData.m_buckets_last_shown.begin(); it != pnode->smsgData.m_buckets_last_shown.end(); ) {
-                    if (it->first < cutoffTime) {
-                        it = pnode->smsgData.m_buckets_last_shown.erase(it);
-                    } else {
-                        ++it;
-                    }
+                SecMsgBucket &bucket = it->second;
+                if (bucket.nTimerExpiry == timer.data) {
+                    bucket.nTimerExpiry = 0;
                 }
-            }
-        }
-
-        for (std::vector<std::pair<int64_t, NodeId> >::iterator it(vTimedOutLocks.begin()); it != vTimedOutLocks.end(); it++) {
-            NodeId nPeerId = it->second;
-
-            LogPrint(BCLog::SMSG, "Lock on bucket %d for peer %d timed out.\n", it->first, nPeerId);
 
-            // Look through the nodes for the peer that locked this bucket
+                bool fErase = it->first < now - SMSG_RETENTION;
+                if (!fErase
+                    && bucket.NextExpiry() < now) {
+                    bucket.hashBucket(it->first);
 
-            {
-                LOCK(g_connman->cs_vNodes);
-                for (auto *pnode : g_connman->vNodes) {
-                    if (pnode->GetId() != nPeerId) {
-                        continue;
+                    // TODO: periodically prune files
+                    if (bucket.nActive < 1 && bucket.nLockUntil == 0) {
+                        fErase = true;
                     }
+                }
 
-                    LOCK(pnode->smsgData.cs_smsg_net);
-                    int64_t ignoreUntil = GetTime() + SMSG_TIME_IGNORE;
-                    pnode->smsgData.ignoreUntil = ignoreUntil;
-
-                    // Alert peer that they are being ignored
-                    std::vector<uint8_t> vchData;
-                    vchData.resize(8);
-                    memcpy(&vchData[0], &ignoreUntil, 8);
-                    g_connman->PushMessage(pnode,
-                        CNetMsgMaker(INIT_PROTO_VERSION).Make(SMSGMsgType::IGNORING, vchData));
-
-                    LogPrint(BCLog::SMSG, "This node will ignore peer %d until %d.\n", nPeerId, ignoreUntil);
-                    break;
+                if (fErase) {
+                    LogPrint(BCLog::SMSG, "Removing bucket %d.\n", it->first);
+                    RemoveBucketFiles(it->first);
+                    shard.buckets.erase(it);
+                } else {
+                    ScheduleBucketExpiry(it->first, bucket);
+                }
+                }
+                break;
+            case SMSG_TIMER_BUCKET_LOCK:
+                {
+                SecMsgBucketShards::Shard &shard = buckets.Get(timer.key);
+                LOCK(shard.cs);
+                auto it = shard.buckets.find(timer.key);
+                if (it == shard.buckets.end()
+                    || it->second.nLockUntil == 0
+                    || it->second.nLockUntil > local_time
+                    || it->second.nLockPeerId != timer.data) {
+                    break; // Released or locked again since
                 }
-            } // g_connman->cs_vNodes
+                timed_out_locks.push_back(std::make_pair(it->first, it->second.nLockPeerId));
+                it->second.nLockUntil = 0;
+                it->second.nLockPeerId = -1;
+                ScheduleBucketExpiry(it->first, it->second);
+                }
+                break;
+            case SMSG_TIMER_SHOW_REQUEST:
+                {
+                // Erase unreceived show_request
+                SecMsgBucketShards::Shard &shard = buckets.Get(timer.key);
+                LOCK(shard.cs);
+                auto it = shard.show_requests.find(timer.key);
+                if (it != shard.show_requests.end() && it->second <= local_time) {
+                    shard.show_requests.erase(it);
+                }
+                }
+                break;
+            case SMSG_TIMER_PURGED_SETS:
+                {
+                LOCK(cs_smsg);
+                if (nLastProcessedPurged + SMSG_SECONDS_IN_DAY <= local_time) {
+                    BuildPurgedSets();
+                }
+                }
+                break;
+            default:
+                break;
         }
-
-        MilliSleep(SMSG_THREAD_DELAY * 1000); //  // check every SMSG_THREAD_DELAY seconds
     }
-    return;
 };
 
 /** Proof of work thread
@@ -353,15 +494,22 @@ void ThreadSecureMsgPow()
                     continue;
                 }
 
-                CTransactionRef txOut;
                 uint256 hashBlock;
                 int blockDepth = -1;
-                {
+                SmsgFundIndex::FundedMsg funded;
+                if (g_smsg_fund_index && g_smsg_fund_index->BlockUntilSyncedToCurrentChain()) {
+                    if (g_smsg_fund_index->FindFunding(msgId, txid, funded)) {
+                        hashBlock = funded.block_hash;
+                    }
+                } else {
+                    CTransactionRef txOut;
                     LOCK(cs_main);
                     if (!GetTransaction(txid, txOut, Params().GetConsensus(), hashBlock)) {
                         // drop through
                     }
-
+                }
+                {
+                    LOCK(cs_main);
                     if (!hashBlock.IsNull()) {
                         BlockMap::iterator mi = ::BlockIndex().find(hashBlock);
                         if (mi != ::BlockIndex().end()) {
@@ -436,6 +584,7 @@ void AddOptions()
     gArgs.AddArg("-smsgnotify=<cmd>", "Execute command when a message is received. (%s in cmd is replaced by receiving address)", ArgsManager::ALLOW_ANY, OptionsCategory::SMSG);
     gArgs.AddArg("-smsgsaddnewkeys", "Scan for incoming messages on new wallet keys. (default: false)", ArgsManager::ALLOW_ANY, OptionsCategory::SMSG);
     gArgs.AddArg("-smsgbantime=<n>", strprintf("Number of seconds to ignore misbehaving peers for (default: %u)", SMSG_DEFAULT_BANTIME), ArgsManager::ALLOW_ANY, OptionsCategory::SMSG);
+    gArgs.AddArg("-smsgfundindex", strprintf("Maintain an index of the funding of paid messages, so validating them doesn't read the funding transaction from disk (default: %u)", DEFAULT_SMSGFUNDINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::SMSG);
     gArgs.AddArg("-smsgmaxreceive=<n>", strprintf("Max number of data messages to tolerate from peers, counter decreases over time (default: %u)", SMSG_DEFAULT_MAXRCV), ArgsManager::ALLOW_ANY, OptionsCategory::SMSG);
     gArgs.AddArg("-smsgsregtestadjust", "Adjust durations in regtest (default: true)", ArgsManager::ALLOW_ANY, OptionsCategory::HIDDEN);
     return;
@@ -562,10 +711,12 @@ int CSMSG::BuildBucketSet()
         size_t nTokenSetSize = 0;
         SecureMessage smsg;
         {
-            LOCK(cs_smsg);
+            SecMsgBucketShards::Shard &shard = buckets.Get(fileTime);
+            LOCK(shard.cs);
 
-            SecMsgBucket &bucket = buckets[fileTime];
+            SecMsgBucket &bucket = shard.buckets[fileTime];
             std::set<SecMsgToken> &tokenSet = bucket.setTokens;
+            ScheduleBucketExpiry(fileTime, bucket);
 
             FILE *fp;
             if (!(fp = fopen(itd->path().string().c_str(), "rb"))) {
@@ -590,9 +741,6 @@ int CSMSG::BuildBucketSet()
                 token.ttl = smsg.version[0] == 0 && smsg.version[1] == 0 ? 0  // Purged message header
                     : smsg.m_ttl;
                 token.m_changed = now - fileTime;
-                if (smsg.m_ttl > 0 && (bucket.nLeastTTL == 0 || smsg.m_ttl < bucket.nLeastTTL)) {
-                    bucket.nLeastTTL = smsg.m_ttl;
-                }
                 if (smsg.nPayload < 8) {
                     continue;
                 }
@@ -604,19 +752,19 @@ int CSMSG::BuildBucketSet()
                     LogPrintf("fseek failed: %s.\n", strerror(errno));
                     break;
                 }
-                tokenSet.insert(token);
+                bucket.AddToken(token, now);
             }
 
             fclose(fp);
             bucket.hashBucket(fileTime);
             nTokenSetSize = tokenSet.size();
-        } // cs_smsg
+        } // shard.cs
 
         nMessages += nTokenSetSize;
         LogPrint(BCLog::SMSG, "Bucket %d contains %u messages.\n", fileTime, nTokenSetSize);
     }
 
-    LogPrintf("Processed %u files, loaded %u buckets containing %u messages.\n", nFiles, buckets.size(), nMessages);
+    LogPrintf("Processed %u files, loaded %u buckets containing %u messages.\n", nFiles, buckets.Size(), nMessages);
     return SMSG_NO_ERROR;
 };
 
@@ -652,6 +800,7 @@ int CSMSG::BuildPurgedSets()
     LogPrint(BCLog::SMSG, "Loaded %u purged tokens from database.\n", nPurged);
 
     nLastProcessedPurged = now;
+    m_timers.Schedule(now + SMSG_SECONDS_IN_DAY, SMSG_TIMER_PURGED_SETS, 0);
 
     return SMSG_NO_ERROR;
 };
@@ -943,11 +1092,22 @@ bool CSMSG::Start(std::shared_ptr<CWallet> pwalletIn, std::vector<std::shared_pt
         ScanBlockChain();
     }
 
+    m_timers.Reset(GetTime());
+
     if (BuildBucketSet() != 0) {
         Disable();
         return error("%s: Could not load bucket sets, secure messaging disabled.", __func__);
     }
 
+    {
+        LOCK(cs_smsgDB);
+        SecMsgDB db;
+        if (!db.Open("cr+") || !db.CheckIndexes()) {
+            Disable();
+            return error("%s: Could not index smsg db, secure messaging disabled.", __func__);
+        }
+    }
+
     if (BuildPurgedSets() != 0) {
         Disable();
         return error("%s: Could not load purged sets, secure messaging disabled.", __func__);
@@ -1018,7 +1178,7 @@ bool CSMSG::Enable(std::shared_ptr<CWallet> pactive_wallet, std::vector<std::sha
         LOCK(cs_smsg);
 
         addresses.clear(); // should be empty already
-        buckets.clear(); // should be empty already
+        buckets.Clear(); // should be empty already
 
         if (!Start(pactive_wallet, vpwallets, false)) {
             return error("%s: SecureMsgStart failed.\n", __func__);
@@ -1058,12 +1218,8 @@ bool CSMSG::Disable()
             return error("%s: SecureMsgShutdown failed.\n", __func__);
         }
 
-        // Clear buckets
-        std::map<int64_t, SecMsgBucket>::iterator it;
-        for (it = buckets.begin(); it != buckets.end(); ++it) {
-            it->second.setTokens.clear();
-        }
-        buckets.clear();
+        buckets.Clear();
+        m_timers.Reset(GetTime());
         addresses.clear();
     }
 
@@ -1261,6 +1417,12 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
             (1) A list of the message hashes that a node does not have and wants to retrieve from the node which sent smsgHave
         + smsgMsg =
             (1) In response to
+        + smsgReqSketch =
+            (1) Sent instead of smsgShow to peers from SMSG_VERSION_SKETCH when the buckets are expected to differ by few messages.
+            (2) respond with smsgSketch - a sketch of the message hashes in each requested bucket, sized as requested.
+        + smsgSketch =
+            (1) Subtracted from the sketch of the local bucket, the messages only the peer has are requested with smsgWant.
+            (2) If the difference can't be decoded fall back to smsgShow.
         + smsgPing = ping request
         + smsgPong = pong response
     */
@@ -1326,9 +1488,9 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
         uint32_t nLocked = 0;           // no. of locked buckets on this node
         uint32_t nInvBuckets;           // no. of bucket headers sent by peer in smsgInv
         memcpy(&nInvBuckets, &vchData[0], 4);
+        bool fLegacyHash = WITH_LOCK(pfrom->smsgData.cs_smsg_net, return pfrom->smsgData.m_version < SMSG_VERSION_BUCKET_DIGEST);
         if (LogAcceptCategory(BCLog::SMSG)) {
-            LOCK(cs_smsg);
-            LogPrintf("Peer %d sent %d bucket headers, this has %d.\n", pfrom->GetId(), nInvBuckets, buckets.size());
+            LogPrintf("Peer %d sent %d bucket headers, this has %d.\n", pfrom->GetId(), nInvBuckets, buckets.Size());
         }
 
         // Check no of buckets:
@@ -1380,17 +1542,18 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
             }
 
             {
-                LOCK(cs_smsg);
-                const auto it_lb = buckets.find(time);
+                SecMsgBucketShards::Shard &shard = buckets.Get(time);
+                LOCK(shard.cs);
+                const auto it_lb = shard.buckets.find(time);
                 if (LogAcceptCategory(BCLog::SMSG)) {
                     LogPrintf("Peer bucket %d %u %u.\n", time, ncontent, hash);
-                    if (it_lb != buckets.end()) {
-                        LogPrintf("This bucket %d %u %u.\n", time, it_lb->second.setTokens.size(), it_lb->second.hash);
+                    if (it_lb != shard.buckets.end()) {
+                        LogPrintf("This bucket %d %u %u.\n", time, it_lb->second.setTokens.size(), fLegacyHash ? it_lb->second.LegacyHash() : it_lb->second.hash);
                     }
                 }
 
-                if (it_lb != buckets.end() && it_lb->second.nLockCount > 0) {
-                    LogPrint(BCLog::SMSG, "Bucket is locked %u, waiting for peer %u to send data.\n", it_lb->second.nLockCount, it_lb->second.nLockPeerId);
+                if (it_lb != shard.buckets.end() && it_lb->second.nLockUntil != 0) {
+                    LogPrint(BCLog::SMSG, "Bucket is locked until %d, waiting for peer %u to send data.\n", it_lb->second.nLockUntil, it_lb->second.nLockPeerId);
                     nLocked++;
                     continue;
                 }
@@ -1398,17 +1561,17 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
                 // If this node has more than the peer node, peer node will pull from this
                 //  if then peer node has more this node will pull fom peer
 
-                if (it_lb == buckets.end()
+                if (it_lb == shard.buckets.end()
                     || it_lb->second.nActive < ncontent
                     || (it_lb->second.nActive == ncontent
-                        && it_lb->second.hash != hash)) { // if same amount in buckets check hash
+                        && (fLegacyHash ? it_lb->second.LegacyHash() : it_lb->second.hash) != hash)) { // if same amount in buckets check hash
                         auto nv = PeerBucket(ncontent, hash);
                         auto ret = pfrom->smsgData.m_buckets.insert(std::pair<int64_t, PeerBucket>(time, nv));
                         if (!ret.second) {
                             ret.first->second = nv;
                         }
                 }
-            } // cs_smsg
+            } // shard.cs
         }
     } else
     if (strCommand == SMSGMsgType::SHOW) {
@@ -1447,9 +1610,10 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
             }
 
             {
-                LOCK(cs_smsg);
-                itb = buckets.find(time);
-                if (itb == buckets.end()) {
+                SecMsgBucketShards::Shard &shard = buckets.Get(time);
+                LOCK(shard.cs);
+                itb = shard.buckets.find(time);
+                if (itb == shard.buckets.end()) {
                     LogPrint(BCLog::SMSG, "Don't have bucket %d.\n", time);
                     continue;
                 }
@@ -1490,6 +1654,9 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
             {
                 LOCK(pfrom->smsgData.cs_smsg_net);
                 pfrom->smsgData.m_buckets_last_shown[time] = now;
+                // Buckets are ordered by time, drop those shown over a day ago
+                auto &last_shown_map = pfrom->smsgData.m_buckets_last_shown;
+                last_shown_map.erase(last_shown_map.begin(), last_shown_map.lower_bound(GetAdjustedTime() - SMSG_SECONDS_IN_DAY));
             }
 
             g_connman->PushMessage(pfrom,
@@ -1501,93 +1668,126 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
         std::vector<uint8_t> vchData;
         vRecv >> vchData;
 
-        if (vchData.size() < 8) {
+        return WantMissing(pfrom, vchData);
+    } else
+    if (strCommand == SMSGMsgType::REQSKETCH) {
+        std::vector<uint8_t> vchData;
+        vRecv >> vchData;
+
+        if (vchData.size() < 4) {
             return SMSG_GENERAL_ERROR;
         }
 
-        int n = (vchData.size() - 8) / 16;
-
-        int64_t time;
-        memcpy(&time, &vchData[0], 8);
+        uint32_t nBuckets;
+        memcpy(&nBuckets, &vchData[0], 4);
 
-        // Check time valid:
-        int64_t now = GetAdjustedTime();
-        if (time < now - SMSG_RETENTION) {
-            LogPrint(BCLog::SMSG, "Not interested in peer %d bucket %d, has expired.\n", pfrom->GetId(), time);
-            return SMSG_GENERAL_ERROR;
-        }
-        if (time > now + SMSG_TIME_LEEWAY) {
-            LogPrint(BCLog::SMSG, "Not interested in peer %d bucket %d, in the future.\n", pfrom->GetId(), time);
+        if (nBuckets > SMSG_MAX_SHOW || vchData.size() < 4 + nBuckets * 12) {
             Misbehaving(pfrom->GetId(), 1);
             return SMSG_GENERAL_ERROR;
         }
 
-        std::vector<uint8_t> vchDataOut;
+        LogPrint(BCLog::SMSG, "Peer %d requests sketches of %u buckets.\n", pfrom->GetId(), nBuckets);
 
-        {
-            LOCK(cs_smsg);
-            m_show_requests.erase(time);
+        const uint8_t *pIn = &vchData[4];
+        for (uint32_t i = 0; i < nBuckets; ++i, pIn += 12) {
+            int64_t time;
+            uint32_t nSize;
+            memcpy(&time, pIn, 8);
+            memcpy(&nSize, pIn+8, 4);
 
-            if (pfrom->smsgData.m_num_want_sent >= MAX_WANT_SENT) {
-                LogPrint(BCLog::SMSG, "Too many messages already requested from peer: %d, %d.\n", pfrom->GetId(), pfrom->smsgData.m_num_want_sent);
-                return SMSG_NO_ERROR;
+            if (!SecMsgSketch::IsValidSize(nSize)) {
+                LogPrint(BCLog::SMSG, "Invalid sketch size %u.\n", nSize);
+                Misbehaving(pfrom->GetId(), 1);
+                continue;
             }
 
-            SecMsgBucket &bucket = buckets[time];
-            if (bucket.nLockCount > 0) {
-                LogPrint(BCLog::SMSG, "Bucket %d lock count %u, waiting for message data from peer %u.\n", time, bucket.nLockCount, bucket.nLockPeerId);
-                return SMSG_GENERAL_ERROR;
+            std::vector<uint8_t> vchDataOut(12);
+            memcpy(&vchDataOut[0], &time, 8);
+            memcpy(&vchDataOut[8], &nSize, 4);
+            {
+                SecMsgBucketShards::Shard &shard = buckets.Get(time);
+                LOCK(shard.cs);
+                auto itb = shard.buckets.find(time);
+                if (itb == shard.buckets.end()) {
+                    LogPrint(BCLog::SMSG, "Don't have bucket %d.\n", time);
+                    continue;
+                }
+                itb->second.hashBucket(time);
+                itb->second.GetSketch().Fold(nSize).GetData(vchDataOut);
             }
 
-            LogPrint(BCLog::SMSG, "Sifting through bucket %d.\n", time);
-
-            vchDataOut.resize(8);
-            memcpy(&vchDataOut[0], &vchData[0], 8);
+            g_connman->PushMessage(pfrom,
+                CNetMsgMaker(INIT_PROTO_VERSION).Make(SMSGMsgType::SKETCH, vchDataOut));
+        }
+    } else
+    if (strCommand == SMSGMsgType::SKETCH) {
+        std::vector<uint8_t> vchData;
+        vRecv >> vchData;
 
-            std::set<SecMsgToken> &tokenSet = bucket.setTokens;
-            SecMsgToken token;
-            SecMsgPurged purgedToken;
-            uint8_t *p = &vchData[8];
+        if (vchData.size() < 12) {
+            return SMSG_GENERAL_ERROR;
+        }
 
-            for (int i = 0; i < n; ++i, p += 16) {
-                memcpy(&token.timestamp, p, 8);
-                memcpy(&token.sample, p+8, 8);
+        int64_t time;
+        uint32_t nSize;
+        memcpy(&time, &vchData[0], 8);
+        memcpy(&nSize, &vchData[8], 4);
 
-                if (setPurgedTimestamps.find(token.timestamp) != setPurgedTimestamps.end()) {
-                    memcpy(&purgedToken.timestamp, p, 8);
-                    memcpy(&purgedToken.sample, p+8, 8);
-                    if (setPurged.find(purgedToken) != setPurged.end()) {
-                        continue;
-                    }
-                }
+        if (!SecMsgSketch::IsValidSize(nSize)) {
+            Misbehaving(pfrom->GetId(), 1);
+            return SMSG_GENERAL_ERROR;
+        }
 
-                std::set<SecMsgToken>::const_iterator it = tokenSet.find(token);
-                if (it == tokenSet.end()) {
-                    int nd = vchDataOut.size();
-                    try {
-                        vchDataOut.resize(nd + 16);
-                    } catch (std::exception &e) {
-                        LogPrintf("vchDataOut.resize %d threw: %s.\n", nd + 16, e.what());
-                        continue;
-                    }
+        SecMsgSketch sketch(nSize);
+        if (!sketch.SetData(&vchData[12], vchData.size() - 12)) {
+            LogPrint(BCLog::SMSG, "Invalid sketch from peer %d.\n", pfrom->GetId());
+            Misbehaving(pfrom->GetId(), 1);
+            return SMSG_GENERAL_ERROR;
+        }
 
-                    memcpy(&vchDataOut[nd], p, 16);
-                }
+        SecMsgBucketShards::Shard &shard = buckets.Get(time);
+        std::vector<SketchKey> only_peer, only_this;
+        bool fDecoded;
+        {
+            LOCK(shard.cs);
+            auto itb = shard.buckets.find(time);
+            if (itb != shard.buckets.end()) {
+                itb->second.hashBucket(time);
+                sketch.Subtract(itb->second.GetSketch().Fold(nSize));
             }
+        }
+        fDecoded = sketch.Decode(only_peer, only_this);
 
-            if (vchDataOut.size() > 8) {
-                size_t n_messages = (vchDataOut.size() - 8) / 16;
-                pfrom->smsgData.m_num_want_sent += n_messages;
-                if (LogAcceptCategory(BCLog::SMSG)) {
-                    LogPrintf("Asking peer for %u messages.\n", n_messages);
-                    LogPrintf("Locking bucket %u for peer %d.\n", time, pfrom->GetId());
-                }
-                bucket.nLockCount   = 3; // lock this bucket for at most 3 * SMSG_THREAD_DELAY seconds, unset when peer sends smsgMsg
-                bucket.nLockPeerId  = pfrom->GetId();
-                g_connman->PushMessage(pfrom,
-                    CNetMsgMaker(INIT_PROTO_VERSION).Make(SMSGMsgType::WANT, vchDataOut));
+        if (!fDecoded) {
+            // Difference is larger than the sketch, fall back to the full token list
+            LogPrint(BCLog::SMSG, "Sketch of bucket %d from peer %d failed to decode, requesting list.\n", time, pfrom->GetId());
+            std::vector<uint8_t> vchDataOut(12);
+            uint32_t nBuckets = 1;
+            memcpy(&vchDataOut[0], &nBuckets, 4);
+            memcpy(&vchDataOut[4], &time, 8);
+            {
+                LOCK(shard.cs);
+                shard.show_requests[time] = GetTime() + 10;
+                m_timers.Schedule(shard.show_requests[time], SMSG_TIMER_SHOW_REQUEST, time);
             }
-        } // cs_smsg
+            g_connman->PushMessage(pfrom,
+                CNetMsgMaker(INIT_PROTO_VERSION).Make(SMSGMsgType::SHOW, vchDataOut));
+            return SMSG_NO_ERROR;
+        }
+
+        LogPrint(BCLog::SMSG, "Sketch of bucket %d from peer %d: peer has %u missing, this node has %u extra.\n",
+            time, pfrom->GetId(), only_peer.size(), only_this.size());
+
+        // Continue as if the peer sent the missing tokens in smsgHave
+        std::vector<uint8_t> vchHave(8 + 16 * only_peer.size());
+        memcpy(&vchHave[0], &time, 8);
+        uint8_t *p = &vchHave[8];
+        for (const auto &key : only_peer) {
+            memcpy(p, &key.first, 8);
+            memcpy(p+8, &key.second, 8);
+            p += 16;
+        }
+        return WantMissing(pfrom, vchHave);
     } else
     if (strCommand == SMSGMsgType::WANT) {
         std::vector<uint8_t> vchData;
@@ -1608,9 +1808,10 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
         memcpy(&time, &vchData[0], 8);
 
         {
-            LOCK(cs_smsg);
-            auto itb = buckets.find(time);
-            if (itb == buckets.end()) {
+            SecMsgBucketShards::Shard &shard = buckets.Get(time);
+            LOCK(shard.cs);
+            auto itb = shard.buckets.find(time);
+            if (itb == shard.buckets.end()) {
                 LogPrint(BCLog::SMSG, "Don't have bucket %d.\n", time);
                 return SMSG_GENERAL_ERROR;
             }
@@ -1645,7 +1846,7 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
                 }
                 p += 16;
             }
-        } // cs_smsg
+        } // shard.cs
 
         if (nBunch > 0) {
             LogPrint(BCLog::SMSG, "Sending block of %u messages for bucket %d.\n", nBunch, time);
@@ -1657,12 +1858,16 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
         }
     } else
     if (strCommand == SMSGMsgType::MSG) {
-        std::vector<uint8_t> vchData;
-        vRecv >> vchData;
+        // Process the messages in the receive buffer, they're copied once when stored
+        uint64_t nSize = ReadCompactSize(vRecv);
+        if (nSize > vRecv.size()) {
+            return SMSG_GENERAL_ERROR;
+        }
 
-        LogPrint(BCLog::SMSG, "smsgMsg vchData.size() %u.\n", vchData.size());
+        LogPrint(BCLog::SMSG, "smsgMsg vchData.size() %u.\n", nSize);
 
-        Receive(pfrom, vchData);
+        Receive(pfrom, Span<const uint8_t>((const uint8_t*)vRecv.data(), nSize));
+        vRecv.ignore(nSize);
     } else
     if (strCommand == SMSGMsgType::PING) {
         // smsgPing is the initial message, send reply
@@ -1672,27 +1877,14 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
     if (strCommand == SMSGMsgType::PONG) {
         LogPrint(BCLog::SMSG, "Peer replied, secure messaging enabled.\n");
 
-        bool was_enabled = false;
         {
             LOCK(pfrom->smsgData.cs_smsg_net);
-            was_enabled = pfrom->smsgData.fEnabled;
             pfrom->smsgData.fEnabled = true;
 
             if (vRecv.size() >= 4) {
                 vRecv >> pfrom->smsgData.m_version;
             }
         }
-        if (!was_enabled) {
-            LOCK(pfrom->cs_vRecv);
-            // Init counters
-            size_t num_types = ARRAYLEN(SMSGMsgType::allTypes);
-            for (size_t t = 0; t < num_types; ++t) {
-                mapMsgCmdSize::iterator i = pfrom->mapRecvBytesPerMsgCmd.find(SMSGMsgType::allTypes[t]);
-                if (i == pfrom->mapRecvBytesPerMsgCmd.end()) {
-                    pfrom->mapRecvBytesPerMsgCmd[SMSGMsgType::allTypes[t]] = 0;
-                }
-            }
-        }
     } else
     if (strCommand == SMSGMsgType::DISABLED) {
         LogPrint(BCLog::SMSG, "Peer %d has disabled secure messaging.\n", pfrom->GetId());
@@ -1701,31 +1893,144 @@ int CSMSG::ReceiveData(CNode *pfrom, const std::string &strCommand, CDataStream
             LOCK(pfrom->smsgData.cs_smsg_net);
             pfrom->smsgData.fEnabled = false;
         }
-    } else
-    if (strCommand == SMSGMsgType::IGNORING) {
-        // Peer is reporting that it will ignore this node until time.
-        //  Ignore peer too
-        std::vector<uint8_t> vchData;
-        vRecv >> vchData;
+    } else
+    if (strCommand == SMSGMsgType::IGNORING) {
+        // Peer is reporting that it will ignore this node until time.
+        //  Ignore peer too
+        std::vector<uint8_t> vchData;
+        vRecv >> vchData;
+
+        if (vchData.size() < 8) {
+            LogPrintf("smsgIgnore, not enough data %u.\n", vchData.size());
+            Misbehaving(pfrom->GetId(), 1);
+            return SMSG_GENERAL_ERROR;
+        }
+
+        int64_t time;
+        memcpy(&time, &vchData[0], 8);
+
+        {
+            LOCK(pfrom->smsgData.cs_smsg_net);
+            pfrom->smsgData.ignoreUntil = time;
+        }
+
+        LogPrint(BCLog::SMSG, "Peer %d is ignoring this node until %d, ignore peer too.\n", pfrom->GetId(), time);
+    } else {
+        return SMSG_UNKNOWN_MESSAGE;
+    }
+
+    return SMSG_NO_ERROR;
+};
+
+/** Sketch size to request for the expected difference, 0 if the full token list is smaller */
+static uint32_t GetSketchSize(uint32_t nPeerActive, uint32_t nActive)
+{
+    uint32_t nDiff = (nPeerActive > nActive ? nPeerActive - nActive : nActive - nPeerActive) + SKETCH_DIFF_SLACK;
+    size_t nSize = SKETCH_MIN_SIZE;
+    while (nSize * 2 < nDiff) {
+        nSize *= 2;
+    }
+    if (nSize > SKETCH_MAX_SIZE
+        || nSize * SKETCH_SUBTABLES * SKETCH_CELL_BYTES >= (size_t)nPeerActive * 16) {
+        return 0;
+    }
+    return nSize;
+};
+
+int CSMSG::WantMissing(CNode *pfrom, const std::vector<uint8_t> &vchData)
+{
+    if (vchData.size() < 8) {
+        return SMSG_GENERAL_ERROR;
+    }
+
+    int n = (vchData.size() - 8) / 16;
+
+    int64_t time;
+    memcpy(&time, &vchData[0], 8);
+
+    // Check time valid:
+    int64_t now = GetAdjustedTime();
+    if (time < now - SMSG_RETENTION) {
+        LogPrint(BCLog::SMSG, "Not interested in peer %d bucket %d, has expired.\n", pfrom->GetId(), time);
+        return SMSG_GENERAL_ERROR;
+    }
+    if (time > now + SMSG_TIME_LEEWAY) {
+        LogPrint(BCLog::SMSG, "Not interested in peer %d bucket %d, in the future.\n", pfrom->GetId(), time);
+        Misbehaving(pfrom->GetId(), 1);
+        return SMSG_GENERAL_ERROR;
+    }
+
+    std::vector<uint8_t> vchDataOut;
+
+    {
+        // For the purged sets
+        LOCK(cs_smsg);
+        SecMsgBucketShards::Shard &shard = buckets.Get(time);
+        LOCK(shard.cs);
+        shard.show_requests.erase(time);
+
+        if (pfrom->smsgData.m_num_want_sent >= MAX_WANT_SENT) {
+            LogPrint(BCLog::SMSG, "Too many messages already requested from peer: %d, %d.\n", pfrom->GetId(), pfrom->smsgData.m_num_want_sent);
+            return SMSG_NO_ERROR;
+        }
 
-        if (vchData.size() < 8) {
-            LogPrintf("smsgIgnore, not enough data %u.\n", vchData.size());
-            Misbehaving(pfrom->GetId(), 1);
+        SecMsgBucket &bucket = shard.buckets[time];
+        ScheduleBucketExpiry(time, bucket);
+        if (bucket.nLockUntil != 0) {
+            LogPrint(BCLog::SMSG, "Bucket %d locked until %d, waiting for message data from peer %u.\n", time, bucket.nLockUntil, bucket.nLockPeerId);
             return SMSG_GENERAL_ERROR;
         }
 
-        int64_t time;
-        memcpy(&time, &vchData[0], 8);
+        LogPrint(BCLog::SMSG, "Sifting through bucket %d.\n", time);
 
-        {
-            LOCK(pfrom->smsgData.cs_smsg_net);
-            pfrom->smsgData.ignoreUntil = time;
+        vchDataOut.resize(8);
+        memcpy(&vchDataOut[0], &vchData[0], 8);
+
+        std::set<SecMsgToken> &tokenSet = bucket.setTokens;
+        SecMsgToken token;
+        SecMsgPurged purgedToken;
+        const uint8_t *p = &vchData[8];
+
+        for (int i = 0; i < n; ++i, p += 16) {
+            memcpy(&token.timestamp, p, 8);
+            memcpy(&token.sample, p+8, 8);
+
+            if (setPurgedTimestamps.find(token.timestamp) != setPurgedTimestamps.end()) {
+                memcpy(&purgedToken.timestamp, p, 8);
+                memcpy(&purgedToken.sample, p+8, 8);
+                if (setPurged.find(purgedToken) != setPurged.end()) {
+                    continue;
+                }
+            }
+
+            std::set<SecMsgToken>::const_iterator it = tokenSet.find(token);
+            if (it == tokenSet.end()) {
+                int nd = vchDataOut.size();
+                try {
+                    vchDataOut.resize(nd + 16);
+                } catch (std::exception &e) {
+                    LogPrintf("vchDataOut.resize %d threw: %s.\n", nd + 16, e.what());
+                    continue;
+                }
+
+                memcpy(&vchDataOut[nd], p, 16);
+            }
         }
 
-        LogPrint(BCLog::SMSG, "Peer %d is ignoring this node until %d, ignore peer too.\n", pfrom->GetId(), time);
-    } else {
-        return SMSG_UNKNOWN_MESSAGE;
-    }
+        if (vchDataOut.size() > 8) {
+            size_t n_messages = (vchDataOut.size() - 8) / 16;
+            pfrom->smsgData.m_num_want_sent += n_messages;
+            if (LogAcceptCategory(BCLog::SMSG)) {
+                LogPrintf("Asking peer for %u messages.\n", n_messages);
+                LogPrintf("Locking bucket %u for peer %d.\n", time, pfrom->GetId());
+            }
+            bucket.nLockUntil   = GetTime() + SMSG_LOCK_TIMEOUT; // unset when peer sends smsgMsg
+            bucket.nLockPeerId  = pfrom->GetId();
+            m_timers.Schedule(bucket.nLockUntil, SMSG_TIMER_BUCKET_LOCK, time, bucket.nLockPeerId);
+            g_connman->PushMessage(pfrom,
+                CNetMsgMaker(INIT_PROTO_VERSION).Make(SMSGMsgType::WANT, vchDataOut));
+        }
+    } // cs_smsg, shard.cs
 
     return SMSG_NO_ERROR;
 };
@@ -1742,6 +2047,7 @@ bool CSMSG::SendData(CNode *pto, bool fSendTrickle)
     LOCK(pto->smsgData.cs_smsg_net);
 
     int64_t now = GetTime();
+    const bool fLegacyHash = pto->smsgData.m_version < SMSG_VERSION_BUCKET_DIGEST;
 
     if (pto->smsgData.lastSeen <= 0) {
         // First contact
@@ -1767,32 +2073,28 @@ bool CSMSG::SendData(CNode *pto, bool fSendTrickle)
 
     uint32_t nBucketsShown = 0;
     std::vector<uint8_t> vchData;
-    {
-        LOCK(cs_smsg);
-        if (pto->smsgData.lastMatched <= m_last_changed) {
-
-            std::map<int64_t, SecMsgBucket>::iterator it;
-
-            /*
-            Get time before loop and after looping through messages set nLastMatched to time before loop.
-            This prevents scenario where:
-                Loop()
-                    message = locked and  thus skipped
-                   message become free and nTimeChanged is updated
-                End loop
-
-                nLastMatched = GetTime()
-                => bucket that became free in loop is now skipped :/
-
-            Scenario 2:
-                Same as one but time is updated before
-
-                    bucket nTimeChanged is updated but not unlocked yet
-                    now = GetTime()
-                    Loop of buckets skips message
-             */
-
-            for (it = buckets.begin(); it != buckets.end(); ++it) {
+    if (pto->smsgData.lastMatched <= m_last_changed) {
+        /*
+        Get time before loop and after looping through messages set nLastMatched to time before loop.
+        This prevents scenario where:
+            Loop()
+                message = locked and  thus skipped
+               message become free and nTimeChanged is updated
+            End loop
+
+            nLastMatched = GetTime()
+            => bucket that became free in loop is now skipped :/
+
+        Scenario 2:
+            Same as one but time is updated before
+
+                bucket nTimeChanged is updated but not unlocked yet
+                now = GetTime()
+                Loop of buckets skips message
+         */
+
+        buckets.ForEachShard([&](SecMsgBucketShards::Shard &shard) {
+            for (auto it = shard.buckets.begin(); it != shard.buckets.end(); ++it) {
                 SecMsgBucket &bkt = it->second;
 
                 uint32_t nMessages = bkt.nActive;
@@ -1802,7 +2104,7 @@ bool CSMSG::SendData(CNode *pto, bool fSendTrickle)
                     continue;
                 }
 
-                uint32_t hash = bkt.hash;
+                uint32_t hash = fLegacyHash ? bkt.LegacyHash() : bkt.hash;
 
                 if (LogAcceptCategory(BCLog::SMSG)) {
                     LogPrintf("Preparing bucket with hash %d for transfer to node %d. timeChanged=%d > lastMatched=%d\n", hash, pto->GetId(), bkt.timeChanged, pto->smsgData.lastMatched);
@@ -1824,7 +2126,7 @@ bool CSMSG::SendData(CNode *pto, bool fSendTrickle)
 
                 nBucketsShown++;
             }
-        }
+        });
     }
     if (nBucketsShown > 0) {
         memcpy(&vchData[0], &nBucketsShown, 4);
@@ -1838,28 +2140,47 @@ bool CSMSG::SendData(CNode *pto, bool fSendTrickle)
         vchData.clear();
     }
 
-    size_t nBucketsContestReq = 0;
+    size_t nBucketsContestReq = 0, nBucketsSketchReq = 0;
+    std::vector<uint8_t> vchSketchReq;
+    const bool fSketch = pto->smsgData.m_version >= SMSG_VERSION_SKETCH;
     if (pto->smsgData.m_buckets.size() > 0) {
-        LOCK(cs_smsg);
         for (auto it = pto->smsgData.m_buckets.begin(); it != pto->smsgData.m_buckets.end();) {
-            if (nBucketsContestReq >= SMSG_MAX_SHOW) {
+            if (nBucketsContestReq + nBucketsSketchReq >= SMSG_MAX_SHOW) {
                  break;
             }
 
-            const auto it_sr = m_show_requests.find(it->first);
-            if (it_sr != m_show_requests.end() && it_sr->second > now) {
+            SecMsgBucketShards::Shard &shard = buckets.Get(it->first);
+            LOCK(shard.cs);
+            const auto it_sr = shard.show_requests.find(it->first);
+            if (it_sr != shard.show_requests.end() && it_sr->second > now) {
                 ++it;
                 continue; // Waiting for peer response
             }
 
             PeerBucket &bkt = it->second;
-            const auto it_lb = buckets.find(it->first);
+            const auto it_lb = shard.buckets.find(it->first);
+            uint32_t nSketchSize = 0;
 
-            if (it_lb == buckets.end()
+            if (it_lb == shard.buckets.end()
                 || (it_lb->second.nLockPeerId < 0 || it_lb->second.nLockPeerId == pto->GetId())) {
-                if (it_lb != buckets.end() &&
-                    (it_lb->second.nActive > bkt.m_active || (it_lb->second.nActive == bkt.m_active && it_lb->second.hash == bkt.m_hash))) {
+                if (it_lb != shard.buckets.end() &&
+                    (it_lb->second.nActive > bkt.m_active || (it_lb->second.nActive == bkt.m_active && (fLegacyHash ? it_lb->second.LegacyHash() : it_lb->second.hash) == bkt.m_hash))) {
                     LogPrint(BCLog::SMSG, "Not requesting list of bucket %d.\n", it->first);
+                } else
+                if (fSketch && it_lb != shard.buckets.end()
+                    && (nSketchSize = GetSketchSize(bkt.m_active, it_lb->second.nActive)) > 0) {
+                    LogPrint(BCLog::SMSG, "Requesting sketch of bucket %d from peer %d.\n", it->first, pto->GetId());
+                    size_t sz = vchSketchReq.size();
+                    if (sz == 0) {
+                        vchSketchReq.resize(4);
+                        sz = 4;
+                    }
+                    vchSketchReq.resize(sz + 12);
+                    memcpy(&vchSketchReq[sz], &it->first, 8);
+                    memcpy(&vchSketchReq[sz + 8], &nSketchSize, 4);
+                    nBucketsSketchReq++;
+                    shard.show_requests[it->first] = now + 10;
+                    m_timers.Schedule(now + 10, SMSG_TIMER_SHOW_REQUEST, it->first);
                 } else {
                     LogPrint(BCLog::SMSG, "Requesting list of bucket %d from peer %d.\n", it->first, pto->GetId());
                     size_t sz = vchData.size();
@@ -1872,7 +2193,8 @@ bool CSMSG::SendData(CNode *pto, bool fSendTrickle)
                     }
                     memcpy(&vchData[sz], &it->first, 8);
                     nBucketsContestReq++;
-                    m_show_requests[it->first] = now + 10;
+                    shard.show_requests[it->first] = now + 10;
+                    m_timers.Schedule(now + 10, SMSG_TIMER_SHOW_REQUEST, it->first);
                 }
                 pto->smsgData.m_buckets.erase(it++);
                 continue;
@@ -1885,6 +2207,11 @@ bool CSMSG::SendData(CNode *pto, bool fSendTrickle)
         g_connman->PushMessage(pto,
             CNetMsgMaker(INIT_PROTO_VERSION).Make(SMSGMsgType::SHOW, vchData));
     }
+    if (nBucketsSketchReq > 0) {
+        memcpy(&vchSketchReq[0], &nBucketsSketchReq, 4);
+        g_connman->PushMessage(pto,
+            CNetMsgMaker(INIT_PROTO_VERSION).Make(SMSGMsgType::REQSKETCH, vchSketchReq));
+    }
 
     pto->smsgData.lastSeen = now + GetRandInt(1);
 
@@ -2167,6 +2494,8 @@ bool CSMSG::ScanBuckets(bool scan_all)
 
         {
             LOCK(cs_smsg);
+            SecMsgDB dbInbox;
+            bool fBatch = WITH_LOCK(cs_smsgDB, return dbInbox.Open("cw")) && dbInbox.TxnBegin();
             FILE *fp;
             errno = 0;
             if (!(fp = fopen(itd->path().string().c_str(), "rb"))) {
@@ -2203,7 +2532,7 @@ bool CSMSG::ScanBuckets(bool scan_all)
                     // Expired message
                 } else {
                     bool fOwnMessage;
-                    int rv = ScanMessage(smsg.data(), &vchData[0], smsg.nPayload, false, fOwnMessage);
+                    int rv = ScanMessage(smsg.data(), &vchData[0], smsg.nPayload, false, fOwnMessage, false, fBatch ? &dbInbox : nullptr);
                     if (rv == SMSG_NO_ERROR) {
                         nFoundMessages++;
                     } else {
@@ -2214,6 +2543,13 @@ bool CSMSG::ScanBuckets(bool scan_all)
             }
 
             fclose(fp);
+
+            if (fBatch) {
+                LOCK(cs_smsgDB);
+                if (!dbInbox.TxnCommit()) {
+                    LogPrintf("%s: Failed to write received messages to inbox db.\n", __func__);
+                }
+            }
         } // cs_smsg
     }
 
@@ -2433,7 +2769,7 @@ int CSMSG::WalletKeyChanged(CKeyID &keyId, const std::string &sLabel, ChangeType
   * if !reportToGui don't fire NotifySecMsgInboxChanged
   *  - loads messages received when wallet locked in bulk.
   */
-int CSMSG::ScanMessage(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayload, bool reportToGui, bool &fOwnMessage, bool unlocking)
+int CSMSG::ScanMessage(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayload, bool reportToGui, bool &fOwnMessage, bool unlocking, SecMsgDB *pdb_batch)
 {
     LogPrint(BCLog::SMSG, "%s\n", __func__);
 
@@ -2561,9 +2897,10 @@ int CSMSG::ScanMessage(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t
         bool fExisted = false;
         {
             LOCK(cs_smsgDB);
-            SecMsgDB dbInbox;
+            SecMsgDB dbOpen;
+            SecMsgDB &dbInbox = pdb_batch ? *pdb_batch : dbOpen;
 
-            if (dbInbox.Open("cw")) {
+            if (pdb_batch || dbOpen.Open("cw")) {
                 if (dbInbox.ExistsSmesg(chKey)) {
                     fExisted = true;
                     LogPrint(BCLog::SMSG, "Message already exists in inbox db.\n");
@@ -2879,7 +3216,6 @@ int CSMSG::ReadSmsgKey(const CKeyID &idk, CKey &key)
 int CSMSG::Retrieve(const SecMsgToken &token, std::vector<uint8_t> &vchData)
 {
     LogPrint(BCLog::SMSG, "%s: %d.\n", __func__, token.timestamp);
-    AssertLockHeld(cs_smsg);
 
     fs::path pathSmsgDir = GetDataDir() / STORE_DIR;
 
@@ -2925,7 +3261,6 @@ int CSMSG::Retrieve(const SecMsgToken &token, std::vector<uint8_t> &vchData)
 int CSMSG::Remove(const SecMsgToken &token)
 {
     LogPrint(BCLog::SMSG, "%s: %d.\n", __func__, token.timestamp);
-    AssertLockHeld(cs_smsg);
 
     fs::path pathSmsgDir = GetDataDir() / STORE_DIR;
 
@@ -2992,19 +3327,20 @@ int CSMSG::SmsgMisbehaving(CNode *pfrom, uint8_t n)
     return 0;
 };
 
-int CSMSG::Receive(CNode *pfrom, std::vector<uint8_t> &vchData)
+int CSMSG::Receive(CNode *pfrom, Span<const uint8_t> vchData)
 {
     LogPrint(BCLog::SMSG, "%s\n", __func__);
 
-    if (vchData.size() < 12) { // nBunch4 + timestamp8
+    const size_t nData = vchData.size();
+    if (nData < 12) { // nBunch4 + timestamp8
         return errorN(SMSG_GENERAL_ERROR, "%s - Not enough data.", __func__);
     }
 
     uint32_t nBunch;
     int64_t bktTime;
 
-    memcpy(&nBunch, &vchData[0], 4);
-    memcpy(&bktTime, &vchData[4], 8);
+    memcpy(&nBunch, vchData.data(), 4);
+    memcpy(&bktTime, vchData.data() + 4, 8);
 
     // Check bktTime ()
     // Bucket may not exist yet - will be created when messages are added
@@ -3030,32 +3366,43 @@ int CSMSG::Receive(CNode *pfrom, std::vector<uint8_t> &vchData)
     }
     pfrom->smsgData.m_num_want_sent -= nBunch;
 
-    if (nBunch == 0 || nBunch > MAX_BUNCH_MESSAGES || vchData.size() > MAX_BUNCH_BYTES) {
-        LogPrintf("Error: Invalid message bunch received for bucket %d: %d, %d.\n", bktTime, nBunch, vchData.size());
+    if (nBunch == 0 || nBunch > MAX_BUNCH_MESSAGES || nData > MAX_BUNCH_BYTES) {
+        LogPrintf("Error: Invalid message bunch received for bucket %d: %d, %d.\n", bktTime, nBunch, nData);
         SmsgMisbehaving(pfrom, 20);
 
         {
-            LOCK(cs_smsg);
+            SecMsgBucketShards::Shard &shard = buckets.Get(bktTime);
+            LOCK(shard.cs);
             // Release lock on bucket if it exists
-            auto itb = buckets.find(bktTime);
-            if (itb != buckets.end()) {
-                itb->second.nLockCount = 0;
+            auto itb = shard.buckets.find(bktTime);
+            if (itb != shard.buckets.end()) {
+                itb->second.nLockUntil = 0;
                 itb->second.nLockPeerId = -1;
+                ScheduleBucketExpiry(itb->first, itb->second);
             }
-        } // cs_smsg
+        } // shard.cs
         return SMSG_GENERAL_ERROR;
     }
 
     uint32_t n = 12;
 
+    // Write the messages received for local keys in one transaction
+    SecMsgDB dbInbox;
+    bool fBatch = WITH_LOCK(cs_smsgDB, return dbInbox.Open("cw")) && dbInbox.TxnBegin();
+
     for (uint32_t i = 0; i < nBunch; ++i) {
-        if (vchData.size() - n < SMSG_HDR_LEN) {
+        if (nData - n < SMSG_HDR_LEN) {
             LogPrintf("Error: not enough data sent, n = %u.\n", n);
             break;
         }
 
-        const SecureMessage *psmsg = (SecureMessage*) &vchData[n];
-        const uint8_t *pPayload = &vchData[n + SMSG_HDR_LEN];
+        // Messages are validated and stored in place in the received data
+        const SecureMessage *psmsg = (const SecureMessage*) (vchData.data() + n);
+        const uint8_t *pPayload = vchData.data() + n + SMSG_HDR_LEN;
+        if (nData - n - SMSG_HDR_LEN < psmsg->nPayload) {
+            LogPrintf("Error: not enough data sent for payload, n = %u.\n", n);
+            break;
+        }
         if (!psmsg->IsPaidVersion() &&
             now - start_time > SMSG_BUCKET_LEN * 2) { // buckets should be fully matched after time
             if (psmsg->timestamp < now - SMSG_BUCKET_LEN * 3) {
@@ -3093,13 +3440,13 @@ int CSMSG::Receive(CNode *pfrom, std::vector<uint8_t> &vchData)
         {
             LOCK(cs_smsg);
             // Store message, but don't hash bucket
-            if (Store(&vchData[n], &vchData[n + SMSG_HDR_LEN], psmsg->nPayload, false) != 0) {
+            if (Store(vchData.data() + n, pPayload, psmsg->nPayload, false) != 0) {
                 // Message dropped
                 break;
             }
 
             bool fOwnMessage;
-            if (ScanMessage(&vchData[n], &vchData[n + SMSG_HDR_LEN], psmsg->nPayload, true, fOwnMessage) != 0) {
+            if (ScanMessage(vchData.data() + n, pPayload, psmsg->nPayload, true, fOwnMessage, false, fBatch ? &dbInbox : nullptr) != 0) {
                 // message recipient is not this node (or failed)
             }
         } // cs_smsg
@@ -3107,19 +3454,28 @@ int CSMSG::Receive(CNode *pfrom, std::vector<uint8_t> &vchData)
         n += SMSG_HDR_LEN + psmsg->nPayload;
     }
 
+    if (fBatch) {
+        LOCK(cs_smsgDB);
+        if (!dbInbox.TxnCommit()) {
+            LogPrintf("%s: Failed to write received messages to inbox db.\n", __func__);
+        }
+    }
+
     {
-        LOCK(cs_smsg);
+        SecMsgBucketShards::Shard &shard = buckets.Get(bktTime);
+        LOCK(shard.cs);
         // If messages have been added, bucket must exist now
-        auto itb = buckets.find(bktTime);
-        if (itb == buckets.end()) {
+        auto itb = shard.buckets.find(bktTime);
+        if (itb == shard.buckets.end()) {
             LogPrint(BCLog::SMSG, "Don't have bucket %d.\n", bktTime);
             return SMSG_GENERAL_ERROR;
         }
 
-        itb->second.nLockCount  = 0; // This node has received data from peer, release lock
+        itb->second.nLockUntil  = 0; // This node has received data from peer, release lock
         itb->second.nLockPeerId = -1;
         itb->second.hashBucket(itb->first);
-    } // cs_smsg
+        ScheduleBucketExpiry(itb->first, itb->second);
+    } // shard.cs
 
     return SMSG_NO_ERROR;
 };
@@ -3198,6 +3554,8 @@ int CSMSG::StoreUnscanned(const uint8_t *pHeader, const uint8_t *pPayload, uint3
     std::string fileName = std::to_string(bucket) + "_01_wl.dat";
     fs::path fullpath = pathSmsgDir / fileName;
 
+    SecMsgBucketShards::Shard &shard = buckets.Get(bucket);
+    LOCK(shard.cs);
     FILE *fp;
     errno = 0;
     if (!(fp = fopen(fullpath.string().c_str(), "ab"))) {
@@ -3252,7 +3610,10 @@ int CSMSG::Store(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayl
     SecMsgToken token(psmsg->timestamp, pPayload, nPayload, 0, nTTL);
     token.m_changed = now - bucketTime;
 
-    SecMsgBucket &bucket = buckets[bucketTime];
+    SecMsgBucketShards::Shard &shard = buckets.Get(bucketTime);
+    LOCK(shard.cs);
+    SecMsgBucket &bucket = shard.buckets[bucketTime];
+    ScheduleBucketExpiry(bucketTime, bucket);
     std::set<SecMsgToken> &tokenSet = bucket.setTokens;
     if (tokenSet.find(token) != tokenSet.end()) {
         LogPrint(BCLog::SMSG, "Already have message.\n");
@@ -3271,6 +3632,8 @@ int CSMSG::Store(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayl
     if (!(fp = fopen(fullpath.string().c_str(), "ab"))) {
         return errorN(SMSG_GENERAL_ERROR, "fopen failed: %s.", strerror(errno));
     }
+    // Write straight from the message buffer, without copying it into the stdio buffer first
+    setvbuf(fp, nullptr, _IONBF, 0);
 
     // On windows ftell will always return 0 after fopen(ab), call fseek to set.
     errno = 0;
@@ -3289,15 +3652,12 @@ int CSMSG::Store(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayl
     fclose(fp);
 
     token.offset = ofs;
-    tokenSet.insert(token);
-
-    if (nTTL > 0 && (bucket.nLeastTTL == 0 || nTTL < bucket.nLeastTTL)) {
-        bucket.nLeastTTL = nTTL;
-    }
+    bucket.AddToken(token, now);
 
     if (fHashBucket) {
         bucket.hashBucket(bucketTime);
     }
+    ScheduleBucketExpiry(bucketTime, bucket);
 
     LogPrint(BCLog::SMSG, "SecureMsg added to bucket %d.\n", bucketTime);
 
@@ -3336,8 +3696,11 @@ int CSMSG::Purge(std::vector<uint8_t> &vMsgId, std::string &sError)
     // Find in buckets
     int64_t bucketTime = msgtime - (msgtime % SMSG_BUCKET_LEN);
 
-    SecMsgBucket &bucket = buckets[bucketTime];
+    SecMsgBucketShards::Shard &shard = buckets.Get(bucketTime);
+    LOCK(shard.cs);
+    SecMsgBucket &bucket = shard.buckets[bucketTime];
     std::set<SecMsgToken> &tokenSet = bucket.setTokens;
+    ScheduleBucketExpiry(bucketTime, bucket);
 
     std::vector<uint8_t> vchOne;
     for (auto it = tokenSet.begin(); it != tokenSet.end(); ++it) {
@@ -3360,7 +3723,9 @@ int CSMSG::Purge(std::vector<uint8_t> &vMsgId, std::string &sError)
             break;
         }
         memcpy(purged.sample, vchOne.data() + SMSG_HDR_LEN, 8);
-        it->ttl = 0;
+        bucket.SetTokenTTL(it, 0, GetAdjustedTime());
+        bucket.hashBucket(bucketTime);
+        ScheduleBucketExpiry(bucketTime, bucket);
         LogPrint(BCLog::SMSG, "Purged message %s in bucket %d\n", it->ToString(), bucketTime);
         memcpy(purged.sample, it->sample, 8);
 
@@ -3391,8 +3756,10 @@ int CSMSG::AdjustDifficulty(int64_t time)
 
     int rv = 0;
     for (auto bucket_time : bucket_times) {
-        auto it = buckets.find(bucket_time);
-        if (it != buckets.end()) {
+        SecMsgBucketShards::Shard &shard = buckets.Get(bucket_time);
+        LOCK(shard.cs);
+        auto it = shard.buckets.find(bucket_time);
+        if (it != shard.buckets.end()) {
             if (it->second.nActive > excessive_messages) {
                 rv += -1 * 10000 * float(it->second.nActive / excessive_messages);
             } else
@@ -3454,9 +3821,23 @@ int CSMSG::Validate(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nP
             return SMSG_GENERAL_ERROR;
         }
 
-        CTransactionRef txOut;
+        // Message funding is enforced in tx_verify.cpp
         uint256 hashBlock;
-        {
+        bool fFound = false;
+        uint32_t nAmount = 0;
+        // Waits for the validation queue, callbacks of which may take cs_smsg
+        AssertLockNotHeld(cs_smsg);
+        if (g_smsg_fund_index && g_smsg_fund_index->BlockUntilSyncedToCurrentChain()) {
+            SmsgFundIndex::FundedMsg funded;
+            if (g_smsg_fund_index->FindFunding(msgId, txid, funded)) {
+                hashBlock = funded.block_hash;
+                nAmount = funded.amount;
+                fFound = true;
+            }
+        }
+        if (!fFound) {
+            // Not indexed, look the transaction up to tell a missing transaction from one not funding the message
+            CTransactionRef txOut;
             LOCK(cs_main);
             if (!GetTransaction(txid, txOut, consensusParams, hashBlock) || hashBlock.IsNull()) {
                 return errorN(SMSG_GENERAL_ERROR, "%s: Transaction %s not found for message %s.\n", __func__, txid.ToString(), msgId.ToString());
@@ -3465,6 +3846,17 @@ int CSMSG::Validate(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nP
                 return errorN(SMSG_GENERAL_ERROR, "%s: Transaction %s for message %s, is coinstake.\n", __func__, txid.ToString(), msgId.ToString());
             }
 
+            // Find all msg pairs, the smallest amount counts
+            for (const auto &entry : GetSmsgFunding(*txOut)) {
+                if (entry.first == msgId && (!fFound || entry.second < nAmount)) {
+                    nAmount = entry.second;
+                    fFound = true;
+                }
+            }
+        }
+
+        {
+            LOCK(cs_main);
             int blockDepth = -1;
             const CBlockIndex *pindex = nullptr;
             BlockMap::iterator mi = ::BlockIndex().find(hashBlock);
@@ -3481,52 +3873,29 @@ int CSMSG::Validate(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nP
                 return errorN(SMSG_GENERAL_ERROR, "%s: Transaction %s for message %s, low depth %d.\n", __func__, txid.ToString(), msgId.ToString(), blockDepth);
             }
 
+            if (!fFound) {
+                return errorN(SMSG_FUND_FAILED, "%s: Transaction %s does not fund message %s.\n", __func__, txid.ToString(), msgId.ToString());
+            }
+
             // blockDepth >= 1 -> nMsgFeePerKPerDay must have been set
             int64_t nExpectFee = ((nMsgFeePerKPerDay * nMsgBytes) / 1000) * nDaysRetention;
 
-            bool fFound = false;
-            // Find all msg pairs
-            // Message funding is enforced in tx_verify.cpp
-            for (const auto &v : txOut->vpout) {
-                if (!v->IsType(OUTPUT_DATA)) {
-                    continue;
-                }
-                const std::vector<uint8_t> &vData = *v->GetPData();
-                if (vData.size() < 25 || vData[0] != DO_FUND_MSG) {
-                    continue;
-                }
-
-                size_t n = (vData.size()-1) / 24;
-                for (size_t k = 0; k < n; ++k) {
-                    const uint8_t *pMsgIdTxStart = &vData[1+k*24];
-                    if (memcmp(pMsgIdTxStart, msgId.begin(), 20) == 0) {
-                        uint32_t nAmount;
-                        memcpy(&nAmount, &vData[1+k*24+20], 4);
-
-                        if (nAmount < nExpectFee) {
-                            // Grace period after fee period transition where prev fee is still allowed
-                            bool matched_last_fee = false;
-                            if (pindex->nHeight % consensusParams.smsg_fee_period < 10) {
-                                int64_t nMsgFeePerKPerDayLast = GetSmsgFeeRate(pindex, true);
-                                int64_t nExpectFeeLast = ((nMsgFeePerKPerDayLast * nMsgBytes) / 1000) * nDaysRetention;
-
-                                if (nAmount >= nExpectFeeLast) {
-                                    matched_last_fee = true;
-                                }
-                            }
+            if (nAmount < nExpectFee) {
+                // Grace period after fee period transition where prev fee is still allowed
+                bool matched_last_fee = false;
+                if (pindex->nHeight % consensusParams.smsg_fee_period < 10) {
+                    int64_t nMsgFeePerKPerDayLast = GetSmsgFeeRate(pindex, true);
+                    int64_t nExpectFeeLast = ((nMsgFeePerKPerDayLast * nMsgBytes) / 1000) * nDaysRetention;
 
-                            if (!matched_last_fee) {
-                                LogPrintf("%s: Transaction %s underfunded message %s, expected %d paid %d.\n", __func__, txid.ToString(), msgId.ToString(), nExpectFee, nAmount);
-                                return SMSG_FUND_FAILED;
-                            }
-                        }
-                        fFound = true;
+                    if (nAmount >= nExpectFeeLast) {
+                        matched_last_fee = true;
                     }
                 }
-            }
 
-            if (!fFound) {
-                return errorN(SMSG_FUND_FAILED, "%s: Transaction %s does not fund message %s.\n", __func__, txid.ToString(), msgId.ToString());
+                if (!matched_last_fee) {
+                    LogPrintf("%s: Transaction %s underfunded message %s, expected %d paid %d.\n", __func__, txid.ToString(), msgId.ToString(), nExpectFee, nAmount);
+                    return SMSG_FUND_FAILED;
+                }
             }
         }
 
@@ -3829,7 +4198,6 @@ int CSMSG::Import(SecureMessage *psmsg, std::string &sError, bool setread, bool
     if (!submitmsg) {
         return SMSG_NO_ERROR;
     }
-    LOCK(cs_smsg);
 
     int rv = SetHash(psmsg->data(), psmsg->pPayload, psmsg->nPayload);
     if (rv != SMSG_NO_ERROR) {
@@ -3843,6 +4211,7 @@ int CSMSG::Import(SecureMessage *psmsg, std::string &sError, bool setread, bool
         return rv;
     }
 
+    LOCK(cs_smsg);
     Store(*psmsg, true);
 
     return SMSG_NO_ERROR;
@@ -3979,26 +4348,7 @@ int CSMSG::Send(CKeyID &addressFrom, CKeyID &addressTo, std::string &message,
     //   if the wallet is encrypted private key needed to decrypt will be unavailable
 
     LogPrint(BCLog::SMSG, "Encrypting message for outbox.\n");
-    CKeyID addressOutbox;
-#ifdef ENABLE_WALLET
-    if (!pactive_wallet) {
-        addressOutbox = addressFrom;
-    } else {
-        LOCK(pactive_wallet->cs_wallet);
-        for (const auto &entry : pactive_wallet->mapAddressBook) { // PAIRTYPE(CTxDestination, CAddressBookData)
-            // Get first owned address
-            if (!IsMine(*pactive_wallet, entry.first)) {
-                continue;
-            }
-            if (entry.first.type() == typeid(PKHash)) {
-                addressOutbox = CKeyID(boost::get<PKHash>(entry.first));
-                break;
-            }
-        }
-    }
-#else
-    addressOutbox = addressFrom;
-#endif
+    CKeyID addressOutbox = GetOutboxAddress(addressFrom);
 
     if (addressOutbox.IsNull()) {
         LogPrintf("%s: Warning, could not find an address to encrypt outbox message with.\n", __func__);
@@ -4059,6 +4409,194 @@ int CSMSG::Send(CKeyID &addressFrom, CKeyID &addressTo, std::string &message,
     return SMSG_NO_ERROR;
 };
 
+CKeyID CSMSG::GetOutboxAddress(const CKeyID &addressFrom)
+{
+    CKeyID addressOutbox;
+#ifdef ENABLE_WALLET
+    if (!pactive_wallet) {
+        addressOutbox = addressFrom;
+    } else {
+        LOCK(pactive_wallet->cs_wallet);
+        for (const auto &entry : pactive_wallet->mapAddressBook) { // PAIRTYPE(CTxDestination, CAddressBookData)
+            // Get first owned address
+            if (!IsMine(*pactive_wallet, entry.first)) {
+                continue;
+            }
+            if (entry.first.type() == typeid(PKHash)) {
+                addressOutbox = CKeyID(boost::get<PKHash>(entry.first));
+                break;
+            }
+        }
+    }
+#else
+    addressOutbox = addressFrom;
+#endif
+    return addressOutbox;
+};
+
+/** Send many messages from one address
+  * Messages are encrypted in parallel, paid messages are funded by FundMsgs
+  * and the send queue and outbox entries are written in one db batch.
+  * Fails without queueing anything if any message can't be created.
+  */
+int CSMSG::SendBatch(const CKeyID &addressFrom, std::vector<SecMsgBatchItem> &items, std::string &sError, bool fPaid,
+    size_t nRetention, bool fTestFee, CAmount *nFee, size_t *nTxBytes, bool add_to_outbox, bool fund_from_rct, size_t nRingSize, CCoinControl *coin_control)
+{
+    bool fSendAnonymous = (addressFrom.IsNull());
+
+    LogPrint(BCLog::SMSG, "%s: %u messages from %s\n", __func__, items.size(),
+        fSendAnonymous ? "anon" : EncodeDestination(PKHash(addressFrom)));
+
+    if (items.empty() || items.size() > SMSG_MAX_SEND_BATCH) {
+        return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Batch size out of range %u.", items.size());
+    }
+
+    if (nRetention < SMSG_MIN_TTL || nRetention > SMSG_MAX_PAID_TTL) {
+        LogPrint(BCLog::SMSG, "TTL out of range %d.\n", nRetention);
+        return SMSG_GENERAL_ERROR;
+    }
+
+    size_t nMaxBytes = fPaid ? SMSG_MAX_MSG_BYTES_PAID : fSendAnonymous ? SMSG_MAX_AMSG_BYTES : SMSG_MAX_MSG_BYTES;
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (items[i].message.size() > nMaxBytes) {
+            sError = strprintf("Message %u is too long, %d > %d", i, items[i].message.size(), nMaxBytes);
+            return errorN(SMSG_MESSAGE_TOO_LONG, "%s: %s.", __func__, sError);
+        }
+    }
+
+    CKeyID addressOutbox;
+    if (add_to_outbox) {
+        addressOutbox = GetOutboxAddress(addressFrom);
+        if (addressOutbox.IsNull()) {
+            LogPrintf("%s: Warning, could not find an address to encrypt outbox message with.\n", __func__);
+        }
+    }
+
+    // Encrypt the messages and their outbox copies on a small pool of threads
+    int64_t now = GetTime();
+    std::atomic<size_t> nNext(0);
+    std::atomic<int> nFailed(0);
+    std::vector<int> vResults(items.size(), SMSG_NO_ERROR);
+    auto encrypt_worker = [&]() {
+        size_t i;
+        while (!nFailed && (i = nNext++) < items.size()) {
+            SecMsgBatchItem &item = items[i];
+            item.smsg.version[0] = fPaid ? 3 : 2;
+            item.smsg.version[1] = fPaid ? 0 : 1;
+            item.smsg.m_ttl = nRetention;
+            item.smsg.timestamp = now;
+            if ((vResults[i] = Encrypt(item.smsg, addressFrom, item.addressTo, item.message)) != 0) {
+                nFailed = 1;
+                break;
+            }
+            if (!addressOutbox.IsNull()) {
+                item.smsgOutbox.version[0] = item.smsg.version[0];
+                item.smsgOutbox.version[1] = item.smsg.version[1];
+                item.smsgOutbox.m_ttl = nRetention;
+                item.smsgOutbox.timestamp = now;
+                if (Encrypt(item.smsgOutbox, addressFrom, addressOutbox, item.message) != 0) {
+                    LogPrintf("%s: Encrypt for outbox failed, message %u.\n", __func__, i);
+                }
+            }
+        }
+    };
+
+    size_t nThreads = std::min<size_t>(items.size(), std::max(GetNumCores(), 1));
+    std::vector<std::thread> vThreads;
+    for (size_t k = 1; k < nThreads; ++k) {
+        vThreads.emplace_back(encrypt_worker);
+    }
+    encrypt_worker();
+    for (auto &t : vThreads) {
+        t.join();
+    }
+
+    for (size_t i = 0; i < items.size(); ++i) {
+        if (vResults[i] != 0) {
+            sError = strprintf("Message %u: %s", i, GetString(vResults[i]));
+            return errorN(vResults[i], "%s: %s.", __func__, sError);
+        }
+    }
+
+    if (fPaid) {
+        std::vector<SecureMessage*> vpsmsg;
+        for (auto &item : items) {
+            uint256 msg_hash;
+            GetPowHash(&item.smsg, item.smsg.pPayload, item.smsg.nPayload-32, msg_hash);
+            memcpy(item.smsg.hash, msg_hash.begin(), 4);
+            vpsmsg.push_back(&item.smsg);
+        }
+        if (0 != FundMsgs(vpsmsg, sError, fTestFee, nFee, nTxBytes, fund_from_rct, nRingSize, coin_control)) {
+            return errorN(SMSG_FUND_FAILED, "%s: FundMsgs failed %s.", __func__, sError);
+        }
+
+        if (fTestFee) {
+            return SMSG_NO_ERROR;
+        }
+    }
+
+    // Place the messages in the send queue, proof of work will happen in a thread.
+    std::vector<SecMsgStored> vOutbox;
+    {
+        LOCK(cs_smsgDB);
+        SecMsgDB db;
+        if (!db.Open("cw") || !db.TxnBegin()) {
+            return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Could not open db.");
+        }
+
+        for (auto &item : items) {
+            uint160 msgId;
+            HashMsg(item.smsg, item.smsg.pPayload, item.smsg.nPayload-(fPaid ? 32 : 0), msgId);
+
+            uint8_t chKey[30];
+            int64_t timestamp_be = bswap_64(item.smsg.timestamp);
+            memcpy(&chKey[0], DBK_QUEUED.data(), 2);
+            memcpy(&chKey[2], &timestamp_be, 8);
+            memcpy(&chKey[10], msgId.begin(), 20);
+
+            SecMsgStored smsgSQ;
+            smsgSQ.timeReceived  = now;
+            smsgSQ.addrTo        = item.addressTo;
+            smsgSQ.vchMessage.resize(SMSG_HDR_LEN + item.smsg.nPayload);
+            memcpy(&smsgSQ.vchMessage[0], item.smsg.data(), SMSG_HDR_LEN);
+            memcpy(&smsgSQ.vchMessage[SMSG_HDR_LEN], item.smsg.pPayload, item.smsg.nPayload);
+            db.WriteSmesg(chKey, smsgSQ);
+
+            if (!item.smsgOutbox.pPayload) {
+                continue;
+            }
+            if (fPaid) {
+                // Encrypt will alloc an extra 32 bytes when smsg version describes paid msg
+                memcpy(item.smsgOutbox.pPayload+item.smsgOutbox.nPayload-32, item.smsg.pPayload+item.smsg.nPayload-32, 32);
+            }
+
+            memcpy(&chKey[0], DBK_OUTBOX.data(), 2);
+
+            SecMsgStored smsgOutbox;
+            smsgOutbox.timeReceived  = now;
+            smsgOutbox.addrTo        = item.addressTo;
+            smsgOutbox.addrOutbox    = addressOutbox;
+            smsgOutbox.vchMessage.resize(SMSG_HDR_LEN + item.smsgOutbox.nPayload);
+            memcpy(&smsgOutbox.vchMessage[0], item.smsgOutbox.data(), SMSG_HDR_LEN);
+            memcpy(&smsgOutbox.vchMessage[SMSG_HDR_LEN], item.smsgOutbox.pPayload, item.smsgOutbox.nPayload);
+            db.WriteSmesg(chKey, smsgOutbox);
+            vOutbox.push_back(std::move(smsgOutbox));
+        }
+
+        if (!db.TxnCommit()) {
+            return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Could not write messages to db.");
+        }
+
+        for (auto &smsgOutbox : vOutbox) {
+            NotifySecMsgOutboxChanged(smsgOutbox);
+        }
+    } // cs_smsgDB
+
+    LogPrint(BCLog::SMSG, "%u secure messages queued for sending.\n", items.size());
+
+    return SMSG_NO_ERROR;
+};
+
 bool CSMSG::GetPowHash(const SecureMessage *psmsg, const uint8_t *pPayload, uint32_t nPayload, uint256 &hash)
 {
     uint8_t civ[32];
@@ -4093,7 +4631,35 @@ int CSMSG::HashMsg(const SecureMessage &smsg, const uint8_t *pPayload, uint32_t
 
 int CSMSG::FundMsg(SecureMessage &smsg, std::string &sError, bool fTestFee, CAmount *nFee, size_t *nTxBytes, bool fund_from_rct, size_t nRingSize, CCoinControl *coin_control)
 {
-    // smsg.pPayload must have smsg.nPayload + 32 bytes allocated
+    return FundMsgs({&smsg}, sError, fTestFee, nFee, nTxBytes, fund_from_rct, nRingSize, coin_control);
+};
+
+std::vector<std::vector<uint8_t>> GetFundMsgData(const std::vector<uint160> &vMsgIds, const std::vector<uint32_t> &vMsgFees)
+{
+    assert(vMsgIds.size() == vMsgFees.size());
+    std::vector<std::vector<uint8_t>> vFundData;
+    for (size_t i = 0; i < vMsgIds.size(); ++i) {
+        if (i % SMSG_FUND_PER_OUTPUT == 0) {
+            vFundData.emplace_back(1, DO_FUND_MSG);
+        }
+        // 20 byte msgid, 4 byte fee, max 42.94967295
+        std::vector<uint8_t> &vData = vFundData.back();
+        vData.insert(vData.end(), vMsgIds[i].begin(), vMsgIds[i].end());
+        vData.insert(vData.end(), (const uint8_t*)&vMsgFees[i], (const uint8_t*)&vMsgFees[i] + 4);
+    }
+    return vFundData;
+};
+
+/** Fund one or more paid messages
+  * Each message gets a 24 byte entry (msgid, fee) in a DO_FUND_MSG output. A
+  * funding tx without change has no standard outputs, consensus then allows
+  * it one data output, so every SMSG_FUND_PER_OUTPUT messages are funded by
+  * their own transaction.
+  * If a later transaction fails the earlier ones have already been sent.
+  */
+int CSMSG::FundMsgs(const std::vector<SecureMessage*> &vpsmsg, std::string &sError, bool fTestFee, CAmount *nFee, size_t *nTxBytes, bool fund_from_rct, size_t nRingSize, CCoinControl *coin_control)
+{
+    // Each smsg.pPayload must have smsg.nPayload + 32 bytes allocated
 #ifdef ENABLE_WALLET
     assert(coin_control);
 
@@ -4101,25 +4667,30 @@ int CSMSG::FundMsg(SecureMessage &smsg, std::string &sError, bool fTestFee, CAmo
         return SMSG_WALLET_UNSET;
     }
 
-    if (smsg.version[0] != 3) {
-        return errorN(SMSG_UNKNOWN_VERSION, sError, __func__, "Bad message version.");
+    if (vpsmsg.empty()) {
+        return errorN(SMSG_GENERAL_ERROR, sError, __func__, "No messages to fund.");
     }
 
-    size_t nDaysRetention = smsg.m_ttl / SMSG_SECONDS_IN_DAY;
-    if (nDaysRetention < 1 || nDaysRetention > 31) {
-        return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Bad message ttl.");
-    }
+    std::vector<uint160> vMsgIds(vpsmsg.size());
+    for (size_t i = 0; i < vpsmsg.size(); ++i) {
+        const SecureMessage &smsg = *vpsmsg[i];
+        if (smsg.version[0] != 3) {
+            return errorN(SMSG_UNKNOWN_VERSION, sError, __func__, "Bad message version.");
+        }
 
-    uint256 txfundId;
-    uint160 msgId;
-    CMutableTransaction txFund;
+        size_t nDaysRetention = smsg.m_ttl / SMSG_SECONDS_IN_DAY;
+        if (nDaysRetention < 1 || nDaysRetention > 31) {
+            return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Bad message ttl.");
+        }
 
-    if (0 != HashMsg(smsg, smsg.pPayload, smsg.nPayload-32, msgId)) {
-        return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Message hash failed.");
+        if (0 != HashMsg(smsg, smsg.pPayload, smsg.nPayload-32, vMsgIds[i])) {
+            return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Message hash failed.");
+        }
     }
 
-    size_t nMsgBytes = SMSG_HDR_LEN + smsg.nPayload;
-    CAmount nFeeRet;
+    std::vector<uint256> vTxFundIds;
+    CAmount nFeeTotal = 0;
+    size_t nTxBytesTotal = 0;
     OutputTypes fund_from = fund_from_rct ? OUTPUT_RINGCT : OUTPUT_STANDARD;
     {
         auto locked_chain = pactive_wallet->chain().lock();
@@ -4128,73 +4699,96 @@ int CSMSG::FundMsg(SecureMessage &smsg, std::string &sError, bool fTestFee, CAmo
         const Consensus::Params &consensusParams = Params().GetConsensus();
         coin_control->m_feerate = CFeeRate(consensusParams.smsg_fee_funding_tx_per_k);
         coin_control->fOverrideFeeRate = true;
-        coin_control->m_extrafee = ((locked_chain->getSmsgFeeRate(nullptr) * nMsgBytes) / 1000) * nDaysRetention;
-        assert(coin_control->m_extrafee <= std::numeric_limits<uint32_t>::max());
-        uint32_t msgFee = coin_control->m_extrafee;
-
-        std::vector<CTempRecipient> vec_send;
-        CTransactionRecord rtx;
-        CTempRecipient tr;
-        tr.nType = OUTPUT_DATA;
-        tr.vData.resize(25); // 4 byte fee, max 42.94967295
-        tr.vData[0] = DO_FUND_MSG;
-        memcpy(&tr.vData[1], msgId.begin(), 20);
-        memcpy(&tr.vData[21], &msgFee, 4);
-        vec_send.push_back(tr);
 
-        CHDWallet *const pw = GetFalconWallet(pactive_wallet.get());
-        CTransactionRef tx_new;
-        CWalletTx wtx(pactive_wallet.get(), tx_new);
+        CAmount nMsgFeeRate = locked_chain->getSmsgFeeRate(nullptr);
+        std::vector<uint32_t> vMsgFees(vpsmsg.size());
+        for (size_t i = 0; i < vpsmsg.size(); ++i) {
+            const SecureMessage &smsg = *vpsmsg[i];
+            size_t nMsgBytes = SMSG_HDR_LEN + smsg.nPayload;
+            size_t nDaysRetention = smsg.m_ttl / SMSG_SECONDS_IN_DAY;
+            CAmount nMsgFee = ((nMsgFeeRate * nMsgBytes) / 1000) * nDaysRetention;
+            assert(nMsgFee <= std::numeric_limits<uint32_t>::max());
+            vMsgFees[i] = nMsgFee;
+        }
 
-        if (fund_from == OUTPUT_STANDARD) {
-            if (0 != pw->AddStandardInputs(*locked_chain, wtx, rtx, vec_send, !fTestFee, nFeeRet, coin_control, sError)) {
-                return SMSG_FUND_FAILED;
+        CHDWallet *const pw = GetFalconWallet(pactive_wallet.get());
+        std::vector<std::vector<uint8_t>> vFundData = GetFundMsgData(vMsgIds, vMsgFees);
+        for (size_t t = 0; t < vFundData.size(); ++t) {
+            coin_control->m_extrafee = 0;
+            for (size_t i = t * SMSG_FUND_PER_OUTPUT; i < std::min<size_t>((t + 1) * SMSG_FUND_PER_OUTPUT, vpsmsg.size()); ++i) {
+                coin_control->m_extrafee += vMsgFees[i];
             }
-        } else
-        if (fund_from == OUTPUT_RINGCT) {
-            const Consensus::Params &consensusParams = Params().GetConsensus();
-            if (consensusParams.clamp_tx_version_time > GetAdjustedTime()) {
-                tr.nType = OUTPUT_STANDARD;
-                tr.fScriptSet = true;
-                tr.scriptPubKey.resize(1);
-                tr.scriptPubKey[0] = OP_RETURN;
-                tr.vData.clear();
-                vec_send.push_back(tr);
+
+            std::vector<CTempRecipient> vec_send;
+            CTransactionRecord rtx;
+            CTempRecipient tr;
+            tr.nType = OUTPUT_DATA;
+            tr.vData = vFundData[t];
+            vec_send.push_back(tr);
+
+            CTransactionRef tx_new;
+            CWalletTx wtx(pactive_wallet.get(), tx_new);
+            CAmount nFeeRet;
+
+            if (fund_from == OUTPUT_STANDARD) {
+                if (0 != pw->AddStandardInputs(*locked_chain, wtx, rtx, vec_send, !fTestFee, nFeeRet, coin_control, sError)) {
+                    return SMSG_FUND_FAILED;
+                }
+            } else
+            if (fund_from == OUTPUT_RINGCT) {
+                if (consensusParams.clamp_tx_version_time > GetAdjustedTime()) {
+                    tr.nType = OUTPUT_STANDARD;
+                    tr.fScriptSet = true;
+                    tr.scriptPubKey.resize(1);
+                    tr.scriptPubKey[0] = OP_RETURN;
+                    tr.vData.clear();
+                    vec_send.push_back(tr);
+                }
+                size_t nInputsPerSig = 1;
+                if (0 != pw->AddAnonInputs(*locked_chain, wtx, rtx, vec_send, !fTestFee, nRingSize, nInputsPerSig, nFeeRet, coin_control, sError)) {
+                    return SMSG_FUND_FAILED;
+                }
+            } else {
+                return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Unknown fund from coin type.");
             }
-            size_t nInputsPerSig = 1;
-            if (0 != pw->AddAnonInputs(*locked_chain, wtx, rtx, vec_send, !fTestFee, nRingSize, nInputsPerSig, nFeeRet, coin_control, sError)) {
-                return SMSG_FUND_FAILED;
+
+            nFeeTotal += nFeeRet;
+            nTxBytesTotal += GetVirtualTransactionSize(*(wtx.tx));
+
+            if (fTestFee) {
+                continue;
             }
-        } else {
-            return errorN(SMSG_GENERAL_ERROR, sError, __func__, "Unknown fund from coin type.");
-        }
 
-        if (nFee) {
-            *nFee = nFeeRet;
-        }
-        if (nTxBytes) {
-            *nTxBytes = GetVirtualTransactionSize(*(wtx.tx));
-        }
+            std::string err_string;
+            if (!pw->TestMempoolAccept(wtx.tx, err_string, m_absurd_smsg_fee)) {
+                return errorN(SMSG_GENERAL_ERROR, sError, __func__, "TestMempoolAccept failed: %s.", err_string);
+            }
 
-        if (fTestFee) {
-            return SMSG_NO_ERROR;
+            wtx.BindWallet(pactive_wallet.get());
+            CValidationState state;
+            bool is_record = !(fund_from == OUTPUT_STANDARD);
+            if (!pw->CommitTransaction(wtx, rtx, state, wtx.mapValue, wtx.vOrderForm, is_record, /* broadcast_tx */ true, m_absurd_smsg_fee)) {
+                return errorN(SMSG_GENERAL_ERROR, sError, __func__, "CommitTransaction failed.");
+            }
+            vTxFundIds.push_back(wtx.tx->GetHash());
         }
+    }
 
-        txfundId = wtx.tx->GetHash();
+    if (nFee) {
+        *nFee = nFeeTotal;
+    }
+    if (nTxBytes) {
+        *nTxBytes = nTxBytesTotal;
+    }
 
-        std::string err_string;
-        if (!pw->TestMempoolAccept(wtx.tx, err_string, m_absurd_smsg_fee)) {
-            return errorN(SMSG_GENERAL_ERROR, sError, __func__, "TestMempoolAccept failed: %s.", err_string);
-        }
+    if (fTestFee) {
+        return SMSG_NO_ERROR;
+    }
 
-        wtx.BindWallet(pactive_wallet.get());
-        CValidationState state;
-        bool is_record = !(fund_from == OUTPUT_STANDARD);
-        if (!pw->CommitTransaction(wtx, rtx, state, wtx.mapValue, wtx.vOrderForm, is_record, /* broadcast_tx */ true, m_absurd_smsg_fee)) {
-            return errorN(SMSG_GENERAL_ERROR, sError, __func__, "CommitTransaction failed.");
-        }
+    for (size_t i = 0; i < vpsmsg.size(); ++i) {
+        SecureMessage *psmsg = vpsmsg[i];
+        memcpy(psmsg->pPayload+(psmsg->nPayload-32), vTxFundIds[i / SMSG_FUND_PER_OUTPUT].begin(), 32);
     }
-    memcpy(smsg.pPayload+(smsg.nPayload-32), txfundId.begin(), 32);
 #else
     return SMSG_WALLET_UNSET;
 #endif
@@ -8,10 +8,16 @@
 
 #include <key_io.h>
 #include <serialize.h>
+#include <span.h>
 #include <ui_interface.h>
 #include <lz4/lz4.h>
 #include <smsg/keystore.h>
+#include <smsg/sketch.h>
+#include <smsg/timerwheel.h>
 #include <interfaces/handler.h>
+#include <sync.h>
+
+#include <atomic>
 
 #include <boost/signals2/signal.hpp>
 
@@ -24,7 +30,11 @@ typedef int64_t NodeId;
 
 namespace smsg {
 
-const int SMSG_VERSION = 1;
+const int SMSG_VERSION = 3;
+//! Peers from this version compare bucket digests from SecMsgBucket::hash
+const int SMSG_VERSION_BUCKET_DIGEST = 2;
+//! Peers from this version answer smsgReqSketch
+const int SMSG_VERSION_SKETCH = 3;
 
 enum SecureMessageCodes {
     SMSG_NO_ERROR = 0,
@@ -75,7 +85,8 @@ extern uint32_t SMSG_RETENTION;
 const uint32_t SMSG_FREE_MSG_DAYS  = 2;
 
 const uint32_t SMSG_SEND_DELAY     = 2;                 // seconds, SecureMsgSendData will delay this long between firing
-const uint32_t SMSG_THREAD_DELAY   = 30;
+const uint32_t SMSG_THREAD_DELAY   = 1;                 // seconds between advancing the timer wheel
+const uint32_t SMSG_LOCK_TIMEOUT   = 90;                // seconds a bucket stays locked waiting for a peer to send the messages asked for
 
 const uint32_t SMSG_TIME_LEEWAY    = 24;
 const uint32_t SMSG_TIME_IGNORE    = 90;                // seconds a peer is ignored for if they fail to deliver messages for a smsgWant
@@ -85,6 +96,8 @@ const uint32_t SMSG_DEFAULT_MAXRCV = 4000;
 const uint32_t SMSG_MAX_MSG_BYTES  = 24000;             // the user input part
 const uint32_t SMSG_MAX_AMSG_BYTES = 512;               // the user input part (ANON)
 const uint32_t SMSG_MAX_MSG_BYTES_PAID = 512 * 1024;    // the user input part (Paid)
+const uint32_t SMSG_MAX_SEND_BATCH = 100;               // max messages sent by one SendBatch call
+const uint32_t SMSG_FUND_PER_OUTPUT = 3;                // max messages funded by one DO_FUND_MSG data output, and so by one funding tx
 
 // Max size of payload worst case compression
 const uint32_t SMSG_MAX_MSG_WORST = LZ4_COMPRESSBOUND(SMSG_MAX_MSG_BYTES+SMSG_PL_HDR_LEN);
@@ -97,6 +110,7 @@ extern const std::string STORE_DIR;
 #define SMSG_MASK_UNREAD (1 << 0)
 
 class SecMsgStored;
+class SecMsgDB;
 
 // Inbox db changed, called with lock cs_smsgDB held.
 extern boost::signals2::signal<void (SecMsgStored &inboxHdr)> NotifySecMsgInboxChanged;
@@ -181,6 +195,16 @@ public:
 };
 #pragma pack(pop)
 
+class SecMsgBatchItem
+{
+// One message of a SendBatch call
+public:
+    CKeyID                addressTo;
+    std::string           message;
+    SecureMessage         smsg;
+    SecureMessage         smsgOutbox;
+};
+
 class MessageData
 {
 // Decrypted SecureMessage data
@@ -271,23 +295,103 @@ public:
     {
         timeChanged     = 0;
         hash            = 0;
-        nLeastTTL       = 0;
         nActive         = 0;
-        nLockCount      = 0;
+        nLockUntil      = 0;
         nLockPeerId     = -1;
     };
+    // m_expiry points into setTokens
+    SecMsgBucket(const SecMsgBucket&) = delete;
+    SecMsgBucket& operator=(const SecMsgBucket&) = delete;
+
+    /** Add a token if not already in setTokens */
+    void AddToken(const SecMsgToken &token, int64_t now);
+    void SetTokenTTL(std::set<SecMsgToken>::iterator it, uint32_t ttl, int64_t now);
+    void ClearTokens();
 
+    /** Drop expired tokens from the digest and publish the digest if changed */
     void hashBucket(int64_t bucket_time);
     size_t CountActive() const;
+    /** Earliest time a token will expire, 0 if no tokens are active */
+    int64_t NextExpiry() const;
+    /** Digest sent to peers with a smsg version below 2, rehashes the active tokens if changed */
+    uint32_t LegacyHash();
+    /** Sketch of the active tokens at SKETCH_MAX_SIZE, built on first use and then kept up to date */
+    const SecMsgSketch &GetSketch();
 
     int64_t               timeChanged;
-    uint32_t              hash;           // token set should get ordered the same on each node
-    uint32_t              nLeastTTL;      // lowest ttl in seconds of messages in bucket
-    uint32_t              nActive;        // Number of untimedout messages in bucket
-    uint32_t              nLockCount;     // set when smsgWant first sent, unset at end of smsgMsg, ticks down in ThreadSecureMsg()
+    uint32_t              hash;           // digest of the active tokens at the last hashBucket, independent of order
+    uint32_t              nActive;        // Number of untimedout messages in bucket at the last hashBucket
+    int64_t               nLockUntil;     // set when smsgWant first sent, unset at end of smsgMsg, released by the lock timer if the peer never sends data
     NodeId                nLockPeerId;    // id of peer that bucket is locked for
+    int64_t               nTimerExpiry = 0; // adjusted time of the earliest pending expiry timer, 0 if none
 
     std::set<SecMsgToken> setTokens;
+
+private:
+    struct ExpiryCompare
+    {
+        bool operator()(const std::pair<int64_t, const SecMsgToken*> &a, const std::pair<int64_t, const SecMsgToken*> &b) const
+        {
+            if (a.first != b.first) {
+                return a.first < b.first;
+            }
+            return *a.second < *b.second;
+        }
+    };
+
+    void Activate(const SecMsgToken &token, int64_t now);
+    void Deactivate(const SecMsgToken &token);
+
+    //! Active tokens ordered by expiry time
+    std::set<std::pair<int64_t, const SecMsgToken*>, ExpiryCompare> m_expiry;
+    uint32_t m_digest = 0;
+    uint32_t m_legacy_hash = 0;
+    bool m_legacy_valid = false;
+    std::unique_ptr<SecMsgSketch> m_sketch;
+};
+
+/**
+ * Buckets split by time over shards with their own locks, so peers syncing
+ * different buckets and the timers don't serialize on cs_smsg.
+ *
+ * A shard lock also guards the bucket files of its buckets. Lock order is
+ * cs_smsg, then cs_smsgDB, then a shard, and only one shard is held at a time.
+ */
+class SecMsgBucketShards
+{
+public:
+    static const size_t NUM_SHARDS = 16;
+
+    struct Shard
+    {
+        mutable Mutex cs;
+        std::map<int64_t, SecMsgBucket> buckets GUARDED_BY(cs);
+        //! Local time until which a list or sketch requested for a bucket is waited for
+        std::map<int64_t, int64_t> show_requests GUARDED_BY(cs);
+    };
+
+    /** Shard of the bucket at bucket_time, consecutive buckets fall in different shards */
+    Shard &Get(int64_t bucket_time)
+    {
+        return m_shards[((uint64_t)bucket_time / SMSG_BUCKET_LEN) % NUM_SHARDS];
+    }
+
+    /** Call f with each shard in turn, with its lock held. Buckets are visited in time order within a shard only */
+    template <typename Callable>
+    void ForEachShard(Callable f)
+    {
+        for (auto &shard : m_shards) {
+            LOCK(shard.cs);
+            f(shard);
+        }
+    }
+
+    size_t Size();
+    /** Drop all buckets and show requests, the bucket files are kept */
+    void Clear();
+
+private:
+    Shard m_shards[NUM_SHARDS];
 };
 
 class SecMsgAddress
@@ -344,9 +448,9 @@ public:
 class SecMsgStored
 {
 public:
-    int64_t              timeReceived;
-    uint8_t              status;         // read etc
-    uint16_t             folderId;
+    int64_t              timeReceived = 0;
+    uint8_t              status = 0;     // read etc
+    uint16_t             folderId = 0;
     CKeyID               addrTo;         // when in owned addr, when sent remote addr
     CKeyID               addrOutbox;     // owned address this copy was encrypted with
     std::vector<uint8_t> vchMessage;     // message header + encryped payload
@@ -378,9 +482,50 @@ public:
     };
 };
 
+/** Fields of a SecMsgStored without the message, kept in the db index */
+class SecMsgStoredMeta
+{
+public:
+    SecMsgStoredMeta() {};
+    explicit SecMsgStoredMeta(const SecMsgStored &smsgStored)
+        : timeReceived(smsgStored.timeReceived), status(smsgStored.status), folderId(smsgStored.folderId),
+          addrTo(smsgStored.addrTo), addrOutbox(smsgStored.addrOutbox), nMessageSize(smsgStored.vchMessage.size()) {};
+
+    int64_t              timeReceived = 0;
+    uint8_t              status = 0;
+    uint16_t             folderId = 0;
+    CKeyID               addrTo;
+    CKeyID               addrOutbox;
+    uint32_t             nMessageSize = 0;  // header + encrypted payload
+
+    template<typename Stream>
+    void Serialize(Stream &s) const
+    {
+        s << timeReceived;
+        s << status;
+        s << folderId;
+        s << addrTo;
+        s << addrOutbox;
+        s << nMessageSize;
+    };
+    template <typename Stream>
+    void Unserialize(Stream &s)
+    {
+        s >> timeReceived;
+        s >> status;
+        s >> folderId;
+        s >> addrTo;
+        s >> addrOutbox;
+        s >> nMessageSize;
+    };
+};
+
 void AddOptions();
 const char *GetString(size_t errorCode);
 
+/** DO_FUND_MSG data output of each funding tx, with a (msgid, fee) entry for up to SMSG_FUND_PER_OUTPUT messages */
+std::vector<std::vector<uint8_t>> GetFundMsgData(const std::vector<uint160> &vMsgIds, const std::vector<uint32_t> &vMsgFees);
+
 extern bool fSecMsgEnabled;
 class CSMSG
 {
@@ -421,7 +566,8 @@ public:
     int WalletUnlocked(CWallet *pwallet);
     int WalletKeyChanged(CKeyID &keyId, const std::string &sLabel, ChangeType mode);
 
-    int ScanMessage(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayload, bool reportToGui, bool &received_msg, bool unlocking=false);
+    /** pdb_batch: if set, received messages are written to its open transaction, committed by the caller */
+    int ScanMessage(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayload, bool reportToGui, bool &received_msg, bool unlocking=false, SecMsgDB *pdb_batch=nullptr);
 
     int GetStoredKey(const CKeyID &ckid, CPubKey &cpkOut);
     int GetLocalKey(const CKeyID &ckid, CPubKey &cpkOut);
@@ -438,14 +584,23 @@ public:
 
     int ReadSmsgKey(const CKeyID &idk, CKey &key);
 
+    /** Read or blank a stored message, called with the shard of the token's bucket locked */
     int Retrieve(const SecMsgToken &token, std::vector<uint8_t> &vchData);
     int Remove(const SecMsgToken &token);
 
     int SmsgMisbehaving(CNode *pfrom, uint8_t n);
-    int Receive(CNode *pfrom, std::vector<uint8_t> &vchData);
+    /** Validate and store a bunch of messages, vchData is usually the network receive buffer */
+    int Receive(CNode *pfrom, Span<const uint8_t> vchData);
+    /** Request the messages listed in smsgHave format data that this node doesn't have */
+    int WantMissing(CNode *pfrom, const std::vector<uint8_t> &vchData);
 
     int CheckPurged(const SecureMessage *psmsg, const uint8_t *pPayload);
 
+    /** Schedule the bucket's next expiry on the timer wheel, if earlier than the pending one. Called with the bucket's shard locked */
+    void ScheduleBucketExpiry(int64_t bucket_time, SecMsgBucket &bucket);
+    /** Handle due timers, returns the locks that timed out as bucket time and peer id */
+    void ProcessTimers(const std::vector<SecMsgTimer> &due, std::vector<std::pair<int64_t, NodeId> > &timed_out_locks);
+
     int StoreUnscanned(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayload);
     int Store(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayload, bool fHashBucket);
     int Store(const SecureMessage &smsg, bool fHashBucket);
@@ -460,13 +615,19 @@ public:
         SecureMessage &smsg, std::string &sError, bool fPaid, size_t nRetention,
         bool fTestFee=false, CAmount *nFee=nullptr, size_t *nTxBytes=nullptr, bool fFromFile=false, bool submit_msg=true, bool add_to_outbox=true, bool fund_from_rct=false, size_t nRingSize=5, CCoinControl *coin_control=nullptr);
 
+    CKeyID GetOutboxAddress(const CKeyID &addressFrom);
+    int SendBatch(const CKeyID &addressFrom, std::vector<SecMsgBatchItem> &items, std::string &sError, bool fPaid, size_t nRetention,
+        bool fTestFee=false, CAmount *nFee=nullptr, size_t *nTxBytes=nullptr, bool add_to_outbox=true, bool fund_from_rct=false, size_t nRingSize=5, CCoinControl *coin_control=nullptr);
+
     bool GetPowHash(const SecureMessage *psmsg, const uint8_t *pPayload, uint32_t nPayload, uint256 &hash);
     int HashMsg(const SecureMessage &smsg, const uint8_t *pPayload, uint32_t nPayload, uint160 &hash);
     int FundMsg(SecureMessage &smsg, std::string &sError, bool fTestFee, CAmount *nFee, size_t *nTxBytes, bool fund_from_rct, size_t nRingSize, CCoinControl *coin_control);
+    int FundMsgs(const std::vector<SecureMessage*> &vpsmsg, std::string &sError, bool fTestFee, CAmount *nFee, size_t *nTxBytes, bool fund_from_rct, size_t nRingSize, CCoinControl *coin_control);
 
     std::vector<uint8_t> GetMsgID(const SecureMessage *psmsg, const uint8_t *pPayload);
     std::vector<uint8_t> GetMsgID(const SecureMessage &smsg);
 
+    /** May wait for the funding index to sync, must not be called with cs_smsg held */
     int Validate(const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayload);
     int SetHash (uint8_t *pHeader, uint8_t *pPayload, uint32_t nPayload);
 
@@ -478,10 +639,10 @@ public:
     int Decrypt(bool fTestOnly, const CKeyID &address, const uint8_t *pHeader, const uint8_t *pPayload, uint32_t nPayload, MessageData &msg);
     int Decrypt(bool fTestOnly, const CKeyID &address, const SecureMessage &smsg, MessageData &msg);
 
-    CCriticalSection cs_smsg; // All except inbox and outbox
+    CCriticalSection cs_smsg; // All except inbox, outbox and buckets
 
     SecMsgKeyStore keyStore;
-    std::map<int64_t, SecMsgBucket> buckets;
+    SecMsgBucketShards buckets;
     std::vector<SecMsgAddress> addresses;
     std::set<SecMsgPurged> setPurged;
     std::set<int64_t> setPurgedTimestamps;
@@ -492,12 +653,13 @@ public:
     std::unique_ptr<interfaces::Handler> m_wallet_load_handler;
 
     int64_t start_time = 0;
-    int64_t m_last_changed = 0;  // Updated whenever a message is stored
+    std::atomic<int64_t> m_last_changed{0};  // Updated whenever a message is stored
     int64_t nLastProcessedPurged = 0;
     CAmount m_absurd_smsg_fee = 500 * COIN;
     uint16_t m_smsg_max_receive_count = SMSG_DEFAULT_MAXRCV;
 
-    std::map<int64_t, int64_t> m_show_requests;
+    //! Bucket expiry, lock timeouts and show request pruning, has its own lock
+    SecMsgTimerWheel m_timers;
 };
 
 double GetDifficulty(uint32_t compact);
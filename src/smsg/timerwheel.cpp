@@ -0,0 +1,105 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <smsg/timerwheel.h>
+
+#include <algorithm>
+
+namespace smsg {
+
+SecMsgTimerWheel::SecMsgTimerWheel(int64_t now) : m_now(now)
+{
+}
+
+void SecMsgTimerWheel::Reset(int64_t now)
+{
+    LOCK(m_mutex);
+    for (auto &level : m_slots) {
+        for (auto &slot : level) {
+            slot.clear();
+        }
+    }
+    m_expired.clear();
+    m_overflow.clear();
+    m_size = 0;
+    m_now = now;
+}
+
+void SecMsgTimerWheel::Insert(const SecMsgTimer &timer)
+{
+    int64_t delta = timer.when - m_now;
+    if (delta <= 0) {
+        m_expired.push_back(timer);
+        return;
+    }
+    for (int level = 0; level < WHEEL_LEVELS; ++level) {
+        if (delta < ((int64_t)1 << (WHEEL_BITS * (level + 1)))) {
+            m_slots[level][(timer.when >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)].push_back(timer);
+            return;
+        }
+    }
+    m_overflow.push_back(timer);
+}
+
+void SecMsgTimerWheel::Cascade(std::vector<SecMsgTimer> &slot)
+{
+    std::vector<SecMsgTimer> timers;
+    timers.swap(slot);
+    for (const auto &timer : timers) {
+        Insert(timer);
+    }
+}
+
+void SecMsgTimerWheel::Schedule(int64_t when, uint8_t type, int64_t key, int64_t data)
+{
+    LOCK(m_mutex);
+    Insert(SecMsgTimer(when, type, key, data));
+    m_size++;
+}
+
+void SecMsgTimerWheel::Advance(int64_t now, std::vector<SecMsgTimer> &due)
+{
+    LOCK(m_mutex);
+    if (m_size == 0) {
+        m_now = std::max(m_now, now);
+        return;
+    }
+
+    size_t num_due = due.size();
+    due.insert(due.end(), m_expired.begin(), m_expired.end());
+    m_expired.clear();
+
+    while (m_now < now) {
+        m_now++;
+        int64_t index = m_now & (WHEEL_SLOTS - 1);
+        for (int level = 1; index == 0 && level < WHEEL_LEVELS; ++level) {
+            index = (m_now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1);
+            Cascade(m_slots[level][index]);
+            if (level == WHEEL_LEVELS - 1) {
+                Cascade(m_overflow);
+            }
+        }
+
+        std::vector<SecMsgTimer> &slot = m_slots[0][m_now & (WHEEL_SLOTS - 1)];
+        due.insert(due.end(), slot.begin(), slot.end());
+        slot.clear();
+        // Timers cascaded down to the current time
+        due.insert(due.end(), m_expired.begin(), m_expired.end());
+        m_expired.clear();
+
+        if (due.size() - num_due == m_size) {
+            m_now = now;
+            break;
+        }
+    }
+    m_size -= due.size() - num_due;
+}
+
+size_t SecMsgTimerWheel::Size() const
+{
+    LOCK(m_mutex);
+    return m_size;
+}
+
+} // namespace smsg
@@ -0,0 +1,79 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef FALCON_SMSG_TIMERWHEEL_H
+#define FALCON_SMSG_TIMERWHEEL_H
+
+#include <sync.h>
+
+#include <stdint.h>
+#include <vector>
+
+namespace smsg {
+
+enum SecMsgTimerType : uint8_t
+{
+    SMSG_TIMER_BUCKET_EXPIRY    = 1,    // key: bucket time, data: adjusted expiry time
+    SMSG_TIMER_BUCKET_LOCK      = 2,    // key: bucket time, data: peer id
+    SMSG_TIMER_SHOW_REQUEST     = 3,    // key: bucket time
+    SMSG_TIMER_PURGED_SETS      = 4,
+};
+
+class SecMsgTimer
+{
+public:
+    SecMsgTimer(int64_t when_, uint8_t type_, int64_t key_, int64_t data_)
+        : when(when_), key(key_), data(data_), type(type_) {};
+
+    int64_t when;
+    int64_t key;
+    int64_t data;
+    uint8_t type;
+};
+
+/**
+ * Hierarchical timer wheel with a resolution of one second.
+ *
+ * Level n holds timers due within 64^(n+1) seconds in slots of 64^n seconds,
+ * a slot is moved down a level when the wheel reaches it, so scheduling and
+ * expiring a timer costs O(1) regardless of how many are pending.
+ * Timers are never cancelled, handlers check the state they refer to is
+ * still current when the timer fires.
+ */
+class SecMsgTimerWheel
+{
+public:
+    explicit SecMsgTimerWheel(int64_t now = 0);
+
+    /** Drop all timers and set the current time */
+    void Reset(int64_t now);
+
+    /** Timers due at or before the current time fire on the next Advance */
+    void Schedule(int64_t when, uint8_t type, int64_t key, int64_t data = 0);
+
+    /** Move the wheel forward to now, appending the timers that became due */
+    void Advance(int64_t now, std::vector<SecMsgTimer> &due);
+
+    size_t Size() const;
+
+private:
+    static const int WHEEL_BITS = 6;
+    static const int WHEEL_SLOTS = 1 << WHEEL_BITS;
+    static const int WHEEL_LEVELS = 4;
+
+    mutable Mutex m_mutex;
+    int64_t m_now GUARDED_BY(m_mutex);
+    size_t m_size GUARDED_BY(m_mutex) = 0;
+    std::vector<SecMsgTimer> m_slots[WHEEL_LEVELS][WHEEL_SLOTS] GUARDED_BY(m_mutex);
+    //! Timers due now or beyond the range of the top level
+    std::vector<SecMsgTimer> m_expired GUARDED_BY(m_mutex);
+    std::vector<SecMsgTimer> m_overflow GUARDED_BY(m_mutex);
+
+    void Insert(const SecMsgTimer &timer) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void Cascade(std::vector<SecMsgTimer> &slot) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+};
+
+} // namespace smsg
+
+#endif // FALCON_SMSG_TIMERWHEEL_H
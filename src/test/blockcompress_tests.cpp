@@ -0,0 +1,191 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <blockcompress.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <miner.h>
+#include <pow.h>
+#include <script/interpreter.h>
+#include <streams.h>
+#include <undo.h>
+#include <validation.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcompress_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(compress_record)
+{
+    std::vector<uint8_t> data(5000), payload, result;
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (i / 100) & 0xFF;
+    }
+
+    BOOST_REQUIRE(CompressDiskRecord(data.data(), data.size(), payload));
+    BOOST_CHECK(payload.size() < data.size());
+    BOOST_CHECK(payload[0] == DISK_RECORD_LZ4);
+
+    std::string error_str;
+    BOOST_CHECK(DecompressDiskRecord(payload.data(), payload.size(), result, error_str));
+    BOOST_CHECK(result == data);
+
+    // Corrupted checksum
+    std::vector<uint8_t> bad = payload;
+    bad[5] ^= 1;
+    BOOST_CHECK(!DecompressDiskRecord(bad.data(), bad.size(), result, error_str));
+    BOOST_CHECK(error_str == "checksum mismatch");
+
+    // Truncated
+    BOOST_CHECK(!DecompressDiskRecord(payload.data(), payload.size() - 4, result, error_str));
+
+    // Unknown version
+    bad = payload;
+    bad[0] = 0x7F;
+    BOOST_CHECK(!DecompressDiskRecord(bad.data(), bad.size(), result, error_str));
+
+    // Incompressible data is left for the caller to store plain
+    std::vector<uint8_t> random_data(500);
+    for (auto &b : random_data) {
+        b = InsecureRandBits(8);
+    }
+    BOOST_CHECK(!CompressDiskRecord(random_data.data(), random_data.size(), payload));
+    BOOST_CHECK(payload.empty());
+}
+
+static uint32_t ReadRecordSize(const FlatFilePos &pos)
+{
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 4;
+    CAutoFile file(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    uint32_t nSize;
+    file >> nSize;
+    return nSize;
+}
+
+BOOST_FIXTURE_TEST_CASE(compressed_block_files, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Mature a few more coinbases, then spend them into many outputs so block and
+    // undo data are compressible
+    for (size_t i = 1; i < 10; ++i) {
+        CreateAndProcessBlock({}, scriptPubKey);
+    }
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    for (size_t i = 0; i < 10; ++i) {
+        spend.vin.push_back(CTxIn(m_coinbase_txns[i]->GetHash(), 0));
+    }
+    for (size_t i = 0; i < 50; ++i) {
+        spend.vout.push_back(CTxOut(1 * CENT, scriptPubKey));
+    }
+    for (size_t i = 0; i < spend.vin.size(); ++i) {
+        std::vector<unsigned char> vchSig;
+        CAmount amount = m_coinbase_txns[i]->vout[0].nValue;
+        std::vector<uint8_t> vchAmount(8);
+        memcpy(vchAmount.data(), &amount, 8);
+        uint256 hash = SignatureHash(scriptPubKey, spend, i, SIGHASH_ALL, vchAmount, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spend.vin[i].scriptSig << vchSig;
+    }
+
+    fCompressBlocks = true;
+    CBlock block = CreateAndProcessBlock({spend}, scriptPubKey);
+    fCompressBlocks = false;
+
+    const CBlockIndex *pindex, *pindex_plain;
+    {
+        LOCK(cs_main);
+        pindex = ::ChainActive().Tip();
+        pindex_plain = pindex->pprev;
+    }
+    BOOST_REQUIRE(pindex->GetBlockHash() == block.GetHash());
+
+    BOOST_CHECK(ReadRecordSize(pindex->GetBlockPos()) & DISK_RECORD_COMPRESSED);
+    BOOST_CHECK(!(ReadRecordSize(pindex_plain->GetBlockPos()) & DISK_RECORD_COMPRESSED));
+
+    // Compressed and plain records coexist in the same file
+    CBlock block_read;
+    BOOST_CHECK(ReadBlockFromDisk(block_read, pindex, Params().GetConsensus()));
+    BOOST_CHECK(block_read.GetHash() == block.GetHash());
+    BOOST_CHECK(ReadBlockFromDisk(block_read, pindex_plain, Params().GetConsensus()));
+
+    // Raw reads, used to serve blocks to peers, return the decompressed block
+    std::vector<uint8_t> raw;
+    BOOST_CHECK(ReadRawBlockFromDisk(raw, pindex, Params().MessageStart()));
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << block;
+    BOOST_CHECK(raw == std::vector<uint8_t>(ss.begin(), ss.end()));
+
+    CTransactionRef tx;
+    BOOST_CHECK(ReadTransactionFromDiskBlock(pindex, 1, tx));
+    BOOST_CHECK(tx->GetHash() == spend.GetHash());
+
+    // Transaction offsets, as stored by the txindex, are relative to the serialized block
+    CBlockHeader header;
+    unsigned int nTxOffset = GetSizeOfCompactSize(block.vtx.size()) + ::GetSerializeSize(*block.vtx[0], CLIENT_VERSION);
+    BOOST_CHECK(ReadTransactionFromDiskBlock(pindex->GetBlockPos(), nTxOffset, header, tx));
+    BOOST_CHECK(header.GetHash() == block.GetHash());
+    BOOST_CHECK(tx->GetHash() == spend.GetHash());
+    BOOST_CHECK(ReadTransactionFromDiskBlock(pindex_plain->GetBlockPos(), GetSizeOfCompactSize(1), header, tx));
+    BOOST_CHECK(header.GetHash() == pindex_plain->GetBlockHash());
+    BOOST_CHECK(tx->IsCoinBase());
+
+    CBlockUndo blockundo;
+    BOOST_CHECK(UndoReadFromDisk(blockundo, pindex));
+    BOOST_REQUIRE(blockundo.vtxundo.size() == 1);
+    BOOST_CHECK(blockundo.vtxundo[0].vprevout.size() == spend.vin.size());
+    BOOST_CHECK(UndoReadFromDisk(blockundo, pindex_plain));
+}
+
+BOOST_FIXTURE_TEST_CASE(import_damaged_records, TestChain100Setup)
+{
+    const CChainParams& chainparams = Params();
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // A block extending the tip, not processed yet
+    std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+    CBlock block = pblocktemplate->block;
+    {
+        LOCK(cs_main);
+        unsigned int extraNonce = 0;
+        IncrementExtraNonce(&block, ::ChainActive().Tip(), extraNonce);
+    }
+    while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+    CDataStream ss_block(SER_DISK, CLIENT_VERSION);
+    ss_block << block;
+
+    std::vector<uint8_t> data(5000), payload;
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = (i / 100) & 0xFF;
+    }
+    BOOST_REQUIRE(CompressDiskRecord(data.data(), data.size(), payload));
+    payload[5] ^= 1;
+
+    // Damaged records claim sizes running over the records after them,
+    // which must be found by scanning on from the byte after the magic.
+    fs::path path = GetDataDir() / "damaged.dat";
+    {
+        CAutoFile file(fsbridge::fopen(path, "wb"), SER_DISK, CLIENT_VERSION);
+        unsigned int nSizeTruncated = ss_block.size();
+        unsigned int nSizeCompressed = payload.size() + 2 * 8 + ss_block.size() / 2 + ss_block.size();
+        file << chainparams.MessageStart() << (nSizeCompressed | DISK_RECORD_COMPRESSED);
+        file.write((const char*)payload.data(), payload.size());
+        file << chainparams.MessageStart() << nSizeTruncated;
+        file.write(ss_block.data(), ss_block.size() / 2);
+        file << chainparams.MessageStart() << (unsigned int)ss_block.size();
+        file.write(ss_block.data(), ss_block.size());
+    }
+
+    BOOST_CHECK(LoadExternalBlockFile(chainparams, fsbridge::fopen(path, "rb")));
+    LOCK(cs_main);
+    const CBlockIndex* pindex = LookupBlockIndex(block.GetHash());
+    BOOST_REQUIRE(pindex);
+    BOOST_CHECK(pindex->nStatus & BLOCK_HAVE_DATA);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
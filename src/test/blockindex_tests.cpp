@@ -0,0 +1,144 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <streams.h>
+#include <test/setup_common.h>
+#include <txdb.h>
+
+#include <map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockindex_tests, FalconBasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(cold_lazy_load)
+{
+    // Entries never written read as zero without allocating
+    CBlockIndex index;
+    const CBlockIndex& index_const = index;
+    BOOST_CHECK(!index.HaveColdLoaded());
+    BOOST_CHECK(index_const.Cold().nMoneySupply == 0);
+    BOOST_CHECK(!index.HaveColdLoaded());
+    index.Cold().nMoneySupply = 5;
+    BOOST_CHECK(index.HaveColdLoaded());
+    BOOST_CHECK(CBlockIndex(index).Cold().nMoneySupply == 5);
+
+    uint256 hash = InsecureRand256();
+    CBlockIndex deep;
+    const CBlockIndex& deep_const = deep;
+    deep.phashBlock = &hash;
+    deep.UnloadCold();
+
+    int num_loads = 0;
+    bool fail = true;
+    g_load_block_index_cold = [&](const uint256& hash_load, CBlockIndexCold& cold) {
+        num_loads++;
+        if (fail || hash_load != hash) {
+            return false;
+        }
+        cold.nMoneySupply = 7;
+        cold.nAnonOutputs = 3;
+        return true;
+    };
+
+    // Unreadable entries read as zero, writes are dropped and they can't be stored
+    BOOST_CHECK(!deep.LoadCold());
+    BOOST_CHECK(deep_const.Cold().nMoneySupply == 0);
+    deep.Cold().nMoneySupply = 9;
+    BOOST_CHECK(!deep.HaveColdLoaded());
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    BOOST_CHECK_THROW(ss << CDiskBlockIndex(&deep), std::ios_base::failure);
+
+    // Loaded once, on first use
+    fail = false;
+    BOOST_CHECK(deep_const.Cold().nMoneySupply == 7);
+    BOOST_CHECK(deep.HaveColdLoaded());
+    int num_loads_before = num_loads;
+    BOOST_CHECK(deep.Cold().nAnonOutputs == 3);
+    BOOST_CHECK(deep_const.Cold().nMoneySupply == 7);
+    BOOST_CHECK_EQUAL(num_loads, num_loads_before);
+
+    g_load_block_index_cold = nullptr;
+}
+
+BOOST_AUTO_TEST_CASE(block_index_loader)
+{
+    const int num_blocks = 3000;
+    CBlockTreeDB db(1 << 20, true);
+
+    // Genesis is checked by the loader, the entries above it are made up
+    std::vector<std::unique_ptr<CBlockIndex>> written;
+    std::vector<uint256> hashes;
+    hashes.reserve(num_blocks);
+    const CBlock& genesis = Params().GenesisBlock();
+    for (int i = 0; i < num_blocks; ++i) {
+        written.emplace_back(new CBlockIndex(i == 0 ? genesis.GetBlockHeader() : CBlockHeader()));
+        CBlockIndex* pindex = written.back().get();
+        if (i > 0) {
+            pindex->nVersion = genesis.nVersion;
+            pindex->nTime = genesis.nTime + i;
+            pindex->nBits = genesis.nBits;
+            pindex->hashMerkleRoot = InsecureRand256();
+            pindex->pprev = written[i - 1].get();
+        }
+        pindex->nHeight = i;
+        pindex->nStatus = BLOCK_VALID_TREE;
+        pindex->Cold().nMoneySupply = i * COIN;
+        pindex->Cold().nAnonOutputs = i;
+        hashes.push_back(pindex->GetBlockHeader().GetHash());
+        pindex->phashBlock = &hashes.back();
+    }
+    std::vector<const CBlockIndex*> blockinfo;
+    for (const auto& pindex : written) {
+        blockinfo.push_back(pindex.get());
+    }
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, blockinfo));
+
+    std::map<uint256, std::unique_ptr<CBlockIndex>> block_index;
+    auto insert = [&block_index](const uint256& hash) -> CBlockIndex* {
+        if (hash.IsNull()) {
+            return nullptr;
+        }
+        auto mi = block_index.find(hash);
+        if (mi == block_index.end()) {
+            mi = block_index.emplace(hash, std::unique_ptr<CBlockIndex>(new CBlockIndex())).first;
+            mi->second->phashBlock = &mi->first;
+        }
+        return mi->second.get();
+    };
+    BOOST_REQUIRE(db.LoadBlockIndexGuts(Params().GetConsensus(), insert, 4));
+    BOOST_REQUIRE_EQUAL(block_index.size(), (size_t)num_blocks);
+
+    g_load_block_index_cold = [&db](const uint256& hash, CBlockIndexCold& cold) {
+        CDiskBlockIndex diskindex;
+        if (!db.ReadDiskBlockIndex(hash, diskindex)) {
+            return false;
+        }
+        cold = diskindex.Cold();
+        return true;
+    };
+
+    int num_unloaded = 0;
+    for (int i = 0; i < num_blocks; ++i) {
+        const CBlockIndex* pindex = block_index[hashes[i]].get();
+        BOOST_REQUIRE(pindex);
+        BOOST_CHECK_EQUAL(pindex->nHeight, i);
+        BOOST_CHECK(pindex->pprev == (i > 0 ? block_index[hashes[i - 1]].get() : nullptr));
+        // Entries near the top keep their cold fields
+        if (!pindex->HaveColdLoaded()) {
+            BOOST_CHECK(i < num_blocks - 1000);
+            num_unloaded++;
+        }
+        BOOST_CHECK_EQUAL(pindex->Cold().nMoneySupply, i * COIN);
+        BOOST_CHECK_EQUAL(pindex->Cold().nAnonOutputs, i);
+        BOOST_CHECK(pindex->HaveColdLoaded());
+    }
+    BOOST_CHECK(num_unloaded > 0);
+
+    g_load_block_index_cold = nullptr;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <insight/blocktimeindex.h>
+#include <validation.h>
+#include <test/setup_common.h>
+
+#include <limits>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blocktimeindex_tests, TestingSetup)
+
+static void BuildChain(std::vector<CBlockIndex> &blocks, std::vector<uint256> &hashes, CBlockIndex *pfork, uint32_t time_start, uint32_t seed)
+{
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        hashes[i] = ArithToUint256(arith_uint256(seed * 1000 + i));
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i > 0 ? &blocks[i - 1] : pfork;
+        blocks[i].nHeight = blocks[i].pprev ? blocks[i].pprev->nHeight + 1 : 0;
+        // Times are not monotonic, every third block steps back
+        blocks[i].nTime = time_start + i * 16 - (i % 3 == 2 ? 24 : 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blocktimeindex_reorg)
+{
+    CBlockTimeIndex index;
+    std::vector<std::pair<uint256, unsigned int> > result;
+    BOOST_CHECK(!index.GetBlockHashes(std::numeric_limits<uint32_t>::max(), 0, false, result));
+
+    {
+        LOCK(cs_main);
+        index.Init();
+    }
+
+    std::vector<CBlockIndex> chain_a(100);
+    std::vector<uint256> hashes_a(100);
+    BuildChain(chain_a, hashes_a, nullptr, 2000000000, 1);
+    index.SetTip(&chain_a.back());
+
+    uint32_t low = chain_a[10].nTime, high = chain_a[60].nTime;
+    BOOST_CHECK(index.GetBlockHashes(high, low, true, result));
+    size_t expect = 0;
+    for (const auto &block : chain_a) {
+        expect += block.nTime >= low && block.nTime < high ? 1 : 0;
+    }
+    BOOST_CHECK_EQUAL(result.size(), expect);
+    for (size_t i = 1; i < result.size(); ++i) {
+        BOOST_CHECK(result[i - 1].second <= result[i].second);
+        BOOST_CHECK(result[i].second >= low && result[i].second < high);
+    }
+
+    // Reorg the top 40 blocks away
+    std::vector<CBlockIndex> chain_b(50);
+    std::vector<uint256> hashes_b(50);
+    BuildChain(chain_b, hashes_b, &chain_a[59], chain_a[59].nTime + 5, 2);
+    index.SetTip(&chain_b.back());
+
+    result.clear();
+    BOOST_CHECK(index.GetBlockHashes(chain_a[99].nTime + 1, chain_a[60].nTime, true, result));
+    for (const auto &item : result) {
+        for (size_t i = 60; i < chain_a.size(); ++i) {
+            BOOST_CHECK(item.first != chain_a[i].GetBlockHash());
+        }
+    }
+
+    // Disconnected blocks are still returned when orphans are included
+    result.clear();
+    BOOST_CHECK(index.GetBlockHashes(chain_a[99].nTime + 1, chain_a[60].nTime, false, result));
+    size_t num_stale = 0;
+    for (const auto &item : result) {
+        for (size_t i = 60; i < chain_a.size(); ++i) {
+            num_stale += item.first == chain_a[i].GetBlockHash() ? 1 : 0;
+        }
+    }
+    BOOST_CHECK_EQUAL(num_stale, 40U);
+    for (size_t i = 1; i < result.size(); ++i) {
+        BOOST_CHECK(result[i - 1].second <= result[i].second);
+    }
+
+    // Reorg back, stale entries move into the active chain
+    index.SetTip(&chain_a.back());
+    result.clear();
+    BOOST_CHECK(index.GetBlockHashes(chain_a[99].nTime + 1, chain_a[0].nTime, true, result));
+    BOOST_CHECK_EQUAL(result.size(), chain_a.size());
+    result.clear();
+    BOOST_CHECK(index.GetBlockHashes(std::numeric_limits<uint32_t>::max(), chain_a[0].nTime, false, result));
+    BOOST_CHECK_EQUAL(result.size(), chain_a.size() + chain_b.size());
+
+    index.Clear();
+    BOOST_CHECK(!index.GetBlockHashes(std::numeric_limits<uint32_t>::max(), 0, false, result));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
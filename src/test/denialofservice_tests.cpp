@@ -22,7 +22,9 @@
 
 #include <test/setup_common.h>
 
+#include <atomic>
 #include <stdint.h>
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -41,6 +43,25 @@ struct CConnmanTest : public CConnman {
         }
         vNodes.clear();
     }
+    void StartMessageHandlers()
+    {
+        flagInterruptMsgProc = false;
+        for (int i = 0; i < m_msghand_threads; i++) {
+            threadMessageHandlers.emplace_back(&CConnman::ThreadMessageHandler, this, i);
+        }
+    }
+    void StopMessageHandlers()
+    {
+        {
+            LOCK(mutexMsgProc);
+            flagInterruptMsgProc = true;
+        }
+        condMsgProc.notify_all();
+        for (auto& thread : threadMessageHandlers) {
+            thread.join();
+        }
+        threadMessageHandlers.clear();
+    }
 };
 
 // Tests these internal-to-net_processing.cpp methods:
@@ -220,6 +241,124 @@ BOOST_AUTO_TEST_CASE(stale_tip_peer_management)
     connman->ClearNodes();
 }
 
+static constexpr int MSGHAND_TEST_PEERS = 8;
+
+/** Takes one queued message per call, recording its sequence number and any peer handled by two threads at once */
+class SequenceEvents : public NetEventsInterface
+{
+public:
+    std::atomic<int> m_processed{0};
+    std::atomic<bool> m_overlap{false};
+    //! Only written by the thread handling the peer
+    std::vector<int> m_received[MSGHAND_TEST_PEERS];
+
+    bool ProcessMessages(CNode* pnode, std::atomic<bool>& interrupt) override
+    {
+        Enter(pnode);
+        std::list<CNetMessage> msgs;
+        bool more_work;
+        {
+            LOCK(pnode->cs_vProcessMsg);
+            if (pnode->vProcessMsg.empty()) {
+                Leave(pnode);
+                return false;
+            }
+            msgs.splice(msgs.begin(), pnode->vProcessMsg, pnode->vProcessMsg.begin());
+            more_work = !pnode->vProcessMsg.empty();
+        }
+        int seq;
+        msgs.front().vRecv >> seq;
+        // Leave room for another thread to pick up the same peer
+        std::this_thread::yield();
+        m_received[pnode->GetId()].push_back(seq);
+        Leave(pnode);
+        m_processed++;
+        return more_work;
+    }
+    bool SendMessages(CNode* pnode) override
+    {
+        Enter(pnode);
+        std::this_thread::yield();
+        Leave(pnode);
+        return true;
+    }
+    void InitializeNode(CNode* pnode) override {}
+    void FinalizeNode(NodeId id, bool& update_connection_time) override {}
+
+private:
+    std::atomic<bool> m_in_peer[MSGHAND_TEST_PEERS]{};
+
+    void Enter(CNode* pnode)
+    {
+        if (m_in_peer[pnode->GetId()].exchange(true)) {
+            m_overlap = true;
+        }
+    }
+    void Leave(CNode* pnode)
+    {
+        m_in_peer[pnode->GetId()] = false;
+    }
+};
+
+static void QueueSequence(CNode& node, int seq)
+{
+    CNetMessage msg(Params().MessageStart(), SER_NETWORK, INIT_PROTO_VERSION);
+    msg.vRecv << seq;
+    LOCK(node.cs_vProcessMsg);
+    node.vProcessMsg.push_back(std::move(msg));
+}
+
+BOOST_AUTO_TEST_CASE(message_handler_threads)
+{
+    constexpr int num_messages = 200;
+    SequenceEvents events;
+    auto connman = MakeUnique<CConnmanTest>(0x1337, 0x1337);
+    CConnman::Options options;
+    options.m_msgproc = &events;
+    options.m_msghand_threads = 4;
+    connman->Init(options);
+
+    std::vector<CNode*> nodes;
+    for (NodeId i = 0; i < MSGHAND_TEST_PEERS; i++) {
+        CAddress addr(ip(0xa0b0c000 + i), NODE_NONE);
+        nodes.push_back(new CNode(i, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", /*fInboundIn=*/ true));
+        connman->AddNode(*nodes.back());
+    }
+
+    // Queue half the messages up front and the rest while the threads run
+    int seq = 0;
+    for (; seq < num_messages / 2; seq++) {
+        for (CNode* node : nodes) {
+            QueueSequence(*node, seq);
+        }
+    }
+    connman->StartMessageHandlers();
+    for (; seq < num_messages; seq++) {
+        for (CNode* node : nodes) {
+            QueueSequence(*node, seq);
+        }
+        connman->WakeMessageHandler();
+    }
+
+    const int64_t deadline = GetTimeMillis() + 60000;
+    while (events.m_processed < num_messages * MSGHAND_TEST_PEERS && GetTimeMillis() < deadline) {
+        connman->WakeMessageHandler();
+        MilliSleep(10);
+    }
+    connman->StopMessageHandlers();
+
+    BOOST_CHECK(!events.m_overlap);
+    BOOST_CHECK_EQUAL(events.m_processed.load(), num_messages * MSGHAND_TEST_PEERS);
+    for (int i = 0; i < MSGHAND_TEST_PEERS; i++) {
+        BOOST_REQUIRE_EQUAL(events.m_received[i].size(), (size_t)num_messages);
+        for (int k = 0; k < num_messages; k++) {
+            BOOST_CHECK_EQUAL(events.m_received[i][k], k);
+        }
+    }
+
+    connman->ClearNodes();
+}
+
 BOOST_AUTO_TEST_CASE(DoS_banning)
 {
     auto banman = MakeUnique<BanMan>(GetDataDir() / "banlist.dat", nullptr, DEFAULT_MISBEHAVING_BANTIME);
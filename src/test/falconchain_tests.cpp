@@ -13,6 +13,9 @@
 #include <pos/kernel.h>
 #include <chainparams.h>
 #include <blind.h>
+#include <chain.h>
+#include <proofverifier.h>
+#include <txdb.h>
 
 #include <script/sign.h>
 #include <policy/policy.h>
@@ -294,6 +297,133 @@ BOOST_AUTO_TEST_CASE(mixed_output_types)
     ECC_Stop_Blinding();
 }
 
+BOOST_AUTO_TEST_CASE(skipped_rangeproofs)
+{
+    ECC_Start_Blinding();
+
+    CMutableTransaction txn;
+    txn.nVersion = FALCON_TXN_VERSION;
+    txn.vin.push_back(CTxIn(InsecureRand256(), 0));
+    OUTPUT_PTR<CTxOutCT> out_ct = MAKE_OUTPUT<CTxOutCT>();
+    out_ct->vData.assign(33, 0x02);
+    out_ct->vRangeproof.assign(600, 0x01);
+    BOOST_REQUIRE(secp256k1_pedersen_commit(secp256k1_ctx_blind, &out_ct->commitment, InsecureRand256().begin(), 1 * COIN, &secp256k1_generator_const_h, &secp256k1_generator_const_g));
+    txn.vpout.push_back(out_ct);
+
+    CValidationState state;
+    state.SetStateInfo(GetTime(), 1, Params().GetConsensus(), true);
+    BOOST_CHECK(!CheckBlindOutput(state, out_ct.get()));
+    BOOST_CHECK(state.GetRejectReason() == "bad-ctout-rangeproof-verify");
+
+    // Below the assumed valid block only the format is checked
+    CValidationState state_skip;
+    state_skip.SetStateInfo(GetTime(), 1, Params().GetConsensus(), true);
+    state_skip.m_skip_rangeproof = true;
+    BOOST_CHECK(CheckBlindOutput(state_skip, out_ct.get()));
+    out_ct->vRangeproof.resize(10);
+    BOOST_CHECK(!CheckBlindOutput(state_skip, out_ct.get()));
+    BOOST_CHECK(state_skip.GetRejectReason() == "bad-ctout-rangeproof-size");
+    out_ct->vRangeproof.assign(600, 0x01);
+
+    // The background verifier catches the bad proof
+    CBlock block;
+    block.nTime = GetTime();
+    block.vtx.push_back(MakeTransactionRef(txn));
+    CBlockIndex index;
+    index.nHeight = 10;
+    CProofVerifier verifier;
+    std::string reason;
+    BOOST_CHECK(!verifier.VerifyBlock(block, &index, reason));
+    BOOST_CHECK(reason.find("bad-ctout-rangeproof-verify") == 0);
+
+    block.vtx[0] = MakeTransactionRef(CMutableTransaction());
+    BOOST_CHECK(verifier.VerifyBlock(block, &index, reason));
+
+    int next_height, skipped_height;
+    verifier.BlockSkipped(&index);
+    verifier.GetProgress(next_height, skipped_height);
+    BOOST_CHECK(next_height == 10 && skipped_height == 10);
+
+    // Heights stored by an earlier run are merged in before writing
+    pblocktree.reset(new CBlockTreeDB(1 << 20, true));
+    BOOST_CHECK(pblocktree->WriteProofCheckState(4, 6, false));
+    BOOST_CHECK(verifier.WriteState(false));
+    BOOST_CHECK(pblocktree->ReadProofCheckState(next_height, skipped_height));
+    BOOST_CHECK(next_height == 4 && skipped_height == 10);
+
+    CProofVerifier verifier_restarted;
+    index.nHeight = 12;
+    verifier_restarted.BlockSkipped(&index);
+    BOOST_CHECK(verifier_restarted.WriteState(true));
+    verifier_restarted.GetProgress(next_height, skipped_height);
+    BOOST_CHECK(next_height == 4 && skipped_height == 12);
+    pblocktree.reset();
+
+    ECC_Stop_Blinding();
+}
+
+BOOST_AUTO_TEST_CASE(txout_arena)
+{
+    CMutableTransaction txn;
+    txn.nVersion = FALCON_TXN_VERSION;
+    txn.vin.push_back(CTxIn(InsecureRand256(), 0));
+
+    CScript scriptPubKey = CScript() << OP_RETURN << std::vector<uint8_t>(40, 0x01);
+    OUTPUT_PTR<CTxOutData> out_fee = MAKE_OUTPUT<CTxOutData>();
+    out_fee->vData.push_back(DO_FEE);
+    BOOST_REQUIRE(0 == PutVarInt(out_fee->vData, 2000));
+    txn.vpout.push_back(out_fee);
+    for (size_t i = 0; i < 20; ++i) {
+        txn.vpout.push_back(MAKE_OUTPUT<CTxOutStandard>(i * COIN, scriptPubKey));
+    }
+    // Won't fit in the first chunk, sized for data outputs
+    for (size_t i = 0; i < 10; ++i) {
+        OUTPUT_PTR<CTxOutCT> out_ct = MAKE_OUTPUT<CTxOutCT>();
+        out_ct->vData.assign(33, i);
+        out_ct->vRangeproof.assign(700, i);
+        out_ct->scriptPubKey = scriptPubKey;
+        txn.vpout.push_back(out_ct);
+        OUTPUT_PTR<CTxOutRingCT> out_rct = MAKE_OUTPUT<CTxOutRingCT>();
+        out_rct->vData.assign(33, i);
+        out_rct->vRangeproof.assign(1000, i);
+        txn.vpout.push_back(out_rct);
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << txn;
+    std::vector<uint8_t> vSerialised(ss.begin(), ss.end());
+
+    CTxOutBaseRef kept;
+    {
+        CTransaction tx(deserialize, ss);
+        BOOST_CHECK(tx.GetHash() == txn.GetHash());
+        BOOST_REQUIRE(tx.vpout.size() == txn.vpout.size());
+        for (size_t k = 0; k < tx.vpout.size(); ++k) {
+            BOOST_CHECK(tx.vpout[k]->GetType() == txn.vpout[k]->GetType());
+        }
+        CDataStream ss_check(SER_NETWORK, PROTOCOL_VERSION);
+        ss_check << tx;
+        BOOST_CHECK(std::vector<uint8_t>(ss_check.begin(), ss_check.end()) == vSerialised);
+        kept = tx.vpout.back();
+
+        // Destroying the outputs doesn't depend on their mutable type tag
+        tx.vpout[1]->nVersion = OUTPUT_RINGCT;
+        tx.vpout[2]->nVersion = 0x7F;
+    }
+
+    // Outputs keep the arena alive after the transaction is gone
+    BOOST_REQUIRE(kept->IsType(OUTPUT_RINGCT));
+    BOOST_CHECK(kept->GetPRangeproof()->size() == 1000);
+    BOOST_CHECK((*kept->GetPData())[0] == 9);
+
+    // Unknown output types are rejected
+    std::vector<uint8_t> vBad = vSerialised;
+    size_t ofs_first_output = 2 + 4 + GetSerializeSize(txn.vin, PROTOCOL_VERSION) + 1;
+    vBad[ofs_first_output] = 0x7F;
+    CDataStream ss_bad(vBad, SER_NETWORK, PROTOCOL_VERSION);
+    BOOST_CHECK_THROW(CTransaction(deserialize, ss_bad), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(op_iscoinstake_tests)
 {
     CKey k1, k2;
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <anon.h>
 #include <policy/policy.h>
 #include <txmempool.h>
 #include <util/system.h>
@@ -751,4 +752,50 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 6ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolKeyImageConflictTest)
+{
+    TestMemPoolEntryHelper entry;
+    CTxMemPool pool;
+
+    std::vector<uint8_t> vKeyImage(33, 0xab);
+    vKeyImage[0] = 0x02;
+    const CCmpPubKey &ki = *((CCmpPubKey*)vKeyImage.data());
+
+    // Two anon spends of the same key image
+    CMutableTransaction tx[2];
+    for (int i = 0; i < 2; i++) {
+        tx[i].vin.resize(1);
+        tx[i].vin[0].prevout.n = COutPoint::ANON_MARKER;
+        tx[i].vin[0].SetAnonInfo(1, 3);
+        tx[i].vin[0].scriptData.stack.push_back(vKeyImage);
+        tx[i].vout.resize(1);
+        tx[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+        tx[i].vout[0].nValue = (10 + i) * COIN;
+    }
+    CTransaction tx0(tx[0]), tx1(tx[1]);
+
+    LOCK2(cs_main, pool.cs);
+    uint256 txhashKI;
+    BOOST_CHECK(!pool.HaveKeyImage(ki, txhashKI));
+    BOOST_CHECK(pool.GetConflictTx(ki) == nullptr);
+
+    pool.addUnchecked(entry.FromTx(tx[0]));
+    BOOST_CHECK(AddKeyImagesToMempool(tx0, pool));
+    BOOST_CHECK(pool.HaveKeyImage(ki, txhashKI));
+    BOOST_CHECK(txhashKI == tx0.GetHash());
+    const CTransaction *ptxConflict = pool.GetConflictTx(ki);
+    BOOST_REQUIRE(ptxConflict);
+    BOOST_CHECK(ptxConflict->GetHash() == tx0.GetHash());
+
+    // Removing a tx that doesn't own the key image leaves it in place
+    BOOST_CHECK(RemoveKeyImagesFromMempool(tx1.GetHash(), tx1.vin[0], pool));
+    BOOST_CHECK(pool.HaveKeyImage(ki, txhashKI));
+
+    // A block spending the key image evicts the conflicting pool tx
+    pool.removeConflicts(tx1);
+    BOOST_CHECK_EQUAL(pool.size(), 0U);
+    BOOST_CHECK(!pool.HaveKeyImage(ki, txhashKI));
+    BOOST_CHECK(pool.GetConflictTx(ki) == nullptr);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
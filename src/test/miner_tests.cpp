@@ -525,4 +525,88 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_AUTO_TEST_CASE(BlockTemplateManager_incremental)
+{
+    BlockTemplateManager manager(Params());
+    RegisterValidationInterface(&manager);
+    GetMainSignals().RegisterWithMempoolSignals(mempool);
+
+    TestMemPoolEntryHelper entry;
+    entry.nFee = 10000;
+    CScript script;
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate = manager.GetBlockTemplate(script, false);
+    BOOST_REQUIRE(pblocktemplate);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 1U);
+    BOOST_CHECK(pblocktemplate->block.hashPrevBlock == ::ChainActive().Tip()->GetBlockHash());
+    const uint64_t nSizeBuilt = nLastBlockSize;
+
+    // A transaction without unconfirmed parents is appended to the shared template
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.resize(1);
+    tx.vout[0].nValue = 1000;
+    tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    CTransactionRef ptx = MakeTransactionRef(tx);
+    {
+        LOCK2(cs_main, mempool.cs);
+        mempool.addUnchecked(entry.FromTx(ptx));
+    }
+    GetMainSignals().TransactionAddedToMempool(ptx);
+    SyncWithValidationInterfaceQueue();
+
+    pblocktemplate = manager.GetBlockTemplate(script, false);
+    BOOST_REQUIRE(pblocktemplate);
+    BOOST_REQUIRE_EQUAL(pblocktemplate->block.vtx.size(), 2U);
+    BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == ptx->GetHash());
+    BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[0], -10000);
+    BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[1], 10000);
+
+    // Stats follow the appended transaction
+    BOOST_CHECK_EQUAL(nLastBlockTx, 1U);
+    BOOST_CHECK_EQUAL(nLastBlockSize, nSizeBuilt + ::GetSerializeSize(*ptx, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(*BlockAssembler::m_last_block_num_txs, 1);
+
+    // Transactions taken from the mempool are marked for the fast validation path
+    BOOST_REQUIRE_EQUAL(pblocktemplate->block.vPrevalidated.size(), 2U);
+    BOOST_CHECK(!pblocktemplate->block.vPrevalidated[0]);
+    BOOST_CHECK(pblocktemplate->block.vPrevalidated[1]);
+    BOOST_CHECK(AssemblerForTest(Params()).CreateNewBlock(script, false)->block.vPrevalidated == pblocktemplate->block.vPrevalidated);
+
+    // Copies handed out are independent of the shared template
+    pblocktemplate->block.vtx.pop_back();
+    BOOST_CHECK_EQUAL(manager.GetBlockTemplate(script, false)->block.vtx.size(), 2U);
+
+    // A child of a mempool transaction is not appended
+    CMutableTransaction child;
+    child.vin.resize(1);
+    child.vin[0].prevout = COutPoint(ptx->GetHash(), 0);
+    child.vin[0].scriptSig = CScript() << OP_1;
+    child.vout.resize(1);
+    child.vout[0].nValue = 500;
+    child.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    CTransactionRef ptx_child = MakeTransactionRef(child);
+    {
+        LOCK2(cs_main, mempool.cs);
+        mempool.addUnchecked(entry.FromTx(ptx_child));
+    }
+    GetMainSignals().TransactionAddedToMempool(ptx_child);
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(manager.GetBlockTemplate(script, false)->block.vtx.size(), 2U);
+
+    // Removing an included transaction rebuilds the template from the mempool
+    {
+        LOCK(mempool.cs);
+        mempool.removeRecursive(*ptx, MemPoolRemovalReason::EXPIRY);
+    }
+    SyncWithValidationInterfaceQueue();
+    BOOST_CHECK_EQUAL(manager.GetBlockTemplate(script, false)->block.vtx.size(), 1U);
+
+    GetMainSignals().UnregisterWithMempoolSignals(mempool);
+    UnregisterValidationInterface(&manager);
+    mempool.clear();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,12 +12,17 @@
 #include <streams.h>
 #include <net.h>
 #include <netbase.h>
+#include <netmessagemaker.h>
 #include <chainparams.h>
 #include <util/memory.h>
 #include <util/system.h>
 
 #include <memory>
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 class CAddrManSerializationMock : public CAddrMan
 {
 public:
@@ -190,6 +195,277 @@ BOOST_AUTO_TEST_CASE(cnode_simple_test)
     BOOST_CHECK(pnode2->fFeeler == false);
 }
 
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(cnode_send_shared_payload)
+{
+    int fds[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    CAddress addr = CAddress(CService(CNetAddr(), 7777), NODE_NETWORK);
+    CConnman connman(0x1337, 0x1337);
+    std::unique_ptr<CNode> pnode = MakeUnique<CNode>(0, NODE_NETWORK, 0, fds[0], addr, 0, 0, CAddress(), "", false);
+
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    std::vector<unsigned char> vPayload(1000);
+    for (size_t i = 0; i < vPayload.size(); ++i) {
+        vPayload[i] = i & 0xff;
+    }
+    CSharedNetPayloadRef payload = msgMaker.MakePayload(0, vPayload);
+    BOOST_CHECK(payload->hash == Hash(payload->data.begin(), payload->data.end()));
+
+    // A shared payload is sent identically to one serialized per peer
+    CSerializedNetMsg expect_msg = msgMaker.Make(NetMsgType::BLOCK, vPayload);
+    BOOST_CHECK(expect_msg.data == payload->data);
+    connman.PushMessage(pnode.get(), msgMaker.MakeShared(NetMsgType::BLOCK, payload));
+    connman.PushMessage(pnode.get(), msgMaker.Make(NetMsgType::BLOCK, vPayload));
+    connman.PushMessage(pnode.get(), msgMaker.MakeShared(NetMsgType::BLOCK, payload));
+    BOOST_CHECK(payload.use_count() == 1);
+    BOOST_CHECK(pnode->vSendMsg.empty());
+
+    const size_t nMsgSize = CMessageHeader::HEADER_SIZE + payload->data.size();
+    std::vector<unsigned char> vRecv(nMsgSize * 3);
+    size_t nRead = 0;
+    while (nRead < vRecv.size()) {
+        ssize_t n = recv(fds[1], vRecv.data() + nRead, vRecv.size() - nRead, 0);
+        BOOST_REQUIRE(n > 0);
+        nRead += n;
+    }
+    for (size_t i = 0; i < 3; ++i) {
+        BOOST_CHECK(std::equal(vRecv.begin(), vRecv.begin() + nMsgSize, vRecv.begin() + i * nMsgSize));
+    }
+    BOOST_CHECK(std::equal(payload->data.begin(), payload->data.end(), vRecv.begin() + CMessageHeader::HEADER_SIZE));
+    close(fds[1]);
+}
+#endif
+
+#ifdef USE_EPOLL
+static void WritePing(int fd, uint64_t nonce)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << CMessageHeader(Params().MessageStart(), NetMsgType::PING, sizeof(nonce)) << nonce;
+    BOOST_REQUIRE_EQUAL(send(fd, ss.data(), ss.size(), 0), (ssize_t)ss.size());
+}
+
+static size_t DrainSocket(int fd)
+{
+    char buf[0x10000];
+    size_t nTotal = 0;
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        nTotal += n;
+    }
+    return nTotal;
+}
+
+static void WaitEpollEvents(int epoll_fd, CNode* pnode)
+{
+    struct epoll_event events[4];
+    int nEvents = epoll_wait(epoll_fd, events, 4, 1000);
+    BOOST_REQUIRE(nEvents > 0);
+    for (int i = 0; i < nEvents; ++i) {
+        BOOST_CHECK_EQUAL(events[i].data.u64, (uint64_t)pnode->GetId());
+        CConnman::EpollNodeEvents(pnode, events[i].events);
+    }
+}
+
+static size_t ProcessQueueSize(CNode* pnode)
+{
+    LOCK(pnode->cs_vProcessMsg);
+    return pnode->vProcessMsg.size();
+}
+
+static bool SendPending(CNode* pnode)
+{
+    LOCK(pnode->cs_vSend);
+    return !pnode->vSendMsg.empty();
+}
+
+BOOST_AUTO_TEST_CASE(epoll_partial_send)
+{
+    int fds[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    BOOST_REQUIRE(epoll_fd >= 0);
+
+    CAddress addr = CAddress(CService(CNetAddr(), 7777), NODE_NETWORK);
+    CConnman connman(0x1337, 0x1337);
+    std::unique_ptr<CNode> pnode = MakeUnique<CNode>(0, NODE_NETWORK, 0, fds[0], addr, 0, 0, CAddress(), "", false);
+    BOOST_REQUIRE(connman.EpollAddNode(epoll_fd, pnode.get()));
+    BOOST_CHECK(pnode->m_sock_registered && pnode->m_sock_recv_ready && pnode->m_sock_send_ready);
+
+    // Nothing to read, the short read clears the readiness
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK(!pnode->m_sock_recv_ready);
+    BOOST_CHECK(!CConnman::EpollNodeHasWork(pnode.get()));
+    BOOST_CHECK(!pnode->fDisconnect);
+
+    // More than the socket buffers hold, the optimistic send is partial
+    const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
+    std::vector<unsigned char> vPayload(4 * 1000 * 1000, 0x55);
+    CSerializedNetMsg msg = msgMaker.Make(NetMsgType::BLOCK, vPayload);
+    const size_t nMsgSize = CMessageHeader::HEADER_SIZE + msg.data.size();
+    connman.PushMessage(pnode.get(), std::move(msg));
+    BOOST_REQUIRE(SendPending(pnode.get()));
+
+    // The failed send clears the readiness until the next EPOLLOUT edge
+    BOOST_CHECK(CConnman::EpollNodeHasWork(pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK(!pnode->m_sock_send_ready);
+    BOOST_CHECK(!CConnman::EpollNodeHasWork(pnode.get()));
+
+    // Data arriving meanwhile is only read once the sends are done
+    WritePing(fds[1], 1);
+    WaitEpollEvents(epoll_fd, pnode.get());
+    BOOST_CHECK(pnode->m_sock_recv_ready);
+    BOOST_CHECK(!CConnman::EpollNodeHasWork(pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK_EQUAL(ProcessQueueSize(pnode.get()), 0U);
+
+    size_t nReceived = 0;
+    for (int pass = 0; SendPending(pnode.get()) && pass < 1000; ++pass) {
+        nReceived += DrainSocket(fds[1]);
+        WaitEpollEvents(epoll_fd, pnode.get());
+        BOOST_CHECK(pnode->m_sock_send_ready);
+        connman.EpollServiceNode(pnode.get());
+    }
+    BOOST_CHECK(!SendPending(pnode.get()));
+    nReceived += DrainSocket(fds[1]);
+    BOOST_CHECK_EQUAL(nReceived, nMsgSize);
+
+    // The remembered readiness lets the ping be read without a new edge
+    BOOST_CHECK(pnode->m_sock_recv_ready);
+    BOOST_CHECK(CConnman::EpollNodeHasWork(pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK_EQUAL(ProcessQueueSize(pnode.get()), 1U);
+    BOOST_CHECK(!pnode->m_sock_recv_ready);
+
+    close(fds[1]);
+    close(epoll_fd);
+}
+
+BOOST_AUTO_TEST_CASE(epoll_pause_resume)
+{
+    int fds[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    BOOST_REQUIRE(epoll_fd >= 0);
+
+    CAddress addr = CAddress(CService(CNetAddr(), 7777), NODE_NETWORK);
+    CConnman connman(0x1337, 0x1337);
+    CConnman::Options options;
+    options.nReceiveFloodSize = 1;
+    connman.Init(options);
+    std::unique_ptr<CNode> pnode = MakeUnique<CNode>(0, NODE_NETWORK, 0, fds[0], addr, 0, 0, CAddress(), "", false);
+    BOOST_REQUIRE(connman.EpollAddNode(epoll_fd, pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+
+    // A queued message over the flood size pauses receiving
+    WritePing(fds[1], 1);
+    WaitEpollEvents(epoll_fd, pnode.get());
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK_EQUAL(ProcessQueueSize(pnode.get()), 1U);
+    BOOST_CHECK(pnode->fPauseRecv);
+
+    // Readiness is kept while paused, but nothing is read
+    WritePing(fds[1], 2);
+    WaitEpollEvents(epoll_fd, pnode.get());
+    BOOST_CHECK(pnode->m_sock_recv_ready);
+    BOOST_CHECK(!CConnman::EpollNodeHasWork(pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK_EQUAL(ProcessQueueSize(pnode.get()), 1U);
+
+    // Once the message handler takes the queue, the data already signalled is read
+    {
+        LOCK(pnode->cs_vProcessMsg);
+        pnode->vProcessMsg.clear();
+        pnode->nProcessQueueSize = 0;
+        pnode->fPauseRecv = false;
+    }
+    BOOST_CHECK(CConnman::EpollNodeHasWork(pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK_EQUAL(ProcessQueueSize(pnode.get()), 1U);
+    BOOST_CHECK(!pnode->m_sock_recv_ready);
+    BOOST_CHECK(!pnode->fDisconnect);
+
+    close(fds[1]);
+    close(epoll_fd);
+}
+
+BOOST_AUTO_TEST_CASE(epoll_disconnect)
+{
+    int fds[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    const int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    BOOST_REQUIRE(epoll_fd >= 0);
+
+    CAddress addr = CAddress(CService(CNetAddr(), 7777), NODE_NETWORK);
+    CConnman connman(0x1337, 0x1337);
+    std::unique_ptr<CNode> pnode = MakeUnique<CNode>(0, NODE_NETWORK, 0, fds[0], addr, 0, 0, CAddress(), "", false);
+    BOOST_REQUIRE(connman.EpollAddNode(epoll_fd, pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK(!CConnman::EpollNodeHasWork(pnode.get()));
+
+    // The peer closing is seen as readable, the read returns 0
+    close(fds[1]);
+    WaitEpollEvents(epoll_fd, pnode.get());
+    BOOST_CHECK(CConnman::EpollNodeHasWork(pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK(pnode->fDisconnect);
+    BOOST_CHECK(!pnode->m_sock_error);
+    BOOST_CHECK_EQUAL(WITH_LOCK(pnode->cs_hSocket, return pnode->hSocket), INVALID_SOCKET);
+
+    // Errors are serviced without read readiness, a closed socket isn't watched
+    CConnman::EpollNodeEvents(pnode.get(), EPOLLERR);
+    BOOST_CHECK(pnode->m_sock_error);
+    BOOST_CHECK(CConnman::EpollNodeHasWork(pnode.get()));
+    connman.EpollServiceNode(pnode.get());
+    BOOST_CHECK(!pnode->m_sock_error);
+    BOOST_CHECK(!connman.EpollAddNode(epoll_fd, pnode.get()));
+
+    close(epoll_fd);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(cnode_msg_process_stats)
+{
+    CNetMsgProcStats stats;
+    stats.Add(0, 10);
+    stats.Add(1, 10);
+    stats.Add(1000, 10);
+    stats.Add(std::numeric_limits<int64_t>::max(), 10);
+    BOOST_CHECK_EQUAL(stats.nCount, 4U);
+    BOOST_CHECK_EQUAL(stats.nBytes, 40U);
+    BOOST_CHECK_EQUAL(stats.vBuckets[0], 1U);
+    BOOST_CHECK_EQUAL(stats.vBuckets[1], 1U);
+    BOOST_CHECK_EQUAL(stats.vBuckets[10], 1U); // 512 <= 1000 < 1024
+    BOOST_CHECK_EQUAL(stats.vBuckets[NET_MSG_TIME_BUCKETS - 1], 1U);
+
+    CNetMsgProcStats merged;
+    merged.Add(5, 1);
+    merged.Merge(stats);
+    BOOST_CHECK_EQUAL(merged.nCount, 5U);
+    BOOST_CHECK_EQUAL(merged.nMaxMicros, std::numeric_limits<int64_t>::max());
+    BOOST_CHECK_EQUAL(merged.vBuckets[3], 1U);
+
+    // Commands the node has no receive counter for are kept together
+    CAddress addr = CAddress(CService(CNetAddr(), 7777), NODE_NETWORK);
+    std::unique_ptr<CNode> pnode = MakeUnique<CNode>(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, CAddress(), "", false);
+    pnode->RecordMsgProcessTime(NetMsgType::TX, 100, 50);
+    pnode->RecordMsgProcessTime(NetMsgType::TX, 100, 70);
+    pnode->RecordMsgProcessTime("unknown1", 10, 1);
+    pnode->RecordMsgProcessTime("unknown2", 10, 1);
+    // smsg commands are timed on their own, before secure messaging is enabled with the peer too
+    pnode->RecordMsgProcessTime(SMSGMsgType::MSG, 500, 30);
+    pnode->RecordMsgProcessTime(SMSGMsgType::INV, 40, 2);
+    CNodeStats nodestats;
+    pnode->copyStats(nodestats);
+    BOOST_CHECK_EQUAL(nodestats.mapProcStatsPerMsgCmd.size(), 4U);
+    BOOST_CHECK_EQUAL(nodestats.mapProcStatsPerMsgCmd[NetMsgType::TX].nTotalMicros, 120);
+    BOOST_CHECK_EQUAL(nodestats.mapProcStatsPerMsgCmd[SMSGMsgType::MSG].nBytes, 500U);
+    BOOST_CHECK_EQUAL(nodestats.mapProcStatsPerMsgCmd[SMSGMsgType::INV].nCount, 1U);
+    BOOST_CHECK_EQUAL(nodestats.mapProcStatsPerMsgCmd[NET_MESSAGE_COMMAND_OTHER].nCount, 2U);
+}
+
 // prior to PR #14728, this test triggers an undefined behavior
 BOOST_AUTO_TEST_CASE(ipv4_peer_with_ipv6_addrMe_test)
 {
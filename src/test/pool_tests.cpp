@@ -0,0 +1,116 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <coins.h>
+#include <memusage.h>
+#include <streams.h>
+#include <support/allocators/pool.h>
+#include <test/setup_common.h>
+#include <undo.h>
+
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    PoolResource<8, 8> resource;
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 0U);
+
+    // first chunk is only allocated on use
+    void* block = resource.Allocate(8, 1);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // freed blocks are reused
+    resource.Deallocate(block, 8, 1);
+    void* b = resource.Allocate(8, 1);
+    BOOST_CHECK(b == block);
+    resource.Deallocate(b, 8, 1);
+
+    // alignment too large for the pool goes through new()
+    void* big = resource.Allocate(8, 16);
+    BOOST_CHECK(big != block);
+    resource.Deallocate(big, 8, 16);
+
+    // sizes too large for the pool go through new() as well
+    void* large = resource.Allocate(16, 1);
+    resource.Deallocate(large, 16, 1);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(chunks_fill_up)
+{
+    PoolResource<16, 8> resource(64);
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < 8; ++i) {
+        blocks.push_back(resource.Allocate(16, 8));
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    for (void* p : blocks) {
+        resource.Deallocate(p, 16, 8);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        resource.Allocate(16, 8);
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(coinsmap_memusage)
+{
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+
+    size_t usage_empty = memusage::DynamicUsage(map);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        map[COutPoint(InsecureRand256(), i)];
+    }
+    BOOST_CHECK(resource.NumAllocatedChunks() > 0);
+    size_t usage_full = memusage::DynamicUsage(map);
+    BOOST_CHECK(usage_full > usage_empty);
+
+    // Erasing keeps the chunks, memory is only returned when the resource goes away
+    map.clear();
+    BOOST_CHECK(memusage::DynamicUsage(map) >= resource.NumAllocatedChunks() * resource.ChunkSizeBytes());
+}
+
+BOOST_FIXTURE_TEST_CASE(coin_commitment, FalconBasicTestingSetup)
+{
+    Coin coin(CTxOut(1 * COIN, CScript() << OP_TRUE), 1, false);
+    BOOST_CHECK(!coin.GetCommitment());
+    size_t usage_plain = coin.DynamicMemoryUsage();
+
+    secp256k1_pedersen_commitment commitment;
+    memset(commitment.data, 0x09, 33);
+    coin.nType = OUTPUT_CT;
+    coin.SetCommitment(commitment);
+    BOOST_REQUIRE(coin.GetCommitment());
+    BOOST_CHECK(coin.DynamicMemoryUsage() > usage_plain);
+
+    Coin copy(coin);
+    BOOST_REQUIRE(copy.GetCommitment());
+    BOOST_CHECK(copy.GetCommitment() != coin.GetCommitment());
+    BOOST_CHECK(memcmp(copy.GetCommitment()->data, commitment.data, 33) == 0);
+
+    copy.Clear();
+    BOOST_CHECK(!copy.GetCommitment());
+    BOOST_CHECK(coin.GetCommitment());
+
+    // A CT coin that lost its commitment fails to serialize instead of dereferencing null
+    copy = Coin(CTxOut(0, CScript() << OP_TRUE), 1, false);
+    copy.nType = OUTPUT_CT;
+    CDataStream ss_bad(SER_DISK, PROTOCOL_VERSION);
+    BOOST_CHECK_THROW(ss_bad << copy, std::ios_base::failure);
+    BOOST_CHECK_THROW(ss_bad << TxInUndoSerializer(&copy), std::ios_base::failure);
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << coin;
+    Coin read;
+    ss >> read;
+    BOOST_REQUIRE(read.GetCommitment());
+    BOOST_CHECK(memcmp(read.GetCommitment()->data, commitment.data, 33) == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,15 +2,20 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <smsg/db.h>
 #include <smsg/smessage.h>
 
 #include <test/setup_common.h>
+#include <consensus/tx_check.h>
+#include <consensus/validation.h>
 #include <net.h>
 #ifdef ENABLE_WALLET
 #include <wallet/wallet.h>
 #endif
 #include <xxhash/xxhash.h>
 
+#include <thread>
+
 #include <boost/test/unit_test.hpp>
 
 struct SmsgTestingSetup : public TestingSetup {
@@ -31,12 +36,449 @@ BOOST_AUTO_TEST_CASE(smsg_test_xxhash)
     XXH32_freeState(state);
 }
 
+BOOST_AUTO_TEST_CASE(smsg_test_bucket_digest)
+{
+    SetMockTime(1600000000);
+    int64_t now = GetAdjustedTime();
+
+    std::vector<smsg::SecMsgToken> tokens;
+    for (int i = 0; i < 20; ++i) {
+        uint8_t sample[8] = {0};
+        sample[0] = i;
+        tokens.emplace_back(now - 100 + i, sample, 8, 0, i < 5 ? 200 : 3600);
+    }
+
+    // The digest doesn't depend on insertion order
+    smsg::SecMsgBucket bucket_a, bucket_b;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        bucket_a.AddToken(tokens[i], now);
+        bucket_b.AddToken(tokens[tokens.size() - 1 - i], now);
+    }
+    bucket_a.AddToken(tokens[0], now);
+    bucket_a.hashBucket(0);
+    bucket_b.hashBucket(0);
+    BOOST_CHECK_EQUAL(bucket_a.setTokens.size(), 20U);
+    BOOST_CHECK_EQUAL(bucket_a.nActive, 20U);
+    BOOST_CHECK(bucket_a.hash != 0);
+    BOOST_CHECK_EQUAL(bucket_a.hash, bucket_b.hash);
+    BOOST_CHECK_EQUAL(bucket_a.NextExpiry(), now + 100);
+
+    // Legacy hash matches hashing the samples of active tokens in order
+    XXH32_state_t *state = XXH32_createState();
+    XXH32_reset(state, 1);
+    for (const auto &token : bucket_a.setTokens) {
+        XXH32_update(state, token.sample, 8);
+    }
+    BOOST_CHECK_EQUAL(bucket_a.LegacyHash(), XXH32_digest(state));
+    XXH32_freeState(state);
+
+    // Expiring tokens leaves the same digest as never adding them
+    SetMockTime(now + 150);
+    BOOST_CHECK_EQUAL(bucket_a.CountActive(), 15U);
+    bucket_a.hashBucket(0);
+    BOOST_CHECK_EQUAL(bucket_a.nActive, 15U);
+    BOOST_CHECK_EQUAL(bucket_a.setTokens.size(), 20U);
+
+    smsg::SecMsgBucket bucket_c;
+    for (size_t i = 5; i < tokens.size(); ++i) {
+        bucket_c.AddToken(tokens[i], now);
+    }
+    bucket_c.hashBucket(0);
+    BOOST_CHECK_EQUAL(bucket_a.hash, bucket_c.hash);
+    BOOST_CHECK_EQUAL(bucket_a.LegacyHash(), bucket_c.LegacyHash());
+
+    // Purged tokens drop out of the digest
+    bucket_a.SetTokenTTL(bucket_a.setTokens.find(tokens[19]), 0, now + 150);
+    bucket_a.hashBucket(0);
+    bucket_c.SetTokenTTL(bucket_c.setTokens.find(tokens[19]), 0, now + 150);
+    bucket_c.hashBucket(0);
+    BOOST_CHECK_EQUAL(bucket_a.nActive, 14U);
+    BOOST_CHECK_EQUAL(bucket_a.hash, bucket_c.hash);
+
+    bucket_a.ClearTokens();
+    bucket_a.hashBucket(0);
+    BOOST_CHECK_EQUAL(bucket_a.hash, 0U);
+    BOOST_CHECK_EQUAL(bucket_a.NextExpiry(), 0);
+
+    SetMockTime(0);
+}
+
+static void SketchInsert(smsg::SecMsgSketch &sketch, int i)
+{
+    uint8_t sample[8] = {0};
+    memcpy(sample, &i, 4);
+    sketch.Insert(1600000000 + i, sample);
+}
+
+BOOST_AUTO_TEST_CASE(smsg_test_sketch)
+{
+    // Sets share 1000 tokens, a has 10 more and b 5 more
+    smsg::SecMsgSketch a(smsg::SKETCH_MAX_SIZE), b(smsg::SKETCH_MAX_SIZE);
+    for (int i = 0; i < 1000; ++i) {
+        SketchInsert(a, i);
+        SketchInsert(b, i);
+    }
+    for (int i = 1000; i < 1010; ++i) {
+        SketchInsert(a, i);
+    }
+    for (int i = 2000; i < 2005; ++i) {
+        SketchInsert(b, i);
+    }
+
+    // Decode the difference from the smallest sketches that fit
+    for (size_t size : {size_t(16), size_t(64)}) {
+        smsg::SecMsgSketch remote(size);
+        std::vector<uint8_t> vchData;
+        a.Fold(size).GetData(vchData);
+        BOOST_CHECK_EQUAL(vchData.size(), size * smsg::SKETCH_SUBTABLES * smsg::SKETCH_CELL_BYTES);
+        BOOST_REQUIRE(remote.SetData(vchData.data(), vchData.size()));
+
+        remote.Subtract(b.Fold(size));
+        std::vector<smsg::SketchKey> only_a, only_b;
+        BOOST_REQUIRE(remote.Decode(only_a, only_b));
+        BOOST_CHECK_EQUAL(only_a.size(), 10U);
+        BOOST_CHECK_EQUAL(only_b.size(), 5U);
+        for (const auto &key : only_a) {
+            int i;
+            memcpy(&i, &key.second, 4);
+            BOOST_CHECK(i >= 1000 && i < 1010);
+            BOOST_CHECK_EQUAL(key.first, 1600000000 + i);
+        }
+    }
+
+    // Erasing undoes inserting
+    smsg::SecMsgSketch c(smsg::SKETCH_MIN_SIZE);
+    uint8_t sample[8] = {1};
+    c.Insert(1, sample);
+    c.Erase(1, sample);
+    std::vector<smsg::SketchKey> only_c, only_other;
+    BOOST_CHECK(c.Decode(only_c, only_other));
+    BOOST_CHECK(only_c.empty() && only_other.empty());
+
+    // Too many differences for the sketch size fail to decode
+    smsg::SecMsgSketch d(smsg::SKETCH_MIN_SIZE);
+    for (int i = 0; i < 100; ++i) {
+        SketchInsert(d, i);
+    }
+    BOOST_CHECK(!d.Decode(only_c, only_other));
+
+    BOOST_CHECK(!smsg::SecMsgSketch::IsValidSize(12));
+    BOOST_CHECK(!smsg::SecMsgSketch::IsValidSize(smsg::SKETCH_MAX_SIZE * 2));
+}
+
+BOOST_AUTO_TEST_CASE(smsg_test_timer_wheel)
+{
+    FastRandomContext rnd(true);
+    const int64_t start = 1600000000;
+    smsg::SecMsgTimerWheel wheel(start);
+
+    // Delays spanning every level and beyond the top level
+    std::vector<int64_t> delays{0, 1, 63, 64, 65, 4095, 4096, 262143, 262144, (1 << 24) - 1, 1 << 24, (1 << 24) + 70000};
+    for (int i = 0; i < 500; ++i) {
+        delays.push_back(rnd.randrange(1 << (6 * (1 + rnd.randrange(4)))));
+    }
+    for (size_t i = 0; i < delays.size(); ++i) {
+        wheel.Schedule(start + delays[i], smsg::SMSG_TIMER_SHOW_REQUEST, i);
+    }
+    wheel.Schedule(start - 10, smsg::SMSG_TIMER_PURGED_SETS, 0);
+    BOOST_CHECK_EQUAL(wheel.Size(), delays.size() + 1);
+
+    std::vector<smsg::SecMsgTimer> due;
+    std::vector<bool> fired(delays.size());
+    int64_t now = start;
+    size_t num_fired = 0;
+    while (wheel.Size() > 0) {
+        int64_t prev = now;
+        now += 1 + rnd.randrange(rnd.randbool() ? 100 : 100000);
+        due.clear();
+        wheel.Advance(now, due);
+        for (const auto &timer : due) {
+            if (timer.type == smsg::SMSG_TIMER_PURGED_SETS) {
+                BOOST_CHECK_EQUAL(prev, start);
+                continue;
+            }
+            // Each timer fires once, on the first advance reaching it
+            BOOST_REQUIRE(timer.key >= 0 && timer.key < (int64_t)delays.size());
+            BOOST_CHECK(!fired[timer.key]);
+            fired[timer.key] = true;
+            BOOST_CHECK(timer.when <= now);
+            BOOST_CHECK(timer.when > prev || (timer.when == start && prev == start));
+            num_fired++;
+        }
+        BOOST_REQUIRE(now < start + (1 << 26));
+    }
+    BOOST_CHECK_EQUAL(num_fired, delays.size());
+
+    // Timers scheduled after a gap fire relative to the new time
+    wheel.Advance(now + 1000000, due);
+    due.clear();
+    wheel.Schedule(now + 1000005, smsg::SMSG_TIMER_BUCKET_LOCK, 1, 2);
+    wheel.Advance(now + 1000004, due);
+    BOOST_CHECK(due.empty());
+    wheel.Advance(now + 1000005, due);
+    BOOST_REQUIRE_EQUAL(due.size(), 1U);
+    BOOST_CHECK_EQUAL(due[0].data, 2);
+
+    wheel.Schedule(now, smsg::SMSG_TIMER_BUCKET_LOCK, 1, 2);
+    wheel.Reset(now);
+    BOOST_CHECK_EQUAL(wheel.Size(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(smsg_test_bucket_shards)
+{
+    SetMockTime(1600000000);
+    const int64_t now = GetAdjustedTime();
+    const size_t num_shards = smsg::SecMsgBucketShards::NUM_SHARDS;
+    const int64_t first_bucket = now - (now % smsg::SMSG_BUCKET_LEN) - smsg::SMSG_BUCKET_LEN * (num_shards - 1);
+
+    // Consecutive buckets fall in different shards
+    smsg::SecMsgBucketShards shards;
+    std::set<const smsg::SecMsgBucketShards::Shard*> seen;
+    for (size_t i = 0; i < num_shards; ++i) {
+        seen.insert(&shards.Get(first_bucket + i * smsg::SMSG_BUCKET_LEN));
+    }
+    BOOST_CHECK_EQUAL(seen.size(), num_shards);
+
+    // Threads adding to the same buckets concurrently
+    const int num_threads = 4, tokens_per_thread = 400;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&shards, first_bucket, now, num_shards, t]() {
+            for (int i = 0; i < tokens_per_thread; ++i) {
+                int64_t bucket_time = first_bucket + (i % num_shards) * smsg::SMSG_BUCKET_LEN;
+                uint8_t sample[8];
+                memcpy(sample, &t, 4);
+                memcpy(sample + 4, &i, 4);
+                smsg::SecMsgToken token(bucket_time + 1, sample, 8, 0, 3600);
+                smsg::SecMsgBucketShards::Shard &shard = shards.Get(bucket_time);
+                LOCK(shard.cs);
+                shard.buckets[bucket_time].AddToken(token, now);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    BOOST_CHECK_EQUAL(shards.Size(), num_shards);
+    size_t num_tokens = 0;
+    shards.ForEachShard([&](smsg::SecMsgBucketShards::Shard &shard) {
+        for (const auto &it : shard.buckets) {
+            BOOST_CHECK(&shards.Get(it.first) == &shard);
+            num_tokens += it.second.setTokens.size();
+        }
+    });
+    BOOST_CHECK_EQUAL(num_tokens, (size_t)(num_threads * tokens_per_thread));
+    shards.Clear();
+    BOOST_CHECK_EQUAL(shards.Size(), 0U);
+
+    // Timers find the bucket in its shard: the lock times out, then the empty bucket expires
+    const int64_t bucket_time = first_bucket;
+    {
+        smsg::SecMsgBucketShards::Shard &shard = smsgModule.buckets.Get(bucket_time);
+        LOCK(shard.cs);
+        smsg::SecMsgBucket &bucket = shard.buckets[bucket_time];
+        bucket.nLockUntil = GetTime() - 1;
+        bucket.nLockPeerId = 7;
+    }
+    std::vector<smsg::SecMsgTimer> due{smsg::SecMsgTimer(GetTime(), smsg::SMSG_TIMER_BUCKET_LOCK, bucket_time, 7)};
+    std::vector<std::pair<int64_t, NodeId> > timed_out_locks;
+    smsgModule.ProcessTimers(due, timed_out_locks);
+    BOOST_REQUIRE_EQUAL(timed_out_locks.size(), 1U);
+    BOOST_CHECK_EQUAL(timed_out_locks[0].first, bucket_time);
+    BOOST_CHECK_EQUAL(timed_out_locks[0].second, 7);
+    BOOST_CHECK_EQUAL(smsgModule.buckets.Size(), 1U);
+
+    due.assign(1, smsg::SecMsgTimer(GetTime(), smsg::SMSG_TIMER_BUCKET_EXPIRY, bucket_time, now));
+    timed_out_locks.clear();
+    smsgModule.ProcessTimers(due, timed_out_locks);
+    BOOST_CHECK(timed_out_locks.empty());
+    BOOST_CHECK_EQUAL(smsgModule.buckets.Size(), 0U);
+
+    SetMockTime(0);
+}
+
+static void DbKey(uint8_t *chKey, const std::string &prefix, uint8_t n)
+{
+    memset(chKey, 0, 30);
+    memcpy(chKey, prefix.data(), 2);
+    chKey[9] = n; // Low byte of the big endian timestamp
+    chKey[10] = n;
+}
+
+BOOST_AUTO_TEST_CASE(smsg_test_db_index)
+{
+    LOCK(smsg::cs_smsgDB);
+    smsg::SecMsgDB db;
+    BOOST_REQUIRE(db.Open("cr+"));
+    BOOST_CHECK(db.CheckIndexes());
+
+    uint8_t chKey[30], chKeyFound[30];
+    smsg::SecMsgStored stored;
+    smsg::SecMsgStoredMeta meta;
+    stored.addrOutbox.SetNull();
+    stored.vchMessage.resize(200, 0xAB);
+    for (uint8_t i = 0; i < 10; ++i) {
+        DbKey(chKey, smsg::DBK_INBOX, i);
+        stored.timeReceived = 1000 + i;
+        stored.status = i % 2 ? SMSG_MASK_UNREAD : 0;
+        memset(stored.addrTo.begin(), i, 20);
+        BOOST_CHECK(db.WriteSmesg(chKey, stored));
+    }
+    DbKey(chKey, smsg::DBK_OUTBOX, 1);
+    BOOST_CHECK(db.WriteSmesg(chKey, stored));
+
+    // Meta lists the inbox in key order without the message
+    std::unique_ptr<leveldb::Iterator> it(db.pdb->NewIterator(leveldb::ReadOptions()));
+    int n = 0;
+    while (db.NextSmesgMeta(it.get(), smsg::DBK_INBOX, chKeyFound, meta)) {
+        DbKey(chKey, smsg::DBK_INBOX, n);
+        BOOST_CHECK(memcmp(chKey, chKeyFound, 30) == 0);
+        BOOST_CHECK_EQUAL(meta.timeReceived, 1000 + n);
+        BOOST_CHECK_EQUAL(meta.nMessageSize, 200U);
+        BOOST_CHECK_EQUAL(*meta.addrTo.begin(), n);
+        n++;
+    }
+    BOOST_CHECK_EQUAL(n, 10);
+
+    auto CountUnread = [&]() {
+        std::unique_ptr<leveldb::Iterator> it(db.pdb->NewIterator(leveldb::ReadOptions()));
+        int n = 0;
+        smsg::SecMsgStored found;
+        while (db.NextSmesgUnread(it.get(), smsg::DBK_INBOX, chKeyFound, found)) {
+            BOOST_CHECK(found.status & SMSG_MASK_UNREAD);
+            BOOST_CHECK_EQUAL(found.vchMessage.size(), 200U);
+            n++;
+        }
+        return n;
+    };
+    BOOST_CHECK_EQUAL(CountUnread(), 5);
+
+    // Status updates and erases within a transaction move the indexes with the message
+    BOOST_CHECK(db.TxnBegin());
+    DbKey(chKey, smsg::DBK_INBOX, 1);
+    BOOST_CHECK(db.ReadSmesg(chKey, stored));
+    stored.status &= ~SMSG_MASK_UNREAD;
+    BOOST_CHECK(db.WriteSmesg(chKey, stored));
+    DbKey(chKey, smsg::DBK_INBOX, 3);
+    BOOST_CHECK(db.EraseSmesg(chKey));
+    BOOST_CHECK(!db.ReadSmesgMeta(chKey, meta));
+    BOOST_CHECK_EQUAL(CountUnread(), 5); // Not committed
+    BOOST_CHECK(db.TxnCommit());
+    BOOST_CHECK_EQUAL(CountUnread(), 3);
+    BOOST_CHECK(!db.ReadSmesgMeta(chKey, meta));
+    DbKey(chKey, smsg::DBK_INBOX, 1);
+    BOOST_CHECK(db.ReadSmesgMeta(chKey, meta));
+    BOOST_CHECK_EQUAL(meta.status, 0);
+
+    // Folder index lists the messages to an address by status, then timestamp
+    CKeyID addr5;
+    memset(addr5.begin(), 5, 20);
+    for (uint8_t i = 20; i < 24; ++i) {
+        DbKey(chKey, smsg::DBK_INBOX, i);
+        stored.timeReceived = 1000 + i;
+        stored.status = i % 2 ? SMSG_MASK_UNREAD : 0;
+        stored.addrTo = addr5;
+        BOOST_CHECK(db.WriteSmesg(chKey, stored));
+    }
+    auto ListTo = [&](const CKeyID *addr) {
+        std::unique_ptr<leveldb::Iterator> it(db.pdb->NewIterator(leveldb::ReadOptions()));
+        std::vector<std::pair<int, int>> found;
+        uint8_t status;
+        while (db.NextSmesgInFolder(it.get(), smsg::DBK_INBOX, 0, addr, chKeyFound, status)) {
+            BOOST_CHECK(memcmp(chKeyFound, smsg::DBK_INBOX.data(), 2) == 0);
+            found.emplace_back(status, chKeyFound[9]);
+        }
+        return found;
+    };
+    std::vector<std::pair<int, int>> expected{{0, 20}, {0, 22}, {1, 5}, {1, 21}, {1, 23}};
+    BOOST_CHECK(ListTo(&addr5) == expected);
+    BOOST_CHECK_EQUAL(ListTo(nullptr).size(), 13U);
+    CKeyID addr_none;
+    memset(addr_none.begin(), 0xEE, 20);
+    BOOST_CHECK(ListTo(&addr_none).empty());
+
+    // Status updates move the folder index entry, erases remove it
+    DbKey(chKey, smsg::DBK_INBOX, 5);
+    BOOST_CHECK(db.ReadSmesg(chKey, stored));
+    stored.status &= ~SMSG_MASK_UNREAD;
+    BOOST_CHECK(db.TxnBegin());
+    BOOST_CHECK(db.WriteSmesg(chKey, stored));
+    DbKey(chKey, smsg::DBK_INBOX, 21);
+    BOOST_CHECK(db.EraseSmesg(chKey));
+    BOOST_CHECK(db.TxnCommit());
+    expected = {{0, 5}, {0, 20}, {0, 22}, {1, 23}};
+    BOOST_CHECK(ListTo(&addr5) == expected);
+    BOOST_CHECK_EQUAL(ListTo(nullptr).size(), 12U);
+
+    // Indexes are rebuilt for a db written without them
+    leveldb::WriteBatch batch;
+    it.reset(db.pdb->NewIterator(leveldb::ReadOptions()));
+    for (it->Seek("m"); it->Valid() && it->key().data()[0] == 'm'; it->Next()) {
+        batch.Delete(it->key());
+    }
+    BOOST_CHECK(db.pdb->Write(leveldb::WriteOptions(), &batch).ok());
+    BOOST_CHECK_EQUAL(CountUnread(), 0);
+    BOOST_CHECK(db.CheckIndexes());
+    BOOST_CHECK_EQUAL(CountUnread(), 3);
+    BOOST_CHECK(ListTo(&addr5) == expected);
+    BOOST_CHECK_EQUAL(ListTo(nullptr).size(), 12U);
+    DbKey(chKey, smsg::DBK_OUTBOX, 1);
+    BOOST_CHECK(db.ReadSmesgMeta(chKey, meta));
+
+    it.reset();
+    delete smsg::smsgDB;
+    smsg::smsgDB = nullptr;
+}
+
 BOOST_AUTO_TEST_CASE(smsg_test_ckeyId_inits_null)
 {
     CKeyID k;
     BOOST_CHECK(k.IsNull());
 }
 
+BOOST_AUTO_TEST_CASE(smsg_test_fund_msg_data)
+{
+    std::vector<uint160> vMsgIds(smsg::SMSG_MAX_SEND_BATCH);
+    std::vector<uint32_t> vMsgFees(smsg::SMSG_MAX_SEND_BATCH);
+    CAmount nFeesExpect = 0;
+    for (size_t i = 0; i < vMsgIds.size(); ++i) {
+        memset(vMsgIds[i].begin(), i, 20);
+        vMsgFees[i] = 1000 + i;
+        nFeesExpect += vMsgFees[i];
+    }
+
+    std::vector<std::vector<uint8_t>> vFundData = smsg::GetFundMsgData(vMsgIds, vMsgFees);
+    BOOST_CHECK_EQUAL(vFundData.size(), (smsg::SMSG_MAX_SEND_BATCH + smsg::SMSG_FUND_PER_OUTPUT - 1) / smsg::SMSG_FUND_PER_OUTPUT);
+
+    // Each funding tx passes CheckTransaction without a change output
+    CAmount nFees = 0;
+    for (const auto &vData : vFundData) {
+        CMutableTransaction mtx;
+        mtx.nVersion = FALCON_TXN_VERSION;
+        mtx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+        mtx.vpout.push_back(MAKE_OUTPUT<CTxOutData>(vData));
+        CTransaction tx(mtx);
+
+        for (bool clamp_tx_version : {false, true}) {
+            CValidationState state;
+            state.m_clamp_tx_version = clamp_tx_version;
+            BOOST_CHECK_MESSAGE(CheckTransaction(tx, state), state.GetRejectReason());
+        }
+        nFees += tx.GetTotalSMSGFees();
+    }
+    BOOST_CHECK_EQUAL(nFees, nFeesExpect);
+
+    // Two funding outputs in one tx break the data output limit
+    CMutableTransaction mtx;
+    mtx.nVersion = FALCON_TXN_VERSION;
+    mtx.vin.emplace_back(COutPoint(InsecureRand256(), 0));
+    mtx.vpout.push_back(MAKE_OUTPUT<CTxOutData>(vFundData[0]));
+    mtx.vpout.push_back(MAKE_OUTPUT<CTxOutData>(vFundData[1]));
+    CValidationState state;
+    BOOST_CHECK(!CheckTransaction(CTransaction(mtx), state));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "too-many-data-outputs");
+}
+
 #ifdef ENABLE_WALLET
 
 void CheckValid(smsg::SecureMessage &smsg, CKeyID &kFrom, CKeyID &kTo, bool expect_pass)
@@ -122,6 +564,20 @@ BOOST_AUTO_TEST_CASE(smsg_test)
         BOOST_CHECK_MESSAGE(smsg::SMSG_MAC_MISMATCH == rv, "SecureMsgDecrypt " << smsg::GetString(rv));
     }
 
+    // Batched messages are encrypted for each recipient
+    std::string sError;
+    std::vector<smsg::SecMsgBatchItem> items(nKeys);
+    for (int i = 0; i < nKeys; i++) {
+        items[i].addressTo = keyRemote[i].GetPubKey().GetID();
+        items[i].message = sTestMessage + std::to_string(i);
+    }
+    BOOST_CHECK_MESSAGE(0 == (rv = smsgModule.SendBatch(kFrom, items, sError, false, smsg::SMSG_MIN_TTL)), "SendBatch " << sError);
+    for (int i = 0; i < nKeys; i++) {
+        smsg::MessageData msg;
+        BOOST_CHECK_MESSAGE(0 == (rv = smsgModule.Decrypt(false, items[i].addressTo, items[i].smsg, msg)), "SecureMsgDecrypt " << rv);
+        BOOST_CHECK(std::string((const char*)msg.vchMessage.data()) == items[i].message);
+    }
+
     smsgModule.Shutdown();
 }
 #endif
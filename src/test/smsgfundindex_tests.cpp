@@ -0,0 +1,77 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/smsgfundindex.h>
+#include <primitives/transaction.h>
+#include <test/setup_common.h>
+#include <util/time.h>
+
+#include <string.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(smsgfundindex_tests)
+
+static void AppendFunding(std::vector<uint8_t> &vData, const uint160 &msg_id, uint32_t amount)
+{
+    size_t ofs = vData.size();
+    vData.resize(ofs + 24);
+    memcpy(&vData[ofs], msg_id.begin(), 20);
+    memcpy(&vData[ofs + 20], &amount, 4);
+}
+
+BOOST_FIXTURE_TEST_CASE(smsgfundindex_get_funding, BasicTestingSetup)
+{
+    uint160 id1, id2;
+    memset(id1.begin(), 0x11, 20);
+    memset(id2.begin(), 0x22, 20);
+
+    CMutableTransaction mtx;
+    mtx.nVersion = FALCON_TXN_VERSION;
+
+    std::vector<uint8_t> vData{DO_FUND_MSG};
+    AppendFunding(vData, id1, 1000);
+    AppendFunding(vData, id2, 2000);
+    mtx.vpout.push_back(MAKE_OUTPUT<CTxOutData>(vData));
+
+    // Other data outputs and truncated funding are ignored
+    mtx.vpout.push_back(MAKE_OUTPUT<CTxOutData>(std::vector<uint8_t>{DO_FUND_MSG, 0x01, 0x02}));
+    std::vector<uint8_t> vOther{DO_NARR_PLAIN};
+    AppendFunding(vOther, id1, 5);
+    mtx.vpout.push_back(MAKE_OUTPUT<CTxOutData>(vOther));
+
+    auto funded = GetSmsgFunding(CTransaction(mtx));
+    BOOST_REQUIRE_EQUAL(funded.size(), 2U);
+    BOOST_CHECK(funded[0].first == id1);
+    BOOST_CHECK_EQUAL(funded[0].second, 1000U);
+    BOOST_CHECK(funded[1].first == id2);
+    BOOST_CHECK_EQUAL(funded[1].second, 2000U);
+}
+
+BOOST_FIXTURE_TEST_CASE(smsgfundindex_initial_sync, TestChain100Setup)
+{
+    SmsgFundIndex fund_index(1 << 20, true);
+    BOOST_CHECK(!fund_index.BlockUntilSyncedToCurrentChain());
+
+    fund_index.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!fund_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // The chain holds no funding transactions
+    BOOST_CHECK_EQUAL(fund_index.Size(), 0U);
+    SmsgFundIndex::FundedMsg funded;
+    BOOST_CHECK(!fund_index.FindFunding(uint160(), m_coinbase_txns[0]->GetHash(), funded));
+
+    fund_index.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
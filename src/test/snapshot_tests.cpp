@@ -0,0 +1,149 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <node/coinstats.h>
+#include <node/snapshot.h>
+#include <rctindex.h>
+#include <streams.h>
+#include <txdb.h>
+#include <validation.h>
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(snapshot_tests, TestChain100Setup)
+
+static uint256 GetUTXOSetHash()
+{
+    CCoinsStats stats;
+    CCoinsView *coins_view = WITH_LOCK(cs_main, return &::ChainstateActive().CoinsDB());
+    BOOST_REQUIRE(GetUTXOStats(coins_view, stats));
+    return stats.hashSerialized;
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_dump_load)
+{
+    // Add RingCT entries at the tip so the tables are covered
+    std::vector<CCmpPubKey> pubkeys;
+    CBlockIndex *pindex_base = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    for (int64_t i = 1; i <= 3; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        pubkeys.emplace_back(key.GetPubKey());
+        CAnonOutput ao;
+        ao.pubkey = pubkeys.back();
+        ao.outpoint = COutPoint(m_coinbase_txns[i]->GetHash(), 0);
+        ao.nBlockHeight = pindex_base->nHeight;
+        BOOST_CHECK(pblocktree->WriteRCTOutput(i, ao));
+        BOOST_CHECK(pblocktree->WriteRCTOutputLink(ao.pubkey, i));
+    }
+    {
+        CDBBatch batch(*pblocktree);
+        batch.Write(std::make_pair(DB_RCTKEYIMAGE, pubkeys[0]), CAnonKeyImageInfo(m_coinbase_txns[5]->GetHash(), pindex_base->nHeight));
+        BOOST_CHECK(pblocktree->WriteBatch(batch));
+    }
+    WITH_LOCK(cs_main, pindex_base->Cold().nAnonOutputs = 3);
+
+    fs::path path = GetDataDir() / "snapshot.dat";
+    SnapshotMetadata metadata;
+    uint256 hash;
+    std::string error;
+    BOOST_REQUIRE(DumpSnapshot(path, metadata, hash, error));
+    BOOST_CHECK(metadata.base_blockhash == pindex_base->GetBlockHash());
+    BOOST_CHECK_EQUAL(metadata.nHeight, 100);
+    BOOST_CHECK_EQUAL(metadata.nAnonOutputs, 3);
+    BOOST_CHECK_EQUAL(metadata.nKeyImages, 1U);
+    BOOST_CHECK(!fs::exists(GetDataDir() / "snapshot.dat.incomplete"));
+    const uint64_t nCoins = metadata.nCoins;
+    const uint256 utxo_hash = GetUTXOSetHash();
+
+    // Reading back gives the same hash
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        SnapshotMetadata metadata_read;
+        uint256 hash_read;
+        BOOST_CHECK(ReadSnapshot(file, metadata_read, hash_read, nullptr, error));
+        BOOST_CHECK(hash_read == hash);
+        BOOST_CHECK_EQUAL(metadata_read.nCoins, metadata.nCoins);
+    }
+
+    // The hash must be known and must match
+    BOOST_CHECK(!VerifySnapshot(path, Params(), metadata, error));
+    BOOST_CHECK(error.find("No snapshot hash is known") != std::string::npos);
+    RegtestParams().AddSnapshotHash(metadata.base_blockhash, hash);
+    BOOST_CHECK(VerifySnapshot(path, Params(), metadata, error));
+
+    fs::path path_bad = GetDataDir() / "snapshot_bad.dat";
+    {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        std::vector<uint8_t> data(fs::file_size(path));
+        file.read((char*)data.data(), data.size());
+        data[data.size() - 10] ^= 1; // In the key image txid
+        CAutoFile file_bad(fsbridge::fopen(path_bad, "wb"), SER_DISK, CLIENT_VERSION);
+        file_bad.write((const char*)data.data(), data.size());
+    }
+    BOOST_CHECK(!VerifySnapshot(path_bad, Params(), metadata, error));
+    BOOST_CHECK(error.find("does not match") != std::string::npos);
+
+    // Snapshots can only be loaded onto the genesis block
+    BOOST_CHECK(!::ChainstateActive().LoadSnapshot(path, Params(), metadata, error));
+
+    // Rewind to genesis and drop the block data, leaving only the headers
+    CValidationState state;
+    CBlockIndex *pindex_first = WITH_LOCK(cs_main, return ::ChainActive()[1]);
+    BOOST_REQUIRE(InvalidateBlock(state, Params(), pindex_first));
+    {
+        LOCK(cs_main);
+        BOOST_REQUIRE_EQUAL(::ChainActive().Height(), 0);
+        for (CBlockIndex *pindex = pindex_base; pindex->nHeight > 0; pindex = pindex->pprev) {
+            ::ChainstateActive().EraseBlockData(pindex);
+        }
+        ResetBlockFailureFlags(pindex_first);
+    }
+    for (int64_t i = 1; i <= 3; ++i) {
+        BOOST_CHECK(pblocktree->EraseRCTOutput(i));
+        BOOST_CHECK(pblocktree->EraseRCTOutputLink(pubkeys[i - 1]));
+    }
+    BOOST_CHECK(pblocktree->EraseRCTKeyImage(pubkeys[0]));
+    WITH_LOCK(cs_main, pindex_base->Cold().nAnonOutputs = 0);
+
+    BOOST_CHECK(!::ChainstateActive().LoadSnapshot(path_bad, Params(), metadata, error));
+    BOOST_REQUIRE(::ChainstateActive().LoadSnapshot(path, Params(), metadata, error));
+    BOOST_CHECK_EQUAL(metadata.nCoins, nCoins);
+    BOOST_CHECK(fSnapshotChainstate);
+    BOOST_CHECK(GetUTXOSetHash() == utxo_hash);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(::ChainActive().Tip() == pindex_base);
+        BOOST_CHECK(::ChainstateActive().CoinsTip().GetBestBlock() == pindex_base->GetBlockHash());
+        BOOST_CHECK_EQUAL(pindex_base->Cold().nAnonOutputs, 3);
+        BOOST_CHECK(pindex_base->HaveTxsDownloaded());
+        BOOST_CHECK(IsBlockPruned(::ChainActive()[50]));
+    }
+
+    CAnonOutput ao;
+    int64_t index;
+    CAnonKeyImageInfo ki_data;
+    BOOST_CHECK(pblocktree->ReadRCTOutput(2, ao));
+    BOOST_CHECK(ao.pubkey == pubkeys[1]);
+    BOOST_CHECK(pblocktree->ReadRCTOutputLink(pubkeys[2], index));
+    BOOST_CHECK_EQUAL(index, 3);
+    BOOST_CHECK(pblocktree->ReadRCTKeyImage(pubkeys[0], ki_data));
+    BOOST_CHECK(ki_data.txid == m_coinbase_txns[5]->GetHash());
+
+    // The chain continues from the snapshot base
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CBlock block = CreateAndProcessBlock({}, scriptPubKey);
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(::ChainActive().Tip()->GetBlockHash() == block.GetHash());
+        BOOST_CHECK_EQUAL(::ChainActive().Height(), 101);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
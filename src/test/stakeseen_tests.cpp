@@ -0,0 +1,87 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <arith_uint256.h>
+#include <pos/stakeseen.h>
+
+#include <test/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(stakeseen_tests, BasicTestingSetup)
+
+static COutPoint Kernel(uint32_t n)
+{
+    return COutPoint(ArithToUint256(arith_uint256(n / 4 + 1)), n % 4);
+}
+
+static uint256 BlockHash(uint32_t n)
+{
+    return ArithToUint256(arith_uint256(n + 1000000));
+}
+
+BOOST_AUTO_TEST_CASE(stakeseen_unique)
+{
+    StakeSeenTracker tracker(10);
+    uint256 first_seen;
+
+    BOOST_CHECK(tracker.CheckUnique(Kernel(1), BlockHash(1), false, first_seen));
+    BOOST_CHECK(!tracker.Contains(Kernel(1)));
+    BOOST_CHECK(tracker.CheckUnique(Kernel(1), BlockHash(1), true, first_seen));
+    BOOST_CHECK(tracker.Contains(Kernel(1)));
+
+    // Same block again is fine, another block using the kernel is not
+    BOOST_CHECK(tracker.CheckUnique(Kernel(1), BlockHash(1), true, first_seen));
+    BOOST_CHECK(!tracker.CheckUnique(Kernel(1), BlockHash(2), true, first_seen));
+    BOOST_CHECK(first_seen == BlockHash(1));
+
+    // Add overwrites
+    tracker.Add(Kernel(1), BlockHash(2));
+    BOOST_CHECK(tracker.CheckUnique(Kernel(1), BlockHash(2), false, first_seen));
+    BOOST_CHECK_EQUAL(tracker.Size(), 1U);
+
+    tracker.Clear();
+    BOOST_CHECK_EQUAL(tracker.Size(), 0U);
+    BOOST_CHECK(!tracker.Contains(Kernel(1)));
+}
+
+BOOST_AUTO_TEST_CASE(stakeseen_eviction)
+{
+    const size_t capacity = 100;
+    StakeSeenTracker tracker(capacity);
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        tracker.Add(Kernel(i), BlockHash(i));
+        BOOST_CHECK_EQUAL(tracker.Size(), std::min<size_t>(i + 1, capacity));
+
+        // Exactly the newest entries remain, in the block they were added with
+        if (i % 97 == 0 || i == 999) {
+            for (uint32_t k = 0; k <= i; ++k) {
+                uint256 first_seen;
+                bool fExpected = k + capacity > i;
+                BOOST_CHECK_EQUAL(tracker.Contains(Kernel(k)), fExpected);
+                if (fExpected) {
+                    BOOST_CHECK(!tracker.CheckUnique(Kernel(k), BlockHash(k + 1), false, first_seen));
+                    BOOST_CHECK(first_seen == BlockHash(k));
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(stakeseen_small)
+{
+    // Capacity close to the table size exercises probing and deletion across collisions
+    StakeSeenTracker tracker(8);
+    for (uint32_t i = 0; i < 200; ++i) {
+        uint256 first_seen;
+        BOOST_CHECK(tracker.CheckUnique(Kernel(i), BlockHash(i), true, first_seen));
+        for (uint32_t k = 0; k <= i; ++k) {
+            BOOST_CHECK_EQUAL(tracker.Contains(Kernel(k)), k + 8 > i);
+        }
+    }
+    BOOST_CHECK_EQUAL(tracker.Size(), 8U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
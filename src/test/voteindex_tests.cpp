@@ -0,0 +1,183 @@
+// Copyright (c) 2021 The Falcon Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <index/voteindex.h>
+#include <primitives/block.h>
+#include <test/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <deque>
+#include <string.h>
+
+#include <boost/test/unit_test.hpp>
+
+struct VoteIndexTest {
+    static void ConnectBlock(VoteIndex& vote_index, const CBlock& block, const CBlockIndex* pindex)
+    {
+        vote_index.BlockConnected(std::make_shared<const CBlock>(block), pindex, {});
+    }
+};
+
+BOOST_AUTO_TEST_SUITE(voteindex_tests)
+
+static CBlock MakeStakedBlock(const std::vector<uint8_t> &vData)
+{
+    CMutableTransaction mtx;
+    mtx.nVersion = FALCON_TXN_VERSION;
+    mtx.SetType(TXN_COINSTAKE);
+    mtx.vin.resize(1);
+    mtx.vpout.push_back(MAKE_OUTPUT<CTxOutData>(vData));
+    mtx.vpout.push_back(MAKE_OUTPUT<CTxOutStandard>());
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(mtx));
+    return block;
+}
+
+static CBlock MakeVoteBlock(int proposal, int option)
+{
+    std::vector<uint8_t> vData{0x01, 0x00, 0x00, 0x00};
+    if (proposal) {
+        uint32_t token = proposal | (option << 16);
+        vData.push_back(DO_VOTE);
+        vData.resize(9);
+        memcpy(&vData[5], &token, 4);
+    }
+    return MakeStakedBlock(vData);
+}
+
+static CBlock MakeRandomVoteBlock()
+{
+    // Some blocks aren't staked, some abstain, the rest vote for one of a few proposals
+    switch (InsecureRandRange(6)) {
+    case 0: return CBlock();
+    case 1: return MakeVoteBlock(0, 0);
+    default: return MakeVoteBlock(1 + InsecureRandRange(3), InsecureRandRange(4));
+    }
+}
+
+//! Tally read from the blocks of chain, like TallyBlockVotes reads them from disk
+static int WalkBlockVotes(const std::vector<CBlock>& chain, int proposal, int height_start, int height_end, std::map<int, int>& votes)
+{
+    votes.clear();
+    int blocks = 0;
+    for (int height = std::min(height_end, (int)chain.size() - 1); height >= std::max(height_start, 0); --height) {
+        if (CountBlockVote(GetBlockVote(chain[height]), proposal, votes)) {
+            blocks++;
+        }
+    }
+    return blocks;
+}
+
+static void CheckTallies(const VoteIndex& vote_index, const std::vector<CBlock>& chain)
+{
+    const int tip_height = chain.size() - 1;
+    for (int i = 0; i < 200; ++i) {
+        int proposal = 1 + InsecureRandRange(3);
+        int height_start = InsecureRandRange(tip_height + 20) - 10;
+        int height_end = height_start + InsecureRandRange(tip_height + 20);
+        std::map<int, int> index_votes, walk_votes;
+        BOOST_CHECK_EQUAL(vote_index.TallyVotes(proposal, height_start, height_end, index_votes),
+                          WalkBlockVotes(chain, proposal, height_start, height_end, walk_votes));
+        BOOST_CHECK(index_votes == walk_votes);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(voteindex_get_block_vote, BasicTestingSetup)
+{
+    // Height followed by a vote for option 3 of proposal 2
+    std::vector<uint8_t> vData{0x01, 0x00, 0x00, 0x00, DO_VOTE};
+    uint32_t token = 2 | (3 << 16);
+    vData.resize(9);
+    memcpy(&vData[5], &token, 4);
+
+    BlockVote vote = GetBlockVote(MakeStakedBlock(vData));
+    BOOST_CHECK(vote.staked);
+    BOOST_CHECK_EQUAL(vote.token, token);
+
+    // Truncated votes and other data abstain
+    vData.resize(8);
+    vote = GetBlockVote(MakeStakedBlock(vData));
+    BOOST_CHECK(vote.staked);
+    BOOST_CHECK_EQUAL(vote.token, 0U);
+
+    vote = GetBlockVote(MakeStakedBlock(std::vector<uint8_t>{0x01, 0x00, 0x00, 0x00}));
+    BOOST_CHECK(vote.staked);
+    BOOST_CHECK_EQUAL(vote.token, 0U);
+
+    // Blocks without a coinstake aren't counted
+    CBlock block;
+    BOOST_CHECK(!GetBlockVote(block).staked);
+}
+
+BOOST_FIXTURE_TEST_CASE(voteindex_initial_sync, TestChain100Setup)
+{
+    VoteIndex vote_index(1 << 20, true);
+    BOOST_CHECK(!vote_index.BlockUntilSyncedToCurrentChain());
+
+    vote_index.Start();
+
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!vote_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        MilliSleep(100);
+    }
+
+    // Every block is indexed, none of them staked
+    BOOST_CHECK_EQUAL(vote_index.Size(), 101U);
+    std::map<int, int> votes;
+    BOOST_CHECK_EQUAL(vote_index.TallyVotes(1, 0, 1000, votes), 0);
+    BOOST_CHECK(votes.empty());
+    BOOST_CHECK_EQUAL(TallyBlockVotes(1, 0, 1000, votes), 0);
+    BOOST_CHECK(votes.empty());
+
+    // Extend the indexed chain with staked blocks, the tally must match walking the blocks
+    const CBlockIndex* tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    std::vector<CBlock> chain(tip->nHeight + 1);
+    std::vector<const CBlockIndex*> chain_index;
+    for (const CBlockIndex* pindex = tip; pindex; pindex = pindex->pprev) {
+        chain_index.insert(chain_index.begin(), pindex);
+    }
+    std::deque<CBlockIndex> block_index;
+    std::deque<uint256> block_hashes;
+    auto connect_block = [&](int height, const CBlock& block) {
+        block_hashes.push_back(InsecureRand256());
+        block_index.emplace_back();
+        CBlockIndex& index = block_index.back();
+        index.phashBlock = &block_hashes.back();
+        index.nHeight = height;
+        index.pprev = const_cast<CBlockIndex*>(chain_index[height - 1]);
+        index.BuildSkip();
+
+        chain.resize(height);
+        chain.push_back(block);
+        chain_index.resize(height);
+        chain_index.push_back(&index);
+        VoteIndexTest::ConnectBlock(vote_index, block, &index);
+    };
+
+    for (int height = tip->nHeight + 1; height <= tip->nHeight + 100; ++height) {
+        connect_block(height, MakeRandomVoteBlock());
+    }
+    BOOST_CHECK_EQUAL(vote_index.Size(), chain.size());
+    CheckTallies(vote_index, chain);
+
+    // A reorg replaces the votes above the fork
+    const int fork_height = tip->nHeight + 50;
+    for (int height = fork_height + 1; height <= fork_height + 30; ++height) {
+        connect_block(height, MakeRandomVoteBlock());
+    }
+    BOOST_CHECK_EQUAL(vote_index.Size(), chain.size());
+    CheckTallies(vote_index, chain);
+
+    vote_index.Stop();
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
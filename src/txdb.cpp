@@ -19,6 +19,10 @@
 
 #include <stdint.h>
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -39,6 +43,7 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_PROOF_CHECK = 'V';
 
 /*
 static const char DB_RCTOUTPUT = 'A';
@@ -437,67 +442,230 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::WriteProofCheckState(int next_height, int skipped_height, bool fSync) {
+    return Write(DB_PROOF_CHECK, std::make_pair(next_height, skipped_height), fSync);
+}
+
+bool CBlockTreeDB::ReadProofCheckState(int &next_height, int &skipped_height) {
+    std::pair<int, int> heights;
+    if (!Read(DB_PROOF_CHECK, heights))
+        return false;
+    next_height = heights.first;
+    skipped_height = heights.second;
+    return true;
+}
+
+bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &hash, CDiskBlockIndex &diskindex) {
+    return Read(std::make_pair(DB_BLOCK_INDEX, hash), diskindex);
+}
+
+/** Entries further than this below the highest entry loaded leave their cold fields on disk */
+static const int BLOCK_INDEX_COLD_DEPTH = 1000;
+/** Number of entries the load threads decode per batch */
+static const size_t BLOCK_INDEX_LOAD_BATCH = 1024;
+
+namespace {
+typedef std::vector<std::pair<uint256, CDiskBlockIndex> > BlockIndexBatch;
+
+/**
+ * Reads the block index in parallel. The key space is split by the first byte
+ * of the block hash, each thread decodes and checks the entries of its range
+ * and queues them in batches for the caller to link.
+ */
+class BlockIndexLoader
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+public:
+    BlockIndexLoader(CDBWrapper &db, const Consensus::Params &consensusParams, int num_threads)
+        : m_db(db), m_consensus(consensusParams)
+    {
+        m_max_batches = num_threads * 4;
+        m_running = num_threads;
+        for (int i = 0; i < num_threads; ++i) {
+            m_threads.emplace_back(&BlockIndexLoader::ThreadRead, this, i * 256 / num_threads, (i + 1) * 256 / num_threads);
+        }
+    }
 
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    ~BlockIndexLoader()
+    {
+        {
+            LOCK(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_all();
+        for (auto &thread : m_threads) {
+            thread.join();
+        }
+    }
 
-    // Load m_block_index
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        if (ShutdownRequested()) return false;
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew  = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev                    = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight                  = diskindex.nHeight;
-                pindexNew->nFile                    = diskindex.nFile;
-                pindexNew->nDataPos                 = diskindex.nDataPos;
-                pindexNew->nUndoPos                 = diskindex.nUndoPos;
-                pindexNew->nVersion                 = diskindex.nVersion;
-                pindexNew->hashMerkleRoot           = diskindex.hashMerkleRoot;
-                pindexNew->hashWitnessMerkleRoot    = diskindex.hashWitnessMerkleRoot;
-                pindexNew->nTime                    = diskindex.nTime;
-                pindexNew->nBits                    = diskindex.nBits;
-                pindexNew->nNonce                   = diskindex.nNonce;
-                pindexNew->nStatus                  = diskindex.nStatus;
-                pindexNew->nTx                      = diskindex.nTx;
-
-                pindexNew->nFlags                   = diskindex.nFlags & ~BLOCK_DELAYED;
-                pindexNew->bnStakeModifier          = diskindex.bnStakeModifier;
-                pindexNew->prevoutStake             = diskindex.prevoutStake;
-                //pindexNew->hashProof                = diskindex.hashProof;
-
-                pindexNew->nMoneySupply             = diskindex.nMoneySupply;
-                pindexNew->nAnonOutputs             = diskindex.nAnonOutputs;
-
-
-                if (pindexNew->nHeight == 0
-                    && pindexNew->GetBlockHash() != Params().GetConsensus().hashGenesisBlock)
-                    return error("LoadBlockIndex(): Genesis block hash incorrect: %s", pindexNew->ToString());
-
-                if (fFalconMode) {
-                    // only CheckProofOfWork for genesis blocks
-                    if (diskindex.hashPrev.IsNull() && !CheckProofOfWork(pindexNew->GetBlockHash(),
-                        pindexNew->nBits, Params().GetConsensus(), 0, Params().GetLastImportHeight()))
-                        return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
-                } else
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus())) {
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+    /** Wait for the next batch, false when done or on error. */
+    bool Next(BlockIndexBatch &batch, std::string &error)
+    {
+        while (true) {
+            boost::this_thread::interruption_point();
+            if (ShutdownRequested()) {
+                error = "shutdown requested";
+                return false;
+            }
+
+            WAIT_LOCK(m_mutex, lock);
+            if (!m_error.empty()) {
+                error = m_error;
+                return false;
+            }
+            if (!m_batches.empty()) {
+                batch = std::move(m_batches.front());
+                m_batches.pop_front();
+                m_cv.notify_all();
+                return true;
+            }
+            if (m_running == 0) {
+                return false;
+            }
+            m_cv.wait_for(lock, std::chrono::milliseconds(100));
+        }
+    }
+
+private:
+    CDBWrapper &m_db;
+    const Consensus::Params &m_consensus;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<BlockIndexBatch> m_batches GUARDED_BY(m_mutex);
+    size_t m_max_batches;
+    int m_running GUARDED_BY(m_mutex);
+    std::string m_error GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex) = false;
+    std::vector<std::thread> m_threads;
+
+    bool Push(BlockIndexBatch &batch)
+    {
+        WAIT_LOCK(m_mutex, lock);
+        m_cv.wait(lock, [&] { return m_stop || m_batches.size() < m_max_batches; });
+        if (m_stop) {
+            return false;
+        }
+        m_batches.push_back(std::move(batch));
+        batch.clear();
+        m_cv.notify_all();
+        return true;
+    }
+
+    void ThreadRead(int begin, int end)
+    {
+        util::ThreadRename("loadblkindex");
+        std::string error;
+        try {
+            error = ReadRange(begin, end);
+        } catch (const std::exception &e) {
+            error = e.what();
+        }
+        {
+            LOCK(m_mutex);
+            if (!error.empty() && m_error.empty()) {
+                m_error = error;
+            }
+            m_running--;
+        }
+        m_cv.notify_all();
+    }
+
+    std::string ReadRange(int begin, int end)
+    {
+        std::unique_ptr<CDBIterator> pcursor(m_db.NewIterator());
+
+        uint256 start;
+        *start.begin() = begin;
+        pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, start));
+
+        BlockIndexBatch batch;
+        batch.reserve(BLOCK_INDEX_LOAD_BATCH);
+        while (pcursor->Valid()) {
+            std::pair<char, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() >= end) {
+                break;
+            }
+            batch.emplace_back();
+            CDiskBlockIndex &diskindex = batch.back().second;
+            if (!pcursor->GetValue(diskindex)) {
+                return "failed to read value";
+            }
+            const uint256 hash = diskindex.GetBlockHash();
+            batch.back().first = hash;
+
+            if (diskindex.nHeight == 0 && hash != m_consensus.hashGenesisBlock)
+                return strprintf("Genesis block hash incorrect: %s", diskindex.ToString());
+
+            if (fFalconMode) {
+                // only CheckProofOfWork for genesis blocks
+                if (diskindex.hashPrev.IsNull() && !CheckProofOfWork(hash,
+                    diskindex.nBits, m_consensus, 0, Params().GetLastImportHeight()))
+                    return strprintf("CheckProofOfWork failed: %s", diskindex.ToString());
+            } else
+            if (!CheckProofOfWork(hash, diskindex.nBits, m_consensus)) {
+                return strprintf("CheckProofOfWork failed: %s", diskindex.ToString());
+            }
+
+            if (batch.size() >= BLOCK_INDEX_LOAD_BATCH) {
+                if (!Push(batch)) {
+                    return "";
                 }
+                batch.reserve(BLOCK_INDEX_LOAD_BATCH);
+            }
+            pcursor->Next();
+        }
+        if (!batch.empty()) {
+            Push(batch);
+        }
+        return "";
+    }
+};
+} // namespace
 
-                pcursor->Next();
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int num_threads)
+{
+    BlockIndexLoader loader(*this, consensusParams, std::max(1, std::min(num_threads, 256)));
+
+    // Load m_block_index, linking stays on this thread as insertBlockIndex isn't thread safe
+    int max_height = 0;
+    BlockIndexBatch batch;
+    std::string error_str;
+    while (loader.Next(batch, error_str)) {
+        for (auto &entry : batch) {
+            const CDiskBlockIndex &diskindex = entry.second;
+
+            // Construct block index object
+            CBlockIndex* pindexNew  = insertBlockIndex(entry.first);
+            pindexNew->pprev                    = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight                  = diskindex.nHeight;
+            pindexNew->nFile                    = diskindex.nFile;
+            pindexNew->nDataPos                 = diskindex.nDataPos;
+            pindexNew->nUndoPos                 = diskindex.nUndoPos;
+            pindexNew->nVersion                 = diskindex.nVersion;
+            pindexNew->hashMerkleRoot           = diskindex.hashMerkleRoot;
+            pindexNew->hashWitnessMerkleRoot    = diskindex.hashWitnessMerkleRoot;
+            pindexNew->nTime                    = diskindex.nTime;
+            pindexNew->nBits                    = diskindex.nBits;
+            pindexNew->nNonce                   = diskindex.nNonce;
+            pindexNew->nStatus                  = diskindex.nStatus;
+            pindexNew->nTx                      = diskindex.nTx;
+
+            pindexNew->nFlags                   = diskindex.nFlags & ~BLOCK_DELAYED;
+
+            // Entries arrive in hash order, which is random in height, so
+            // max_height is close to the tip after the first few batches and
+            // only a handful of deep entries keep their cold fields.
+            if (diskindex.nHeight + BLOCK_INDEX_COLD_DEPTH >= max_height) {
+                pindexNew->Cold() = diskindex.Cold();
             } else {
-                return error("%s: failed to read value", __func__);
+                pindexNew->UnloadCold();
             }
-        } else {
-            break;
+            max_height = std::max(max_height, diskindex.nHeight);
         }
     }
+    if (!error_str.empty()) {
+        return error("%s: %s", __func__, error_str);
+    }
 
     return true;
 }
@@ -23,6 +23,7 @@
 #include <vector>
 
 class CBlockIndex;
+class CDiskBlockIndex;
 class CCoinsViewDBCursor;
 class uint256;
 
@@ -130,7 +131,10 @@ public:
 
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+    bool WriteProofCheckState(int next_height, int skipped_height, bool fSync);
+    bool ReadProofCheckState(int &next_height, int &skipped_height);
+    bool ReadDiskBlockIndex(const uint256 &hash, CDiskBlockIndex &diskindex);
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int num_threads = 1);
 
 
     bool ReadRCTOutput(int64_t i, CAnonOutput &ao);
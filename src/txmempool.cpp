@@ -726,22 +726,13 @@ void CTxMemPool::removeConflicts(const CTransaction &tx)
             for (size_t k = 0; k < nInputs; ++k)
             {
                 const CCmpPubKey &ki = *((CCmpPubKey*)&vKeyImages[k*33]);
-                uint256 txhashKI;
-                if (HaveKeyImage(ki, txhashKI))
+                const CTransaction* txConflict = GetConflictTx(ki);
+                if (txConflict && *txConflict != tx)
                 {
-                    txiter origit = mapTx.find(txhashKI);
-
-                    if (origit != mapTx.end())
-                    {
-                        const CTransaction& txConflict = origit->GetTx();
-                        if (txConflict != tx)
-                        {
-                            if (LogAcceptCategory(BCLog::RINGCT))
-                                LogPrintf("Clearing conflicting anon tx from mempool, removed:%s, tx:%s\n", txhashKI.ToString(), tx.GetHash().ToString());
-                            ClearPrioritisation(txConflict.GetHash());
-                            removeRecursive(txConflict, MemPoolRemovalReason::CONFLICT);
-                        };
-                    };
+                    if (LogAcceptCategory(BCLog::RINGCT))
+                        LogPrintf("Clearing conflicting anon tx from mempool, removed:%s, tx:%s\n", txConflict->GetHash().ToString(), tx.GetHash().ToString());
+                    ClearPrioritisation(txConflict->GetHash());
+                    removeRecursive(*txConflict, MemPoolRemovalReason::CONFLICT);
                 };
             };
             continue;
@@ -795,6 +786,7 @@ void CTxMemPool::_clear()
     mapLinks.clear();
     mapTx.clear();
     mapNextTx.clear();
+    mapKeyImages.clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     lastRollingFeeUpdate = GetTime();
@@ -1092,9 +1084,7 @@ bool CTxMemPool::HaveKeyImage(const CCmpPubKey &ki, uint256 &hash) const
 {
     LOCK(cs);
 
-    std::map<CCmpPubKey, uint256>::const_iterator mi;
-    mi = mapKeyImages.find(ki);
-
+    const auto mi = mapKeyImages.find(ki);
     if (mi != mapKeyImages.end())
     {
         hash = mi->second;
@@ -1110,6 +1100,16 @@ const CTransaction* CTxMemPool::GetConflictTx(const COutPoint& prevout) const
     return it == mapNextTx.end() ? nullptr : it->second;
 }
 
+const CTransaction* CTxMemPool::GetConflictTx(const CCmpPubKey& ki) const
+{
+    const auto it = mapKeyImages.find(ki);
+    if (it == mapKeyImages.end()) {
+        return nullptr;
+    }
+    const auto origit = mapTx.find(it->second);
+    return origit == mapTx.end() ? nullptr : &origit->GetTx();
+}
+
 boost::optional<CTxMemPool::txiter> CTxMemPool::GetIter(const uint256& txid) const
 {
     auto it = mapTx.find(txid);
@@ -1164,7 +1164,7 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
                 if (out->IsType(OUTPUT_CT))
                 {
                     coin.nType = OUTPUT_CT;
-                    coin.commitment = ((CTxOutCT*)out)->commitment;
+                    coin.SetCommitment(((CTxOutCT*)out)->commitment);
                 };
                 return true;
             };
@@ -1183,7 +1183,7 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
     // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapKeyImages) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -1377,3 +1377,5 @@ void CTxMemPool::SetIsLoaded(bool loaded)
 }
 
 SaltedTxidHasher::SaltedTxidHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+SaltedKeyImageHasher::SaltedKeyImageHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
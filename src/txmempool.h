@@ -11,6 +11,7 @@
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -377,6 +378,20 @@ public:
     }
 };
 
+class SaltedKeyImageHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedKeyImageHasher();
+
+    size_t operator()(const CCmpPubKey& ki) const {
+        return CSipHasher(k0, k1).Write(ki.begin(), ki.size()).Finalize();
+    }
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -573,7 +588,8 @@ public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
     std::map<uint256, CAmount> mapDeltas;
 
-    std::map<CCmpPubKey, uint256> mapKeyImages;
+    /** Key images spent by anon inputs of transactions in the pool, see AddKeyImagesToMempool */
+    std::unordered_map<CCmpPubKey, uint256, SaltedKeyImageHasher> mapKeyImages GUARDED_BY(cs);
 
 
     /** Create a new CTxMemPool.
@@ -636,6 +652,8 @@ public:
 public:
     /** Get the transaction in the pool that spends the same prevout */
     const CTransaction* GetConflictTx(const COutPoint& prevout) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Get the transaction in the pool that spends the same anon key image */
+    const CTransaction* GetConflictTx(const CCmpPubKey& ki) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     /** Returns an iterator to the given hash, if found */
     boost::optional<txiter> GetIter(const uint256& txid) const EXCLUSIVE_LOCKS_REQUIRED(cs);
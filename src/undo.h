@@ -34,8 +34,13 @@ public:
         }
         ::Serialize(s, CTxOutCompressor(REF(txout->out)));
         ::Serialize(s, txout->nType);
-        if (txout->nType == OUTPUT_CT)
-            s.write((char*)&txout->commitment.data[0], 33);
+        if (txout->nType == OUTPUT_CT) {
+            const secp256k1_pedersen_commitment *commitment = txout->GetCommitment();
+            if (!commitment) {
+                throw std::ios_base::failure("CT input undo record without commitment");
+            }
+            s.write((char*)&commitment->data[0], 33);
+        }
     }
 
     explicit TxInUndoSerializer(const Coin* coin) : txout(coin) {}
@@ -61,8 +66,11 @@ public:
         }
         ::Unserialize(s, CTxOutCompressor(REF(txout->out)));
         ::Unserialize(s, txout->nType);
-        if (txout->nType == OUTPUT_CT)
-            s.read((char*)&txout->commitment.data[0], 33);
+        if (txout->nType == OUTPUT_CT) {
+            secp256k1_pedersen_commitment commitment;
+            s.read((char*)&commitment.data[0], 33);
+            txout->SetCommitment(commitment);
+        }
     }
 
     explicit TxInUndoDeserializer(Coin* coin) : txout(coin) {}
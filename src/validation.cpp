@@ -18,6 +18,7 @@
 #include <flatfile.h>
 #include <hash.h>
 #include <index/txindex.h>
+#include <node/snapshot.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
@@ -49,14 +50,21 @@
 #include <smsg/smessage.h>
 #include <net.h>
 #include <pos/kernel.h>
+#include <pos/stakeseen.h>
 #include <anon.h>
+#include <blind.h>
+#include <blockcompress.h>
+#include <proofverifier.h>
 #include <rctindex.h>
 #include <insight/insight.h>
 #include <insight/balanceindex.h>
+#include <insight/blocktimeindex.h>
 
+#include <condition_variable>
 #include <future>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -115,8 +123,7 @@ CChain& ChainActive() {
 RecursiveMutex cs_main;
 
 std::map<uint256, StakeConflict> mapStakeConflict;
-std::map<COutPoint, uint256> mapStakeSeen;
-std::list<COutPoint> listStakeSeen;
+StakeSeenTracker stakeSeen(MAX_STAKE_SEEN_SIZE);
 
 CoinStakeCache coinStakeCache GUARDED_BY(cs_main);
 std::set<CCmpPubKey> setConnectKi; // hacky workaround
@@ -132,8 +139,10 @@ std::atomic_bool fSkipRangeproof(false);
 std::atomic_bool fBusyImporting(false);        // covers ActivateBestChain too
 bool fHavePruned = false;
 bool fPruneMode = false;
+bool fSnapshotChainstate = false;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
+bool fCompressBlocks = DEFAULT_COMPRESS_BLOCKS;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
@@ -647,44 +656,63 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
     }
 
     // Check for conflicts with in-memory transactions
+    auto add_conflict = [&](const CTransaction* ptxConflicting) {
+        if (!ptxConflicting || setConflicts.count(ptxConflicting->GetHash())) {
+            return true;
+        }
+        // Allow opt-out of transaction replacement by setting
+        // nSequence > MAX_BIP125_RBF_SEQUENCE (SEQUENCE_FINAL-2) on all inputs.
+        //
+        // SEQUENCE_FINAL-1 is picked to still allow use of nLockTime by
+        // non-replaceable transactions. All inputs rather than just one
+        // is for the sake of multi-party protocols, where we don't
+        // want a single party to be able to disable replacement.
+        //
+        // The opt-out ignores descendants as anyone relying on
+        // first-seen mempool behavior should be checking all
+        // unconfirmed ancestors anyway; doing otherwise is hopelessly
+        // insecure.
+        bool fReplacementOptOut = true;
+        for (const CTxIn &_txin : ptxConflicting->vin)
+        {
+            if (_txin.nSequence <= MAX_BIP125_RBF_SEQUENCE)
+            {
+                fReplacementOptOut = false;
+                break;
+            }
+        }
+        if (fReplacementOptOut) {
+            return state.Invalid(ValidationInvalidReason::TX_MEMPOOL_POLICY, false, REJECT_DUPLICATE, "txn-mempool-conflict");
+        }
+
+        setConflicts.insert(ptxConflicting->GetHash());
+        return true;
+    };
     for (const CTxIn &txin : tx.vin)
     {
         if (txin.IsAnonInput()) {
-            continue;
-        }
-        const CTransaction* ptxConflicting = m_pool.GetConflictTx(txin.prevout);
-        if (ptxConflicting) {
-            if (!setConflicts.count(ptxConflicting->GetHash()))
-            {
-                // Allow opt-out of transaction replacement by setting
-                // nSequence > MAX_BIP125_RBF_SEQUENCE (SEQUENCE_FINAL-2) on all inputs.
-                //
-                // SEQUENCE_FINAL-1 is picked to still allow use of nLockTime by
-                // non-replaceable transactions. All inputs rather than just one
-                // is for the sake of multi-party protocols, where we don't
-                // want a single party to be able to disable replacement.
-                //
-                // The opt-out ignores descendants as anyone relying on
-                // first-seen mempool behavior should be checking all
-                // unconfirmed ancestors anyway; doing otherwise is hopelessly
-                // insecure.
-                bool fReplacementOptOut = true;
-                for (const CTxIn &_txin : ptxConflicting->vin)
-                {
-                    if (_txin.nSequence <= MAX_BIP125_RBF_SEQUENCE)
-                    {
-                        fReplacementOptOut = false;
-                        break;
-                    }
-                }
-                if (fReplacementOptOut) {
-                    return state.Invalid(ValidationInvalidReason::TX_MEMPOOL_POLICY, false, REJECT_DUPLICATE, "txn-mempool-conflict");
+            // Key images are checked for validity in VerifyMLSAG
+            uint32_t nInputs, nRingSize;
+            txin.GetAnonInfo(nInputs, nRingSize);
+            if (txin.scriptData.stack.size() < 1
+                || txin.scriptData.stack[0].size() != nInputs * 33) {
+                continue;
+            }
+            const std::vector<uint8_t> &vKeyImages = txin.scriptData.stack[0];
+            for (size_t k = 0; k < nInputs; ++k) {
+                const CCmpPubKey &ki = *((CCmpPubKey*)&vKeyImages[k*33]);
+                if (!add_conflict(m_pool.GetConflictTx(ki))) {
+                    return false;
                 }
-
-                setConflicts.insert(ptxConflicting->GetHash());
             }
+            continue;
+        }
+        if (!add_conflict(m_pool.GetConflictTx(txin.prevout))) {
+            return false;
         }
     }
+    // Anon inputs of a replacement may reuse the key images of the txns it replaces
+    state.m_replaced_txids = setConflicts;
 
     LockPoints lp;
     m_view.SetBackend(m_viewmempool);
@@ -1259,7 +1287,51 @@ bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus
 // CBlock and CBlockIndex
 //
 
-static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
+/** Compress the serialized form of obj if -compressblocks is set, payload is left empty otherwise. */
+template<typename T>
+static void CompressForDisk(const T& obj, std::vector<uint8_t>& payload)
+{
+    payload.clear();
+    if (!fCompressBlocks) {
+        return;
+    }
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << obj;
+    CompressDiskRecord((const uint8_t*)ss.data(), ss.size(), payload);
+}
+
+/**
+ * Read the record header before pos and, for compressed records, the payload into data.
+ * filein is left positioned at pos for plain records, with nSize set to their length.
+ */
+static bool ReadDiskRecord(CAutoFile& filein, const FlatFilePos& pos, std::vector<uint8_t>& data, bool& fCompressed, uint32_t& nSize, CMessageHeader::MessageStartChars* blk_start = nullptr)
+{
+    CMessageHeader::MessageStartChars start;
+    filein >> start >> nSize;
+    if (blk_start) {
+        memcpy(*blk_start, start, CMessageHeader::MESSAGE_START_SIZE);
+    }
+
+    fCompressed = nSize & DISK_RECORD_COMPRESSED;
+    nSize &= ~DISK_RECORD_COMPRESSED;
+    if (nSize > MAX_SIZE) {
+        return error("%s: Record is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                nSize, MAX_SIZE);
+    }
+    if (!fCompressed) {
+        return true;
+    }
+
+    std::vector<uint8_t> payload(nSize);
+    filein.read((char*)payload.data(), nSize);
+    std::string error_str;
+    if (!DecompressDiskRecord(payload.data(), payload.size(), data, error_str)) {
+        return error("%s: %s at %s", __func__, error_str, pos.ToString());
+    }
+    return true;
+}
+
+static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart, const std::vector<uint8_t>& compressed)
 {
     // Open history file to append
     CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
@@ -1267,7 +1339,7 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
         return error("WriteBlockToDisk: OpenBlockFile failed");
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(block, fileout.GetVersion());
+    unsigned int nSize = compressed.empty() ? GetSerializeSize(block, fileout.GetVersion()) : compressed.size() | DISK_RECORD_COMPRESSED;
     fileout << messageStart << nSize;
 
     // Write block
@@ -1275,7 +1347,11 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
     if (fileOutPos < 0)
         return error("WriteBlockToDisk: ftell failed");
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
+    if (compressed.empty()) {
+        fileout << block;
+    } else {
+        fileout.write((const char*)compressed.data(), compressed.size());
+    }
 
     return true;
 }
@@ -1285,13 +1361,26 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::P
     block.SetNull();
 
     // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8; // Seek back 8 bytes for meta header
+    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
     // Read block
     try {
-        filein >> block;
+        std::vector<uint8_t> data;
+        bool fCompressed;
+        uint32_t nSize;
+        if (!ReadDiskRecord(filein, pos, data, fCompressed, nSize)) {
+            return false;
+        }
+        if (fCompressed) {
+            CDataStream ss(data, SER_DISK, CLIENT_VERSION);
+            ss >> block;
+        } else {
+            filein >> block;
+        }
     }
     catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
@@ -1328,6 +1417,20 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+template<typename Stream>
+static bool ReadTransactionFromBlockStream(Stream& s, int nIndex, CBlockHeader& blockHeader, CTransactionRef& txOut)
+{
+    s >> blockHeader;
+
+    int nTxns = ReadCompactSize(s);
+    if (nTxns <= nIndex || nIndex < 0)
+        return false;
+
+    for (int k = 0; k <= nIndex; ++k)
+        s >> txOut;
+    return true;
+}
+
 bool ReadTransactionFromDiskBlock(const CBlockIndex* pindex, int nIndex, CTransactionRef &txOut)
 {
     FlatFilePos hpos;
@@ -1337,21 +1440,29 @@ bool ReadTransactionFromDiskBlock(const CBlockIndex* pindex, int nIndex, CTransa
     }
 
     // Open history file to read
-    CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
+    FlatFilePos record_pos = hpos;
+    record_pos.nPos -= 8; // Seek back 8 bytes for meta header
+    CAutoFile filein(OpenBlockFile(record_pos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("%s: OpenBlockFile failed for %s", __func__, hpos.ToString());
 
     CBlockHeader blockHeader;
     try {
-        filein >> blockHeader;
-
-        int nTxns = ReadCompactSize(filein);
-
-        if (nTxns <= nIndex || nIndex < 0)
-            return error("%s: Block %s, txn %d not in available range %d.", __func__, pindex->GetBlockPos().ToString(), nIndex, nTxns);
-
-        for (int k = 0; k <= nIndex; ++k)
-            filein >> txOut;
+        std::vector<uint8_t> data;
+        bool fCompressed;
+        uint32_t nSize;
+        if (!ReadDiskRecord(filein, hpos, data, fCompressed, nSize)) {
+            return false;
+        }
+        if (fCompressed) {
+            CDataStream ss(data, SER_DISK, CLIENT_VERSION);
+            if (!ReadTransactionFromBlockStream(ss, nIndex, blockHeader, txOut)) {
+                return error("%s: Block %s, txn %d not in available range.", __func__, pindex->GetBlockPos().ToString(), nIndex);
+            }
+        } else
+        if (!ReadTransactionFromBlockStream(filein, nIndex, blockHeader, txOut)) {
+            return error("%s: Block %s, txn %d not in available range.", __func__, pindex->GetBlockPos().ToString(), nIndex);
+        }
     } catch (const std::exception& e)
     {
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), hpos.ToString());
@@ -1363,6 +1474,40 @@ bool ReadTransactionFromDiskBlock(const CBlockIndex* pindex, int nIndex, CTransa
     return true;
 }
 
+bool ReadTransactionFromDiskBlock(const FlatFilePos& pos, unsigned int nTxOffset, CBlockHeader& header, CTransactionRef& txOut)
+{
+    FlatFilePos record_pos = pos;
+    record_pos.nPos -= 8; // Seek back 8 bytes for meta header
+    CAutoFile filein(OpenBlockFile(record_pos, true), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull())
+        return error("%s: OpenBlockFile failed for %s", __func__, pos.ToString());
+
+    try {
+        std::vector<uint8_t> data;
+        bool fCompressed;
+        uint32_t nSize;
+        if (!ReadDiskRecord(filein, pos, data, fCompressed, nSize)) {
+            return false;
+        }
+        // nTxOffset is relative to the end of the header in the serialized block, not the file
+        if (fCompressed) {
+            CDataStream ss(data, SER_DISK, CLIENT_VERSION);
+            ss >> header;
+            ss.ignore(nTxOffset);
+            ss >> txOut;
+        } else {
+            filein >> header;
+            if (fseek(filein.Get(), nTxOffset, SEEK_CUR)) {
+                return error("%s: fseek(...) failed", __func__);
+            }
+            filein >> txOut;
+        }
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+    }
+    return true;
+}
+
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
     FlatFilePos hpos = pos;
@@ -1374,9 +1519,13 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
 
     try {
         CMessageHeader::MessageStartChars blk_start;
-        unsigned int blk_size;
+        bool fCompressed;
+        uint32_t blk_size;
 
-        filein >> blk_start >> blk_size;
+        // Compressed blocks are served decompressed
+        if (!ReadDiskRecord(filein, pos, block, fCompressed, blk_size, &blk_start)) {
+            return false;
+        }
 
         if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
             return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
@@ -1384,13 +1533,10 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
                     HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
         }
 
-        if (blk_size > MAX_SIZE) {
-            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
-                    blk_size, MAX_SIZE);
+        if (!fCompressed) {
+            block.resize(blk_size); // Zeroing of memory is intentional here
+            filein.read((char*)block.data(), blk_size);
         }
-
-        block.resize(blk_size); // Zeroing of memory is intentional here
-        filein.read((char*)block.data(), blk_size);
     } catch(const std::exception& e) {
         return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
     }
@@ -1867,8 +2013,11 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             memcpy(vchAmount.data(), &amount, sizeof(amount));
         } else
         if (coin.nType == OUTPUT_CT) {
+            if (!coin.GetCommitment()) {
+                return state.Error(strprintf("input-commitment-missing (%s)", prevout.ToString()));
+            }
             vchAmount.resize(33);
-            memcpy(vchAmount.data(), coin.commitment.data, 33);
+            memcpy(vchAmount.data(), coin.GetCommitment()->data, 33);
         }
 
         // Verify signature
@@ -1906,7 +2055,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
     }
 
     if (fHasAnonInput && fAnonChecks
-        && !VerifyMLSAG(tx, state)) {
+        && !VerifyMLSAG(tx, state, state.m_skip_mlsag_signatures ? MLSAG_CHECK_INPUTS : MLSAG_CHECK_ALL)) {
             return false;
     }
 
@@ -1919,7 +2068,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
     return true;
 }
 
-static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart, const std::vector<uint8_t>& compressed)
 {
     // Open history file to append
     CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
@@ -1927,7 +2076,7 @@ static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const
         return error("%s: OpenUndoFile failed", __func__);
 
     // Write index header
-    unsigned int nSize = GetSerializeSize(blockundo, fileout.GetVersion());
+    unsigned int nSize = compressed.empty() ? GetSerializeSize(blockundo, fileout.GetVersion()) : compressed.size() | DISK_RECORD_COMPRESSED;
     fileout << messageStart << nSize;
 
     // Write undo data
@@ -1935,7 +2084,11 @@ static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const
     if (fileOutPos < 0)
         return error("%s: ftell failed", __func__);
     pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
+    if (compressed.empty()) {
+        fileout << blockundo;
+    } else {
+        fileout.write((const char*)compressed.data(), compressed.size());
+    }
 
     // calculate & write checksum
     CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
@@ -1954,16 +2107,33 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     }
 
     // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    FlatFilePos hpos = pos;
+    hpos.nPos -= 8; // Seek back 8 bytes for meta header
+    CAutoFile filein(OpenUndoFile(hpos, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull())
         return error("%s: OpenUndoFile failed", __func__);
 
     // Read block
-    uint256 hashChecksum, nullHash;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+    uint256 hashChecksum, hashData, nullHash;
     try {
-        verifier << (pindex->pprev ? pindex->pprev->GetBlockHash() : nullHash);
-        verifier >> blockundo;
+        std::vector<uint8_t> data;
+        bool fCompressed;
+        uint32_t nSize;
+        if (!ReadDiskRecord(filein, pos, data, fCompressed, nSize)) {
+            return false;
+        }
+        if (fCompressed) {
+            CDataStream ss(data, SER_DISK, CLIENT_VERSION);
+            CHashVerifier<CDataStream> verifier(&ss);
+            verifier << (pindex->pprev ? pindex->pprev->GetBlockHash() : nullHash);
+            verifier >> blockundo;
+            hashData = verifier.GetHash();
+        } else {
+            CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+            verifier << (pindex->pprev ? pindex->pprev->GetBlockHash() : nullHash);
+            verifier >> blockundo;
+            hashData = verifier.GetHash();
+        }
         filein >> hashChecksum;
     }
     catch (const std::exception& e) {
@@ -1971,7 +2141,7 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
     }
 
     // Verify checksum
-    if (hashChecksum != verifier.GetHash())
+    if (hashChecksum != hashData)
         return error("%s: Checksum mismatch", __func__);
 
     return true;
@@ -2104,7 +2274,7 @@ DisconnectResult CChainState::DisconnectBlock(const CBlock& block, const CBlockI
                 CTxOutRingCT *txout = (CTxOutRingCT*)out;
 
                 if (view.nLastRCTOutput == 0) {
-                    view.nLastRCTOutput = pindex->nAnonOutputs;
+                    view.nLastRCTOutput = pindex->Cold().nAnonOutputs;
                     // Verify data matches
                     CAnonOutput ao;
                     if (!pblocktree->ReadRCTOutput(view.nLastRCTOutput, ao)) {
@@ -2295,12 +2465,15 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
 {
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
+        std::vector<uint8_t> compressed;
+        CompressForDisk(blockundo, compressed);
+        unsigned int nUndoSize = compressed.empty() ? ::GetSerializeSize(blockundo, CLIENT_VERSION) : compressed.size();
         FlatFilePos _pos;
-        if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, CLIENT_VERSION) + 40))
+        if (!FindUndoPos(state, pindex->nFile, _pos, nUndoSize + 40))
             return error("ConnectBlock(): FindUndoPos failed");
 
         uint256 nullHash;
-        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev ? pindex->pprev->GetBlockHash() : nullHash, chainparams.MessageStart()))
+        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev ? pindex->pprev->GetBlockHash() : nullHash, chainparams.MessageStart(), compressed))
             return AbortNode(state, "Failed to write undo data");
 
         // update nUndoPos in block index
@@ -2443,6 +2616,50 @@ static int64_t nTimeCallbacks = 0;
 static int64_t nTimeTotal = 0;
 static int64_t nBlocksTotal = 0;
 
+/** Whether pindex is an ancestor of the assumed valid block, see ConnectBlock(). */
+static bool IsAssumedValid(const CBlockIndex *pindex, const Consensus::Params &consensusParams) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (hashAssumeValid.IsNull() || !pindexBestHeader) {
+        return false;
+    }
+    const CBlockIndex *pindex_assume_valid = LookupBlockIndex(hashAssumeValid);
+    if (!pindex_assume_valid) {
+        return false;
+    }
+    return pindex_assume_valid->GetAncestor(pindex->nHeight) == pindex &&
+        pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
+        pindexBestHeader->nChainWork >= nMinimumChainWork &&
+        GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, consensusParams) > 60 * 60 * 24 * 7 * 2;
+}
+
+/** Whether vtx[i] of a block assembled by this node is still in the mempool, unchanged, and was
+ *  accepted under the rules state was set up with for the block. Its scripts, MLSAG signatures and range proofs
+ *  were verified on entry and need not be verified again, see CheckBlock() and ConnectBlock(). */
+static bool IsPrevalidatedTx(const CBlock& block, size_t i, const CValidationState& state, const Consensus::Params& consensusParams)
+{
+    if (i >= block.vPrevalidated.size() || !block.vPrevalidated[i]
+        || block.vPrevalidated.size() != block.vtx.size()) {
+        return false;
+    }
+    const CTransaction& tx = *block.vtx[i];
+    int64_t nAcceptTime;
+    {
+        LOCK(mempool.cs);
+        CTxMemPool::txiter it = mempool.mapTx.find(tx.GetHash());
+        if (it == mempool.mapTx.end() || it->GetTx().GetWitnessHash() != tx.GetWitnessHash()) {
+            return false;
+        }
+        nAcceptTime = it->GetTime();
+    }
+    CValidationState state_accept;
+    state_accept.SetStateInfo(nAcceptTime, -1, consensusParams);
+    return state_accept.fBulletproofsActive == state.fBulletproofsActive
+        && state_accept.rct_active == state.rct_active
+        && state_accept.m_clamp_tx_version == state.m_clamp_tx_version
+        && state_accept.m_exploit_fix_1 == state.m_exploit_fix_1
+        && state_accept.m_exploit_fix_2 == state.m_exploit_fix_2;
+}
+
 /** Apply the effects of this block (with given index) on the UTXO set represented by coins.
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
@@ -2470,7 +2687,31 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     // is enforced in ContextualCheckBlockHeader(); we wouldn't want to
     // re-enforce that rule here (at least until we make it impossible for
     // GetAdjustedTime() to go backward).
-    if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck)) {
+
+    // We've been configured with the hash of a block which has been externally verified to have a valid history.
+    // A suitable default value is included with the software and updated from time to time.  Because validity
+    //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
+    // This setting doesn't force the selection of any particular chain but makes validating some faster by
+    //  effectively caching the result of part of the verification.
+    // If this block is a member of the assumed verified chain and an ancestor of the best header,
+    // script, MLSAG and range proof verification is skipped. Assuming the assumevalid block is
+    // valid this is safe because block merkle hashes are still computed and checked,
+    // Of course, if an assumed valid block is invalid due to false scriptSigs or proofs
+    // this optimization would allow an invalid chain to be accepted.
+    // The equivalent time check discourages hash power from extorting the network via DOS attack
+    //  into accepting an invalid block through telling users they must manually set assumevalid.
+    //  Requiring a software change or burying the invalid block, regardless of the setting, makes
+    //  it hard to hide the implication of the demand.  This also avoids having release candidates
+    //  that are hardly doing any signature verification at all in testing without having to
+    //  artificially set the default assumed verified block further back.
+    // The test against nMinimumChainWork prevents the skipping when denied access to any chain at
+    //  least as good as the expected chain.
+    bool fScriptChecks = !IsAssumedValid(pindex, chainparams.GetConsensus());
+
+    state.m_skip_rangeproof = !fScriptChecks;
+    bool fCheckedBlock = CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck);
+    state.m_skip_rangeproof = false;
+    if (!fCheckedBlock) {
         if (state.GetReason() == ValidationInvalidReason::BLOCK_MUTATED) {
             // We don't write down blocks to disk if they may have been
             // corrupted, so this should be impossible unless we're having hardware
@@ -2481,7 +2722,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     }
 
     if (block.IsProofOfStake()) {
-        pindex->bnStakeModifier = ComputeStakeModifierV2(pindex->pprev, pindex->prevoutStake.hash);
+        pindex->Cold().bnStakeModifier = ComputeStakeModifierV2(pindex->pprev, pindex->Cold().prevoutStake.hash);
         setDirtyBlockIndex.insert(pindex);
 
         uint256 hashProof, targetProofOfStake;
@@ -2507,35 +2748,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     nBlocksTotal++;
 
-    bool fScriptChecks = true;
-    if (!hashAssumeValid.IsNull()) {
-        // We've been configured with the hash of a block which has been externally verified to have a valid history.
-        // A suitable default value is included with the software and updated from time to time.  Because validity
-        //  relative to a piece of software is an objective fact these defaults can be easily reviewed.
-        // This setting doesn't force the selection of any particular chain but makes validating some faster by
-        //  effectively caching the result of part of the verification.
-        BlockMap::const_iterator  it = m_blockman.m_block_index.find(hashAssumeValid);
-        if (it != m_blockman.m_block_index.end()) {
-            if (it->second->GetAncestor(pindex->nHeight) == pindex &&
-                pindexBestHeader->GetAncestor(pindex->nHeight) == pindex &&
-                pindexBestHeader->nChainWork >= nMinimumChainWork) {
-                // This block is a member of the assumed verified chain and an ancestor of the best header.
-                // Script verification is skipped when connecting blocks under the
-                // assumevalid block. Assuming the assumevalid block is valid this
-                // is safe because block merkle hashes are still computed and checked,
-                // Of course, if an assumed valid block is invalid due to false scriptSigs
-                // this optimization would allow an invalid chain to be accepted.
-                // The equivalent time check discourages hash power from extorting the network via DOS attack
-                //  into accepting an invalid block through telling users they must manually set assumevalid.
-                //  Requiring a software change or burying the invalid block, regardless of the setting, makes
-                //  it hard to hide the implication of the demand.  This also avoids having release candidates
-                //  that are hardly doing any signature verification at all in testing without having to
-                //  artificially set the default assumed verified block further back.
-                // The test against nMinimumChainWork prevents the skipping when denied access to any chain at
-                //  least as good as the expected chain.
-                fScriptChecks = (GetBlockProofEquivalentTime(*pindexBestHeader, *pindex, *pindexBestHeader, chainparams.GetConsensus()) <= 60 * 60 * 24 * 7 * 2);
-            }
-        }
+    if (!fJustCheck && g_proof_verifier
+        && (!fScriptChecks || (fBusyImporting && fSkipRangeproof))) {
+        g_proof_verifier->BlockSkipped(pindex);
     }
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
@@ -2647,7 +2862,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
             CAmount txfee = 0;
             if (!Consensus::CheckTxInputs(tx, state, view, pindex->nHeight, txfee)) {
                 control.Wait();
-                if (!IsBlockReason(state.GetReason())) {
+                if (!state.IsError() && !IsBlockReason(state.GetReason())) {
                     // CheckTxInputs may return MISSING_INPUTS or
                     // PREMATURE_SPEND but we can't return that, as it's not
                     // defined for a block, so we reset the reason flag to
@@ -2755,7 +2970,12 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         {
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
-            if (fScriptChecks && !CheckInputs(tx, state, view, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr)) {
+            bool fPrevalidated = fScriptChecks && IsPrevalidatedTx(block, i, state, chainparams.GetConsensus());
+            bool fTxScriptChecks = fScriptChecks && !fPrevalidated;
+            // Only the scripts and MLSAG signatures of a prevalidated tx are skipped, its ring members
+            // and key images are checked against the chain it is connected to
+            if ((fTxScriptChecks && !CheckInputs(tx, state, view, flags, fCacheResults, fCacheResults, txdata[i], nScriptCheckThreads ? &vChecks : nullptr))
+                || (fPrevalidated && state.fHasAnonInput && !VerifyMLSAG(tx, state, MLSAG_CHECK_INPUTS))) {
                 control.Wait();
                 if (state.GetReason() == ValidationInvalidReason::TX_NOT_STANDARD) {
                     // CheckInputs may return NOT_STANDARD for extra flags we passed,
@@ -2783,7 +3003,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         }
 
         if (view.nLastRCTOutput == 0) {
-            view.nLastRCTOutput = pindex->pprev ? pindex->pprev->nAnonOutputs : 0;
+            view.nLastRCTOutput = pindex->pprev ? pindex->pprev->Cold().nAnonOutputs : 0;
         }
         // Index rct outputs and keyimages
         if (state.fHasAnonOutput || state.fHasAnonInput) {
@@ -2810,13 +3030,13 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 if (!fVerifyingDB && pblocktree->ReadRCTOutputLink(txout->pk, nTestExists)) {
                     control.Wait();
 
-                    if (nTestExists > pindex->pprev->nAnonOutputs) {
+                    if (nTestExists > pindex->pprev->Cold().nAnonOutputs) {
                         // The anon index can diverge from the chain index if shutdown does not complete
-                        LogPrintf("%s: Duplicate anon-output %s, index %d, above last index %d.\n", __func__, HexStr(txout->pk.begin(), txout->pk.end()), nTestExists, pindex->pprev->nAnonOutputs);
+                        LogPrintf("%s: Duplicate anon-output %s, index %d, above last index %d.\n", __func__, HexStr(txout->pk.begin(), txout->pk.end()), nTestExists, pindex->pprev->Cold().nAnonOutputs);
                         if (!attempted_rct_index_repair) {
                             LogPrintf("Attempting to repair anon index.\n");
                             std::set<CCmpPubKey> setKi; // unused
-                            RollBackRCTIndex(pindex->pprev->nAnonOutputs, nTestExists, pindex->pprev->nHeight, setKi);
+                            RollBackRCTIndex(pindex->pprev->Cold().nAnonOutputs, nTestExists, pindex->pprev->nHeight, setKi);
                             attempted_rct_index_repair = true;
                             return false;
                         } else {
@@ -3029,14 +3249,14 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     if (block.nTime >= consensus.exploit_fix_2_time && pindex->pprev && pindex->pprev->nTime < consensus.exploit_fix_2_time) {
         // TODO: Set to block height after fork
         // Set moneysupply to utxoset sum
-        pindex->nMoneySupply = GetUTXOSum() + nMoneyCreated;
-        LogPrintf("RCT mint fix HF2, set nMoneySupply to: %d\n", pindex->nMoneySupply);
+        pindex->Cold().nMoneySupply = GetUTXOSum() + nMoneyCreated;
+        LogPrintf("RCT mint fix HF2, set nMoneySupply to: %d\n", pindex->Cold().nMoneySupply);
         reset_balances = true;
-        block_balances[BAL_IND_PLAIN] = pindex->nMoneySupply;
+        block_balances[BAL_IND_PLAIN] = pindex->Cold().nMoneySupply;
     } else {
-        pindex->nMoneySupply = (pindex->pprev ? pindex->pprev->nMoneySupply : 0) + nMoneyCreated;
+        pindex->Cold().nMoneySupply = (pindex->pprev ? pindex->pprev->Cold().nMoneySupply : 0) + nMoneyCreated;
     }
-    pindex->nAnonOutputs = view.nLastRCTOutput;
+    pindex->Cold().nAnonOutputs = view.nLastRCTOutput;
     setDirtyBlockIndex.insert(pindex); // pindex has changed, must save to disk
 
     if ((!fIsGenesisBlock || fFalconMode)
@@ -3169,6 +3389,10 @@ bool CChainState::FlushStateToDisk(
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
+                // Before the chainstate, which may include blocks connected with proofs skipped
+                if (g_proof_verifier && !g_proof_verifier->WriteState(true)) {
+                    return AbortNode(state, "Failed to write proof check state");
+                }
             }
             // Finally remove any pruned files
             if (fFlushForPrune)
@@ -3328,6 +3552,8 @@ void UpdateTip(const CBlockIndex* pindexNew, const CChainParams& chainParams)
         g_best_block_cv.notify_all();
     }
 
+    g_block_time_index.SetTip(pindexNew);
+
     std::string warningMessages;
     if (!::ChainstateActive().IsInitialBlockDownload())
     {
@@ -4289,52 +4515,25 @@ bool CheckBlockSignature(const CBlock &block)
 bool AddToMapStakeSeen(const COutPoint &kernel, const uint256 &blockHash)
 {
     // Overwrites existing values
-
-    std::pair<std::map<COutPoint, uint256>::iterator,bool> ret;
-    ret = mapStakeSeen.insert(std::pair<COutPoint, uint256>(kernel, blockHash));
-    if (ret.second == false) { // existing element
-        ret.first->second = blockHash;
-    } else {
-        listStakeSeen.push_back(kernel);
-    }
-
+    stakeSeen.Add(kernel, blockHash);
     return true;
 };
 
 bool CheckStakeUnused(const COutPoint &kernel)
 {
-    std::map<COutPoint, uint256>::const_iterator mi = mapStakeSeen.find(kernel);
-    return (mi == mapStakeSeen.end());
+    return !stakeSeen.Contains(kernel);
 }
 
 bool CheckStakeUnique(const CBlock &block, bool fUpdate)
 {
-    LOCK(cs_main);
-
     uint256 blockHash = block.GetHash();
     const COutPoint &kernel = block.vtx[0]->vin[0].prevout;
 
-    std::map<COutPoint, uint256>::const_iterator mi = mapStakeSeen.find(kernel);
-    if (mi != mapStakeSeen.end()) {
-        if (mi->second == blockHash) {
-            return true;
-        }
-        return error("%s: Stake kernel for %s first seen on %s.", __func__, blockHash.ToString(), mi->second.ToString());
-    }
-
-    if (!fUpdate) {
-        return true;
+    uint256 firstSeen;
+    if (!stakeSeen.CheckUnique(kernel, blockHash, fUpdate, firstSeen)) {
+        return error("%s: Stake kernel for %s first seen on %s.", __func__, blockHash.ToString(), firstSeen.ToString());
     }
-
-    while (listStakeSeen.size() > MAX_STAKE_SEEN_SIZE) {
-        const COutPoint &oldest = listStakeSeen.front();
-        if (1 != mapStakeSeen.erase(oldest)) {
-            LogPrintf("%s: Warning: mapStakeSeen did not erase %s %n\n", __func__, oldest.hash.ToString(), oldest.n);
-        }
-        listStakeSeen.pop_front();
-    }
-
-    return AddToMapStakeSeen(kernel, blockHash);
+    return true;
 };
 
 bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
@@ -4378,7 +4577,8 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
         return state.Invalid(ValidationInvalidReason::CONSENSUS, false, REJECT_INVALID, "bad-blk-length", "size limits failed");
 
     if (fFalconMode) {
-        if (!::ChainstateActive().IsInitialBlockDownload()
+        // Blocks read from disk may include orphaned duplicates
+        if (!fReindex && !fImporting
             && block.vtx[0]->IsCoinStake()
             && !CheckStakeUnique(block)) {
             //state.DoS(10, false, REJECT_INVALID, "bad-cs-duplicate", false, "duplicate coinstake");
@@ -4391,7 +4591,7 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
             {
                 LogPrint(BCLog::POS, "%s: Ignoring CheckStakeUnique for block %s, chain height behind peers.\n", __func__, block.GetHash().ToString());
                 const COutPoint &kernel = block.vtx[0]->vin[0].prevout;
-                mapStakeSeen[kernel] = block.GetHash();
+                stakeSeen.Add(kernel, block.GetHash());
             } else
                 return state.DoS(20, false, REJECT_INVALID, "bad-cs-duplicate", false, "duplicate coinstake");
             */
@@ -4424,10 +4624,17 @@ bool CheckBlock(const CBlock& block, CValidationState& state, const Consensus::P
 
     // Check transactions
     // Must check for duplicate inputs (see CVE-2018-17144)
-    for (const auto& tx : block.vtx)
-        if (!CheckTransaction(*tx, state, true)) // Check for duplicate inputs, TODO: UpdateCoins should return a bool, db/coinsview txn should be undone
+    const bool skip_rangeproof = state.m_skip_rangeproof;
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const auto& tx = block.vtx[i];
+        state.m_skip_rangeproof = skip_rangeproof || IsPrevalidatedTx(block, i, state, consensusParams);
+        if (!CheckTransaction(*tx, state, true)) { // Check for duplicate inputs, TODO: UpdateCoins should return a bool, db/coinsview txn should be undone
+            state.m_skip_rangeproof = skip_rangeproof;
             return state.Invalid(state.GetReason(), false, state.GetRejectCode(), state.GetRejectReason(),
                                  strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), state.GetDebugMessage()));
+        }
+    }
+    state.m_skip_rangeproof = skip_rangeproof;
 
     unsigned int nSigOps = 0;
     for (const auto& tx : block.vtx)
@@ -4848,9 +5055,9 @@ bool ProcessDuplicateStakeHeader(CBlockIndex *pindex, NodeId nodeId) EXCLUSIVE_L
                     pindexPrev->nStatus &= (~BLOCK_FAILED_VALID);
                     setDirtyBlockIndex.insert(pindexPrev);
 
-                    if (!pindexPrev->prevoutStake.IsNull()) {
+                    if (!pindexPrev->Cold().prevoutStake.IsNull()) {
                         uint256 prevhash = pindexPrev->GetBlockHash();
-                        AddToMapStakeSeen(pindexPrev->prevoutStake, prevhash);
+                        AddToMapStakeSeen(pindexPrev->Cold().prevoutStake, prevhash);
                     }
 
                     pindexPrev->nStatus &= (~BLOCK_FAILED_CHILD);
@@ -4862,8 +5069,8 @@ bool ProcessDuplicateStakeHeader(CBlockIndex *pindex, NodeId nodeId) EXCLUSIVE_L
             pindex->nStatus &= (~BLOCK_FAILED_CHILD);
         //};
 
-        if (!pindex->prevoutStake.IsNull()) {
-            AddToMapStakeSeen(pindex->prevoutStake, hash);
+        if (!pindex->Cold().prevoutStake.IsNull()) {
+            AddToMapStakeSeen(pindex->Cold().prevoutStake, hash);
         }
         return true;
     }
@@ -5204,7 +5411,12 @@ bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidatio
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 static FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, const CChainParams& chainparams, const FlatFilePos* dbp) {
-    unsigned int nBlockSize = ::GetSerializeSize(block, CLIENT_VERSION);
+    std::vector<uint8_t> compressed;
+    if (dbp == nullptr) {
+        CompressForDisk(block, compressed);
+    }
+    // When reindexing, blocks already on disk may be compressed, the serialized size is an upper bound
+    unsigned int nBlockSize = compressed.empty() ? ::GetSerializeSize(block, CLIENT_VERSION) : compressed.size();
     FlatFilePos blockPos;
     if (dbp != nullptr)
         blockPos = *dbp;
@@ -5213,7 +5425,7 @@ static FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, const CChai
         return FlatFilePos();
     }
     if (dbp == nullptr) {
-        if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart())) {
+        if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart(), compressed)) {
             AbortNode("Failed to write block");
             return FlatFilePos();
         }
@@ -5270,15 +5482,18 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
         if (pindex->nChainWork < nMinimumChainWork) return true;
     }
 
-    if (!CheckBlock(block, state, chainparams.GetConsensus())) {
+    state.m_skip_rangeproof = IsAssumedValid(pindex, chainparams.GetConsensus());
+    bool fCheckedBlock = CheckBlock(block, state, chainparams.GetConsensus());
+    state.m_skip_rangeproof = false;
+    if (!fCheckedBlock) {
         return error("%s: %s", __func__, FormatStateMessage(state));
     }
 
     if (block.IsProofOfStake()) {
         pindex->SetProofOfStake();
-        pindex->prevoutStake = pblock->vtx[0]->vin[0].prevout;
+        pindex->Cold().prevoutStake = pblock->vtx[0]->vin[0].prevout;
         if (!pindex->pprev
-            || (pindex->pprev->bnStakeModifier.IsNull()
+            || (pindex->pprev->Cold().bnStakeModifier.IsNull()
                 && pindex->pprev->GetBlockHash() != chainparams.GetConsensus().hashGenesisBlock)) {
             // Block received out of order
             if (fFalconMode && !IsInitialBlockDownload()) {
@@ -5291,7 +5506,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CVali
                 return DelayBlock(pblock, state);
             }
         } else {
-            pindex->bnStakeModifier = ComputeStakeModifierV2(pindex->pprev, pindex->prevoutStake.hash);
+            pindex->Cold().bnStakeModifier = ComputeStakeModifierV2(pindex->pprev, pindex->Cold().prevoutStake.hash);
         }
         pindex->nFlags &= ~BLOCK_DELAYED;
         setDirtyBlockIndex.insert(pindex);
@@ -5370,7 +5585,11 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
 
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
+        // During IBD the header is known, range proofs below the assumed valid block are skipped.
+        const CBlockIndex *pindex_header = LookupBlockIndex(pblock->GetHash());
+        state.m_skip_rangeproof = pindex_header && IsAssumedValid(pindex_header, chainparams.GetConsensus());
         bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
+        state.m_skip_rangeproof = false;
         if (ret) {
             // Store to disk
             ret = ::ChainstateActive().AcceptBlock(pblock, state, chainparams, &pindex, fForceProcessing, nullptr, fNewBlock);
@@ -5655,7 +5874,17 @@ bool BlockManager::LoadBlockIndex(
     CBlockTreeDB& blocktree,
     std::set<CBlockIndex*, CBlockIndexWorkComparator>& block_index_candidates)
 {
-    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); }))
+    g_load_block_index_cold = [](const uint256& hash, CBlockIndexCold& cold) {
+        CDiskBlockIndex diskindex;
+        if (!pblocktree || !pblocktree->ReadDiskBlockIndex(hash, diskindex)) {
+            return AbortNode(strprintf("Failed to read block index entry %s", hash.ToString()));
+        }
+        cold = diskindex.Cold();
+        return true;
+    };
+
+    if (!blocktree.LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); },
+            std::max(1, nScriptCheckThreads)))
         return false;
 
     // Calculate nChainWork
@@ -5762,6 +5991,17 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams) EXCLUSIVE_LOCKS_RE
     if (fHavePruned)
         LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
 
+    // Blocks below the base of a loaded snapshot are treated as pruned
+    bool fLoadingSnapshot = false;
+    if (pblocktree->ReadFlag("loadingsnapshot", fLoadingSnapshot) && fLoadingSnapshot) {
+        return error("LoadBlockIndexDB(): Loading a chainstate snapshot was interrupted, you will need to rebuild the database using -reindex");
+    }
+    pblocktree->ReadFlag("snapshotchainstate", fSnapshotChainstate);
+    if (fSnapshotChainstate) {
+        LogPrintf("LoadBlockIndexDB(): Chainstate was loaded from a snapshot, blocks below its base are not validated\n");
+        fHavePruned = true;
+    }
+
     // Check whether we need to continue reindexing
     bool fReindexing = false;
     pblocktree->ReadReindexing(fReindexing);
@@ -5849,7 +6089,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         uiInterface.ShowProgress(_("Verifying blocks...").translated, percentageDone, false);
         if (pindex->nHeight <= ::ChainActive().Height()-nCheckDepth)
             break;
-        if (fPruneMode && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+        if ((fPruneMode || fSnapshotChainstate) && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
             // If pruning, only go back as far as we have data.
             LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
             break;
@@ -6090,7 +6330,7 @@ bool CChainState::RewindBlockIndex(const CChainParams& params)
             // Make sure nothing changed from under us (this won't happen because RewindBlockIndex runs before importing/network are active)
             assert(tip == m_chain.Tip());
             if (tip == nullptr || tip->nHeight < nHeight) break;
-            if (fPruneMode && !(tip->nStatus & BLOCK_HAVE_DATA)) {
+            if ((fPruneMode || fSnapshotChainstate) && !(tip->nStatus & BLOCK_HAVE_DATA)) {
                 // If pruning, don't try rewinding past the HAVE_DATA point;
                 // since older blocks can't be served anyway, there's
                 // no need to walk further, and trying to DisconnectTip()
@@ -6172,6 +6412,7 @@ void UnloadBlockIndex()
 {
     LOCK(cs_main);
     ::ChainActive().SetTip(nullptr);
+    g_block_time_index.Clear();
     g_blockman.Unload();
     pindexBestInvalid = nullptr;
     pindexBestHeader = nullptr;
@@ -6185,6 +6426,7 @@ void UnloadBlockIndex()
         warningcache[b].clear();
     }
     fHavePruned = false;
+    fSnapshotChainstate = false;
 
     ::ChainstateActive().UnloadBlockIndex();
 }
@@ -6269,7 +6511,435 @@ bool LoadGenesisBlock(const CChainParams& chainparams)
     return ::ChainstateActive().LoadGenesisBlock(chainparams);
 }
 
-bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp)
+namespace {
+/** Writes the records of a snapshot to the chainstate and the RingCT tables */
+class SnapshotLoader : public SnapshotVisitor
+{
+private:
+    CCoinsViewCache& m_coins;
+    const uint256 m_base_blockhash;
+    const int m_base_height;
+    CDBBatch m_batch;
+
+    bool WriteBatch(std::string& error)
+    {
+        if (!pblocktree->WriteBatch(m_batch)) {
+            error = "Failed to write RingCT tables";
+            return false;
+        }
+        m_batch.Clear();
+        return true;
+    }
+
+public:
+    SnapshotLoader(CCoinsViewCache& coins, const uint256& base_blockhash, int base_height)
+        : m_coins(coins), m_base_blockhash(base_blockhash), m_base_height(base_height), m_batch(*pblocktree) {}
+
+    bool OnCoin(const COutPoint& outpoint, Coin&& coin, std::string& error) override
+    {
+        m_coins.AddCoin(outpoint, std::move(coin), false);
+        if (m_coins.DynamicMemoryUsage() > nCoinCacheUsage) {
+            m_coins.SetBestBlock(m_base_blockhash, m_base_height);
+            if (!m_coins.Flush()) {
+                error = "Failed to write coins";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool OnAnonOutput(int64_t index, const CAnonOutput& ao, std::string& error) override
+    {
+        m_batch.Write(std::make_pair(DB_RCTOUTPUT, index), ao);
+        m_batch.Write(std::make_pair(DB_RCTOUTPUT_LINK, ao.pubkey), index);
+        return m_batch.SizeEstimate() < nDefaultDbBatchSize || WriteBatch(error);
+    }
+
+    bool OnKeyImage(const CCmpPubKey& ki, const CAnonKeyImageInfo& data, std::string& error) override
+    {
+        m_batch.Write(std::make_pair(DB_RCTKEYIMAGE, ki), data);
+        return m_batch.SizeEstimate() < nDefaultDbBatchSize || WriteBatch(error);
+    }
+
+    bool Finish(std::string& error)
+    {
+        return WriteBatch(error);
+    }
+};
+} // namespace
+
+bool CChainState::LoadSnapshot(const fs::path& path, const CChainParams& chainparams, SnapshotMetadata& metadata, std::string& error)
+{
+    {
+        LOCK(cs_main);
+        if (m_chain.Height() != 0) {
+            error = "The chain tip must be the genesis block to load a snapshot";
+            return false;
+        }
+        if (fAddressIndex || fSpentIndex || fTimestampIndex || fBalancesIndex) {
+            error = "Loading a snapshot is not supported with the insight indices enabled";
+            return false;
+        }
+    }
+
+    // Check the whole file against the known hash before touching the chainstate
+    if (!VerifySnapshot(path, chainparams, metadata, error)) {
+        return false;
+    }
+
+    LOCK2(cs_main, ::mempool.cs);
+    CBlockIndex* pindex_base = LookupBlockIndex(metadata.base_blockhash);
+    if (!pindex_base || pindex_base->nHeight != metadata.nHeight) {
+        error = strprintf("The header of the snapshot base block %s is not known", metadata.base_blockhash.ToString());
+        return false;
+    }
+    if (pindex_base->nStatus & BLOCK_FAILED_MASK) {
+        error = strprintf("The snapshot base block %s is invalid", metadata.base_blockhash.ToString());
+        return false;
+    }
+    if (m_chain.Height() != 0) {
+        error = "The chain tip must be the genesis block to load a snapshot";
+        return false;
+    }
+
+    LogPrintf("Loading chainstate snapshot at block %s (height %d)\n", metadata.base_blockhash.ToString(), metadata.nHeight);
+    int64_t nStart = GetTimeMillis();
+
+    // From here on a failure leaves a partially written chainstate
+    if (!pblocktree->WriteFlag("loadingsnapshot", true)) {
+        error = "Failed to write to the block database";
+        return false;
+    }
+
+    // Remove the coins created by the genesis block
+    CCoinsViewCache& coins = CoinsTip();
+    {
+        std::unique_ptr<CCoinsViewCursor> pcursor(CoinsDB().Cursor());
+        for (; pcursor->Valid(); pcursor->Next()) {
+            COutPoint outpoint;
+            if (pcursor->GetKey(outpoint)) {
+                coins.SpendCoin(outpoint);
+            }
+        }
+    }
+
+    CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull()) {
+        error = strprintf("Unable to open %s", path.string());
+        return AbortNode(error);
+    }
+    SnapshotLoader loader(coins, metadata.base_blockhash, metadata.nHeight);
+    SnapshotMetadata metadata_read;
+    uint256 hash;
+    if (!ReadSnapshot(file, metadata_read, hash, &loader, error) ||
+        !loader.Finish(error)) {
+        return AbortNode(strprintf("Loading snapshot failed: %s", error));
+    }
+    const auto mi = chainparams.SnapshotHashes().find(metadata.base_blockhash);
+    if (mi == chainparams.SnapshotHashes().end() || mi->second != hash) {
+        error = "Snapshot file changed while loading";
+        return AbortNode(error);
+    }
+
+    // Blocks below the base are treated as valid and pruned, the number of
+    // transactions in missing blocks is unknown and is set to one.
+    CBlockIndexCold& cold = pindex_base->Cold();
+    cold.bnStakeModifier = metadata.bnStakeModifier;
+    cold.prevoutStake = metadata.prevoutStake;
+    cold.nMoneySupply = metadata.nMoneySupply;
+    cold.nAnonOutputs = metadata.nAnonOutputs;
+    for (int nHeight = 1; nHeight <= pindex_base->nHeight; ++nHeight) {
+        CBlockIndex* pindex = pindex_base->GetAncestor(nHeight);
+        if (pindex->nTx == 0) {
+            pindex->nTx = 1;
+        }
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            pindex->nStatus |= BLOCK_OPT_WITNESS;
+        }
+        pindex->nChainTx = pindex->pprev->nChainTx + pindex->nTx;
+        pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        setDirtyBlockIndex.insert(pindex);
+    }
+
+    m_chain.SetTip(pindex_base);
+    coins.SetBestBlock(metadata.base_blockhash, metadata.nHeight);
+    setBlockIndexCandidates.insert(pindex_base);
+    PruneBlockIndexCandidates();
+    ::mempool.clear();
+
+    fHavePruned = true;
+    fSnapshotChainstate = true;
+    CValidationState state;
+    if (!pblocktree->WriteFlag("snapshotchainstate", true) ||
+        !FlushStateToDisk(chainparams, state, FlushStateMode::ALWAYS) ||
+        !pblocktree->WriteFlag("loadingsnapshot", false)) {
+        error = "Failed to write chainstate";
+        return AbortNode(error);
+    }
+    CheckBlockIndex(chainparams.GetConsensus());
+
+    metadata.nCoins = metadata_read.nCoins;
+    metadata.nKeyImages = metadata_read.nKeyImages;
+    LogPrintf("Loaded chainstate snapshot with %d coins, %d anon outputs and %d key images in %dms\n",
+        metadata.nCoins, metadata.nAnonOutputs, metadata.nKeyImages, GetTimeMillis() - nStart);
+    return true;
+}
+
+namespace {
+/** Maximum number of blocks and bytes the import reader may run ahead of the final stage */
+static const size_t IMPORT_READAHEAD_BLOCKS = 1024;
+static const size_t IMPORT_READAHEAD_BYTES = 64 * 1024 * 1024;
+
+/** A block record on its way through the import pipeline */
+struct BlockImportRecord
+{
+    FlatFilePos pos;
+    size_t nSize = 0;
+    std::shared_ptr<CBlock> block;
+    bool fDone = false;
+};
+
+/**
+ * Block import pipeline for -reindex and -loadblock.
+ *
+ * One thread reads and decodes blocks ahead through the files, a pool of
+ * workers runs the context-free CheckBlock, and Next() hands them back in
+ * file order for AcceptBlock. Decoding stays with the reader so a record that
+ * fails to decode is rescanned from the byte after its magic, as before.
+ */
+class BlockImportPipeline
+{
+public:
+    /** Returns the next file to read or nullptr, pos.nFile is set if the file is a block file */
+    typedef std::function<FILE*(FlatFilePos&)> NextFileFn;
+
+    BlockImportPipeline(const CChainParams& chainparams, NextFileFn next_file, int num_workers);
+    ~BlockImportPipeline();
+
+    /** Wait for the next record in file order, false once all files are read. */
+    bool Next(std::shared_ptr<BlockImportRecord>& record);
+
+    std::string GetReadError()
+    {
+        LOCK(m_mutex);
+        return m_read_error;
+    }
+
+private:
+    const CChainParams& m_chainparams;
+    NextFileFn m_next_file;
+
+    Mutex m_mutex;
+    std::condition_variable m_cv_work;
+    std::condition_variable m_cv_done;
+    std::condition_variable m_cv_space;
+    //! Records waiting for a worker
+    std::deque<std::shared_ptr<BlockImportRecord>> m_work GUARDED_BY(m_mutex);
+    //! Records in file order, waiting for the final stage
+    std::deque<std::shared_ptr<BlockImportRecord>> m_pending GUARDED_BY(m_mutex);
+    size_t m_pending_bytes GUARDED_BY(m_mutex) = 0;
+    bool m_read_done GUARDED_BY(m_mutex) = false;
+    std::string m_read_error GUARDED_BY(m_mutex);
+    std::atomic<bool> m_stop{false};
+
+    std::thread m_thread_read;
+    std::vector<std::thread> m_threads_check;
+
+    void ThreadRead();
+    void ReadFile(FILE* fileIn, const FlatFilePos& pos);
+    void Push(const std::shared_ptr<BlockImportRecord>& record);
+    void ThreadCheck();
+    void CheckRecord(BlockImportRecord& record);
+};
+
+BlockImportPipeline::BlockImportPipeline(const CChainParams& chainparams, NextFileFn next_file, int num_workers)
+    : m_chainparams(chainparams), m_next_file(next_file)
+{
+    for (int i = 0; i < num_workers; ++i) {
+        m_threads_check.emplace_back([this, i] {
+            TraceThread(strprintf("loadblk.%d", i).c_str(), std::bind(&BlockImportPipeline::ThreadCheck, this));
+        });
+    }
+    m_thread_read = std::thread(&TraceThread<std::function<void()>>, "loadblkread",
+                                std::bind(&BlockImportPipeline::ThreadRead, this));
+}
+
+BlockImportPipeline::~BlockImportPipeline()
+{
+    {
+        LOCK(m_mutex);
+        m_stop = true;
+    }
+    m_cv_work.notify_all();
+    m_cv_space.notify_all();
+    m_thread_read.join();
+    for (auto& thread : m_threads_check) {
+        thread.join();
+    }
+}
+
+bool BlockImportPipeline::Next(std::shared_ptr<BlockImportRecord>& record)
+{
+    while (true) {
+        boost::this_thread::interruption_point();
+
+        WAIT_LOCK(m_mutex, lock);
+        if (!m_pending.empty() && m_pending.front()->fDone) {
+            record = m_pending.front();
+            m_pending.pop_front();
+            m_pending_bytes -= record->nSize;
+            m_cv_space.notify_one();
+            return true;
+        }
+        if (m_pending.empty() && m_read_done) {
+            return false;
+        }
+        m_cv_done.wait_for(lock, std::chrono::milliseconds(100));
+    }
+}
+
+void BlockImportPipeline::ThreadRead()
+{
+    ScheduleBatchPriority();
+
+    try {
+        FlatFilePos pos;
+        FILE* file;
+        while (!m_stop && (file = m_next_file(pos)) != nullptr) {
+            ReadFile(file, pos);
+        }
+    } catch (const std::runtime_error& e) {
+        LOCK(m_mutex);
+        m_read_error = e.what();
+    }
+    {
+        LOCK(m_mutex);
+        m_read_done = true;
+    }
+    m_cv_done.notify_all();
+}
+
+void BlockImportPipeline::ReadFile(FILE* fileIn, const FlatFilePos& pos)
+{
+    // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
+    CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
+    uint64_t nRewind = blkdat.GetPos();
+    while (!m_stop) {
+        // Rewind before testing for the end, a damaged record may have been read up to it
+        blkdat.SetPos(nRewind);
+        if (blkdat.eof()) {
+            break;
+        }
+        nRewind++; // start one byte further next time, in case of failure
+        blkdat.SetLimit(); // remove former limit
+        unsigned int nSize = 0;
+        bool fCompressed = false;
+        try {
+            // locate a header
+            unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+            blkdat.FindByte(m_chainparams.MessageStart()[0]);
+            nRewind = blkdat.GetPos()+1;
+            blkdat >> buf;
+            if (memcmp(buf, m_chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
+                continue;
+            // read size
+            blkdat >> nSize;
+            fCompressed = nSize & DISK_RECORD_COMPRESSED;
+            nSize &= ~DISK_RECORD_COMPRESSED;
+            if (nSize < (fCompressed ? DISK_RECORD_HEADER_SIZE : 80) || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                continue;
+        } catch (const std::exception&) {
+            // no valid block header found; don't complain
+            break;
+        }
+        try {
+            // read block
+            uint64_t nBlockPos = blkdat.GetPos();
+            blkdat.SetLimit(nBlockPos + nSize);
+            std::shared_ptr<BlockImportRecord> record = std::make_shared<BlockImportRecord>();
+            record->pos = FlatFilePos(pos.nFile, nBlockPos);
+            record->nSize = nSize;
+            record->block = std::make_shared<CBlock>();
+            if (fCompressed) {
+                std::vector<uint8_t> payload(nSize), data;
+                blkdat.read((char*)payload.data(), nSize);
+                std::string error_str;
+                if (!DecompressDiskRecord(payload.data(), payload.size(), data, error_str)) {
+                    LogPrintf("%s: Compressed block at %d: %s\n", __func__, nBlockPos, error_str);
+                    continue;
+                }
+                VectorReader(SER_DISK, CLIENT_VERSION, data, 0) >> *record->block;
+            } else {
+                blkdat >> *record->block;
+            }
+            nRewind = blkdat.GetPos();
+            Push(record);
+        } catch (const std::exception& e) {
+            LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
+        }
+    }
+}
+
+void BlockImportPipeline::Push(const std::shared_ptr<BlockImportRecord>& record)
+{
+    WAIT_LOCK(m_mutex, lock);
+    m_cv_space.wait(lock, [&] {
+        return m_stop || m_pending.empty() ||
+            (m_pending.size() < IMPORT_READAHEAD_BLOCKS && m_pending_bytes < IMPORT_READAHEAD_BYTES);
+    });
+    if (m_stop) {
+        return;
+    }
+    m_pending.push_back(record);
+    m_pending_bytes += record->nSize;
+    m_work.push_back(record);
+    m_cv_work.notify_one();
+}
+
+void BlockImportPipeline::ThreadCheck()
+{
+    ScheduleBatchPriority();
+    BlindScratchScope scratch;
+
+    while (true) {
+        std::shared_ptr<BlockImportRecord> record;
+        {
+            WAIT_LOCK(m_mutex, lock);
+            m_cv_work.wait(lock, [&] { return m_stop || !m_work.empty(); });
+            if (m_stop) {
+                return;
+            }
+            record = m_work.front();
+            m_work.pop_front();
+        }
+        CheckRecord(*record);
+        {
+            LOCK(m_mutex);
+            record->fDone = true;
+        }
+        m_cv_done.notify_all();
+    }
+}
+
+void BlockImportPipeline::CheckRecord(BlockImportRecord& record)
+{
+    const Consensus::Params& consensusParams = m_chainparams.GetConsensus();
+
+    const CBlock& block = *record.block;
+
+    // Context-free checks, AcceptBlock skips CheckBlock for blocks with fChecked set.
+    // Failures are left for AcceptBlock to report and mark invalid.
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = LookupBlockIndex(block.GetHash());
+        state.m_skip_rangeproof = pindex && IsAssumedValid(pindex, consensusParams);
+    }
+    CheckBlock(block, state, consensusParams);
+}
+} // namespace
+
+static bool ImportBlockFiles(const CChainParams& chainparams, BlockImportPipeline::NextFileFn next_file)
 {
     // Map of disk positions for blocks with unknown parent (only used for reindex)
     static std::multimap<uint256, FlatFilePos> mapBlocksUnknownParent;
@@ -6281,44 +6951,14 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
     fBalancesIndex = gArgs.GetBoolArg("-balancesindex", DEFAULT_BALANCESINDEX);
 
     int nLoaded = 0;
-    try {
-        // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
-        CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
-        uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            boost::this_thread::interruption_point();
-
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(chainparams.MessageStart()[0]);
-                nRewind = blkdat.GetPos()+1;
-                blkdat >> buf;
-                if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
-                    continue;
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
-            }
+    {
+        BlockImportPipeline pipeline(chainparams, next_file, std::max(1, nScriptCheckThreads));
+        std::shared_ptr<BlockImportRecord> record;
+        while (pipeline.Next(record)) {
             try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                blkdat.SetPos(nBlockPos);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                FlatFilePos* dbp = record->pos.IsNull() ? nullptr : &record->pos;
+                std::shared_ptr<CBlock> pblock = record->block;
                 CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
 
                 uint256 hash = block.GetHash();
                 {
@@ -6388,14 +7028,48 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFi
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
         }
-    } catch (const std::runtime_error& e) {
-        AbortNode(std::string("System error: ") + e.what());
+
+        std::string read_error = pipeline.GetReadError();
+        if (!read_error.empty()) {
+            AbortNode(std::string("System error: ") + read_error);
+        }
     }
     if (nLoaded > 0)
         LogPrintf("Loaded %i blocks from external file in %dms\n", nLoaded, GetTimeMillis() - nStart);
     return nLoaded > 0;
 }
 
+bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp)
+{
+    bool fLoaded = ImportBlockFiles(chainparams, [&fileIn, dbp](FlatFilePos& pos) {
+        FILE* file = fileIn;
+        pos = dbp ? FlatFilePos(dbp->nFile, 0) : FlatFilePos();
+        fileIn = nullptr;
+        return file;
+    });
+    if (fileIn) {
+        // Import stopped before the reader took over the file
+        fclose(fileIn);
+    }
+    return fLoaded;
+}
+
+bool ReindexBlockFiles(const CChainParams& chainparams)
+{
+    int nFile = 0;
+    return ImportBlockFiles(chainparams, [&nFile](FlatFilePos& pos) -> FILE* {
+        pos = FlatFilePos(nFile, 0);
+        if (!fs::exists(GetBlockPosFilename(pos)))
+            return nullptr; // No block files left to reindex
+        FILE *file = OpenBlockFile(pos, true);
+        if (!file)
+            return nullptr; // This error is logged in OpenBlockFile
+        LogPrintf("Reindexing block file blk%05u.dat...\n", (unsigned int)nFile);
+        nFile++;
+        return file;
+    });
+}
+
 void CChainState::CheckBlockIndex(const Consensus::Params& consensusParams)
 {
     if (!fCheckBlockIndex) {
@@ -6611,6 +7285,42 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+/** Number of persisted mempool transactions verified in parallel at a time on load */
+static const uint64_t MEMPOOL_LOAD_BATCH = 1000;
+
+/** Verify the context-free proofs and MLSAG signatures of a batch of persisted mempool transactions
+ *  in parallel, sets vValid[i] if both passed for vTxns[i] under the rules at vTimes[i].
+ *  Key images are left to AcceptToMemoryPool, which adds the transactions in order. */
+static void PrevalidateMempoolBatch(const std::vector<CTransactionRef>& vTxns, const std::vector<int64_t>& vTimes, std::vector<char>& vValid, int nHeight, const Consensus::Params& consensus)
+{
+    vValid.assign(vTxns.size(), 0);
+    std::atomic<size_t> nNext(0);
+    auto verify_worker = [&]() {
+        BlindScratchScope scratch;
+        size_t i;
+        while ((i = nNext++) < vTxns.size()) {
+            if (vTimes[i] < 0) {
+                continue; // expired
+            }
+            const CTransaction& tx = *vTxns[i];
+            CValidationState state;
+            state.SetStateInfo(vTimes[i], nHeight, consensus);
+            bool fHasAnonInput = std::any_of(tx.vin.begin(), tx.vin.end(), [](const CTxIn& txin) { return txin.IsAnonInput(); });
+            vValid[i] = CheckTransaction(tx, state)
+                && (!fHasAnonInput || VerifyMLSAG(tx, state, MLSAG_CHECK_SIGNATURES));
+        }
+    };
+
+    size_t nThreads = std::min<size_t>(std::max(nScriptCheckThreads, 1), vTxns.size());
+    std::vector<std::thread> vThreads;
+    for (size_t k = 1; k < nThreads; ++k) {
+        vThreads.emplace_back(verify_worker);
+    }
+    verify_worker();
+    for (auto& t : vThreads) {
+        t.join();
+    }
+}
 
 bool LoadMempool(CTxMemPool& pool)
 {
@@ -6628,6 +7338,7 @@ bool LoadMempool(CTxMemPool& pool)
     int64_t failed = 0;
     int64_t already_there = 0;
     int64_t nNow = GetTime();
+    int64_t nTimeStart = GetTimeMicros();
 
     try {
         uint64_t version;
@@ -6637,25 +7348,47 @@ bool LoadMempool(CTxMemPool& pool)
         }
         uint64_t num;
         file >> num;
-        while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+        while (num) {
+            // Read a batch, verify range proofs across the script check threads,
+            // then add to the pool in file order.
+            size_t nBatch = std::min<uint64_t>(num, MEMPOOL_LOAD_BATCH);
+            num -= nBatch;
+            std::vector<CTransactionRef> vTxns(nBatch);
+            std::vector<int64_t> vTimes(nBatch);
+            for (size_t i = 0; i < nBatch; ++i) {
+                int64_t nTime;
+                int64_t nFeeDelta;
+                file >> vTxns[i];
+                file >> nTime;
+                file >> nFeeDelta;
+
+                CAmount amountdelta = nFeeDelta;
+                if (amountdelta) {
+                    pool.PrioritiseTransaction(vTxns[i]->GetHash(), amountdelta);
+                }
+                vTimes[i] = nTime + nExpiryTimeout > nNow ? nTime : -1;
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
-                                           false /* test_accept */, false /* ignore_locks */);
-                if (state.IsValid()) {
+
+            std::vector<char> vValid;
+            PrevalidateMempoolBatch(vTxns, vTimes, vValid, WITH_LOCK(cs_main, return ::ChainActive().Height()), chainparams.GetConsensus());
+
+            for (size_t i = 0; i < nBatch; ++i) {
+                const CTransactionRef& tx = vTxns[i];
+                if (vTimes[i] < 0) {
+                    ++expired;
+                    continue;
+                }
+                CValidationState state;
+                if (vValid[i]) {
+                    // Proofs and signatures verified above under the same rules
+                    state.m_skip_rangeproof = true;
+                    state.m_skip_mlsag_signatures = true;
+                    LOCK(cs_main);
+                    AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr /* pfMissingInputs */, vTimes[i],
+                                               nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
+                                               false /* test_accept */, false /* ignore_locks */);
+                }
+                if (vValid[i] && state.IsValid()) {
                     ++count;
                 } else {
                     // mempool may contain the transaction already, e.g. from
@@ -6668,8 +7401,6 @@ bool LoadMempool(CTxMemPool& pool)
                         ++failed;
                     }
                 }
-            } else {
-                ++expired;
             }
             if (ShutdownRequested())
                 return false;
@@ -6685,7 +7416,7 @@ bool LoadMempool(CTxMemPool& pool)
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
+    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there, %.2fs\n", count, failed, expired, already_there, 0.000001 * (GetTimeMicros() - nTimeStart));
     return true;
 }
 
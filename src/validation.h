@@ -43,6 +43,8 @@ class CScriptCheck;
 class CBlockPolicyEstimator;
 class CTxMemPool;
 class CValidationState;
+class SnapshotMetadata;
+class StakeSeenTracker;
 struct ChainTxData;
 
 struct DisconnectedBlockTransactions;
@@ -161,8 +163,6 @@ extern CCriticalSection cs_main;
 extern CBlockPolicyEstimator feeEstimator;
 extern CTxMemPool mempool;
 typedef std::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
-extern std::map<COutPoint, uint256> mapStakeSeen;
-extern std::list<COutPoint> listStakeSeen;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
 extern Mutex g_best_block_mutex;
@@ -175,6 +175,8 @@ extern std::atomic_bool fBusyImporting;
 extern int nScriptCheckThreads;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
+/** Write new block and undo records LZ4 compressed. */
+extern bool fCompressBlocks;
 extern bool fCheckpointsEnabled;
 extern size_t nCoinCacheUsage;
 extern bool fVerifyingDB;
@@ -197,6 +199,8 @@ extern CBlockIndex *pindexBestHeader;
 extern bool fHavePruned;
 /** True if we're running in -prune mode. */
 extern bool fPruneMode;
+/** True if the chainstate was loaded from a snapshot, block data below the snapshot base is not available. */
+extern bool fSnapshotChainstate;
 /** Number of MiB of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of ::ChainActive().Tip() will not be pruned. */
@@ -259,6 +263,8 @@ FILE* OpenBlockFile(const FlatFilePos &pos, bool fReadOnly = false);
 fs::path GetBlockPosFilename(const FlatFilePos &pos);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, FlatFilePos *dbp = nullptr);
+/** Reindex the block files from blk00000.dat on, reading ahead across files */
+bool ReindexBlockFiles(const CChainParams& chainparams);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock(const CChainParams& chainparams);
 /** Returns true if the block index needs to be reindexed. */
@@ -420,6 +426,8 @@ void InitScriptExecutionCache();
 bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 bool ReadTransactionFromDiskBlock(const CBlockIndex *pindex, int nIndex, CTransactionRef &txOut);
+/** Read the header of the block at pos and the transaction nTxOffset bytes after it, from plain or compressed records. */
+bool ReadTransactionFromDiskBlock(const FlatFilePos& pos, unsigned int nTxOffset, CBlockHeader& header, CTransactionRef& txOut);
 
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
@@ -428,7 +436,7 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
 /** Functions for validating blocks and updating the block tree */
 
-bool AddToMapStakeSeen(const COutPoint &kernel, const uint256 &blockHash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+bool AddToMapStakeSeen(const COutPoint &kernel, const uint256 &blockHash);
 bool CheckStakeUnused(const COutPoint &kernel);
 bool CheckStakeUnique(const CBlock &block, bool fUpdate=true);
 
@@ -773,6 +781,13 @@ public:
     bool RewindBlockIndex(const CChainParams& params) LOCKS_EXCLUDED(cs_main);
     bool LoadGenesisBlock(const CChainParams& chainparams);
 
+    /**
+     * Replace the chainstate with the snapshot at path, see DumpSnapshot.
+     * The chain tip must be the genesis block and the header of the snapshot base
+     * block must be known. The snapshot hash is checked against chainparams.
+     */
+    bool LoadSnapshot(const fs::path& path, const CChainParams& chainparams, SnapshotMetadata& metadata, std::string& error) LOCKS_EXCLUDED(cs_main);
+
     void PruneBlockIndexCandidates();
 
     void UnloadBlockIndex();
@@ -902,6 +917,7 @@ public:
 
 extern std::map<uint256, StakeConflict> mapStakeConflict;
 extern CoinStakeCache coinStakeCache;
+extern StakeSeenTracker stakeSeen;
 
 DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view);
 bool FlushStateToDisk(const CChainParams& chainParams, CValidationState &state, FlushStateMode mode, int nManualPruneHeight=0);
@@ -5802,8 +5802,7 @@ void CHDWallet::LoadToWallet(CWalletTx& wtxIn)
         int csHeight;
         if (wtxIn.tx->GetCoinStakeHeight(csHeight)
             && csHeight > nBestHeight - (MAX_STAKE_SEEN_SIZE * 1.5)) {
-            // Add to MapStakeSeen to prevent node submitting a block that would be rejected.
-            LOCK(cs_main);
+            // Add to stakeSeen to prevent node submitting a block that would be rejected.
             const COutPoint &kernel = wtxIn.tx->vin[0].prevout;
             uint256 hash = wtxIn.GetHash();
             AddToMapStakeSeen(kernel, hash);
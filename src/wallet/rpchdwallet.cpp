@@ -22,6 +22,7 @@
 #include <txdb.h>
 #include <blind.h>
 #include <anon.h>
+#include <blockcompress.h>
 #include <util/moneystr.h>
 #include <util/validation.h>
 #include <util/translation.h>
@@ -34,10 +35,12 @@
 #include <chainparams.h>
 #include <key/mnemonic.h>
 #include <pos/miner.h>
+#include <pos/stakeseen.h>
 #include <crypto/sha256.h>
 #include <warnings.h>
 #include <shutdown.h>
 #include <txmempool.h>
+#include <index/voteindex.h>
 
 #include <univalue.h>
 #include <boost/thread.hpp>
@@ -4129,7 +4132,7 @@ static UniValue getstakinginfo(const JSONRPCRequest &request)
         LOCK(cs_main);
         nTipTime = ::ChainActive().Tip()->nTime;
         rCoinYearReward = Params().GetCoinYearReward(nTipTime) / CENT;
-        nMoneySupply = ::ChainActive().Tip()->nMoneySupply;
+        nMoneySupply = ::ChainActive().Tip()->Cold().nMoneySupply;
     }
 
     uint64_t nWeight = pwallet->GetStakeWeight();
@@ -6626,8 +6629,7 @@ static UniValue debugwallet(const JSONRPCRequest &request)
     if (clear_stakes_seen) {
         LOCK(cs_main);
         mapStakeConflict.clear();
-        mapStakeSeen.clear();
-        listStakeSeen.clear();
+        stakeSeen.Clear();
         return "Cleared stakes seen.";
     }
 
@@ -7635,7 +7637,8 @@ static UniValue tallyvotes(const JSONRPCRequest &request)
 {
             RPCHelpMan{"tallyvotes",
                 "\nCount votes."
-                "\nStart and end blocks are included in the count.\n",
+                "\nStart and end blocks are included in the count."
+                "\nBlocks are read from the vote index when running with -voteindex.\n",
                 {
                     {"proposal", RPCArg::Type::NUM, RPCArg::Optional::NO, "The proposal id."},
                     {"height_start", RPCArg::Type::NUM, RPCArg::Optional::NO, "The chain starting height, including."},
@@ -7665,50 +7668,14 @@ static UniValue tallyvotes(const JSONRPCRequest &request)
     int nStartHeight = request.params[1].get_int();
     int nEndHeight = request.params[2].get_int();
 
-    CBlock block;
-    const Consensus::Params& consensusParams = Params().GetConsensus();
-
     std::map<int, int> mapVotes;
-    std::pair<std::map<int, int>::iterator, bool> ri;
-
     int nBlocks = 0;
-    CBlockIndex *pindex = ::ChainActive().Tip();
-    if (pindex)
-    do {
-        if (pindex->nHeight < nStartHeight) {
-            break;
-        }
-        if (pindex->nHeight <= nEndHeight) {
-            if (!ReadBlockFromDisk(block, pindex, consensusParams)) {
-                continue;
-            }
-
-            if (block.vtx.size() < 1
-                || !block.vtx[0]->IsCoinStake()) {
-                continue;
-            }
-
-            std::vector<uint8_t> &vData = ((CTxOutData*)block.vtx[0]->vpout[0].get())->vData;
-            if (vData.size() < 9 || vData[4] != DO_VOTE) {
-                ri = mapVotes.insert(std::pair<int, int>(0, 1));
-                if (!ri.second) ri.first->second++;
-            } else {
-                uint32_t voteToken;
-                memcpy(&voteToken, &vData[5], 4);
-                int option = 0; // default to abstain
 
-                // count only if related to current issue:
-                if ((int) (voteToken & 0xFFFF) == issue) {
-                    option = (voteToken >> 16) & 0xFFFF;
-                }
-
-                ri = mapVotes.insert(std::pair<int, int>(option, 1));
-                if (!ri.second) ri.first->second++;
-            }
-
-            nBlocks++;
-        }
-    } while ((pindex = pindex->pprev));
+    if (g_vote_index && g_vote_index->BlockUntilSyncedToCurrentChain()) {
+        nBlocks = g_vote_index->TallyVotes(issue, nStartHeight, nEndHeight, mapVotes);
+    } else {
+        nBlocks = TallyBlockVotes(issue, nStartHeight, nEndHeight, mapVotes);
+    }
 
     UniValue result(UniValue::VOBJ);
     result.pushKV("proposal", issue);
@@ -9139,7 +9106,9 @@ static UniValue verifyrawtransaction(const JSONRPCRequest &request)
                 }
                 std::vector<uint8_t> vchCommitment = ParseHex(s);
                 assert(vchCommitment.size() == 33);
-                memcpy(newcoin.commitment.data, vchCommitment.data(), 33);
+                secp256k1_pedersen_commitment commitment;
+                memcpy(commitment.data, vchCommitment.data(), 33);
+                newcoin.SetCommitment(commitment);
                 newcoin.nType = OUTPUT_CT;
             } else {
                 throw JSONRPCError(RPC_INVALID_PARAMETER, "\"amount\" or \"amount_commitment\" is required");
@@ -9197,8 +9166,12 @@ static UniValue verifyrawtransaction(const JSONRPCRequest &request)
             memcpy(vchAmount.data(), &coin.out.nValue, 8);
         } else
         if (coin.nType == OUTPUT_CT) {
+            if (!coin.GetCommitment()) {
+                TxInErrorToJSON(txin, vErrors, "Input commitment not found");
+                continue;
+            }
             vchAmount.resize(33);
-            memcpy(vchAmount.data(), coin.commitment.data, 33);
+            memcpy(vchAmount.data(), coin.GetCommitment()->data, 33);
         } else {
             throw JSONRPCError(RPC_MISC_ERROR, strprintf("Bad input type: %d", coin.nType));
         }
@@ -9248,6 +9221,7 @@ static bool PruneBlockFile(FILE *fp, bool test_only, size_t &num_blocks_in_file,
         nRewind++; // start one byte further next time, in case of failure
         blkdat.SetLimit(); // remove former limit
         unsigned int nSize = 0;
+        bool fCompressed = false;
         try {
             // locate a header
             unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
@@ -9256,22 +9230,35 @@ static bool PruneBlockFile(FILE *fp, bool test_only, size_t &num_blocks_in_file,
             blkdat >> buf;
             if (memcmp(buf, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE))
                 continue;
-            // read size
+            // read size, decoded as in ReadDiskRecord
             blkdat >> nSize;
-            if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+            fCompressed = nSize & DISK_RECORD_COMPRESSED;
+            nSize &= ~DISK_RECORD_COMPRESSED;
+            if (nSize < (fCompressed ? DISK_RECORD_HEADER_SIZE : 80) || nSize > MAX_BLOCK_SERIALIZED_SIZE)
                 continue;
         } catch (const std::exception&) {
             // no valid block header found; don't complain
             break;
         }
         try {
-            // read block
+            // read block record, kept as stored so compressed blocks stay compressed
             uint64_t nBlockPos = blkdat.GetPos();
             blkdat.SetLimit(nBlockPos + nSize);
             blkdat.SetPos(nBlockPos);
-            std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-            CBlock& block = *pblock;
-            blkdat >> block;
+            std::vector<uint8_t> record(nSize);
+            blkdat.read((char*)record.data(), nSize);
+
+            CBlock block;
+            if (fCompressed) {
+                std::vector<uint8_t> data;
+                std::string error_str;
+                if (!DecompressDiskRecord(record.data(), record.size(), data, error_str)) {
+                    return error("%s: %s\n", __func__, error_str);
+                }
+                VectorReader(SER_DISK, CLIENT_VERSION, data, 0) >> block;
+            } else {
+                VectorReader(SER_DISK, CLIENT_VERSION, record, 0) >> block;
+            }
             uint256 blockhash = block.GetHash();
             nRewind = blkdat.GetPos();
 
@@ -9282,8 +9269,8 @@ static bool PruneBlockFile(FILE *fp, bool test_only, size_t &num_blocks_in_file,
                 num_blocks_removed++;
             } else
             if (!test_only) {
-                fileout << chainparams.MessageStart() << nSize;
-                fileout << block;
+                fileout << chainparams.MessageStart() << (fCompressed ? nSize | DISK_RECORD_COMPRESSED : nSize);
+                fileout.write((const char*)record.data(), record.size());
             }
         } catch (const std::exception& e) {
             return error("%s: Deserialize or I/O error - %s\n", __func__, e.what());
@@ -90,7 +90,7 @@ BOOST_AUTO_TEST_CASE(frozen_blinded_test)
         BOOST_CHECK_NO_THROW(rv = CallRPC("getnewstealthaddress"));
         stealth_address = DecodeDestination(StripQuotes(rv.write()));
     }
-    BOOST_REQUIRE(::ChainActive().Tip()->nMoneySupply == base_supply);
+    BOOST_REQUIRE(::ChainActive().Tip()->Cold().nMoneySupply == base_supply);
 
     std::vector<uint256> txids_unexploited;
     for (size_t i = 0; i < 10; ++i) {
@@ -170,7 +170,7 @@ BOOST_AUTO_TEST_CASE(frozen_blinded_test)
 
     // Set frozen blinded markers
     const CBlockIndex *tip = ::ChainActive().Tip();
-    RegtestParams().GetConsensus_nc().m_frozen_anon_index = tip->nAnonOutputs;
+    RegtestParams().GetConsensus_nc().m_frozen_anon_index = tip->Cold().nAnonOutputs;
     RegtestParams().GetConsensus_nc().m_frozen_blinded_height = tip->nHeight;
 
     BOOST_CHECK_NO_THROW(rv = CallRPC("debugwallet {\"list_frozen_outputs\":true}"));
@@ -185,7 +185,7 @@ BOOST_AUTO_TEST_CASE(frozen_blinded_test)
 
     // Enable HF2
     RegtestParams().GetConsensus_nc().exploit_fix_2_time = tip->nTime + 1;
-    CAmount moneysupply_before_fork = tip->nMoneySupply;
+    CAmount moneysupply_before_fork = tip->Cold().nMoneySupply;
 
     while (GetTime() < tip->nTime + 1) {
         std::this_thread::sleep_for(std::chrono::milliseconds(250));
@@ -267,7 +267,7 @@ BOOST_AUTO_TEST_CASE(frozen_blinded_test)
     CAmount stake_reward = Params().GetProofOfStakeReward(::ChainActive().Tip(), 0);
     StakeNBlocks(pwallet, 1);
 
-    CAmount moneysupply_post_fork = WITH_LOCK(cs_main, return ::ChainActive().Tip()->nMoneySupply);
+    CAmount moneysupply_post_fork = WITH_LOCK(cs_main, return ::ChainActive().Tip()->Cold().nMoneySupply);
     pwallet->GetBalances(balances);
     CAmount balance_before = balances.nPart + balances.nPartStaked;
     CAmount utxo_sum_after_fork = GetUTXOSum();
@@ -451,7 +451,7 @@ BOOST_AUTO_TEST_CASE(frozen_blinded_test)
     StakeNBlocks(pwallet, 1);
 
     pwallet->GetBalances(balances);
-    CAmount moneysupply_before_post_fork_to_blinded = WITH_LOCK(cs_main, return ::ChainActive().Tip()->nMoneySupply);
+    CAmount moneysupply_before_post_fork_to_blinded = WITH_LOCK(cs_main, return ::ChainActive().Tip()->Cold().nMoneySupply);
     BOOST_REQUIRE(moneysupply_before_post_fork_to_blinded == balances.nPart + balances.nPartStaked);
     BOOST_REQUIRE(GetUTXOSum() == moneysupply_before_post_fork_to_blinded);
 
@@ -482,7 +482,7 @@ BOOST_AUTO_TEST_CASE(frozen_blinded_test)
 
 
     pwallet->GetBalances(balances);
-    CAmount moneysupply_after_post_fork_to_blinded = WITH_LOCK(cs_main, return ::ChainActive().Tip()->nMoneySupply);
+    CAmount moneysupply_after_post_fork_to_blinded = WITH_LOCK(cs_main, return ::ChainActive().Tip()->Cold().nMoneySupply);
     CAmount utxosum = GetUTXOSum();
     BOOST_REQUIRE(utxosum + 2100 * COIN == moneysupply_after_post_fork_to_blinded);
     BOOST_REQUIRE(balances.nPart + balances.nPartStaked + 2100 * COIN == moneysupply_after_post_fork_to_blinded);
@@ -594,7 +594,7 @@ BOOST_AUTO_TEST_CASE(frozen_blinded_test)
 
     // Check moneysupply didn't climb more than stakes
     stake_reward = Params().GetProofOfStakeReward(::ChainActive().Tip(), 0);
-    CAmount moneysupply_after_post_fork_blind_spends = WITH_LOCK(cs_main, return ::ChainActive().Tip()->nMoneySupply);
+    CAmount moneysupply_after_post_fork_blind_spends = WITH_LOCK(cs_main, return ::ChainActive().Tip()->Cold().nMoneySupply);
     BOOST_REQUIRE(moneysupply_after_post_fork_to_blinded + stake_reward * 2 ==  moneysupply_after_post_fork_blind_spends);
 
     // Test debugwallet spend_frozen_output
@@ -4,6 +4,7 @@
 
 #include <wallet/test/hdwallet_test_fixture.h>
 
+#include <pos/stakeseen.h>
 #include <rpc/server.h>
 #include <wallet/db.h>
 #include <wallet/hdwallet.h>
@@ -39,8 +40,7 @@ HDWalletTestingSetup::~HDWalletTestingSetup()
     RemoveWallet(pwalletMain);
     pwalletMain.reset();
 
-    mapStakeSeen.clear();
-    listStakeSeen.clear();
+    stakeSeen.Clear();
 
     ECC_Stop_Stealth();
     ECC_Stop_Blinding();
@@ -68,8 +68,7 @@ StakeTestingSetup::~StakeTestingSetup()
     RemoveWallet(pwalletMain);
     pwalletMain.reset();
 
-    mapStakeSeen.clear();
-    listStakeSeen.clear();
+    stakeSeen.Clear();
 
     ECC_Stop_Stealth();
     ECC_Stop_Blinding();
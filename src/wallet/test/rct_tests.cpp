@@ -89,7 +89,7 @@ BOOST_AUTO_TEST_CASE(rct_test)
         BOOST_CHECK_NO_THROW(rv = CallRPC("getnewstealthaddress"));
         stealth_address = DecodeDestination(StripQuotes(rv.write()));
     }
-    BOOST_REQUIRE(::ChainActive().Tip()->nMoneySupply == base_supply);
+    BOOST_REQUIRE(::ChainActive().Tip()->Cold().nMoneySupply == base_supply);
 
     std::vector<uint256> txids_unexploited;
     for (size_t i = 0; i < 10; ++i) {
@@ -442,6 +442,11 @@ BOOST_AUTO_TEST_CASE(rct_test)
     BOOST_REQUIRE(Consensus::CheckTxInputs(tx2, tx_state, tx_view, nSpendHeight, txfee));
     BOOST_REQUIRE(!VerifyMLSAG(tx2, tx_state));
     BOOST_REQUIRE(tx_state.GetRejectReason() == "bad-anonin-dup-ki");
+
+    // Prevalidated txns in a block skip only the signatures, the spent key image is still found
+    BOOST_REQUIRE(!VerifyMLSAG(tx2, tx_state, MLSAG_CHECK_INPUTS));
+    BOOST_REQUIRE(tx_state.GetRejectReason() == "bad-anonin-dup-ki");
+    BOOST_REQUIRE(VerifyMLSAG(tx2, tx_state, MLSAG_CHECK_SIGNATURES));
     }
     }
 
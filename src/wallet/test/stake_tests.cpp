@@ -146,12 +146,12 @@ BOOST_AUTO_TEST_CASE(stake_test)
         const auto bal = pwallet->GetBalance();
         BOOST_REQUIRE(bal.m_mine_trusted == base_supply);
     }
-    BOOST_REQUIRE(::ChainActive().Tip()->nMoneySupply == base_supply);
+    BOOST_REQUIRE(::ChainActive().Tip()->Cold().nMoneySupply == base_supply);
     CAmount stake_reward = Params().GetProofOfStakeReward(::ChainActive().Tip(), 0);
 
     StakeNBlocks(pwallet, 2);
-    BOOST_REQUIRE(::ChainActive().Tip()->nMoneySupply == 12500000079274);
-    BOOST_REQUIRE(::ChainActive().Tip()->nMoneySupply == base_supply + stake_reward * 2);
+    BOOST_REQUIRE(::ChainActive().Tip()->Cold().nMoneySupply == 12500000079274);
+    BOOST_REQUIRE(::ChainActive().Tip()->Cold().nMoneySupply == base_supply + stake_reward * 2);
 
     CBlockIndex *pindexDelete = ::ChainActive().Tip();
     BOOST_REQUIRE(pindexDelete);
@@ -206,7 +206,7 @@ BOOST_AUTO_TEST_CASE(stake_test)
 
     BOOST_CHECK(::ChainActive().Height() == pindexDelete->nHeight - 1);
     BOOST_CHECK(::ChainActive().Tip()->GetBlockHash() == pindexDelete->pprev->GetBlockHash());
-    BOOST_REQUIRE(::ChainActive().Tip()->nMoneySupply == base_supply + stake_reward * 1);
+    BOOST_REQUIRE(::ChainActive().Tip()->Cold().nMoneySupply == base_supply + stake_reward * 1);
 
 
     // Reconnect block
@@ -219,7 +219,7 @@ BOOST_AUTO_TEST_CASE(stake_test)
         CCoinsViewCache &view = ::ChainstateActive().CoinsTip();
         const Coin &coin = view.AccessCoin(txin.prevout);
         BOOST_REQUIRE(coin.IsSpent());
-        BOOST_REQUIRE(::ChainActive().Tip()->nMoneySupply == base_supply + stake_reward * 2);
+        BOOST_REQUIRE(::ChainActive().Tip()->Cold().nMoneySupply == base_supply + stake_reward * 2);
     }
     BOOST_REQUIRE(block.GetHash() == ::ChainActive().Tip()->GetBlockHash());
     {
@@ -319,7 +319,7 @@ BOOST_AUTO_TEST_CASE(stake_test)
             UpdateTip(pindexDelete, chainparams);
 
             BOOST_CHECK(tipHash == ::ChainActive().Tip()->GetBlockHash());
-            BOOST_CHECK(::ChainActive().Tip()->nMoneySupply == 12500000118911);
+            BOOST_CHECK(::ChainActive().Tip()->Cold().nMoneySupply == 12500000118911);
         }
     }
 
@@ -327,7 +327,7 @@ BOOST_AUTO_TEST_CASE(stake_test)
     std::string extaddr = StripQuotes(rv.write());
 
     BOOST_CHECK(pwallet->GetBalance().m_mine_trusted + pwallet->GetStaked() == 12500000108911);
-    BOOST_CHECK(::ChainActive().Tip()->nMoneySupply - nAmountSendAway == 12500000108911);
+    BOOST_CHECK(::ChainActive().Tip()->Cold().nMoneySupply - nAmountSendAway == 12500000108911);
 
 
     {
@@ -347,8 +347,8 @@ BOOST_AUTO_TEST_CASE(stake_test)
         BOOST_CHECK(30 * COIN == pwallet->GetAvailableAnonBalance(&coinControl));
         BOOST_CHECK(30 * COIN == pwallet->GetAvailableBlindBalance(&coinControl));
 
-        BOOST_CHECK(::ChainActive().Tip()->nAnonOutputs == 4);
-        BOOST_CHECK(::ChainActive().Tip()->nMoneySupply == base_supply + stake_reward * 5);
+        BOOST_CHECK(::ChainActive().Tip()->Cold().nAnonOutputs == 4);
+        BOOST_CHECK(::ChainActive().Tip()->Cold().nMoneySupply == base_supply + stake_reward * 5);
 
         for (size_t i = 0; i < 2; ++i) {
             LOCK(cs_main);
@@ -366,8 +366,8 @@ BOOST_AUTO_TEST_CASE(stake_test)
             BOOST_CHECK(prevTipHash == ::ChainActive().Tip()->GetBlockHash());
         }
 
-        BOOST_CHECK(::ChainActive().Tip()->nAnonOutputs == 0);
-        BOOST_CHECK(::ChainActive().Tip()->nMoneySupply == 12500000118911);
+        BOOST_CHECK(::ChainActive().Tip()->Cold().nAnonOutputs == 0);
+        BOOST_CHECK(::ChainActive().Tip()->Cold().nMoneySupply == 12500000118911);
     }
 }
 
@@ -7,7 +7,10 @@
 # Test timestampindex generation and fetching
 #
 
+import http.client
+import json
 import time
+import urllib.parse
 
 from test_framework.test_falcon import FalconTestFramework
 from test_framework.util import connect_nodes, assert_equal
@@ -20,7 +23,7 @@ class TimestampIndexTest(FalconTestFramework):
         self.extra_args = [
             # Nodes 0/1 are "wallet" nodes
             ['-debug',],
-            ['-debug','-timestampindex'],
+            ['-debug','-timestampindex','-rest'],
             # Nodes 2/3 are used for testing
             ['-debug',],
             ['-debug','-timestampindex'],]
@@ -71,6 +74,20 @@ class TimestampIndexTest(FalconTestFramework):
 
         assert_equal(hashes, blockhashes)
 
+        hashes = self.nodes[1].getblockhashes(high, low, {'noOrphans': True, 'logicalTimes': True})
+        assert_equal([h['blockhash'] for h in hashes], blockhashes)
+        assert_equal(hashes[0]['logicalts'], low)
+
+        hashes = self.nodes[1].getblockhashes(high, low + 1)
+        assert_equal(hashes, blockhashes[1:])
+
+        print('Checking REST interface...')
+        url = urllib.parse.urlparse(self.nodes[1].url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request('GET', '/rest/blockhashes/{}/{}/noorphans.json'.format(high, low))
+        rest_hashes = json.loads(conn.getresponse().read().decode('utf-8'))
+        assert_equal([h['blockhash'] for h in rest_hashes], blockhashes)
+
         print('Passed\n')
 
 